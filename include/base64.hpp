@@ -0,0 +1,347 @@
+/**
+ * @file base64.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Base64 / base64url encoder and strict decoder
+ *
+ * Bulk is vectorized (AVX2 or SSSE3, selected at compile time) with the
+ * pshufb lookup of W.Mula and D.Lemire, the tail and the padding are done by scalar code.
+ * Decoder is strict: unknown character, misplaced padding and non zero trailing bits are rejected.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_BASE64_Hpp
+# define  MULT_BASE64_Hpp
+
+# include <array>
+# include <cstring>
+
+# if defined (__AVX2__) || defined (__SSSE3__)
+#  include <immintrin.h>
+# endif
+
+# include "byte_buffer.hpp"
+
+namespace Mult {
+    /** Base64 alphabet .
+     */
+    enum class base64_alphabet {
+        standard, //!< RFC 4648 section 4 "+/"
+        url,      //!< RFC 4648 section 5 "-_"
+    };
+
+    namespace Internal {
+        static constexpr char base64StdTbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        static constexpr char base64UrlTbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+        static constexpr std::int8_t BASE64_INVALID = -1;
+        static constexpr auto make_base64_decode_tbl(const char* alphabet)
+        {
+            std::array<std::int8_t, 256> tbl{};
+            for (auto& x : tbl) x = BASE64_INVALID;
+            for (std::int8_t i = 0; i < 64; ++i) tbl[static_cast<std::uint8_t>(alphabet[i])] = i;
+            return tbl;
+        }
+        static constexpr auto base64StdDecodeTbl = make_base64_decode_tbl(base64StdTbl);
+        static constexpr auto base64UrlDecodeTbl = make_base64_decode_tbl(base64UrlTbl);
+
+# if defined (__SSSE3__)
+        /** 12 bytes (in the low 12 bytes) to 16 sextets in byte lanes .
+         */
+        inline __m128i base64_unpack(__m128i in) noexcept
+        {
+            in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+            auto t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+            auto t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+            return _mm_or_si128(t0, t1);
+        }
+        /** sextets to ASCII .
+         */
+        inline __m128i base64_ascii(__m128i idx, base64_alphabet a) noexcept
+        {
+            const char c62 = (a == base64_alphabet::url) ? '-' : '+';
+            const char c63 = (a == base64_alphabet::url) ? '_' : '/';
+            const auto shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, static_cast<char>(c62 - 62), static_cast<char>(c63 - 63), 'A', 0, 0);
+            auto r = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+            auto less = _mm_cmpgt_epi8(_mm_set1_epi8(26), idx);
+            r = _mm_or_si128(r, _mm_and_si128(less, _mm_set1_epi8(13)));
+            return _mm_add_epi8(_mm_shuffle_epi8(shift, r), idx);
+        }
+        /** Lookup tables for the vector decoder (indexed by the higher nibble) .
+         */
+        struct base64_decode_lut
+        {
+            char lower[16];
+            char upper[16];
+            char shift[16];
+            char special;        //!< the 63rd character which is out of the ranges
+            char special_adjust; //!< adjust for special after shift
+        };
+        inline const base64_decode_lut& base64_lut(base64_alphabet a) noexcept
+        {
+            static constexpr char L = 1; // lower bound for invalid nibble
+            static constexpr char H = 0; // upper bound for invalid nibble
+            static constexpr base64_decode_lut stdLut = {
+                {L, L, 0x2b, 0x30, 0x41, 0x50, 0x61, 0x70, L, L, L, L, L, L, L, L},
+                {H, H, 0x2b, 0x39, 0x4f, 0x5a, 0x6f, 0x7a, H, H, H, H, H, H, H, H},
+                {0, 0, 0x3e - 0x2b, 0x34 - 0x30, 0x00 - 0x41, 0x0f - 0x50, 0x1a - 0x61, 0x29 - 0x70, 0, 0, 0, 0, 0, 0, 0, 0},
+                0x2f, 63 - (0x2f + 0x3e - 0x2b),
+            };
+            static constexpr base64_decode_lut urlLut = {
+                {L, L, 0x2d, 0x30, 0x41, 0x50, 0x61, 0x70, L, L, L, L, L, L, L, L},
+                {H, H, 0x2d, 0x39, 0x4f, 0x5a, 0x6f, 0x7a, H, H, H, H, H, H, H, H},
+                {0, 0, 0x3e - 0x2d, 0x34 - 0x30, 0x00 - 0x41, 0x0f - 0x50, 0x1a - 0x61, 0x29 - 0x70, 0, 0, 0, 0, 0, 0, 0, 0},
+                0x5f, 63 - (0x5f + 0x0f - 0x50),
+            };
+            return (a == base64_alphabet::url) ? urlLut : stdLut;
+        }
+        /** 16 ASCII to 16 sextets .
+         *
+         *  \retval false when invalid character is contained
+         */
+        inline bool base64_sextets(__m128i in, const base64_decode_lut& t, __m128i& out) noexcept
+        {
+            auto hi      = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+            auto lower   = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t.lower)), hi);
+            auto upper   = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t.upper)), hi);
+            auto special = _mm_cmpeq_epi8(in, _mm_set1_epi8(t.special));
+            auto outside = _mm_andnot_si128(special, _mm_or_si128(_mm_cmpgt_epi8(lower, in), _mm_cmpgt_epi8(in, upper)));
+            if (_mm_movemask_epi8(outside)) return false;
+            auto shift = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t.shift)), hi);
+            out = _mm_add_epi8(_mm_add_epi8(in, shift), _mm_and_si128(special, _mm_set1_epi8(t.special_adjust)));
+            return true;
+        }
+        /** 16 sextets to 12 bytes (in the low 12 bytes) .
+         */
+        inline __m128i base64_pack(__m128i v) noexcept
+        {
+            auto ab = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+            auto x  = _mm_madd_epi16(ab, _mm_set1_epi32(0x00011000));
+            return _mm_shuffle_epi8(x, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        }
+# endif
+# if defined (__AVX2__)
+        inline __m256i base64_unpack(__m256i in) noexcept
+        {
+            in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                                         10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+            auto t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+            auto t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+            return _mm256_or_si256(t0, t1);
+        }
+        inline __m256i base64_ascii(__m256i idx, base64_alphabet a) noexcept
+        {
+            const char c62 = (a == base64_alphabet::url) ? '-' : '+';
+            const char c63 = (a == base64_alphabet::url) ? '_' : '/';
+            const auto shift = _mm256_broadcastsi128_si256(
+                _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                              '0' - 52, '0' - 52, '0' - 52, static_cast<char>(c62 - 62), static_cast<char>(c63 - 63), 'A', 0, 0));
+            auto r = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+            auto less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx);
+            r = _mm256_or_si256(r, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+            return _mm256_add_epi8(_mm256_shuffle_epi8(shift, r), idx);
+        }
+        inline bool base64_sextets(__m256i in, const base64_decode_lut& t, __m256i& out) noexcept
+        {
+            auto lut     = [](const char* p) {return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));};
+            auto hi      = _mm256_and_si256(_mm256_srli_epi32(in, 4), _mm256_set1_epi8(0x0f));
+            auto lower   = _mm256_shuffle_epi8(lut(t.lower), hi);
+            auto upper   = _mm256_shuffle_epi8(lut(t.upper), hi);
+            auto special = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(t.special));
+            auto outside = _mm256_andnot_si256(special, _mm256_or_si256(_mm256_cmpgt_epi8(lower, in), _mm256_cmpgt_epi8(in, upper)));
+            if (_mm256_movemask_epi8(outside)) return false;
+            auto shift = _mm256_shuffle_epi8(lut(t.shift), hi);
+            out = _mm256_add_epi8(_mm256_add_epi8(in, shift), _mm256_and_si256(special, _mm256_set1_epi8(t.special_adjust)));
+            return true;
+        }
+        /** 32 sextets to 24 bytes (in the low 24 bytes) .
+         */
+        inline __m256i base64_pack(__m256i v) noexcept
+        {
+            auto ab = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+            auto x  = _mm256_madd_epi16(ab, _mm256_set1_epi32(0x00011000));
+            x = _mm256_shuffle_epi8(x, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+            return _mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        }
+# endif
+    } //<-- namespace Internal ends here.
+
+    /** Encoded length .
+     *
+     *  \param[in] n source length
+     *  \param[in] pad with '=' padding
+     */
+    constexpr size_type base64_encoded_length(size_type n, bool pad = true) noexcept
+    {
+        return (pad) ? ((n + 2) / 3) * 4 : (n / 3) * 4 + ((n % 3) ? (n % 3) + 1 : 0);
+    }
+    /** Maximum decoded length (enough for output buffer) .
+     */
+    constexpr size_type base64_decoded_max_length(size_type n) noexcept
+    {
+        return (n / 4) * 3 + ((n % 4) ? (n % 4) - 1 : 0);
+    }
+    /** Encode to base64 .
+     *
+     *  \param[in] src source
+     *  \param[in] n length of src
+     *  \param[out] dst output, necessary base64_encoded_length(n, pad) rooms
+     *  \param[in] a alphabet
+     *  \param[in] pad with '=' padding
+     *  \retval written length
+     */
+    inline auto base64_encode(const char* src, size_type n, char* dst, base64_alphabet a = base64_alphabet::standard, bool pad = true) noexcept -> size_type
+    {
+        auto s = reinterpret_cast<const std::uint8_t*>(src);
+        auto e = s + n;
+        auto d = dst;
+# if defined (__AVX2__)
+        for (; e - s >= 28; s += 24, d += 32) { // two 16 bytes loads, 12 bytes are used in each lane
+            auto in = _mm256_set_m128i(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 12)),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), Internal::base64_ascii(Internal::base64_unpack(in), a));
+        }
+# endif
+# if defined (__SSSE3__)
+        for (; e - s >= 16; s += 12, d += 16) {
+            auto in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d), Internal::base64_ascii(Internal::base64_unpack(in), a));
+        }
+# endif
+        const char* tbl = (a == base64_alphabet::url) ? Internal::base64UrlTbl : Internal::base64StdTbl;
+        for (; e - s >= 3; s += 3, d += 4) {
+            std::uint32_t v = (std::uint32_t{s[0]} << 16) | (std::uint32_t{s[1]} << 8) | s[2];
+            d[0] = tbl[(v >> 18) & 0x3f];
+            d[1] = tbl[(v >> 12) & 0x3f];
+            d[2] = tbl[(v >>  6) & 0x3f];
+            d[3] = tbl[v & 0x3f];
+        }
+        if (e - s == 2) {
+            std::uint32_t v = (std::uint32_t{s[0]} << 16) | (std::uint32_t{s[1]} << 8);
+            *d++ = tbl[(v >> 18) & 0x3f];
+            *d++ = tbl[(v >> 12) & 0x3f];
+            *d++ = tbl[(v >>  6) & 0x3f];
+            if (pad) *d++ = '=';
+        } else if (e - s == 1) {
+            std::uint32_t v = std::uint32_t{s[0]} << 16;
+            *d++ = tbl[(v >> 18) & 0x3f];
+            *d++ = tbl[(v >> 12) & 0x3f];
+            if (pad) {*d++ = '='; *d++ = '=';}
+        }
+        return static_cast<size_type>(d - dst);
+    }
+    /** Decode from base64 (strict) .
+     *
+     *  \param[in] src base64 text
+     *  \param[in] n length of src
+     *  \param[out] dst output, necessary base64_decoded_max_length(n) rooms
+     *  \param[in] a alphabet
+     *  \param[in] pad true: padding is required (length must be multiple of 4), false: padding is rejected
+     *  \retval decoded length
+     *  \retval error_type(FAIL_ARG) invalid character, bad padding, bad length or non zero trailing bits
+     */
+    inline auto base64_decode(const char* src, size_type n, char* dst, base64_alphabet a = base64_alphabet::standard, bool pad = true) noexcept -> Result<size_type>
+    {
+        using result = Result<size_type>;
+        // split off the last (maybe partial or padded) quantum
+        size_type tail = 0;
+        if (pad) {
+            if (n % 4) return result(error_type(FAIL_ARG));
+            tail = (n) ? 4 : 0;
+        } else {
+            if (n % 4 == 1) return result(error_type(FAIL_ARG));
+            tail = (n % 4) ? n % 4 : ((n) ? 4 : 0);
+        }
+        auto s = reinterpret_cast<const std::uint8_t*>(src);
+        auto e = s + (n - tail);
+        auto d = reinterpret_cast<std::uint8_t*>(dst);
+# if defined (__AVX2__)
+        const auto& lut = Internal::base64_lut(a);
+        for (; e - s >= 48; s += 32, d += 24) { // keep 16 more characters, 8 bytes garbage is overwritten by the next
+            __m256i v;
+            if (! Internal::base64_sextets(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(s)), lut, v)) break;
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), Internal::base64_pack(v));
+        }
+# elif defined (__SSSE3__)
+        const auto& lut = Internal::base64_lut(a);
+# endif
+# if defined (__SSSE3__)
+        for (; e - s >= 24; s += 16, d += 12) { // keep 8 more characters, 4 bytes garbage is overwritten by the next
+            __m128i v;
+            if (! Internal::base64_sextets(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s)), lut, v)) break;
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d), Internal::base64_pack(v));
+        }
+# endif
+        const auto& tbl = (a == base64_alphabet::url) ? Internal::base64UrlDecodeTbl : Internal::base64StdDecodeTbl;
+        for (; s != e; s += 4, d += 3) {
+            auto c0 = tbl[s[0]], c1 = tbl[s[1]], c2 = tbl[s[2]], c3 = tbl[s[3]];
+            if ((c0 | c1 | c2 | c3) < 0) return result(error_type(FAIL_ARG));
+            std::uint32_t v = (std::uint32_t(c0) << 18) | (std::uint32_t(c1) << 12) | (std::uint32_t(c2) << 6) | std::uint32_t(c3);
+            d[0] = static_cast<std::uint8_t>(v >> 16);
+            d[1] = static_cast<std::uint8_t>(v >> 8);
+            d[2] = static_cast<std::uint8_t>(v);
+        }
+        // last quantum
+        if (tail) {
+            size_type chars = tail;
+            if (pad) {
+                if (s[3] == '=') chars = (s[2] == '=') ? 2 : 3;
+            }
+            if (chars < 2) return result(error_type(FAIL_ARG));
+            std::uint32_t v = 0;
+            for (size_type i = 0; i < chars; ++i) {
+                auto c = tbl[s[i]];
+                if (c < 0) return result(error_type(FAIL_ARG));
+                v |= std::uint32_t(c) << (18 - 6 * i);
+            }
+            // trailing bits must be zero (canonical encoding)
+            if ((chars == 2 && (v & 0xffff)) || (chars == 3 && (v & 0xff))) return result(error_type(FAIL_ARG));
+            *d++ = static_cast<std::uint8_t>(v >> 16);
+            if (chars > 2) *d++ = static_cast<std::uint8_t>(v >> 8);
+            if (chars > 3) *d++ = static_cast<std::uint8_t>(v);
+        }
+        return result(static_cast<size_type>(reinterpret_cast<char*>(d) - dst));
+    }
+
+    /** ByteBuffer to base64 (append to dst) .
+     *
+     * dst is grown at once when it has not enough rooms
+     *  \param[in] src source
+     *  \param[inout] dst output
+     *  \param[in] a alphabet
+     *  \param[in] pad with '=' padding
+     *  \retval OK encoded
+     */
+    inline auto base64Encode(const ByteBuffer& src, ByteBuffer& dst, base64_alphabet a = base64_alphabet::standard, bool pad = true) noexcept -> return_code
+    {
+        auto l = base64_encoded_length(src.size(), pad);
+        auto w = base64_encode(src.const_ptr(), src.size(), dst.prepare(l), a, pad);
+        return dst.commit(w);
+    }
+    /** base64 to ByteBuffer (append to dst) .
+     *
+     * dst is grown at once when it has not enough rooms, nothing is appended on error
+     *  \param[in] src base64 text
+     *  \param[inout] dst output
+     *  \param[in] a alphabet
+     *  \param[in] pad padding is required or rejected
+     *  \retval OK decoded
+     *  \retval FAIL_ARG src is not valid base64
+     */
+    inline auto base64Decode(const ByteBuffer& src, ByteBuffer& dst, base64_alphabet a = base64_alphabet::standard, bool pad = true) noexcept -> return_code
+    {
+        auto l = base64_decoded_max_length(src.size());
+        auto r = base64_decode(src.const_ptr(), src.size(), dst.prepare(l), a, pad);
+        if (! r) return r.error();
+        return dst.commit(r.value());
+    }
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_BASE64_Hpp ends here.
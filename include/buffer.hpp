@@ -14,6 +14,7 @@
 #ifndef BUFFER_Hpp
 # define  BUFFER_Hpp
 # define MULT_TRACE 1
+# include <span>
 # include "debug.hpp"
 # include "result.hpp"
 # include "storage.hpp"
@@ -87,7 +88,7 @@ namespace Mult {
          */
         auto append(const_pointer pv, size_type n) noexcept
         {
-            if (super::overflow()) super::resize();
+            grow(n);
             super::copy(pv, pv + n);
             return OK;
         }
@@ -97,8 +98,7 @@ namespace Mult {
          */
         auto append(const BufferBase& cr) noexcept
         {
-            auto n = cr.size();
-            if (super::overflow(n)) super::resize();
+            grow(cr.size());
             super::copy(cr.const_begin(), cr.const_end());
             return OK;
         }
@@ -125,6 +125,30 @@ namespace Mult {
             super::copy(cr.const_begin(), cr.const_end());
             return OK;
         }
+        /** Prepare rooms at tail for direct writing .
+         *
+         * Writer fills the rooms through the returned pointer and then calls commit()
+         * \note When buffer has not enough rooms, then resizing occur
+         *  \param[in] n number of rooms which will be written
+         *  \retval pointer of tail
+         */
+        auto prepare(size_type n) noexcept -> pointer
+        {
+            grow(n);
+            return super::m_tail;
+        }
+        /** Commit contents written through prepare() .
+         *
+         *  \param[in] n number of written contents
+         *  \retval OK tail moved
+         *  \retval OUT_OF_RANGE n is over capacity
+         */
+        auto commit(size_type n) noexcept -> return_code
+        {
+            if (super::overflow(n)) return OUT_OF_RANGE;
+            super::update_tail(n);
+            return OK;
+        }
         /** Push back 1 object (const value_type&).
          *
          * Append 1 object at storage tail
@@ -178,6 +202,22 @@ namespace Mult {
             return *this;
         }
 
+        /** View of contents (no copy) .
+         *
+         * \note invalidated by resizing
+         */
+        auto span() noexcept -> std::span<value_type>
+        {
+            return std::span<value_type>(super::m_head, super::size());
+        }
+        /** View of contents (const, no copy) .
+         *
+         * \note invalidated by resizing
+         */
+        auto const_span() const noexcept -> std::span<const value_type>
+        {
+            return std::span<const value_type>(super::m_head, super::size());
+        }
         /** []access .
          *
          * auto y = x[i]
@@ -262,6 +302,16 @@ namespace Mult {
             return dest;
         }
     private:
+        /** Make rooms for n more content(s) .
+         *
+         * grow twice or to the required size (which is bigger)
+         */
+        auto grow(size_type n) noexcept -> void
+        {
+            if (! super::overflow(n)) return;
+            auto req = super::size() + n;
+            super::resize((super::capacity() * 2 < req) ? req : super::capacity() * 2);
+        }
         size_type m_read = ZERO; //!< index for read storage
     }; //<-- class BufferBase ends here.
 //    using ByteBuffer = BufferBase<size_type N, char>;
@@ -15,7 +15,11 @@
 #ifndef MULT_BUFFER_Hpp
 # define  MULT_BUFFER_Hpp
 
+# include <string>
+# include <string_view>
+
 # include "buffer.hpp"
+# include "hex_dump.hpp"
 
 namespace Mult {
     /**  .
@@ -25,61 +29,110 @@ namespace Mult {
     using ByteBuffer = BufferBase<char>;
     /** ByteBuffer to std::string .
      *
-     *
+     * copy, use to_string_view() when a view is enough
      */
-    std::string to_string(const ByteBuffer& b)
+    inline std::string to_string(const ByteBuffer& b)
     {
         return std::string(b.const_ptr(), b.size());
     }
-    /** std::string to ByteBuffer .
+    /** ByteBuffer to std::string_view .
      *
+     * no copy, invalidated by resizing or destruction of b
+     */
+    inline std::string_view to_string_view(const ByteBuffer& b) noexcept
+    {
+        return std::string_view(b.const_ptr(), b.size());
+    }
+    /** std::string to ByteBuffer .
      *
+     * copy
      */
-    ByteBuffer from_string(const std::string& s)
+    inline ByteBuffer from_string(const std::string& s)
     {
         auto b = ByteBuffer(s.size());
         b.copy_from(s.data(), s.size());
         return b;
     }
-
-    /** ByteBuffer to string in hex dump  .
+    /** std::string to ByteBuffer (adopt) .
      *
+     * The string is moved into the buffer's keeper and its characters are refered without copy.
+     * The buffer is full (capacity() == size()), appending copies to own rooms once.
+     */
+    inline ByteBuffer from_string(std::string&& s)
+    {
+        if (s.empty()) return ByteBuffer(ZERO); // nothing to refer, no empty keeper
+        auto keeper = std::make_shared<std::string>(std::move(s));
+        auto p = keeper->data();
+        auto n = keeper->size();
+        return ByteBuffer(ByteBuffer::released{p, n, n, std::move(keeper)});
+    }
+
+    /** Sink to ByteBuffer (append to tail) .
      *
+     * usable for hex_dump_to / xxd_dump_to / readable_ctrl_code_to
      */
-    inline std::string hexDump(ByteBuffer& t)
+    class BufferSink
     {
-        std::string d(0x0, t.capacity());
-        for (auto x : t) {
-            d.append(Debug::hexChar256Tbl[(static_cast<std::uint8_t>(x)) & 0xff]);
+    public:
+        explicit BufferSink(ByteBuffer& b) noexcept : m_buffer(b) {}
+        return_code operator()(const char* p, size_type n) noexcept
+        {
+            return m_buffer.append(p, n);
         }
+    private:
+        ByteBuffer& m_buffer;
+    }; //<-- class BufferSink ends here.
+
+    /** ByteBuffer to sink in hex dump .
+     *
+     *  \param[in] t dump target
+     *  \param[inout] sink output (MemorySink, FdSink, StreamSink, BufferSink or any callable)
+     */
+    template <typename Sink>
+    inline auto hexDump(const ByteBuffer& t, Sink&& sink) -> return_code
+    {
+        return hex_dump_to(t.const_ptr(), t.size(), std::forward<Sink>(sink));
+    }
+    /** ByteBuffer to sink in xxd style (offset, hex and ASCII column) .
+     *
+     *  \param[in] t dump target
+     *  \param[inout] sink output
+     *  \param[in] offset printed offset of the first byte
+     */
+    template <typename Sink>
+    inline auto xxdDump(const ByteBuffer& t, Sink&& sink, std::uint64_t offset = 0) -> return_code
+    {
+        return xxd_dump_to(t.const_ptr(), t.size(), std::forward<Sink>(sink), offset);
+    }
+    /** ByteBuffer to string in hex dump  .
+     *
+     * string is allocated only once (size() * 2)
+     */
+    inline std::string hexDump(const ByteBuffer& t)
+    {
+        std::string d(t.size() * 2, '\0');
+        Internal::hex_encode(t.const_ptr(), t.size(), d.data());
         return d;
     }
-    /** ByteBuffer to string in human readable .
+    /** ByteBuffer to sink in human readable .
      *
+     *  \param[in] s target
+     *  \param[inout] sink output
+     */
+    template <typename Sink>
+    inline auto toReadableCtrlCode(const ByteBuffer& s, Sink&& sink) -> return_code
+    {
+        return readable_ctrl_code_to(s.const_ptr(), s.size(), std::forward<Sink>(sink));
+    }
+    /** ByteBuffer to string in human readable .
      *
+     * string is allocated only once (exact length is counted first)
      */
-    inline std::string toReadableCtrlCode(ByteBuffer& s)
+    inline std::string toReadableCtrlCode(const ByteBuffer& s)
     {
-        std::string d{};
-        std::string t;
-        for (auto c : s) {
-            auto x = (static_cast<size_type>(c)) & 0xff;
-            if (x < 0x20) {
-                d += Debug::ctrlCharTbl[x];
-            } else if (x == 0x20) {
-                d.append("[SPC]");
-            } else if (x == 0x7f) {
-                d.append("[DEL]");
-            } else if (x > 0x7f) {
-                if (x == 0xff) {
-                    d.append("[EOF]");
-                } else {
-                    d.append(Debug::ctrlCharTbl[x - 0x60]);
-                }
-            } else {
-                d.push_back(x);
-            }
-        }
+        std::string d;
+        d.reserve(readable_ctrl_code_length(s.const_ptr(), s.size()));
+        readable_ctrl_code_to(s.const_ptr(), s.size(), [&d](const char* p, size_type n) -> return_code {d.append(p, n); return OK;});
         return d;
     } //<-- function toReadableCtrlCode ends here.
 } //<-- namespace Mult ends here.
@@ -0,0 +1,270 @@
+/**
+ * @file byte_order.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Endian aware unaligned typed access for ByteBuffer
+ *
+ * Values are moved by memcpy (one unaligned load/store, no strict-aliasing issue)
+ * and swapped by bswap when the requested byte order is not native.
+ * ByteView checks the range once for a whole header, the members never check again.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_BYTE_ORDER_Hpp
+# define  MULT_BYTE_ORDER_Hpp
+
+# include <bit>
+# include <cstring>
+# include <span>
+# include <type_traits>
+
+# if defined (__AVX2__) || defined (__SSSE3__)
+#  include <immintrin.h>
+# endif
+
+# include "byte_buffer.hpp"
+# include "result.hpp"
+
+namespace Mult {
+    /** Requirement for load/store value (integral, floating point and enum of 1, 2, 4, 8 bytes) .
+     */
+    template <typename T>
+    using is_byte_order_requirement = std::bool_constant<
+        (std::is_integral_v<T> || std::is_floating_point_v<T> || std::is_enum_v<T>)
+        && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)>;
+
+    namespace Internal {
+        template <size_type N> struct uint_of;
+        template <> struct uint_of<1> {using type = std::uint8_t;};
+        template <> struct uint_of<2> {using type = std::uint16_t;};
+        template <> struct uint_of<4> {using type = std::uint32_t;};
+        template <> struct uint_of<8> {using type = std::uint64_t;};
+        template <typename T> using uint_of_t = typename uint_of<sizeof(T)>::type;
+
+        template <typename U>
+        constexpr U bswap(U v) noexcept
+        {
+            if constexpr (sizeof(U) == 1) return v;
+            else if constexpr (sizeof(U) == 2) return __builtin_bswap16(v);
+            else if constexpr (sizeof(U) == 4) return __builtin_bswap32(v);
+            else return __builtin_bswap64(v);
+        }
+    } //<-- namespace Internal ends here.
+
+    /** Reverse byte order of v .
+     */
+    template <typename T>
+    constexpr T byte_swap(T v) noexcept
+    {
+        static_assert(is_byte_order_requirement<T>::value, "T must be integral, floating point or enum of 1, 2, 4 or 8 bytes");
+        using U = Internal::uint_of_t<T>;
+        return std::bit_cast<T>(Internal::bswap(std::bit_cast<U>(v)));
+    }
+    /** Load T stored in byte order E from unaligned address .
+     *
+     * no range check
+     */
+    template <typename T, std::endian E>
+    inline T load_unaligned(const void* src) noexcept
+    {
+        static_assert(is_byte_order_requirement<T>::value, "T must be integral, floating point or enum of 1, 2, 4 or 8 bytes");
+        using U = Internal::uint_of_t<T>;
+        U u;
+        std::memcpy(&u, src, sizeof(U));
+        if constexpr (E != std::endian::native) u = Internal::bswap(u);
+        return std::bit_cast<T>(u);
+    }
+    /** Store v in byte order E to unaligned address .
+     *
+     * no range check
+     */
+    template <typename T, std::endian E>
+    inline void store_unaligned(void* dst, T v) noexcept
+    {
+        static_assert(is_byte_order_requirement<T>::value, "T must be integral, floating point or enum of 1, 2, 4 or 8 bytes");
+        auto u = std::bit_cast<Internal::uint_of_t<T>>(v);
+        if constexpr (E != std::endian::native) u = Internal::bswap(u);
+        std::memcpy(dst, &u, sizeof(u));
+    }
+
+    namespace Internal {
+# if defined (__AVX2__) || defined (__SSSE3__)
+        /** pshufb control for reversing each S bytes lane .
+         */
+        template <size_type S>
+        inline __m128i bswap_mask() noexcept
+        {
+            alignas(16) std::uint8_t m[16];
+            for (size_type i = 0; i < 16; ++i) m[i] = static_cast<std::uint8_t>((i / S) * S + (S - 1 - i % S));
+            return _mm_load_si128(reinterpret_cast<const __m128i*>(m));
+        }
+# endif
+        template <size_type S>
+        inline void bulk_bswap(const char* src, char* dst, size_type n) noexcept
+        {
+            size_type i = 0;
+            auto bytes = n * S;
+# if defined (__AVX2__)
+            auto mask = _mm256_broadcastsi128_si256(bswap_mask<S>());
+            for (; i + 32 <= bytes; i += 32) {
+                auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(v, mask));
+            }
+# endif
+# if defined (__AVX2__) || defined (__SSSE3__)
+            auto mask16 = bswap_mask<S>();
+            for (; i + 16 <= bytes; i += 16) {
+                auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(v, mask16));
+            }
+# endif
+            using U = typename uint_of<S>::type;
+            for (; i < bytes; i += S) {
+                U u;
+                std::memcpy(&u, src + i, S);
+                u = bswap(u);
+                std::memcpy(dst + i, &u, S);
+            }
+        }
+    } //<-- namespace Internal ends here.
+
+    /** Reverse byte order of n elements from src into dst .
+     *
+     * src and dst may be the same array (in place), must not overlap otherwise.
+     */
+    template <typename T>
+    inline void bulk_byteswap(const T* src, T* dst, size_type n) noexcept
+    {
+        static_assert(is_byte_order_requirement<T>::value, "T must be integral, floating point or enum of 1, 2, 4 or 8 bytes");
+        if constexpr (sizeof(T) == 1) {
+            if (src != dst) std::memmove(dst, src, n);
+        } else {
+            Internal::bulk_bswap<sizeof(T)>(reinterpret_cast<const char*>(src), reinterpret_cast<char*>(dst), n);
+        }
+    }
+    template <typename T>
+    inline void bulk_byteswap(std::span<T> v) noexcept {bulk_byteswap(v.data(), v.data(), v.size());}
+
+    /** Range checked window of bytes .
+     *
+     * made by view(), members are not checked again (MULT_ASSERT only).
+     */
+    class ByteView
+    {
+    public:
+        constexpr ByteView() noexcept = default;
+        constexpr ByteView(const char* p, size_type n) noexcept : m_ptr(p), m_size(n) {}
+        template <typename T, std::endian E>
+        T load(size_type offset) const noexcept
+        {
+            MULT_ASSERT(offset + sizeof(T) <= m_size, "ByteView::load out of range", true);
+            return load_unaligned<T, E>(m_ptr + offset);
+        }
+        /** Load n elements into dst with bulk byte swap .
+         */
+        template <typename T, std::endian E>
+        void load(size_type offset, T* dst, size_type n) const noexcept
+        {
+            MULT_ASSERT(offset + sizeof(T) * n <= m_size, "ByteView::load out of range", true);
+            if constexpr (E == std::endian::native) std::memcpy(dst, m_ptr + offset, sizeof(T) * n);
+            else Internal::bulk_bswap<sizeof(T)>(m_ptr + offset, reinterpret_cast<char*>(dst), n);
+        }
+        constexpr auto data() const noexcept {return m_ptr;}
+        constexpr auto size() const noexcept {return m_size;}
+    private:
+        const char* m_ptr = nullptr;
+        size_type m_size = 0;
+    }; //<-- class ByteView ends here.
+
+    /** Range checked writable window of bytes .
+     */
+    class MutableByteView
+    {
+    public:
+        constexpr MutableByteView() noexcept = default;
+        constexpr MutableByteView(char* p, size_type n) noexcept : m_ptr(p), m_size(n) {}
+        template <typename T, std::endian E>
+        T load(size_type offset) const noexcept
+        {
+            MULT_ASSERT(offset + sizeof(T) <= m_size, "MutableByteView::load out of range", true);
+            return load_unaligned<T, E>(m_ptr + offset);
+        }
+        template <typename T, std::endian E>
+        void store(size_type offset, T v) noexcept
+        {
+            MULT_ASSERT(offset + sizeof(T) <= m_size, "MutableByteView::store out of range", true);
+            store_unaligned<T, E>(m_ptr + offset, v);
+        }
+        /** Store n elements from src with bulk byte swap .
+         */
+        template <typename T, std::endian E>
+        void store(size_type offset, const T* src, size_type n) noexcept
+        {
+            MULT_ASSERT(offset + sizeof(T) * n <= m_size, "MutableByteView::store out of range", true);
+            if constexpr (E == std::endian::native) std::memcpy(m_ptr + offset, src, sizeof(T) * n);
+            else Internal::bulk_bswap<sizeof(T)>(reinterpret_cast<const char*>(src), m_ptr + offset, n);
+        }
+        constexpr auto data() const noexcept {return m_ptr;}
+        constexpr auto size() const noexcept {return m_size;}
+    private:
+        char* m_ptr = nullptr;
+        size_type m_size = 0;
+    }; //<-- class MutableByteView ends here.
+
+    /** Check range [offset, offset + length) of valid data once .
+     *
+     *  \retval ByteView
+     *  \retval OUT_OF_RANGE range is over size()
+     */
+    inline Result<ByteView> view(const ByteBuffer& b, size_type offset, size_type length) noexcept
+    {
+        if (offset > b.size() || length > b.size() - offset) return Result<ByteView>(error_type(OUT_OF_RANGE));
+        return Result<ByteView>(ByteView(b.const_ptr() + offset, length));
+    }
+    inline Result<MutableByteView> mutable_view(ByteBuffer& b, size_type offset, size_type length) noexcept
+    {
+        if (offset > b.size() || length > b.size() - offset) return Result<MutableByteView>(error_type(OUT_OF_RANGE));
+        return Result<MutableByteView>(MutableByteView(b.ptr() + offset, length));
+    }
+    /** Load one value from valid data .
+     *
+     *  \retval value
+     *  \retval OUT_OF_RANGE offset + sizeof(T) is over size()
+     */
+    template <typename T, std::endian E>
+    inline Result<T> load(const ByteBuffer& b, size_type offset) noexcept
+    {
+        if (offset > b.size() || sizeof(T) > b.size() - offset) return Result<T>(error_type(OUT_OF_RANGE));
+        return Result<T>(load_unaligned<T, E>(b.const_ptr() + offset));
+    }
+    /** Overwrite one value in valid data .
+     *
+     *  \retval OK
+     *  \retval OUT_OF_RANGE offset + sizeof(T) is over size()
+     */
+    template <typename T, std::endian E>
+    inline return_code store(ByteBuffer& b, size_type offset, T v) noexcept
+    {
+        if (offset > b.size() || sizeof(T) > b.size() - offset) return OUT_OF_RANGE;
+        store_unaligned<T, E>(b.ptr() + offset, v);
+        return OK;
+    }
+    /** Append one value in byte order E .
+     */
+    template <typename T, std::endian E>
+    inline return_code store_back(ByteBuffer& b, T v) noexcept
+    {
+        auto p = b.prepare(sizeof(T));
+        if (! p) return NO_RESOURCE;
+        store_unaligned<T, E>(p, v);
+        return b.commit(sizeof(T));
+    }
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_BYTE_ORDER_Hpp ends here.
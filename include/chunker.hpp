@@ -0,0 +1,233 @@
+/**
+ * @file chunker.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Content defined chunking (FastCDC) for ByteBuffer
+ *
+ * Gear rolling hash with normalized chunking (level 2) : a cut point is searched from min_size
+ * with a harder mask until avg_size and with an easier mask after it, a chunk never exceeds max_size.
+ * The hash rolls 2 bytes per step, mask bits exclude bit 63 so the result is same as 1 byte rolling.
+ * Cut points depend only on contents, not on how the stream is appended.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_CHUNKER_Hpp
+# define  MULT_CHUNKER_Hpp
+
+# include <cstring>
+# include <string_view>
+# include <type_traits>
+
+# include "byte_buffer.hpp"
+# include "sha256.hpp"
+
+namespace Mult {
+    /** Chunk size options [byte] .
+     */
+    struct cdc_options
+    {
+        size_type min_size    {2048};
+        size_type avg_size    {8192};
+        size_type max_size    {65536};
+        bool      fingerprint {true}; //!< compute SHA-256 of each chunk
+    };
+    /** Emitted chunk .
+     *
+     * data refers to the scanned buffer (no copy), valid until the buffer is modified
+     */
+    struct chunk
+    {
+        size_type        offset;      //!< offset in whole stream
+        std::string_view data;
+        sha256_digest    fingerprint; //!< zero when cdc_options::fingerprint is false
+    };
+    /** Sink requirement, return other than OK stops scanning .
+     */
+    template <typename S>
+    using is_chunk_sink_requirement = std::is_invocable_r<return_code, S&, const chunk&>;
+
+    namespace Internal {
+        struct gear_table
+        {
+            std::uint64_t v[256];
+            std::uint64_t shifted[256]; //!< v << 1 (for 2 bytes rolling)
+        };
+        constexpr gear_table make_gear_table() noexcept
+        {
+            gear_table t{};
+            std::uint64_t x = 0x6d756c745f636463ULL; // fixed seed, cut points must be stable
+            for (int i = 0; i < 256; ++i) { // splitmix64
+                x += 0x9e3779b97f4a7c15ULL;
+                auto z = x;
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                t.v[i] = z ^ (z >> 31);
+                t.shifted[i] = t.v[i] << 1;
+            }
+            return t;
+        }
+        static constexpr gear_table gearTbl = make_gear_table();
+        /** k one bits just below bit 63 .
+         */
+        constexpr std::uint64_t cdc_mask(int k) noexcept {return ((std::uint64_t(1) << k) - 1) << (63 - k);}
+    } //<-- namespace Internal ends here.
+
+    /** Streaming content defined chunker .
+     *
+     * The scanned ByteBuffer may grow by append() between update() calls, already scanned bytes are not scanned again.
+     * @code
+     * Chunker c;
+     * ByteBuffer b;
+     * while (read_some(b)) {      // append to b
+     *     c.update(b, sink);
+     *     c.compact(b);           // drop emitted chunks from b (optional)
+     * }
+     * c.finish(b, sink);
+     * @endcode
+     */
+    class Chunker
+    {
+    public:
+        explicit Chunker(const cdc_options& opt = cdc_options{}) noexcept : m_options(opt)
+        {
+            if (m_options.avg_size < 64) m_options.avg_size = 64;
+            if (m_options.min_size > m_options.avg_size) m_options.min_size = m_options.avg_size;
+            if (m_options.max_size < m_options.avg_size) m_options.max_size = m_options.avg_size;
+            int bits = 0;
+            while ((size_type(2) << bits) <= m_options.avg_size) ++bits;
+            m_mask_s = Internal::cdc_mask(bits + 2);
+            m_mask_l = Internal::cdc_mask(bits - 2);
+        }
+        /** Emit chunks completed in b .
+         *
+         *  \retval OK
+         *  \retval other sink result
+         */
+        template <typename Sink>
+        return_code update(const ByteBuffer& b, Sink&& sink)
+        {
+            static_assert(is_chunk_sink_requirement<std::remove_reference_t<Sink>>::value, "Sink must be callable as return_code(const chunk&)");
+            auto p = reinterpret_cast<const std::uint8_t*>(b.const_ptr());
+            auto n = b.size();
+            while (m_start < n) {
+                auto len = cut(p + m_start, n - m_start);
+                if (len == 0) break;
+                auto rc = emit(b, len, sink);
+                if (rc != OK) return rc;
+            }
+            return OK;
+        }
+        /** Emit last chunk (end of stream) and reset for the next stream .
+         */
+        template <typename Sink>
+        return_code finish(const ByteBuffer& b, Sink&& sink)
+        {
+            auto rc = update(b, sink);
+            if (rc == OK && m_start < b.size()) rc = emit(b, b.size() - m_start, sink);
+            reset();
+            return rc;
+        }
+        void reset() noexcept
+        {
+            m_start = 0;
+            m_scan = 0;
+            m_hash = 0;
+            m_stream = 0;
+        }
+        /** Offset in the buffer of the first byte not emitted yet .
+         */
+        size_type pending() const noexcept {return m_start;}
+        /** First n bytes of the buffer were removed by the caller .
+         *
+         *  \retval OK
+         *  \retval OUT_OF_RANGE n is over pending()
+         */
+        return_code rebase(size_type n) noexcept
+        {
+            if (n > m_start) return OUT_OF_RANGE;
+            m_start -= n;
+            m_stream += n;
+            return OK;
+        }
+        /** Move not emitted bytes to the head of b .
+         */
+        void compact(ByteBuffer& b) noexcept
+        {
+            if (m_start == 0) return;
+            auto rest = b.size() - m_start;
+            std::memmove(b.ptr(), b.const_ptr() + m_start, rest);
+            b.clear();
+            b.commit(rest);
+            rebase(m_start);
+        }
+        const cdc_options& options() const noexcept {return m_options;}
+    private:
+        /** Search cut point from p (chunk head) .
+         *
+         *  \retval chunk length
+         *  \retval 0 need more data (scan state is kept)
+         */
+        size_type cut(const std::uint8_t* p, size_type n) noexcept
+        {
+            const auto& g = Internal::gearTbl;
+            auto limit = (n < m_options.max_size) ? n : m_options.max_size;
+            auto i = (m_scan < m_options.min_size) ? m_options.min_size : m_scan;
+            auto h = m_hash;
+            auto normal = (limit < m_options.avg_size) ? limit : m_options.avg_size;
+            auto found = [&](std::uint64_t mask, size_type end) -> bool {
+                for (; i + 2 <= end; i += 2) {
+                    h = (h << 2) + g.shifted[p[i]];
+                    if (! (h & (mask << 1))) {h >>= 1; ++i; return true;}
+                    h += g.v[p[i + 1]];
+                    if (! (h & mask)) {i += 2; return true;}
+                }
+                if (i < end) {
+                    h = (h << 1) + g.v[p[i]];
+                    ++i;
+                    if (! (h & mask)) return true;
+                }
+                return false;
+            };
+            if (found(m_mask_s, normal) || found(m_mask_l, limit) || limit == m_options.max_size) {
+                m_scan = 0;
+                m_hash = 0;
+                return i;
+            }
+            m_scan = i;
+            m_hash = h;
+            return 0;
+        }
+        template <typename Sink>
+        return_code emit(const ByteBuffer& b, size_type len, Sink& sink)
+        {
+            chunk c{m_stream + m_start, std::string_view(b.const_ptr() + m_start, len), {}};
+            if (m_options.fingerprint) c.fingerprint = sha256(c.data.data(), len);
+            m_start += len;
+            return sink(static_cast<const chunk&>(c));
+        }
+        cdc_options   m_options;
+        std::uint64_t m_mask_s {0}; //!< before avg_size (harder)
+        std::uint64_t m_mask_l {0}; //!< after avg_size (easier)
+        size_type     m_start  {0}; //!< head of open chunk in buffer
+        size_type     m_scan   {0}; //!< scanned length of open chunk
+        std::uint64_t m_hash   {0};
+        size_type     m_stream {0}; //!< stream offset of buffer head
+    }; //<-- class Chunker ends here.
+
+    /** Chunk whole buffer .
+     */
+    template <typename Sink>
+    inline return_code chunkBuffer(const ByteBuffer& b, Sink&& sink, const cdc_options& opt = cdc_options{})
+    {
+        Chunker c(opt);
+        return c.finish(b, std::forward<Sink>(sink));
+    }
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_CHUNKER_Hpp ends here.
@@ -0,0 +1,393 @@
+/**
+ * @file column_codec.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Integer column compression for StorageBase<uint32_t/uint64_t>
+ *
+ * The column is cut into blocks of 256 integers, each block is decodable alone (block index).
+ * - delta_bitpack  : lane strided delta (v[i] - v[i - L]) + frame of reference bit packing
+ * - delta_of_delta : lane strided delta of delta + bit packing (regular timestamps pack to ~0 bit)
+ * - stream_vbyte   : 1..4 bytes per value with 2 bits length in separated control bytes (uint32 only)
+ * L is the number of lanes of 256 bit vector (8 for uint32, 4 for uint64) so that prefix sums
+ * run vertically, and the packed words are interleaved by lane (format is same for any ISA).
+ * Decoder uses AVX2 (bit packing) and SSSE3 (stream-vbyte) when compiled with them, otherwise scalar.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_COLUMN_CODEC_Hpp
+# define  MULT_COLUMN_CODEC_Hpp
+
+# include <array>
+# include <bit>
+# include <cstdint>
+# include <cstring>
+# include <memory>
+# include <type_traits>
+# include <utility>
+# include <vector>
+
+# if defined (__AVX2__) || defined (__SSSE3__)
+#  include <immintrin.h>
+# endif
+
+# include "byte_buffer.hpp"
+# include "result.hpp"
+# include "storage.hpp"
+
+namespace Mult {
+    enum class column_codec : std::uint8_t {
+        delta_bitpack,
+        delta_of_delta,
+        stream_vbyte,
+    };
+    template <typename T>
+    using is_column_value_requirement = std::disjunction<std::is_same<T, std::uint32_t>, std::is_same<T, std::uint64_t>>;
+
+    namespace Internal {
+        static constexpr size_type COLUMN_BLOCK = 256;
+        /** Lane operations of 256 bit vector (scalar version) .
+         */
+        template <typename U>
+        struct column_lanes
+        {
+            static constexpr size_type L = 32 / sizeof(U);
+            struct vec {U v[L];};
+            static vec load(const U* p) noexcept {vec r; std::memcpy(r.v, p, sizeof(r.v)); return r;}
+            static void store(U* p, const vec& a) noexcept {std::memcpy(p, a.v, sizeof(a.v));}
+            static vec set1(U x) noexcept {vec r; for (auto& e : r.v) e = x; return r;}
+            static vec zero() noexcept {return set1(0);}
+            static vec add(const vec& a, const vec& b) noexcept {vec r; for (size_type l = 0; l < L; ++l) r.v[l] = a.v[l] + b.v[l]; return r;}
+            static vec band(const vec& a, const vec& b) noexcept {vec r; for (size_type l = 0; l < L; ++l) r.v[l] = a.v[l] & b.v[l]; return r;}
+            static vec bor(const vec& a, const vec& b) noexcept {vec r; for (size_type l = 0; l < L; ++l) r.v[l] = a.v[l] | b.v[l]; return r;}
+            static vec srl(const vec& a, int n) noexcept {vec r; for (size_type l = 0; l < L; ++l) r.v[l] = a.v[l] >> n; return r;}
+            static vec sll(const vec& a, int n) noexcept {vec r; for (size_type l = 0; l < L; ++l) r.v[l] = a.v[l] << n; return r;}
+        };
+# if defined (__AVX2__)
+        template <>
+        struct column_lanes<std::uint32_t>
+        {
+            static constexpr size_type L = 8;
+            using vec = __m256i;
+            static vec load(const std::uint32_t* p) noexcept {return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));}
+            static void store(std::uint32_t* p, vec a) noexcept {_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a);}
+            static vec set1(std::uint32_t x) noexcept {return _mm256_set1_epi32(static_cast<int>(x));}
+            static vec zero() noexcept {return _mm256_setzero_si256();}
+            static vec add(vec a, vec b) noexcept {return _mm256_add_epi32(a, b);}
+            static vec band(vec a, vec b) noexcept {return _mm256_and_si256(a, b);}
+            static vec bor(vec a, vec b) noexcept {return _mm256_or_si256(a, b);}
+            static vec srl(vec a, int n) noexcept {return _mm256_srl_epi32(a, _mm_cvtsi32_si128(n));}
+            static vec sll(vec a, int n) noexcept {return _mm256_sll_epi32(a, _mm_cvtsi32_si128(n));}
+        };
+        template <>
+        struct column_lanes<std::uint64_t>
+        {
+            static constexpr size_type L = 4;
+            using vec = __m256i;
+            static vec load(const std::uint64_t* p) noexcept {return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));}
+            static void store(std::uint64_t* p, vec a) noexcept {_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a);}
+            static vec set1(std::uint64_t x) noexcept {return _mm256_set1_epi64x(static_cast<long long>(x));}
+            static vec zero() noexcept {return _mm256_setzero_si256();}
+            static vec add(vec a, vec b) noexcept {return _mm256_add_epi64(a, b);}
+            static vec band(vec a, vec b) noexcept {return _mm256_and_si256(a, b);}
+            static vec bor(vec a, vec b) noexcept {return _mm256_or_si256(a, b);}
+            static vec srl(vec a, int n) noexcept {return _mm256_srl_epi64(a, _mm_cvtsi32_si128(n));}
+            static vec sll(vec a, int n) noexcept {return _mm256_sll_epi64(a, _mm_cvtsi32_si128(n));}
+        };
+# endif
+        /** Unpack 256 values of B bits and accumulate (Order 1 : delta, 2 : delta of delta) .
+         *
+         * in  : B x L words, word k of lane l at in[k * L + l]
+         * out : value j * L + l is bit j * B of lane l
+         */
+        template <typename U, int Order, int B>
+        inline void column_unpack(const U* in, U* out, const U* prev, const U* step, U ref) noexcept
+        {
+            using O = column_lanes<U>;
+            constexpr int W = sizeof(U) * 8;
+            constexpr auto L = O::L;
+            auto v = O::load(prev);
+            auto d = O::load(step);
+            const auto r = O::set1(ref);
+            const auto mask = O::set1(static_cast<U>((B < W) ? (U(1) << (B % W)) - 1 : ~U(0)));
+            for (int j = 0, bit = 0; j < W; ++j, bit += B) {
+                auto x = r;
+                if constexpr (B != 0) {
+                    auto k = bit / W;
+                    auto sh = bit % W;
+                    auto w = O::srl(O::load(in + k * L), sh);
+                    if (sh + B > W) w = O::bor(w, O::sll(O::load(in + (k + 1) * L), W - sh));
+                    x = O::add(x, O::band(w, mask));
+                }
+                if constexpr (Order == 2) {
+                    d = O::add(d, x);
+                    v = O::add(v, d);
+                } else {
+                    v = O::add(v, x);
+                }
+                O::store(out + j * L, v);
+            }
+        }
+        template <typename U, int Order>
+        using column_unpack_fn = void (*)(const U*, U*, const U*, const U*, U);
+        template <typename U, int Order, int... B>
+        constexpr auto make_column_unpackers(std::integer_sequence<int, B...>) noexcept
+        {
+            return std::array<column_unpack_fn<U, Order>, sizeof...(B)>{&column_unpack<U, Order, B>...};
+        }
+        template <typename U, int Order>
+        static constexpr auto columnUnpackers = make_column_unpackers<U, Order>(std::make_integer_sequence<int, sizeof(U) * 8 + 1>{});
+
+        /** Stream-vbyte tables (control byte -> shuffle / data length) .
+         */
+        struct svb_tables
+        {
+            std::uint8_t shuffle[256][16];
+            std::uint8_t length[256];
+        };
+        constexpr svb_tables make_svb_tables() noexcept
+        {
+            svb_tables t{};
+            for (int c = 0; c < 256; ++c) {
+                int src = 0;
+                for (int k = 0; k < 4; ++k) {
+                    int len = ((c >> (2 * k)) & 3) + 1;
+                    for (int b = 0; b < 4; ++b) t.shuffle[c][k * 4 + b] = (b < len) ? static_cast<std::uint8_t>(src + b) : 0x80;
+                    src += len;
+                }
+                t.length[c] = static_cast<std::uint8_t>(src);
+            }
+            return t;
+        }
+        alignas(16) static constexpr svb_tables svbTbl = make_svb_tables();
+        /** Decode 256 values (data is readable 16 bytes over its end) .
+         *
+         *  \retval end of data
+         */
+        inline const std::uint8_t* svb_decode(const std::uint8_t* ctrl, const std::uint8_t* data, std::uint32_t* out) noexcept
+        {
+            for (size_type g = 0; g < COLUMN_BLOCK / 4; ++g) {
+                auto c = ctrl[g];
+# if defined (__SSSE3__)
+                auto in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+                auto m = _mm_load_si128(reinterpret_cast<const __m128i*>(svbTbl.shuffle[c]));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + g * 4), _mm_shuffle_epi8(in, m));
+# else
+                auto p = data;
+                for (int k = 0; k < 4; ++k) {
+                    int len = ((c >> (2 * k)) & 3) + 1;
+                    std::uint32_t v = 0;
+                    for (int b = 0; b < len; ++b) v |= std::uint32_t(p[b]) << (8 * b);
+                    out[g * 4 + k] = v;
+                    p += len;
+                }
+# endif
+                data += svbTbl.length[c];
+            }
+            return data;
+        }
+    } //<-- namespace Internal ends here.
+
+    /** Compressed integer column .
+     *
+     * @code
+     * StorageBase<std::uint64_t> ts = ...;
+     * CompressedColumn<std::uint64_t> c;
+     * c.encode(ts, column_codec::delta_of_delta);
+     * auto all = c.decode();              // StorageBase<std::uint64_t>
+     * std::uint64_t blk[CompressedColumn<std::uint64_t>::BLOCK];
+     * auto n = c.decode_block(10, blk);   // values 2560 .. 2560 + n - 1
+     * @endcode
+     */
+    template <typename T>
+    class CompressedColumn
+    {
+        static_assert(is_column_value_requirement<T>::value, "T must be std::uint32_t or std::uint64_t");
+        using O = Internal::column_lanes<T>;
+        using S = std::make_signed_t<T>;
+        static constexpr size_type L = O::L;
+        static constexpr size_type HEADER = 3 * sizeof(T) + 1; //!< base, step, reference, width
+        static constexpr size_type TAIL_PAD = 16;              //!< stream-vbyte decoder reads 16 bytes at once
+    public:
+        static constexpr size_type BLOCK = Internal::COLUMN_BLOCK;
+        CompressedColumn() noexcept : m_data(ZERO) {}
+        /** Compress n values .
+         *
+         *  \retval OK
+         *  \retval FAIL_ARG stream_vbyte for uint64_t
+         */
+        auto encode(const T* p, size_type n, column_codec codec) -> return_code
+        {
+            if (codec == column_codec::stream_vbyte && sizeof(T) != 4) return FAIL_ARG;
+            m_data = ByteBuffer(n / 2 + BLOCK);
+            m_blocks.clear();
+            m_size = n;
+            m_codec = codec;
+            T v[BLOCK];
+            for (size_type at = 0; at < n; at += BLOCK) {
+                auto c = (n - at < BLOCK) ? n - at : BLOCK;
+                std::memcpy(v, p + at, c * sizeof(T));
+                for (auto i = c; i < BLOCK; ++i) v[i] = (i >= 2) ? 2 * v[i - 1] - v[i - 2] : v[0]; // keep the trend
+                m_blocks.push_back(m_data.size());
+                if (codec == column_codec::stream_vbyte) encode_svb(v);
+                else encode_packed(v, c, codec == column_codec::delta_of_delta ? 2 : 1);
+            }
+            std::memset(m_data.prepare(TAIL_PAD), 0, TAIL_PAD);
+            m_data.commit(TAIL_PAD);
+            return OK;
+        }
+        auto encode(const StorageBase<T>& s, column_codec codec) -> return_code {return encode(s.const_ptr(), s.size(), codec);}
+        /** Decode block b .
+         *
+         *  \param[out] out rooms of BLOCK values
+         *  \retval number of values in the block (0 when b is out of range)
+         */
+        auto decode_block(size_type b, T* out) const noexcept -> size_type
+        {
+            if (b >= m_blocks.size()) return 0;
+            auto p = reinterpret_cast<const std::uint8_t*>(m_data.const_ptr()) + m_blocks[b];
+            if constexpr (sizeof(T) == 4) {
+                if (m_codec == column_codec::stream_vbyte) {
+                    Internal::svb_decode(p, p + BLOCK / 4, out);
+                    return count(b);
+                }
+            }
+            T base, step, ref;
+            std::memcpy(&base, p, sizeof(T));
+            std::memcpy(&step, p + sizeof(T), sizeof(T));
+            std::memcpy(&ref, p + 2 * sizeof(T), sizeof(T));
+            auto width = p[3 * sizeof(T)];
+            T prev[L], d[L];
+            initial(base, step, prev, d);
+            auto words = reinterpret_cast<const T*>(p + HEADER); // unaligned, read by memcpy/loadu only
+            if (m_codec == column_codec::delta_of_delta) Internal::columnUnpackers<T, 2>[width](words, out, prev, d, ref);
+            else Internal::columnUnpackers<T, 1>[width](words, out, prev, d, ref);
+            return count(b);
+        }
+        /** Decode all values .
+         *
+         *  \param[out] out rooms of size() values
+         */
+        auto decode(T* out) const noexcept -> size_type
+        {
+            auto full = m_size / BLOCK;
+            for (size_type b = 0; b < full; ++b) decode_block(b, out + b * BLOCK);
+            if (full < m_blocks.size()) {
+                T tmp[BLOCK];
+                auto c = decode_block(full, tmp);
+                std::memcpy(out + full * BLOCK, tmp, c * sizeof(T));
+            }
+            return m_size;
+        }
+        /** Decode all values into new storage (no copy) .
+         */
+        auto decode() const -> StorageBase<T>
+        {
+            if (m_size == 0) return StorageBase<T>(ZERO);
+            auto a = std::make_shared_for_overwrite<T[]>(m_size); // owned from the start
+            auto p = a.get();
+            decode(p);
+            return StorageBase<T>(typename StorageBase<T>::released{p, m_size, m_size,
+                                  typename StorageBase<T>::keeper_type(std::move(a), static_cast<void*>(p))});
+        }
+        /** Value at index i (decodes its block) .
+         *
+         *  \retval value
+         *  \retval OUT_OF_RANGE i is over size()
+         */
+        auto at(size_type i) const noexcept -> Result<T>
+        {
+            if (i >= m_size) return Result<T>(error_type(OUT_OF_RANGE));
+            T tmp[BLOCK];
+            decode_block(i / BLOCK, tmp);
+            return Result<T>(tmp[i % BLOCK]);
+        }
+        auto size() const noexcept -> size_type {return m_size;}
+        auto block_count() const noexcept -> size_type {return m_blocks.size();}
+        auto codec() const noexcept -> column_codec {return m_codec;}
+        /** Bytes of compressed data and block index .
+         */
+        auto compressed_size() const noexcept -> size_type {return m_data.size() + m_blocks.size() * sizeof(size_type);}
+    private:
+        auto count(size_type b) const noexcept -> size_type {return (m_size - b * BLOCK < BLOCK) ? m_size - b * BLOCK : BLOCK;}
+        /** Lanes before the block (linear ramp ending at base) .
+         */
+        static void initial(T base, T step, T* prev, T* d) noexcept
+        {
+            for (size_type l = 0; l < L; ++l) {
+                prev[l] = base - static_cast<T>(L - l) * step;
+                d[l] = static_cast<T>(L) * step;
+            }
+        }
+        void encode_packed(const T* v, size_type c, int order)
+        {
+            T base = v[0];
+            T step = (c > 1) ? v[1] - v[0] : 0;
+            T prev[L], d[L], x[BLOCK];
+            initial(base, step, prev, d);
+            for (size_type i = 0; i < BLOCK; ++i) {
+                auto l = i % L;
+                T cur = v[i] - prev[l];
+                x[i] = (order == 2) ? cur - d[l] : cur;
+                d[l] = cur;
+                prev[l] = v[i];
+            }
+            auto lo = static_cast<S>(x[0]), hi = lo;
+            for (auto e : x) {
+                auto s = static_cast<S>(e);
+                if (s < lo) lo = s;
+                if (s > hi) hi = s;
+            }
+            T ref = static_cast<T>(lo);
+            int width = std::bit_width(static_cast<T>(static_cast<T>(hi) - ref));
+            constexpr int W = sizeof(T) * 8;
+            auto bytes = HEADER + width * L * sizeof(T);
+            auto p = m_data.prepare(bytes);
+            std::memset(p, 0, bytes);
+            std::memcpy(p, &base, sizeof(T));
+            std::memcpy(p + sizeof(T), &step, sizeof(T));
+            std::memcpy(p + 2 * sizeof(T), &ref, sizeof(T));
+            p[3 * sizeof(T)] = static_cast<char>(width);
+            if (width != 0) {
+                std::vector<T> words(width * L, 0);
+                for (size_type j = 0; j < BLOCK / L; ++j) {
+                    auto bit = static_cast<int>(j) * width;
+                    auto k = static_cast<size_type>(bit / W);
+                    auto sh = bit % W;
+                    for (size_type l = 0; l < L; ++l) {
+                        T e = x[j * L + l] - ref;
+                        words[k * L + l] |= e << sh;
+                        if (sh + width > W) words[(k + 1) * L + l] |= e >> (W - sh);
+                    }
+                }
+                std::memcpy(p + HEADER, words.data(), words.size() * sizeof(T));
+            }
+            m_data.commit(bytes);
+        }
+        void encode_svb(const T* v)
+        {
+            auto p = reinterpret_cast<std::uint8_t*>(m_data.prepare(BLOCK / 4 + BLOCK * 4));
+            auto ctrl = p;
+            auto data = p + BLOCK / 4;
+            std::memset(ctrl, 0, BLOCK / 4);
+            for (size_type i = 0; i < BLOCK; ++i) {
+                auto e = static_cast<std::uint32_t>(v[i]);
+                int len = (e < (1u << 8)) ? 1 : (e < (1u << 16)) ? 2 : (e < (1u << 24)) ? 3 : 4;
+                ctrl[i / 4] |= static_cast<std::uint8_t>((len - 1) << (2 * (i % 4)));
+                for (int b = 0; b < len; ++b) *data++ = static_cast<std::uint8_t>(e >> (8 * b));
+            }
+            m_data.commit(static_cast<size_type>(data - p));
+        }
+        ByteBuffer             m_data;
+        std::vector<size_type> m_blocks;          //!< offset of each block in m_data
+        size_type              m_size  {0};
+        column_codec           m_codec {column_codec::delta_bitpack};
+    }; //<-- class CompressedColumn ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_COLUMN_CODEC_Hpp ends here.
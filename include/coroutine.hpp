@@ -0,0 +1,594 @@
+/**
+ * @file coroutine.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief C++20 coroutine Task<T> (Result<T>), Scheduler and awaitables (Signal, timers, fd readiness, AsyncQueue)
+ *
+ * Scheduler runs coroutines on the calling thread (run()) or on a ThreadPool. Timers live in a
+ * TimerWheel and fd readiness in epoll, both served by one reactor (the run() loop, or a reactor
+ * thread in pool mode). Coroutine frames are allocated from per thread free lists.
+ * Linux only (epoll, eventfd).
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_COROUTINE_Hpp
+# define  MULT_COROUTINE_Hpp
+
+# include <atomic>
+# include <cerrno>
+# include <chrono>
+# include <coroutine>
+# include <cstdint>
+# include <deque>
+# include <exception>
+# include <mutex>
+# include <optional>
+# include <set>
+# include <condition_variable>
+# include <thread>
+# include <type_traits>
+# include <utility>
+# include <vector>
+
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+# include <unistd.h>
+
+# include "mult.hpp"
+# include "result.hpp"
+# include "signal.hpp"
+# include "thread_pool.hpp"
+# include "timer_wheel.hpp"
+# include "internal/block_pool.hpp"
+
+namespace Mult {
+    template <typename T> class Task;
+
+    namespace Internal {
+        /** Resumes the awaiting coroutine when a Task finishes (symmetric transfer) .
+         */
+        struct task_final_awaiter
+        {
+            auto await_ready() const noexcept -> bool {return false;}
+            template <typename P>
+            auto await_suspend(std::coroutine_handle<P> h) noexcept -> std::coroutine_handle<>
+            {
+                auto c = h.promise().continuation;
+                return c ? c : std::noop_coroutine();
+            }
+            void await_resume() const noexcept {}
+        };
+        /** Common part of Task promises, frames come from block_pool .
+         */
+        template <typename T>
+        struct task_promise_base : pooled
+        {
+            auto initial_suspend() const noexcept -> std::suspend_always {return {};}
+            auto final_suspend() const noexcept -> task_final_awaiter {return {};}
+            void unhandled_exception() noexcept {result.emplace(error_type(FAILURE));}
+            std::coroutine_handle<>  continuation;
+            std::optional<Result<T>> result;
+        };
+        template <typename T>
+        struct task_promise : task_promise_base<T>
+        {
+            auto get_return_object() noexcept -> Task<T>;
+            void return_value(T v) {this->result.emplace(std::move(v));}
+            void return_value(Result<T> r) {this->result.emplace(std::move(r));}
+        };
+        template <>
+        struct task_promise<void> : task_promise_base<void>
+        {
+            auto get_return_object() noexcept -> Task<void>;
+            void return_void() noexcept {this->result.emplace();}
+        };
+        /** Self destroying coroutine used by spawn() / run() .
+         */
+        struct detached
+        {
+            struct promise_type : pooled
+            {
+                auto get_return_object() noexcept -> detached {return {std::coroutine_handle<promise_type>::from_promise(*this)};}
+                auto initial_suspend() const noexcept -> std::suspend_always {return {};}
+                auto final_suspend() const noexcept -> std::suspend_never {return {};}
+                void return_void() noexcept {}
+                void unhandled_exception() noexcept {}
+            };
+            std::coroutine_handle<promise_type> handle;
+        };
+    } //<-- namespace Internal ends here.
+
+    /** Lazy coroutine producing Result<T> .
+     *
+     * Starts when awaited (or spawned), co_return T or Result<T>, an escaping exception becomes FAILURE.
+     * @code
+     * auto fetch(Scheduler& s, int fd) -> Task<std::size_t>
+     * {
+     *     auto r = co_await s.readable(fd, std::chrono::seconds(1));   // Result<void>, TIMEOUT
+     *     if (! r) co_return Result<std::size_t>(r.error_info());
+     *     co_return static_cast<std::size_t>(::read(fd, buf, sizeof(buf)));
+     * }
+     * auto n = co_await fetch(s, fd);                                // Result<std::size_t>
+     * @endcode
+     */
+    template <typename T>
+    class Task
+    {
+    public:
+        using promise_type = Internal::task_promise<T>;
+        using handle_type  = std::coroutine_handle<promise_type>;
+        using result_type  = Result<T>;
+        Task() noexcept = default;
+        explicit Task(handle_type h) noexcept : m_handle(h) {}
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+        Task(Task&& rhs) noexcept : m_handle(std::exchange(rhs.m_handle, {})) {}
+        Task& operator=(Task&& rhs) noexcept
+        {
+            if (this != &rhs) {
+                if (m_handle) m_handle.destroy();
+                m_handle = std::exchange(rhs.m_handle, {});
+            }
+            return *this;
+        }
+        ~Task() {if (m_handle) m_handle.destroy();}
+        auto valid() const noexcept -> bool {return static_cast<bool>(m_handle);}
+        auto done() const noexcept -> bool {return m_handle && m_handle.done();}
+        /** Run this task in the awaiting coroutine, resumes it with the Result .
+         */
+        auto operator co_await() && noexcept
+        {
+            struct awaiter
+            {
+                handle_type h;
+                auto await_ready() const noexcept -> bool {return ! h || h.done();}
+                auto await_suspend(std::coroutine_handle<> c) noexcept -> std::coroutine_handle<>
+                {
+                    h.promise().continuation = c;
+                    return h;
+                }
+                auto await_resume() -> result_type
+                {
+                    if (! h || ! h.promise().result) return result_type(error_type(FAIL_ARG));
+                    return std::move(*h.promise().result);
+                }
+            };
+            return awaiter{m_handle};
+        }
+        auto operator co_await() & noexcept {return std::move(*this).operator co_await();}
+    private:
+        handle_type m_handle;
+    }; //<-- class Task ends here.
+
+    namespace Internal {
+        template <typename T>
+        auto task_promise<T>::get_return_object() noexcept -> Task<T> {return Task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));}
+        inline auto task_promise<void>::get_return_object() noexcept -> Task<void> {return Task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));}
+        /** Reactor side of an awaitable (timer, fd, or both) .
+         */
+        struct io_waiter
+        {
+            std::coroutine_handle<> handle;
+            timer_id                timer = 0;
+            int                     fd = -1;
+            return_code             status = OK;
+        };
+    } //<-- namespace Internal ends here.
+
+    /** Coroutine scheduler .
+     *
+     * Single thread mode: Scheduler s; s.run(main_task(s)); // drives everything on this thread
+     * Pool mode: Scheduler s(pool); resumptions are pool jobs, a reactor thread serves timers and fds.
+     * Destroy the scheduler only after every coroutine waiting on it has finished.
+     */
+    class Scheduler final
+    {
+    public:
+        using clock    = TimerWheel::clock;
+        using duration = TimerWheel::duration;
+        /** Single thread scheduler (drive with run()) .
+         *
+         *  \param[in] tick timer resolution
+         */
+        explicit Scheduler(duration tick = std::chrono::milliseconds(1)) : m_wheel(tick) {open();}
+        /** Scheduler resuming coroutines on pool .
+         */
+        explicit Scheduler(ThreadPool& pool, duration tick = std::chrono::milliseconds(1)) : m_pool(&pool), m_wheel(tick)
+        {
+            open();
+            m_reactor = std::thread([this] {while (! m_stop.load(std::memory_order_acquire)) react(-1);});
+        }
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+        ~Scheduler()
+        {
+            m_stop.store(true, std::memory_order_release);
+            wake();
+            if (m_reactor.joinable()) m_reactor.join();
+            if (m_epoll >= 0) ::close(m_epoll);
+            if (m_event >= 0) ::close(m_event);
+        }
+        /** Make h ready (any thread) .
+         */
+        auto post(std::coroutine_handle<> h) -> void
+        {
+            if (m_pool) {
+                if (m_pool->post([h] {h.resume();}) != OK) h.resume(); // pool stopped
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> l(m_guard);
+                m_ready.push_back(h);
+            }
+            if (m_pool || ! on_loop()) wake();
+        }
+        /** Start task, its frame is freed when it finishes .
+         */
+        template <typename T>
+        auto spawn(Task<T> t) -> void {post(detach(std::move(t)).handle);}
+        /** Run task to completion and return its Result .
+         *
+         * Single thread mode drives the scheduler on this thread until the task is done,
+         * pool mode blocks this thread (do not call from a pool worker).
+         */
+        template <typename T>
+        auto run(Task<T> t) -> Result<T>
+        {
+            run_state<T> st;
+            post(finish(std::move(t), st).handle);
+            if (m_pool) {
+                std::unique_lock<std::mutex> l(st.guard);
+                st.monitor.wait(l, [&] {return st.done;});
+            } else {
+                m_loop.store(std::this_thread::get_id(), std::memory_order_relaxed);
+                while (! st.finished()) {
+                    if (! drain()) react(-1);
+                }
+                drain(); // continuations posted by the last step
+                m_loop.store(std::thread::id(), std::memory_order_relaxed);
+            }
+            return std::move(*st.out);
+        }
+        /** co_await s.schedule() : continue as a new scheduler job .
+         */
+        auto schedule() noexcept
+        {
+            struct awaiter
+            {
+                Scheduler* s;
+                auto await_ready() const noexcept -> bool {return false;}
+                void await_suspend(std::coroutine_handle<> h) {s->post(h);}
+                void await_resume() const noexcept {}
+            };
+            return awaiter{this};
+        }
+        /** co_await s.sleep_for(d) .
+         */
+        auto sleep_for(duration d) noexcept
+        {
+            struct awaiter
+            {
+                Scheduler*         s;
+                duration           d;
+                Internal::io_waiter w {};
+                auto await_ready() const noexcept -> bool {return d.count() <= 0;}
+                void await_suspend(std::coroutine_handle<> h)
+                {
+                    w.handle = h;
+                    s->arm_timer(w, d, OK);
+                }
+                void await_resume() const noexcept {}
+            };
+            return awaiter{this, d};
+        }
+    private:
+        auto io(int fd, std::uint32_t events, duration timeout) noexcept
+        {
+            struct awaiter
+            {
+                Scheduler*          s;
+                int                 fd;
+                std::uint32_t       events;
+                duration            timeout;
+                Internal::io_waiter w {};
+                auto await_ready() const noexcept -> bool {return false;}
+                auto await_suspend(std::coroutine_handle<> h) -> bool
+                {
+                    w.handle = h;
+                    w.fd = fd;
+                    auto rc = s->watch(w, events, timeout);
+                    if (rc == OK) return true; // w may already be resumed elsewhere, leave it alone
+                    w.status = rc;
+                    return false;
+                }
+                auto await_resume() const noexcept -> Result<void>
+                {
+                    if (w.status != OK) return Result<void>(error_type(w.status));
+                    return Result<void>();
+                }
+            };
+            return awaiter{this, fd, events, timeout};
+        }
+    public:
+        /** co_await s.readable(fd [, timeout]) -> Result<void> (TIMEOUT, IO_ERROR_BASE - errno) .
+         */
+        auto readable(int fd, duration timeout = duration::zero()) noexcept {return io(fd, EPOLLIN, timeout);}
+        auto writable(int fd, duration timeout = duration::zero()) noexcept {return io(fd, EPOLLOUT, timeout);}
+        /** co_await s.wait_update(sig) -> Result<return_code> (FAILURE when the wait is cancelled) .
+         *
+         * Takes one update like Signal::wait_update(), without blocking a thread.
+         */
+        auto wait_update(Signal& sig) noexcept
+        {
+            struct awaiter final : Signal::waiter
+            {
+                awaiter(Scheduler* s, Signal& g) noexcept : s(s), sig(g) {}
+                Scheduler*              s;
+                Signal&                 sig;
+                std::coroutine_handle<> h;
+                auto await_ready() const noexcept -> bool {return false;}
+                auto await_suspend(std::coroutine_handle<> c) -> bool
+                {
+                    h = c;
+                    return sig.wait_async(*this);
+                }
+                void wake() noexcept override {s->post(h);}
+                auto await_resume() const noexcept -> Result<return_code>
+                {
+                    if (canceled) return Result<return_code>(error_type(FAILURE));
+                    return Result<return_code>(id);
+                }
+            };
+            return awaiter(this, sig);
+        }
+        auto pool() const noexcept -> ThreadPool* {return m_pool;}
+    private:
+        auto on_loop() const noexcept -> bool {return m_loop.load(std::memory_order_relaxed) == std::this_thread::get_id();}
+        auto open() -> void
+        {
+            m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+            m_event = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (m_epoll < 0 || m_event < 0) {
+                MULT_FATAL("=====> Scheduler epoll / eventfd creation failed");
+                return;
+            }
+            epoll_event ev {};
+            ev.events = EPOLLIN;
+            ev.data.ptr = nullptr; // nullptr = wake up
+            ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_event, &ev);
+        }
+        auto wake() noexcept -> void
+        {
+            std::uint64_t one = 1;
+            [[maybe_unused]] auto n = ::write(m_event, &one, sizeof(one));
+        }
+        /** Resume ready coroutines of the single thread loop .
+         *
+         *  \retval true something ran
+         */
+        auto drain() -> bool
+        {
+            bool ran = false;
+            while (true) {
+                std::coroutine_handle<> h;
+                {
+                    std::lock_guard<std::mutex> l(m_guard);
+                    if (m_ready.empty()) break;
+                    h = m_ready.front();
+                    m_ready.pop_front();
+                }
+                h.resume();
+                ran = true;
+            }
+            return ran;
+        }
+        /** Arm the timer of w (m_guard held) .
+         */
+        auto arm_locked(Internal::io_waiter& w, duration d, return_code status) -> void
+        {
+            w.timer = m_wheel.arm_at(clock::now() + d, [this, &w, status] {
+                w.timer = 0;
+                if (w.fd >= 0) { // fd wait timed out
+                    ::epoll_ctl(m_epoll, EPOLL_CTL_DEL, w.fd, nullptr);
+                    m_registered.erase(w.fd);
+                }
+                w.status = status;
+                m_due.push_back(w.handle);
+            });
+        }
+        auto arm_timer(Internal::io_waiter& w, duration d, return_code status) -> void
+        {
+            {
+                std::lock_guard<std::mutex> l(m_guard);
+                arm_locked(w, d, status);
+            }
+            if (! on_loop()) wake();
+        }
+        /** Register w for events (and its timeout) in one step, the reactor can not see half of it .
+         */
+        auto watch(Internal::io_waiter& w, std::uint32_t events, duration timeout) noexcept -> return_code
+        {
+            epoll_event ev {};
+            ev.events = events | EPOLLONESHOT;
+            ev.data.ptr = &w;
+            {
+                std::lock_guard<std::mutex> l(m_guard);
+                auto op = m_registered.count(w.fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+                if (::epoll_ctl(m_epoll, op, w.fd, &ev) != 0) {
+                    if (op == EPOLL_CTL_ADD || errno != ENOENT || ::epoll_ctl(m_epoll, EPOLL_CTL_ADD, w.fd, &ev) != 0) return IO_ERROR_BASE - errno;
+                }
+                m_registered.insert(w.fd);
+                if (timeout.count() > 0) arm_locked(w, timeout, TIMEOUT);
+            }
+            if (timeout.count() > 0 && ! on_loop()) wake();
+            return OK;
+        }
+        /** One reactor step : due timers, fd events (waits up to the next deadline) .
+         */
+        auto react(int max_wait_ms) -> void
+        {
+            std::vector<std::coroutine_handle<>> ready;
+            int timeout;
+            {
+                std::lock_guard<std::mutex> l(m_guard);
+                m_wheel.advance(clock::now());
+                ready.swap(m_due);
+                timeout = m_wheel.timeout_ms(clock::now());
+                if (! m_ready.empty() || ! ready.empty()) timeout = 0;
+            }
+            if (max_wait_ms >= 0 && (timeout < 0 || timeout > max_wait_ms)) timeout = max_wait_ms;
+            epoll_event evs[64];
+            auto n = ::epoll_wait(m_epoll, evs, 64, timeout);
+            for (int i = 0; i < n; ++i) {
+                auto w = static_cast<Internal::io_waiter*>(evs[i].data.ptr);
+                if (! w) {
+                    std::uint64_t v;
+                    [[maybe_unused]] auto r = ::read(m_event, &v, sizeof(v));
+                    continue;
+                }
+                if (evs[i].events & (EPOLLERR | EPOLLHUP)) w->status = (evs[i].events & EPOLLERR) ? IO_ERROR_BASE - EIO : OK; // HUP: readable (EOF)
+                {
+                    std::lock_guard<std::mutex> l(m_guard);
+                    if (w->timer) m_wheel.cancel(w->timer);
+                    w->timer = 0;
+                }
+                ready.push_back(w->handle);
+            }
+            for (auto h : ready) post(h);
+        }
+        template <typename T>
+        static auto detach(Task<T> t) -> Internal::detached {co_await std::move(t);}
+        template <typename T>
+        struct run_state
+        {
+            std::mutex               guard;
+            std::condition_variable  monitor;
+            bool                     done = false;
+            std::optional<Result<T>> out;
+            auto finished() -> bool
+            {
+                std::lock_guard<std::mutex> l(guard);
+                return done;
+            }
+        };
+        template <typename T>
+        static auto finish(Task<T> t, run_state<T>& st) -> Internal::detached
+        {
+            auto r = co_await std::move(t);
+            std::lock_guard<std::mutex> l(st.guard); // run() can not return before the unlock
+            st.out.emplace(std::move(r));
+            st.done = true;
+            st.monitor.notify_one();
+        }
+        ThreadPool*                          m_pool = nullptr;
+        std::mutex                           m_guard;
+        TimerWheel                           m_wheel;
+        std::vector<std::coroutine_handle<>> m_due;
+        std::deque<std::coroutine_handle<>>  m_ready;
+        std::set<int>                        m_registered;
+        int                                  m_epoll = -1;
+        int                                  m_event = -1;
+        std::atomic<std::thread::id>         m_loop;
+        std::atomic<bool>                    m_stop {false};
+        std::thread                          m_reactor;
+    }; //<-- class Scheduler ends here.
+
+    /** Multi producer / multi consumer queue with awaitable pop .
+     *
+     * push() from any thread (also plain threads), co_await q.pop() -> Result<T> (NO_DATA after close()).
+     * Waiting consumers are served in FIFO order and resumed through the scheduler.
+     */
+    template <typename T>
+    class AsyncQueue final
+    {
+        struct waiter
+        {
+            std::coroutine_handle<>  handle;
+            std::optional<Result<T>> value;
+        };
+    public:
+        explicit AsyncQueue(Scheduler& s) noexcept : m_sched(s) {}
+        AsyncQueue(const AsyncQueue&) = delete;
+        AsyncQueue& operator=(const AsyncQueue&) = delete;
+        /**
+         *  \retval OK queued or handed to a waiting consumer
+         *  \retval NO_RESOURCE closed
+         */
+        auto push(T v) -> return_code
+        {
+            std::unique_lock<std::mutex> l(m_guard);
+            if (m_closed) return NO_RESOURCE;
+            if (m_waiters.empty()) {
+                m_items.push_back(std::move(v));
+                return OK;
+            }
+            auto w = m_waiters.front();
+            m_waiters.pop_front();
+            w->value.emplace(std::move(v));
+            l.unlock();
+            m_sched.post(w->handle);
+            return OK;
+        }
+        /** Wake every waiting consumer with NO_DATA, queued items can still be popped .
+         */
+        auto close() -> void
+        {
+            std::deque<waiter*> ws;
+            {
+                std::lock_guard<std::mutex> l(m_guard);
+                m_closed = true;
+                ws.swap(m_waiters);
+            }
+            for (auto w : ws) {
+                w->value.emplace(error_type(NO_DATA));
+                m_sched.post(w->handle);
+            }
+        }
+        auto size() -> size_type
+        {
+            std::lock_guard<std::mutex> l(m_guard);
+            return m_items.size();
+        }
+        auto pop() noexcept
+        {
+            struct awaiter
+            {
+                AsyncQueue* q;
+                waiter      w {};
+                auto await_ready() -> bool {return false;}
+                auto await_suspend(std::coroutine_handle<> h) -> bool
+                {
+                    std::lock_guard<std::mutex> l(q->m_guard);
+                    if (! q->m_items.empty()) {
+                        w.value.emplace(std::move(q->m_items.front()));
+                        q->m_items.pop_front();
+                        return false;
+                    }
+                    if (q->m_closed) {
+                        w.value.emplace(error_type(NO_DATA));
+                        return false;
+                    }
+                    w.handle = h;
+                    q->m_waiters.push_back(&w);
+                    return true;
+                }
+                auto await_resume() -> Result<T> {return std::move(*w.value);}
+            };
+            return awaiter{this};
+        }
+    private:
+        Scheduler&          m_sched;
+        std::mutex          m_guard;
+        std::deque<T>       m_items;
+        std::deque<waiter*> m_waiters;
+        bool                m_closed = false;
+    }; //<-- class AsyncQueue ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_COROUTINE_Hpp ends here.
@@ -0,0 +1,210 @@
+/**
+ * @file cpu_topology.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief CPU topology from /sys/devices/system/cpu (cores, SMT siblings, L2/L3 groups)
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_CPU_TOPOLOGY_Hpp
+# define  MULT_CPU_TOPOLOGY_Hpp
+
+# include <algorithm>
+# include <cstdint>
+# include <fstream>
+# include <sstream>
+# include <string>
+# include <string_view>
+# include <thread>
+# include <tuple>
+# include <vector>
+
+# ifdef __linux__
+#  include <sched.h>
+# endif
+
+# include "mult.hpp"
+
+namespace Mult {
+    /** One logical CPU .
+     */
+    struct cpu_info
+    {
+        static constexpr unsigned NO_GROUP = ~0u;
+        unsigned cpu     = 0;        //!< logical CPU number (affinity index)
+        unsigned core    = 0;        //!< core_id inside package
+        unsigned package = 0;        //!< physical_package_id
+        unsigned smt     = 0;        //!< position among SMT siblings (0 = first hardware thread)
+        unsigned l2      = NO_GROUP; //!< lowest CPU sharing this L2 (NO_GROUP when unknown)
+        unsigned l3      = NO_GROUP; //!< lowest CPU sharing this L3 (NO_GROUP when unknown)
+    };
+
+    /** Parse Linux cpu list ("0-3,8,10-11") .
+     *
+     *  \retval CPU numbers ascending, empty on malformed input or a CPU number >= CPU_SETSIZE
+     */
+    inline auto parse_cpu_list(std::string_view s) -> std::vector<unsigned>
+    {
+# ifdef __linux__
+        constexpr unsigned limit = CPU_SETSIZE;
+# else
+        constexpr unsigned limit = 1024;
+# endif
+        std::vector<unsigned> out;
+        auto number = [&s](size_type& i, unsigned& v) {
+            auto b = i;
+            v = 0;
+            while (i < s.size() && s[i] >= '0' && s[i] <= '9') {
+                v = v * 10 + static_cast<unsigned>(s[i++] - '0');
+                if (v >= limit) return false; // before it can wrap
+            }
+            return i != b;
+        };
+        size_type i = 0;
+        while (i < s.size() && s[i] != '\n') {
+            unsigned a, b;
+            if (! number(i, a)) return {};
+            b = a;
+            if (i < s.size() && s[i] == '-') {
+                ++i;
+                if (! number(i, b) || b < a) return {};
+            }
+            for (auto c = a; c <= b; ++c) out.push_back(c);
+            if (i < s.size() && s[i] == ',') ++i;
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return out;
+    }
+
+    /** CPU topology snapshot .
+     *
+     * Read once at start up, placement() gives the CPU order for pinning pool workers:
+     * one hardware thread per physical core first (neighbours share L3), SMT siblings last.
+     * @code
+     * auto topo = CpuTopology::discover();
+     * ThreadPool pool(topo.core_count(), thread_options{}, topo.placement(topo.core_count()));
+     * @endcode
+     */
+    class CpuTopology
+    {
+    public:
+        /** Read topology from sysfs .
+         *
+         * Missing files degrade gracefully: without sysfs every hardware thread is its own core.
+         *  \param[in] root sysfs cpu directory (for tests)
+         */
+        static auto discover(const std::string& root = "/sys/devices/system/cpu") -> CpuTopology
+        {
+            CpuTopology t;
+            auto online = parse_cpu_list(read(root + "/online"));
+            if (online.empty()) {
+                auto n = std::thread::hardware_concurrency();
+                for (unsigned c = 0; c < (n ? n : 1); ++c) online.push_back(c);
+            }
+            for (auto c : online) {
+                auto dir = root + "/cpu" + std::to_string(c);
+                cpu_info i;
+                i.cpu = c;
+                i.core = read_number(dir + "/topology/core_id", c);
+                i.package = read_number(dir + "/topology/physical_package_id", 0);
+                auto siblings = parse_cpu_list(read(dir + "/topology/thread_siblings_list"));
+                auto pos = std::find(siblings.begin(), siblings.end(), c);
+                i.smt = pos == siblings.end() ? 0 : static_cast<unsigned>(pos - siblings.begin());
+                for (unsigned k = 0; k < 8; ++k) { // cache/indexN, data or unified only
+                    auto idx = dir + "/cache/index" + std::to_string(k);
+                    auto level = read_number(idx + "/level", 0);
+                    if (level == 0) {
+                        if (read(idx + "/type").empty()) break;
+                        continue;
+                    }
+                    if (read(idx + "/type").starts_with("Instruction")) continue;
+                    auto shared = parse_cpu_list(read(idx + "/shared_cpu_list"));
+                    auto lead = shared.empty() ? c : shared.front();
+                    if (level == 2) i.l2 = lead;
+                    if (level == 3) i.l3 = lead;
+                }
+                t.m_cpus.push_back(i);
+            }
+            return t;
+        }
+        auto cpus() const noexcept -> const std::vector<cpu_info>& {return m_cpus;}
+        auto size() const noexcept -> size_type {return m_cpus.size();}
+        /** Info of logical CPU c (nullptr when offline or unknown) .
+         */
+        auto find(unsigned c) const noexcept -> const cpu_info*
+        {
+            for (auto& i : m_cpus) if (i.cpu == c) return &i;
+            return nullptr;
+        }
+        auto core_count() const -> size_type {return distinct([](const cpu_info& i) {return key(i.package, i.core);});}
+        auto package_count() const -> size_type {return distinct([](const cpu_info& i) {return std::uint64_t{i.package};});}
+        auto l3_count() const -> size_type {return distinct([](const cpu_info& i) {return std::uint64_t{i.l3};});}
+        /** SMT siblings of c including c .
+         */
+        auto siblings(unsigned c) const -> std::vector<unsigned>
+        {
+            std::vector<unsigned> out;
+            if (auto s = find(c)) {
+                for (auto& i : m_cpus) if (i.package == s->package && i.core == s->core) out.push_back(i.cpu);
+            }
+            return out;
+        }
+        auto shares_l2(unsigned a, unsigned b) const noexcept -> bool {return same(a, b, &cpu_info::l2);}
+        auto shares_l3(unsigned a, unsigned b) const noexcept -> bool {return same(a, b, &cpu_info::l3);}
+        /** CPU order for n workers .
+         *
+         * Ordered by (L3 group, package, core, smt): first SMT thread of every core, then the
+         * second ones and so on. Cycles when n exceeds the CPU count.
+         */
+        auto placement(size_type n) const -> std::vector<unsigned>
+        {
+            std::vector<cpu_info> order(m_cpus);
+            std::stable_sort(order.begin(), order.end(), [](const cpu_info& a, const cpu_info& b) {
+                return std::tie(a.smt, a.l3, a.package, a.core, a.cpu) < std::tie(b.smt, b.l3, b.package, b.core, b.cpu);
+            });
+            std::vector<unsigned> out;
+            out.reserve(n);
+            for (size_type k = 0; ! order.empty() && k < n; ++k) out.push_back(order[k % order.size()].cpu);
+            return out;
+        }
+    private:
+        static auto read(const std::string& path) -> std::string
+        {
+            std::ifstream in(path);
+            if (! in) return {};
+            std::stringstream ss;
+            ss << in.rdbuf();
+            return ss.str();
+        }
+        static auto read_number(const std::string& path, unsigned fallback) -> unsigned
+        {
+            auto s = read(path);
+            if (s.empty() || s[0] < '0' || s[0] > '9') return fallback;
+            return static_cast<unsigned>(std::stoul(s));
+        }
+        static constexpr auto key(unsigned hi, unsigned lo) noexcept -> std::uint64_t {return (std::uint64_t{hi} << 32) | lo;}
+        template <typename K>
+        auto distinct(K k) const -> size_type
+        {
+            std::vector<std::uint64_t> keys;
+            for (auto& i : m_cpus) keys.push_back(k(i));
+            std::sort(keys.begin(), keys.end());
+            return static_cast<size_type>(std::unique(keys.begin(), keys.end()) - keys.begin());
+        }
+        auto same(unsigned a, unsigned b, unsigned cpu_info::* g) const noexcept -> bool
+        {
+            auto x = find(a), y = find(b);
+            return x && y && x->*g != cpu_info::NO_GROUP && x->*g == y->*g;
+        }
+        std::vector<cpu_info> m_cpus;
+    }; //<-- class CpuTopology ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_CPU_TOPOLOGY_Hpp ends here.
@@ -0,0 +1,84 @@
+/**
+ * @file crc32c.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief CRC-32C (Castagnoli)
+ *
+ * Uses the SSE4.2 crc32 instruction when compiled with it, otherwise slicing by 8 tables.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_CRC32C_Hpp
+# define  MULT_CRC32C_Hpp
+
+# include <cstdint>
+# include <cstring>
+
+# if defined (__SSE4_2__)
+#  include <nmmintrin.h>
+# endif
+
+# include "mult.hpp"
+
+namespace Mult {
+    namespace Internal {
+        struct crc32c_tables
+        {
+            std::uint32_t t[8][256];
+        };
+        constexpr crc32c_tables make_crc32c_tables() noexcept
+        {
+            crc32c_tables r{};
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                auto c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ 0x82f63b78u : c >> 1;
+                r.t[0][i] = c;
+            }
+            for (int s = 1; s < 8; ++s) {
+                for (int i = 0; i < 256; ++i) r.t[s][i] = (r.t[s - 1][i] >> 8) ^ r.t[0][r.t[s - 1][i] & 0xff];
+            }
+            return r;
+        }
+        static constexpr crc32c_tables crc32cTbl = make_crc32c_tables();
+    } //<-- namespace Internal ends here.
+
+    /** Continue CRC-32C over n bytes .
+     *
+     * @code
+     * auto c = crc32c(p, n);             // whole
+     * auto d = crc32c(q, m, crc32c(p, n)); // same as crc32c of p then q
+     * @endcode
+     */
+    inline std::uint32_t crc32c(const void* src, size_type n, std::uint32_t crc = 0) noexcept
+    {
+        auto p = static_cast<const std::uint8_t*>(src);
+        std::uint64_t c = ~crc;
+# if defined (__SSE4_2__)
+        for (; n >= 8; n -= 8, p += 8) {
+            std::uint64_t w;
+            std::memcpy(&w, p, 8);
+            c = _mm_crc32_u64(c, w);
+        }
+        for (; n > 0; --n, ++p) c = _mm_crc32_u8(static_cast<std::uint32_t>(c), *p);
+# else
+        const auto& t = Internal::crc32cTbl.t;
+        for (; n >= 8; n -= 8, p += 8) {
+            std::uint64_t w;
+            std::memcpy(&w, p, 8); // little endian
+            w ^= c;
+            c = t[7][w & 0xff] ^ t[6][(w >> 8) & 0xff] ^ t[5][(w >> 16) & 0xff] ^ t[4][(w >> 24) & 0xff]
+                ^ t[3][(w >> 32) & 0xff] ^ t[2][(w >> 40) & 0xff] ^ t[1][(w >> 48) & 0xff] ^ t[0][w >> 56];
+        }
+        for (; n > 0; --n, ++p) c = t[0][(c ^ *p) & 0xff] ^ (c >> 8);
+# endif
+        return ~static_cast<std::uint32_t>(c);
+    }
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_CRC32C_Hpp ends here.
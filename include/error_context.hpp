@@ -0,0 +1,275 @@
+/**
+ * @file error_context.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Allocation free context for error_type
+ *
+ * Interned source locations (16bit site id), error categories, lazy messages and
+ * per thread error trace ring. Nothing here allocates, all tables are fixed static storage.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_ERROR_CONTEXT_Hpp
+# define  MULT_ERROR_CONTEXT_Hpp
+
+# include <atomic>
+# include <cstdint>
+# include <cstdio>
+# include <source_location>
+# include <string_view>
+
+# include "mult.hpp"
+
+namespace Mult {
+    /** Error category, derived from return_code unless given explicitly .
+     */
+    enum class error_category : std::uint8_t
+    {
+        none = 0,   //!< OK
+        generic,    //!< FAILURE and unknown codes
+        resource,   //!< TIMEOUT, NO_RESOURCE, NO_DATA
+        argument,   //!< FAIL_ARG, FAIL_ARGC
+        command,    //!< FAIL_CMD
+        thread,     //!< FAIL_LUNCH, FAIL_JOIN
+        range,      //!< OUT_OF_RANGE ... OVER_INDEX
+        io,         //!< IO_ERROR_BASE - errno
+        device,     //!< DEVICE_ERROR_BASE - n
+        user = 128, //!< first user defined category
+    };
+    /** Category of return_code .
+     */
+    constexpr auto category_of(std::int64_t c) noexcept -> error_category
+    {
+        if (c >= OK)                 return error_category::none;
+        if (c <= DEVICE_ERROR_BASE)  return error_category::device;
+        if (c <= IO_ERROR_BASE)      return error_category::io;
+        if (c <= OUT_OF_RANGE)       return error_category::range;
+        if (c == FAIL_JOIN || c == FAIL_LUNCH) return error_category::thread;
+        if (c == FAIL_CMD)           return error_category::command;
+        if (c == FAIL_ARG || c == FAIL_ARGC) return error_category::argument;
+        if (c <= TIMEOUT && c >= NO_DATA) return error_category::resource;
+        return error_category::generic;
+    }
+    /** Interned error site .
+     */
+    struct error_site
+    {
+        const char*   file     = "";
+        const char*   function = "";
+        std::uint32_t line     = 0;
+        std::uint32_t column   = 0;
+    };
+
+    namespace Internal {
+        struct error_site_slot
+        {
+            std::atomic<std::uint32_t> state {0}; // 0 empty, 1 writing, 2 ready
+            std::uint32_t line   = 0;
+            std::uint32_t column = 0;
+            const char*   file     = nullptr;
+            const char*   function = nullptr;
+        };
+        inline constexpr std::uint32_t ERROR_SITES = 4096;
+        inline error_site_slot errorSites[ERROR_SITES];
+
+        struct error_message_slot
+        {
+            std::atomic<std::uint32_t> state {0};
+            std::int64_t     code = 0;
+            std::string_view text;
+        };
+        inline constexpr std::uint32_t ERROR_MESSAGES = 256;
+        inline error_message_slot errorMessages[ERROR_MESSAGES];
+        inline std::atomic<std::uint32_t> errorMessageCount {0};
+
+        inline auto builtin_message(std::int64_t c) noexcept -> std::string_view
+        {
+            switch (c) {
+            case OK:           return "ok";
+            case FAILURE:      return "failure";
+            case TIMEOUT:      return "timeout";
+            case NO_RESOURCE:  return "no resource";
+            case NO_DATA:      return "no data";
+            case FAIL_ARG:     return "invalid argument";
+            case FAIL_ARGC:    return "invalid argument count";
+            case FAIL_CMD:     return "command failed";
+            case FAIL_LUNCH:   return "thread launch failed";
+            case FAIL_JOIN:    return "thread join failed";
+            case OUT_OF_RANGE: return "out of range";
+            case UNDER_FLOW:   return "underflow";
+            case OVER_FLOW:    return "overflow";
+            case UNDER_INDEX:  return "index under";
+            case OVER_INDEX:   return "index over";
+            default: break;
+            }
+            switch (category_of(c)) {
+            case error_category::io:     return "I/O error";
+            case error_category::device: return "device error";
+            default: return "unknown error";
+            }
+        }
+    } //<-- namespace Internal ends here.
+
+    /** Intern source location, returns site id (0 when table is full) .
+     *
+     * Lock free, called once per error creation (never on propagation).
+     * The same site may get more than one id when its file name literal is not merged.
+     */
+    inline auto intern_error_site(const std::source_location& loc) noexcept -> std::uint16_t
+    {
+        using namespace Internal;
+        auto file = loc.file_name();
+        std::uint32_t line = loc.line(), column = loc.column();
+        std::uint64_t h = reinterpret_cast<std::uintptr_t>(file) ^ (static_cast<std::uint64_t>(line) << 20) ^ column;
+        h *= 0x9e3779b97f4a7c15ULL;
+        auto i = static_cast<std::uint32_t>(h >> 52); // 12 bits
+        for (std::uint32_t probe = 0; probe < ERROR_SITES; ++probe, i = (i + 1) & (ERROR_SITES - 1)) {
+            auto& s = errorSites[i];
+            auto st = s.state.load(std::memory_order_acquire);
+            if (st == 0) {
+                if (s.state.compare_exchange_strong(st, 1, std::memory_order_acq_rel)) {
+                    s.file = file;
+                    s.function = loc.function_name();
+                    s.line = line;
+                    s.column = column;
+                    s.state.store(2, std::memory_order_release);
+                    return static_cast<std::uint16_t>(i + 1);
+                }
+            }
+            while (st == 1) st = s.state.load(std::memory_order_acquire); // being written by another thread
+            if (s.file == file && s.line == line && s.column == column) return static_cast<std::uint16_t>(i + 1);
+        }
+        return 0;
+    }
+    /** Lookup interned site (empty site for 0 or unknown id) .
+     */
+    inline auto error_site_of(std::uint16_t id) noexcept -> error_site
+    {
+        if (id == 0 || id > Internal::ERROR_SITES) return {};
+        auto& s = Internal::errorSites[id - 1];
+        if (s.state.load(std::memory_order_acquire) != 2) return {};
+        return {s.file, s.function, s.line, s.column};
+    }
+    /** Register message text for a user code .
+     *
+     *  \param c code
+     *  \param text must outlive every use (string literal)
+     *  \retval true registered
+     *  \retval false message table full
+     */
+    inline auto register_error_message(std::int64_t c, std::string_view text) noexcept -> bool
+    {
+        auto i = Internal::errorMessageCount.fetch_add(1, std::memory_order_relaxed);
+        if (i >= Internal::ERROR_MESSAGES) return false;
+        auto& m = Internal::errorMessages[i];
+        m.code = c;
+        m.text = text;
+        m.state.store(1, std::memory_order_release);
+        return true;
+    }
+    /** Message of code (registered one wins, then built in) .
+     *
+     * Only evaluated when asked, never while errors propagate.
+     */
+    inline auto error_message(std::int64_t c) noexcept -> std::string_view
+    {
+        auto n = Internal::errorMessageCount.load(std::memory_order_acquire);
+        if (n > Internal::ERROR_MESSAGES) n = Internal::ERROR_MESSAGES;
+        for (auto i = n; i > 0; --i) { // newest registration wins
+            auto& m = Internal::errorMessages[i - 1];
+            if (m.state.load(std::memory_order_acquire) == 1 && m.code == c) return m.text;
+        }
+        return Internal::builtin_message(c);
+    }
+    /** Format "file:line function: message (code)" into buf without allocation .
+     *
+     *  \retval written length (truncated to n - 1)
+     */
+    inline auto format_error(char* buf, size_type n, std::int64_t c, std::uint16_t site) noexcept -> size_type
+    {
+        if (n == 0) return 0;
+        auto msg = error_message(c);
+        auto s = error_site_of(site);
+        int w;
+        if (site) {
+            w = std::snprintf(buf, n, "%s:%u %s: %.*s (%lld)", s.file, s.line, s.function,
+                              static_cast<int>(msg.size()), msg.data(), static_cast<long long>(c));
+        } else {
+            w = std::snprintf(buf, n, "%.*s (%lld)", static_cast<int>(msg.size()), msg.data(), static_cast<long long>(c));
+        }
+        if (w < 0) return 0;
+        return static_cast<size_type>(w) < n ? static_cast<size_type>(w) : n - 1;
+    }
+
+    /** One hop of error propagation .
+     */
+    struct error_trace_entry
+    {
+        std::int32_t  code   = 0;
+        std::uint16_t origin = 0; //!< site where the error was created
+        std::uint16_t site   = 0; //!< site of this hop (== origin on creation)
+    };
+    /** Per thread bounded error trace ring (disabled by default) .
+     *
+     * When enabled, error creation and error_type::propagate() append one entry,
+     * oldest entries are overwritten. Cost when disabled is one relaxed load.
+     * @code
+     * ErrorTrace::enable(true);
+     * ...
+     * error_trace_entry path[ErrorTrace::CAPACITY];
+     * auto n = ErrorTrace::snapshot(path, ErrorTrace::CAPACITY); // oldest first
+     * @endcode
+     */
+    class ErrorTrace
+    {
+    public:
+        static constexpr size_type CAPACITY = 64;
+        static auto enable(bool on) noexcept -> void {flag().store(on, std::memory_order_relaxed);}
+        static auto enabled() noexcept -> bool {return flag().load(std::memory_order_relaxed);}
+        static auto record(std::int64_t c, std::uint16_t origin, std::uint16_t site) noexcept -> void
+        {
+            if (! enabled()) return;
+            auto& r = ring();
+            r.entries[r.count % CAPACITY] = {static_cast<std::int32_t>(c), origin, site};
+            ++r.count;
+        }
+        /** Copy newest min(n, recorded) entries of this thread, oldest first .
+         */
+        static auto snapshot(error_trace_entry* out, size_type n) noexcept -> size_type
+        {
+            auto& r = ring();
+            auto have = r.count < CAPACITY ? r.count : CAPACITY;
+            if (n > have) n = have;
+            for (size_type i = 0; i < n; ++i) out[i] = r.entries[(r.count - n + i) % CAPACITY];
+            return n;
+        }
+        /** Total entries recorded on this thread (including overwritten) .
+         */
+        static auto recorded() noexcept -> std::uint64_t {return ring().count;}
+        static auto clear() noexcept -> void {ring().count = 0;}
+    private:
+        struct ring_type
+        {
+            error_trace_entry entries[CAPACITY];
+            std::uint64_t     count = 0;
+        };
+        static auto flag() noexcept -> std::atomic<bool>&
+        {
+            static std::atomic<bool> f {false};
+            return f;
+        }
+        static auto ring() noexcept -> ring_type&
+        {
+            thread_local ring_type r;
+            return r;
+        }
+    }; //<-- class ErrorTrace ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_ERROR_CONTEXT_Hpp ends here.
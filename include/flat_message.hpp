@@ -0,0 +1,359 @@
+/**
+ * @file flat_message.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Flat message readable in place
+ *
+ * @code
+ * +0  u32 magic "MFL1"
+ * +4  u32 total size (header, table and data)
+ * +8  u16 field count N
+ * +10 u16 flags (0)
+ * +12 u32 reserved (0)
+ * +16 N x entry {u32 offset from message head (0 is absent), u8 kind, u8 element kind, u16 reserved}
+ *     data (little endian)
+ *       scalar        aligned to its size
+ *       string/bytes  aligned to 4, u32 length, bytes (string has terminating NUL)
+ *       vector        aligned to 8, u32 count, u32 reserved, elements
+ *       message       aligned to 8, nested flat message
+ * @endcode
+ * FlatReader::verify checks the whole message (and nested ones) once, then the accessors
+ * read the memory directly without parse nor copy. Any memory works as source
+ * (ByteBuffer, MappedFile, shared memory), the message head must be aligned to 8.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_FLAT_MESSAGE_Hpp
+# define  MULT_FLAT_MESSAGE_Hpp
+
+# include <bit>
+# include <cstdint>
+# include <cstring>
+# include <span>
+# include <string_view>
+# include <type_traits>
+
+# include "byte_buffer.hpp"
+# include "byte_order.hpp"
+# include "result.hpp"
+
+namespace Mult {
+    static_assert(std::endian::native == std::endian::little, "flat message is read in place, little endian host only");
+
+    enum class flat_kind : std::uint8_t {
+        none = 0,
+        u8, i8, u16, i16, u32, i32, u64, i64, f32, f64, boolean,
+        string, bytes, vector, message,
+    };
+    static constexpr std::uint32_t FLAT_MAGIC       = 0x314c464d; // "MFL1"
+    static constexpr size_type     FLAT_HEADER_SIZE = 16;
+    static constexpr size_type     FLAT_ENTRY_SIZE  = 8;
+    static constexpr size_type     FLAT_MAX_DEPTH   = 16;
+    static constexpr size_type     FLAT_MAX_FIELDS  = 0xffff; // 16 bit field count in the header
+
+    namespace Internal {
+        template <typename T>
+        constexpr flat_kind flat_kind_of() noexcept
+        {
+            if constexpr (std::is_same_v<T, bool>)          return flat_kind::boolean;
+            else if constexpr (std::is_same_v<T, std::uint8_t>)  return flat_kind::u8;
+            else if constexpr (std::is_same_v<T, std::int8_t>)   return flat_kind::i8;
+            else if constexpr (std::is_same_v<T, std::uint16_t>) return flat_kind::u16;
+            else if constexpr (std::is_same_v<T, std::int16_t>)  return flat_kind::i16;
+            else if constexpr (std::is_same_v<T, std::uint32_t>) return flat_kind::u32;
+            else if constexpr (std::is_same_v<T, std::int32_t>)  return flat_kind::i32;
+            else if constexpr (std::is_same_v<T, std::uint64_t>) return flat_kind::u64;
+            else if constexpr (std::is_same_v<T, std::int64_t>)  return flat_kind::i64;
+            else if constexpr (std::is_same_v<T, float>)         return flat_kind::f32;
+            else if constexpr (std::is_same_v<T, double>)        return flat_kind::f64;
+            else return flat_kind::none;
+        }
+        constexpr size_type flat_scalar_size(flat_kind k) noexcept
+        {
+            switch (k) {
+            case flat_kind::u8: case flat_kind::i8: case flat_kind::boolean: return 1;
+            case flat_kind::u16: case flat_kind::i16: return 2;
+            case flat_kind::u32: case flat_kind::i32: case flat_kind::f32: return 4;
+            case flat_kind::u64: case flat_kind::i64: case flat_kind::f64: return 8;
+            default: return 0;
+            }
+        }
+        constexpr size_type align_up(size_type v, size_type a) noexcept {return (v + a - 1) & ~(a - 1);}
+    } //<-- namespace Internal ends here.
+
+    /** Requirement for scalar field (and vector element) .
+     */
+    template <typename T>
+    using is_flat_scalar_requirement = std::bool_constant<Internal::flat_kind_of<T>() != flat_kind::none>;
+
+    /** Verified flat message (view) .
+     *
+     * Accessors return default value / empty view when the field is absent or of other kind.
+     */
+    class FlatReader
+    {
+    public:
+        constexpr FlatReader() noexcept = default;
+        /** Verify message at p .
+         *
+         *  \param[in] p message head (aligned to 8)
+         *  \param[in] n readable length from p
+         *  \retval FlatReader
+         *  \retval FAIL_ARG broken message (magic, size, alignment, offset or nested message)
+         */
+        static auto verify(const char* p, size_type n) noexcept -> Result<FlatReader>
+        {
+            if (! check(p, n, 0)) return Result<FlatReader>(error_type(FAIL_ARG));
+            return Result<FlatReader>(FlatReader(p));
+        }
+        static auto verify(const ByteBuffer& b) noexcept -> Result<FlatReader> {return verify(b.const_ptr(), b.size());}
+        constexpr auto is_valid() const noexcept -> bool {return m_ptr != nullptr;}
+        auto size() const noexcept -> size_type {return m_ptr ? u32(4) : 0;}
+        auto field_count() const noexcept -> size_type {return m_ptr ? load_unaligned<std::uint16_t, std::endian::little>(m_ptr + 8) : 0;}
+        auto data() const noexcept -> const char* {return m_ptr;}
+        auto kind(size_type id) const noexcept -> flat_kind
+        {
+            if (id >= field_count()) return flat_kind::none;
+            return static_cast<flat_kind>(m_ptr[FLAT_HEADER_SIZE + id * FLAT_ENTRY_SIZE + 4]);
+        }
+        auto has(size_type id) const noexcept -> bool {return kind(id) != flat_kind::none;}
+        template <typename T>
+        auto get(size_type id, T def = T{}) const noexcept -> T
+        {
+            static_assert(is_flat_scalar_requirement<T>::value, "T must be bool, fixed size integer, float or double");
+            if (kind(id) != Internal::flat_kind_of<T>()) return def;
+            if constexpr (std::is_same_v<T, bool>) return m_ptr[offset(id)] != 0;
+            else return load_unaligned<T, std::endian::little>(m_ptr + offset(id));
+        }
+        auto string(size_type id) const noexcept -> std::string_view
+        {
+            if (kind(id) != flat_kind::string) return {};
+            return std::string_view(m_ptr + offset(id) + 4, u32(offset(id)));
+        }
+        auto bytes(size_type id) const noexcept -> std::string_view
+        {
+            if (kind(id) != flat_kind::bytes) return {};
+            return std::string_view(m_ptr + offset(id) + 4, u32(offset(id)));
+        }
+        template <typename T>
+        auto vector(size_type id) const noexcept -> std::span<const T>
+        {
+            static_assert(is_flat_scalar_requirement<T>::value, "T must be bool, fixed size integer, float or double");
+            if (kind(id) != flat_kind::vector || element_kind(id) != Internal::flat_kind_of<T>()) return {};
+            return std::span<const T>(reinterpret_cast<const T*>(m_ptr + offset(id) + 8), u32(offset(id)));
+        }
+        auto message(size_type id) const noexcept -> FlatReader
+        {
+            if (kind(id) != flat_kind::message) return FlatReader();
+            return FlatReader(m_ptr + offset(id));
+        }
+    private:
+        explicit constexpr FlatReader(const char* p) noexcept : m_ptr(p) {}
+        auto u32(size_type at) const noexcept -> size_type {return load_unaligned<std::uint32_t, std::endian::little>(m_ptr + at);}
+        auto offset(size_type id) const noexcept -> size_type {return u32(FLAT_HEADER_SIZE + id * FLAT_ENTRY_SIZE);}
+        auto element_kind(size_type id) const noexcept -> flat_kind
+        {
+            return static_cast<flat_kind>(m_ptr[FLAT_HEADER_SIZE + id * FLAT_ENTRY_SIZE + 5]);
+        }
+        /** One pass bounds check .
+         */
+        static auto check(const char* p, size_type n, size_type depth) noexcept -> bool
+        {
+            using Internal::flat_scalar_size;
+            if (! p || depth > FLAT_MAX_DEPTH || reinterpret_cast<std::uintptr_t>(p) % 8 != 0) return false;
+            if (n < FLAT_HEADER_SIZE) return false;
+            auto rd = [p](size_type at) -> size_type {return load_unaligned<std::uint32_t, std::endian::little>(p + at);};
+            if (rd(0) != FLAT_MAGIC) return false;
+            auto total = rd(4);
+            auto count = size_type(load_unaligned<std::uint16_t, std::endian::little>(p + 8));
+            auto table_end = FLAT_HEADER_SIZE + count * FLAT_ENTRY_SIZE;
+            if (total > n || table_end > total) return false;
+            for (size_type id = 0; id < count; ++id) {
+                auto e = FLAT_HEADER_SIZE + id * FLAT_ENTRY_SIZE;
+                auto off = rd(e);
+                auto k = static_cast<flat_kind>(p[e + 4]);
+                if (k == flat_kind::none) {
+                    if (off != 0) return false;
+                    continue;
+                }
+                if (off < table_end || off >= total) return false;
+                auto room = total - off;
+                if (auto s = flat_scalar_size(k); s != 0) {
+                    if (off % s != 0 || s > room) return false;
+                    continue;
+                }
+                switch (k) {
+                case flat_kind::string:
+                case flat_kind::bytes: {
+                    if (off % 4 != 0 || room < 4) return false;
+                    auto len = rd(off);
+                    auto need = len + ((k == flat_kind::string) ? 1 : 0);
+                    if (need > room - 4) return false;
+                    if (k == flat_kind::string && p[off + 4 + len] != '\0') return false;
+                    break;
+                }
+                case flat_kind::vector: {
+                    auto s = flat_scalar_size(static_cast<flat_kind>(p[e + 5]));
+                    if (s == 0 || off % 8 != 0 || room < 8) return false;
+                    if (rd(off) > (room - 8) / s) return false;
+                    break;
+                }
+                case flat_kind::message:
+                    if (! check(p + off, room, depth + 1)) return false;
+                    break;
+                default:
+                    return false;
+                }
+            }
+            return true;
+        }
+        const char* m_ptr = nullptr;
+    }; //<-- class FlatReader ends here.
+
+    /** Flat message writer (appends one message to a ByteBuffer) .
+     *
+     * @code
+     * ByteBuffer out;
+     * FlatBuilder b(out, 3);
+     * b.add<std::uint32_t>(0, 42);
+     * b.add_string(1, "name");
+     * b.add_vector<double>(2, values);
+     * b.finish();
+     * @endcode
+     */
+    class FlatBuilder
+    {
+    public:
+        /** Start message with field_count fields at tail of out (padded to 8) .
+         *
+         * field_count over FLAT_MAX_FIELDS writes nothing, add*() and finish() return OVER_FLOW.
+         */
+        FlatBuilder(ByteBuffer& out, size_type field_count) noexcept : m_out(out), m_count(field_count)
+        {
+            if (field_count > FLAT_MAX_FIELDS) {
+                m_count = 0;
+                m_error = OVER_FLOW;
+                return;
+            }
+            pad(8);
+            m_base = m_out.size();
+            auto p = m_out.prepare(FLAT_HEADER_SIZE + field_count * FLAT_ENTRY_SIZE);
+            std::memset(p, 0, FLAT_HEADER_SIZE + field_count * FLAT_ENTRY_SIZE);
+            store_unaligned<std::uint32_t, std::endian::little>(p, FLAT_MAGIC);
+            store_unaligned<std::uint16_t, std::endian::little>(p + 8, static_cast<std::uint16_t>(field_count));
+            m_out.commit(FLAT_HEADER_SIZE + field_count * FLAT_ENTRY_SIZE);
+        }
+        /** Add scalar field .
+         *
+         *  \retval OK
+         *  \retval OUT_OF_RANGE id is over field count
+         *  \retval FAIL_ARG id was already added or message was finished
+         */
+        template <typename T>
+        auto add(size_type id, T v) noexcept -> return_code
+        {
+            static_assert(is_flat_scalar_requirement<T>::value, "T must be bool, fixed size integer, float or double");
+            constexpr auto k = Internal::flat_kind_of<T>();
+            auto rc = begin_field(id, k, flat_kind::none, sizeof(T));
+            if (rc != OK) return rc;
+            auto p = m_out.prepare(sizeof(T));
+            if constexpr (std::is_same_v<T, bool>) *p = v ? 1 : 0;
+            else store_unaligned<T, std::endian::little>(p, v);
+            return m_out.commit(sizeof(T));
+        }
+        auto add_string(size_type id, std::string_view v) noexcept -> return_code {return add_blob(id, flat_kind::string, v);}
+        auto add_bytes(size_type id, std::string_view v) noexcept -> return_code {return add_blob(id, flat_kind::bytes, v);}
+        template <typename T>
+        auto add_vector(size_type id, std::span<const T> v) noexcept -> return_code
+        {
+            static_assert(is_flat_scalar_requirement<T>::value, "T must be bool, fixed size integer, float or double");
+            if (v.size() > 0xffffffffu) return OVER_FLOW;
+            auto rc = begin_field(id, flat_kind::vector, Internal::flat_kind_of<T>(), 8);
+            if (rc != OK) return rc;
+            auto bytes = v.size() * sizeof(T);
+            auto p = m_out.prepare(8 + bytes);
+            store_unaligned<std::uint32_t, std::endian::little>(p, static_cast<std::uint32_t>(v.size()));
+            store_unaligned<std::uint32_t, std::endian::little>(p + 4, 0);
+            if (bytes) std::memcpy(p + 8, v.data(), bytes);
+            return m_out.commit(8 + bytes);
+        }
+        /** Add nested message (built by another FlatBuilder, copied) .
+         *
+         *  \retval FAIL_ARG m is not a verified message
+         */
+        auto add_message(size_type id, const FlatReader& m) noexcept -> return_code
+        {
+            if (! m.is_valid()) return FAIL_ARG;
+            auto rc = begin_field(id, flat_kind::message, flat_kind::none, 8);
+            if (rc != OK) return rc;
+            return m_out.append(m.data(), m.size());
+        }
+        /** Write total size .
+         *
+         *  \retval OK
+         *  \retval OVER_FLOW message is over 4GiB or field count over FLAT_MAX_FIELDS
+         *  \retval FAIL_ARG already finished
+         */
+        auto finish() noexcept -> return_code
+        {
+            if (m_error != OK) return m_error;
+            if (m_finished) return FAIL_ARG;
+            auto total = m_out.size() - m_base;
+            if (total > 0xffffffffu) return OVER_FLOW;
+            store_unaligned<std::uint32_t, std::endian::little>(m_out.ptr() + m_base + 4, static_cast<std::uint32_t>(total));
+            m_finished = true;
+            return OK;
+        }
+        /** Offset of the message in out .
+         */
+        auto base() const noexcept -> size_type {return m_base;}
+    private:
+        auto pad(size_type a) noexcept -> void
+        {
+            auto n = Internal::align_up(m_out.size(), a) - m_out.size();
+            if (n == 0) return;
+            std::memset(m_out.prepare(n), 0, n);
+            m_out.commit(n);
+        }
+        auto begin_field(size_type id, flat_kind k, flat_kind element, size_type align) noexcept -> return_code
+        {
+            if (m_error != OK) return m_error;
+            if (id >= m_count) return OUT_OF_RANGE;
+            auto e = m_out.ptr() + m_base + FLAT_HEADER_SIZE + id * FLAT_ENTRY_SIZE;
+            if (m_finished || e[4] != 0) return FAIL_ARG;
+            pad(align);
+            auto off = m_out.size() - m_base;
+            if (off > 0xffffffffu) return OVER_FLOW;
+            e = m_out.ptr() + m_base + FLAT_HEADER_SIZE + id * FLAT_ENTRY_SIZE; // pad may move storage
+            store_unaligned<std::uint32_t, std::endian::little>(e, static_cast<std::uint32_t>(off));
+            e[4] = static_cast<char>(k);
+            e[5] = static_cast<char>(element);
+            return OK;
+        }
+        auto add_blob(size_type id, flat_kind k, std::string_view v) noexcept -> return_code
+        {
+            if (v.size() > 0xfffffffeu) return OVER_FLOW;
+            auto rc = begin_field(id, k, flat_kind::none, 4);
+            if (rc != OK) return rc;
+            auto nul = (k == flat_kind::string) ? 1 : 0;
+            auto p = m_out.prepare(4 + v.size() + nul);
+            store_unaligned<std::uint32_t, std::endian::little>(p, static_cast<std::uint32_t>(v.size()));
+            if (! v.empty()) std::memcpy(p + 4, v.data(), v.size());
+            if (nul) p[4 + v.size()] = '\0';
+            return m_out.commit(4 + v.size() + nul);
+        }
+        ByteBuffer& m_out;
+        size_type   m_count;
+        size_type   m_base {0};
+        bool        m_finished {false};
+        return_code m_error {OK};     //!< set by the constructor, reported by every call
+    }; //<-- class FlatBuilder ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_FLAT_MESSAGE_Hpp ends here.
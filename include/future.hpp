@@ -0,0 +1,535 @@
+/**
+ * @file future.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Future<Result<T>> for ThreadPool (submit, then, when_all, when_any)
+ *
+ * Values travel as Result, exceptions thrown by user callables become error_type(FAILURE).
+ * Shared states and continuation jobs are allocated from per thread free lists (Internal::pooled).
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_FUTURE_Hpp
+# define  MULT_FUTURE_Hpp
+
+# include <atomic>
+# include <cstdint>
+# include <functional>
+# include <new>
+# include <optional>
+# include <thread>
+# include <tuple>
+# include <type_traits>
+# include <utility>
+# include <vector>
+
+# include "mult.hpp"
+# include "result.hpp"
+# include "thread_pool.hpp"
+# include "internal/block_pool.hpp"
+
+namespace Mult {
+    template <typename R> class Future;
+
+    namespace Internal {
+        template <typename R> struct result_value {};
+        template <typename T> struct result_value<Result<T>> {using type = T;};
+        template <typename U> struct as_result {using type = Result<U>;};
+        template <typename T> struct as_result<Result<T>> {using type = Result<T>;};
+        template <> struct as_result<void> {using type = Result<void>;};
+        /** Result type of f(a...) (T -> Result<T>, Result<T> as is, void -> Result<void>) .
+         */
+        template <typename F, typename... A>
+        using invoke_as_result_t = typename as_result<std::remove_cvref_t<std::invoke_result_t<F, A...>>>::type;
+        /** Call f(a...) and wrap into Result, exception becomes FAILURE .
+         */
+        template <typename F, typename... A>
+        auto invoke_as_result(F& f, A&&... a) noexcept -> invoke_as_result_t<F&, A...>
+        {
+            using R = invoke_as_result_t<F&, A...>;
+            using U = std::remove_cvref_t<std::invoke_result_t<F&, A...>>;
+            try {
+                if constexpr (is_result<U>::value) {
+                    return R(std::invoke(f, std::forward<A>(a)...));
+                } else if constexpr (std::is_void_v<U>) {
+                    std::invoke(f, std::forward<A>(a)...);
+                    return R();
+                } else {
+                    return R(std::invoke(f, std::forward<A>(a)...));
+                }
+            } catch (...) {
+                return R(error_type(FAILURE));
+            }
+        }
+
+        /** Shared state between producer and Future .
+         *
+         * flags READY / CONT decide who dispatches the continuation (the second one to arrive).
+         */
+        template <typename R>
+        struct future_state : pooled
+        {
+            static constexpr std::uint32_t READY = 1;
+            static constexpr std::uint32_t CONT  = 2;
+            explicit future_state(ThreadPool* p, std::uint32_t r = 2) noexcept : refs(r), pool(p) {}
+            auto set(R&& r) noexcept -> void
+            {
+                value.emplace(std::move(r));
+                auto prev = flags.fetch_or(READY, std::memory_order_acq_rel);
+                flags.notify_all();
+                if (prev & CONT) dispatch();
+            }
+            auto attach(pool_job* j, bool run_inline) noexcept -> void
+            {
+                cont = j;
+                cont_inline = run_inline;
+                auto prev = flags.fetch_or(CONT, std::memory_order_acq_rel);
+                if (prev & READY) dispatch();
+            }
+            auto ready() const noexcept -> bool {return flags.load(std::memory_order_acquire) & READY;}
+            auto wait() noexcept -> void
+            {
+                size_type idle = 0;
+                while (true) {
+                    auto f = flags.load(std::memory_order_acquire);
+                    if (f & READY) return;
+                    if (pool && pool->current_index() != ThreadPool::NOT_WORKER) { // never park a worker while work is queued
+                        if (pool->try_run_one()) {
+                            idle = 0;
+                            continue;
+                        }
+                        if (++idle < 64) {
+                            std::this_thread::yield();
+                            continue;
+                        }
+                        idle = 0;
+                    }
+                    flags.wait(f, std::memory_order_acquire);
+                }
+            }
+            auto release() noexcept -> void
+            {
+                if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+            }
+            std::atomic<std::uint32_t> flags {0};
+            std::atomic<std::uint32_t> refs;
+            ThreadPool*                pool;
+            pool_job*                  cont = nullptr;
+            bool                       cont_inline = false;
+            std::optional<R>           value;      // Result has no default state
+        private:
+            auto dispatch() noexcept -> void
+            {
+                auto j = cont;
+                if (cont_inline || ! pool || pool->post_job(j) != OK) {
+                    j->execute();
+                    delete j;
+                }
+            }
+        };
+
+        /** Job running f() for submit() .
+         */
+        template <typename F, typename R>
+        struct submit_job final : pool_job, pooled
+        {
+            submit_job(F&& f, future_state<R>* s) : fn(std::move(f)), state(s) {}
+            ~submit_job() override
+            {
+                if (state) { // dropped without running
+                    state->set(R(error_type(NO_RESOURCE)));
+                    state->release();
+                }
+            }
+            void execute() noexcept override
+            {
+                state->set(invoke_as_result(fn));
+                state->release();
+                state = nullptr;
+            }
+            F                fn;
+            future_state<R>* state;
+        };
+
+        /** Parameter of a callable with one non template call operator (void when it is not known) .
+         *
+         * Result<int> converts to int through operator bool, so f(int) and f(Result<int>)
+         * are told apart by the declared parameter, not by invocability.
+         */
+        template <typename M>
+        struct call_arg {using type = void;};
+        template <typename R, typename C, typename A>
+        struct call_arg<R (C::*)(A)> {using type = A;};
+        template <typename R, typename C, typename A>
+        struct call_arg<R (C::*)(A) const> {using type = A;};
+        template <typename R, typename C, typename A>
+        struct call_arg<R (C::*)(A) noexcept> {using type = A;};
+        template <typename R, typename C, typename A>
+        struct call_arg<R (C::*)(A) const noexcept> {using type = A;};
+        template <typename F, typename = void>
+        struct sole_arg {using type = void;};
+        template <typename F>
+        struct sole_arg<F, std::void_t<decltype(&F::operator())>> : call_arg<decltype(&F::operator())> {};
+        template <typename R, typename A>
+        struct sole_arg<R (*)(A)> {using type = A;};
+        template <typename R, typename A>
+        struct sole_arg<R (*)(A) noexcept> {using type = A;};
+        /** f takes the whole Result S: declared f(S) or, for generic / overloaded f, invocable with S .
+         */
+        template <typename F, typename S, typename A = typename sole_arg<F>::type>
+        inline constexpr bool takes_result = std::is_same_v<std::remove_cvref_t<A>, S>;
+        template <typename F, typename S>
+        inline constexpr bool takes_result<F, S, void> = std::is_invocable_v<F&, S&&>;
+        /** Continuation of Future<S>::then(f) producing Result D .
+         *
+         * f(Result) gets the whole result, f(value) only runs on success (error passes through).
+         */
+        template <typename F, typename S, typename D>
+        struct then_job final : pool_job, pooled
+        {
+            then_job(F&& f, future_state<S>* s, future_state<D>* d) : fn(std::move(f)), src(s), dst(d) {}
+            ~then_job() override
+            {
+                if (src) {
+                    dst->set(D(error_type(NO_RESOURCE)));
+                    src->release();
+                    dst->release();
+                }
+            }
+            void execute() noexcept override
+            {
+                dst->set(apply(fn, std::move(*src->value)));
+                src->release();
+                dst->release();
+                src = nullptr;
+            }
+            static auto apply(F& f, S&& v) noexcept -> D
+            {
+                using T = typename result_value<S>::type;
+                if constexpr (takes_result<F, S>) {
+                    return invoke_as_result(f, std::move(v));
+                } else {
+                    if (! v) return D(v.error_info());
+                    if constexpr (std::is_void_v<T>) return invoke_as_result(f);
+                    else return invoke_as_result(f, std::move(v).value());
+                }
+            }
+            F                fn;
+            future_state<S>* src;
+            future_state<D>* dst;
+        };
+        /** Result type of then(f) on Future<S> .
+         */
+        template <typename F, typename S, typename T = typename result_value<S>::type>
+        struct then_result
+        {
+            using type = invoke_as_result_t<F&, T&&>;
+        };
+        template <typename F, typename S>
+        struct then_result<F, S, void>
+        {
+            using type = invoke_as_result_t<F&>;
+        };
+        template <typename F, typename S, bool Whole = takes_result<F, S>>
+        struct then_whole : then_result<F, S> {};
+        template <typename F, typename S>
+        struct then_whole<F, S, true>
+        {
+            using type = invoke_as_result_t<F&, S&&>;
+        };
+        template <typename F, typename S>
+        using then_result_t = typename then_whole<F, S>::type;
+        /** Inline continuation calling g(index, Result&&) .
+         */
+        template <typename S, typename G>
+        struct notify_job final : pool_job, pooled
+        {
+            notify_job(future_state<S>* s, size_type i, G g) : src(s), index(i), sink(g) {}
+            ~notify_job() override {if (src) src->release();}
+            void execute() noexcept override
+            {
+                sink(index, std::move(*src->value));
+                src->release();
+                src = nullptr;
+            }
+            future_state<S>* src;
+            size_type        index;
+            G                sink;
+        };
+    } //<-- namespace Internal ends here.
+
+    /** Future of Result .
+     *
+     * Move only handle of a value produced by submit() or a continuation.
+     * Prefer then() in pool jobs, get() on a worker executes other jobs while waiting.
+     * @code
+     * auto f = submit(pool, [] {return parse();})                  // Future<Result<Msg>>
+     *     .then([](Msg&& m) {return m.size();})                     // runs only on success
+     *     .then([](Result<size_type>&& r) {return r ? 1 : 0;});     // sees errors too
+     * auto r = std::move(f).get();                                  // Result<int>
+     * @endcode
+     *
+     *  \tparam R Result<T>
+     */
+    template <typename R>
+    class Future
+    {
+        static_assert(Internal::is_result<R>::value, "Future holds Result<T>");
+        using state_type = Internal::future_state<R>;
+    public:
+        using result_type = R;
+        using value_type  = typename Internal::result_value<R>::type;
+        Future() noexcept = default;
+        explicit Future(state_type* s) noexcept : m_state(s) {}
+        Future(const Future&) = delete;
+        Future& operator=(const Future&) = delete;
+        Future(Future&& rhs) noexcept : m_state(std::exchange(rhs.m_state, nullptr)) {}
+        Future& operator=(Future&& rhs) noexcept
+        {
+            if (this != &rhs) {
+                reset();
+                m_state = std::exchange(rhs.m_state, nullptr);
+            }
+            return *this;
+        }
+        ~Future() {reset();}
+        auto valid() const noexcept -> bool {return m_state != nullptr;}
+        auto ready() const noexcept -> bool {return m_state && m_state->ready();}
+        /** Block until ready (a worker helps its pool meanwhile) .
+         */
+        auto wait() const noexcept -> void {if (m_state) m_state->wait();}
+        /** Take the result (waits), invalid future gives FAIL_ARG .
+         */
+        auto get() && -> R
+        {
+            if (! m_state) return R(error_type(FAIL_ARG));
+            m_state->wait();
+            R r(std::move(*m_state->value));
+            reset();
+            return r;
+        }
+        /** Continue with f when ready, never blocks .
+         *
+         * f(Result<T>) (or generic f(auto)) sees errors, f(T) (or f() for void) runs only on success.
+         * f runs as a job of the producing pool (inline when there is none).
+         *  \retval Future of f's result (T -> Result<T>, Result<U> as is)
+         */
+        template <typename F>
+        auto then(F&& f) && -> Future<Internal::then_result_t<std::decay_t<F>, R>>
+        {
+            using D = Internal::then_result_t<std::decay_t<F>, R>;
+            if (! m_state) return make_error<D>(nullptr, FAIL_ARG);
+            auto dst = new Internal::future_state<D>(m_state->pool);
+            auto src = std::exchange(m_state, nullptr);
+            src->attach(new Internal::then_job<std::decay_t<F>, R, D>(std::forward<F>(f), src, dst), false);
+            return Future<D>(dst);
+        }
+        /** Call g(index, R&&) on the completing thread (for combinators) .
+         *
+         * An invalid future arrives at once with FAIL_ARG.
+         */
+        template <typename G>
+        auto notify(size_type index, G g) && -> void
+        {
+            if (! m_state) {
+                g(index, R(error_type(FAIL_ARG)));
+                return;
+            }
+            auto src = std::exchange(m_state, nullptr);
+            src->attach(new Internal::notify_job<R, G>(src, index, g), true);
+        }
+        auto pool() const noexcept -> ThreadPool* {return m_state ? m_state->pool : nullptr;}
+    private:
+        template <typename D>
+        static auto make_error(ThreadPool* p, return_code c) -> Future<D>
+        {
+            auto s = new Internal::future_state<D>(p, 1);
+            s->set(D(error_type(c)));
+            return Future<D>(s);
+        }
+        auto reset() noexcept -> void
+        {
+            if (m_state) std::exchange(m_state, nullptr)->release();
+        }
+        state_type* m_state = nullptr;
+    }; //<-- class Future ends here.
+
+    /** Run f() in pool, Future of its Result .
+     *
+     * f may return T, Result<T> or void. When the pool is stopping the Future holds NO_RESOURCE.
+     */
+    template <typename F>
+    auto submit(ThreadPool& pool, F&& f) -> Future<Internal::invoke_as_result_t<std::decay_t<F>&>>
+    {
+        using R = Internal::invoke_as_result_t<std::decay_t<F>&>;
+        auto s = new Internal::future_state<R>(&pool);
+        auto j = new Internal::submit_job<std::decay_t<F>, R>(std::decay_t<F>(std::forward<F>(f)), s);
+        if (pool.post_job(j) != OK) delete j; // sets NO_RESOURCE
+        return Future<R>(s);
+    }
+    /** Already ready Future .
+     */
+    template <typename R>
+    auto make_ready_future(R r, ThreadPool* pool = nullptr) -> Future<R>
+    {
+        auto s = new Internal::future_state<R>(pool, 1);
+        s->set(std::move(r));
+        return Future<R>(s);
+    }
+
+    namespace Internal {
+        template <typename T>
+        using all_result_t = std::conditional_t<std::is_void_v<T>, Result<void>, Result<std::vector<T>>>;
+        template <typename T>
+        using any_result_t = std::conditional_t<std::is_void_v<T>, Result<size_type>, Result<std::pair<size_type, T>>>;
+        template <typename T>
+        struct all_state : pooled
+        {
+            using out_type = all_result_t<T>;
+            explicit all_state(size_type n, future_state<out_type>* o) : left(n), slots(n), out(o) {}
+            auto arrive(size_type i, Result<T>&& r) noexcept -> void
+            {
+                slots[i].emplace(std::move(r));
+                if (left.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+                out->set(collect());
+                out->release();
+                delete this;
+            }
+            auto collect() noexcept -> out_type
+            {
+                for (auto& r : slots) {
+                    if (! *r) return out_type(r->error_info());
+                }
+                if constexpr (std::is_void_v<T>) {
+                    return out_type();
+                } else {
+                    try {
+                        std::vector<T> v;
+                        v.reserve(slots.size());
+                        for (auto& r : slots) v.push_back(std::move(*r).value());
+                        return out_type(std::move(v));
+                    } catch (...) {
+                        return out_type(error_type(NO_RESOURCE));
+                    }
+                }
+            }
+            std::atomic<size_type>        left;
+            std::vector<std::optional<Result<T>>> slots;
+            future_state<out_type>*       out;
+        };
+        template <typename T>
+        struct any_state : pooled
+        {
+            using out_type = any_result_t<T>;
+            explicit any_state(size_type n, future_state<out_type>* o) : left(n), failed(0), out(o) {}
+            auto arrive(size_type i, Result<T>&& r) noexcept -> void
+            {
+                if (r) {
+                    if (! won.exchange(true, std::memory_order_acq_rel)) {
+                        if constexpr (std::is_void_v<T>) out->set(out_type(i));
+                        else out->set(out_type(std::pair<size_type, T>(i, std::move(r).value())));
+                    }
+                } else if (failed.fetch_add(1, std::memory_order_acq_rel) + 1 == total()) {
+                    out->set(out_type(r.error_info())); // every input failed, last error
+                }
+                if (left.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+                out->release();
+                delete this;
+            }
+            auto total() const noexcept -> size_type {return n_total;}
+            std::atomic<size_type>        left;
+            std::atomic<size_type>        failed;
+            std::atomic<bool>             won {false};
+            size_type                     n_total = 0;
+            future_state<out_type>*       out;
+        };
+        template <typename... T>
+        struct tuple_state : pooled
+        {
+            using out_type = Result<std::tuple<T...>>;
+            explicit tuple_state(future_state<out_type>* o) : out(o) {}
+            template <size_type I, typename U>
+            auto arrive(Result<U>&& r) noexcept -> void
+            {
+                std::get<I>(slots).emplace(std::move(r));
+                if (left.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+                out->set(collect(std::index_sequence_for<T...>{}));
+                out->release();
+                delete this;
+            }
+            template <size_type... I>
+            auto collect(std::index_sequence<I...>) noexcept -> out_type
+            {
+                const error_type* e = nullptr;
+                ((e = (e || *std::get<I>(slots)) ? e : &std::get<I>(slots)->error_info()), ...);
+                if (e) return out_type(*e);
+                return out_type(std::tuple<T...>(std::move(*std::get<I>(slots)).value()...));
+            }
+            std::atomic<size_type>        left {sizeof...(T)};
+            std::tuple<std::optional<Result<T>>...> slots;
+            future_state<out_type>*       out;
+        };
+    } //<-- namespace Internal ends here.
+
+    /** Future of all values (first error in input order wins) .
+     *
+     *  \retval Future<Result<std::vector<T>>> (Future<Result<void>> for void)
+     */
+    template <typename T>
+    auto when_all(std::vector<Future<Result<T>>>&& fs) -> Future<Internal::all_result_t<T>>
+    {
+        using O = Internal::all_result_t<T>;
+        ThreadPool* pool = fs.empty() ? nullptr : fs.front().pool();
+        if (fs.empty()) {
+            if constexpr (std::is_void_v<T>) return make_ready_future(O(), pool);
+            else return make_ready_future(O(std::vector<T>{}), pool);
+        }
+        auto out = new Internal::future_state<O>(pool);
+        auto all = new Internal::all_state<T>(fs.size(), out);
+        for (size_type i = 0; i < fs.size(); ++i) {
+            std::move(fs[i]).notify(i, [all](size_type k, Result<T>&& r) {all->arrive(k, std::move(r));});
+        }
+        return Future<O>(out);
+    }
+    /** Future of the first successful value and its index (last error when every input failed) .
+     *
+     *  \retval Future<Result<std::pair<size_type, T>>> (Future<Result<size_type>> for void)
+     */
+    template <typename T>
+    auto when_any(std::vector<Future<Result<T>>>&& fs) -> Future<Internal::any_result_t<T>>
+    {
+        using O = Internal::any_result_t<T>;
+        ThreadPool* pool = fs.empty() ? nullptr : fs.front().pool();
+        if (fs.empty()) return make_ready_future(O(error_type(NO_DATA)), pool);
+        auto out = new Internal::future_state<O>(pool);
+        auto any = new Internal::any_state<T>(fs.size(), out);
+        any->n_total = fs.size();
+        for (size_type i = 0; i < fs.size(); ++i) {
+            std::move(fs[i]).notify(i, [any](size_type k, Result<T>&& r) {any->arrive(k, std::move(r));});
+        }
+        return Future<O>(out);
+    }
+    /** Future of a tuple of values from different types (first error in argument order wins) .
+     */
+    template <typename... T>
+    auto when_all(Future<Result<T>>&&... fs) -> Future<Result<std::tuple<T...>>>
+    {
+        static_assert(sizeof...(T) > 0 && (! std::is_void_v<T> && ...), "when_all(f...) needs non void values");
+        using O = Result<std::tuple<T...>>;
+        ThreadPool* pool = (fs.pool(), ...);
+        auto out = new Internal::future_state<O>(pool);
+        auto st = new Internal::tuple_state<T...>(out);
+        [&]<size_type... I>(std::index_sequence<I...>) {
+            (std::move(fs).notify(I, [st](size_type, auto&& r) {st->template arrive<I>(std::move(r));}), ...);
+        }(std::index_sequence_for<T...>{});
+        return Future<O>(out);
+    }
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_FUTURE_Hpp ends here.
@@ -0,0 +1,299 @@
+/**
+ * @file hex_dump.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Streaming hex / xxd / control code renderer
+ *
+ * Every renderer encodes into a fixed size stack chunk and hands the chunk to a sink,
+ * so dumping a large frame never allocates per byte.
+ * A sink is any callable of the form return_code(const char*, size_type).
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_HEX_DUMP_Hpp
+# define  MULT_HEX_DUMP_Hpp
+
+# include <array>
+# include <cerrno>
+# include <cstring>
+# include <ostream>
+# include <type_traits>
+# include <unistd.h>
+
+# if defined (__AVX2__) || defined (__SSSE3__)
+#  include <immintrin.h>
+# endif
+
+# include "mult.hpp"
+
+namespace Mult {
+    static constexpr size_type HEX_DUMP_CHUNK = 4096; //!< output chunk size for every renderer
+    static constexpr size_type XXD_LINE_BYTES = 16;   //!< source bytes per xxd line
+
+    template <typename S>
+    using is_dump_sink_requirement = std::is_invocable_r<return_code, S&, const char*, size_type>;
+
+    namespace Internal {
+        static constexpr char hexDigitTbl[] = "0123456789abcdef";
+        /** Readable token for one byte (max 5 chars) .
+         */
+        struct readable_token
+        {
+            char          text[5];
+            std::uint8_t  length;
+        };
+        static constexpr auto make_readable_tbl()
+        {
+            constexpr const char* low[0x20] = {
+                "[NUL]","[SOH]","[STX]","[ETX]","[EOT]","[ENQ]","[ACK]","[BEL]",
+                "[ BS]","[ HT]","[ LF]","[ VT]","[ FF]","[ CR]","[ SO]","[ SI]",
+                "[DEL]","[DC1]","[DC2]","[DC3]","[DC4]","[NAK]","[SYN]","[ETB]",
+                "[CAN]","[ EM]","[SUB]","[ESC]","[ FS]","[ GS]","[ RS]","[ US]",
+            };
+            std::array<readable_token, 256> tbl{};
+            auto set = [&tbl](size_type i, const char* s) {
+                for (std::uint8_t j = 0; j < 5; ++j) tbl[i].text[j] = s[j];
+                tbl[i].length = 5;
+            };
+            for (size_type i = 0; i < 256; ++i) {
+                if (i < 0x20) {
+                    set(i, low[i]);
+                } else if (i == 0x20) {
+                    set(i, "[SPC]");
+                } else if (i == 0x7f) {
+                    set(i, "[DEL]");
+                } else if (i == 0xff) {
+                    set(i, "[EOF]");
+                } else if (i > 0x7f) {
+                    char s[5] = {'[', hexDigitTbl[i >> 4], hexDigitTbl[i & 0x0f], 'H', ']'};
+                    set(i, s);
+                } else {
+                    tbl[i].text[0] = static_cast<char>(i);
+                    tbl[i].length = 1;
+                }
+            }
+            return tbl;
+        }
+        static constexpr auto readableTbl = make_readable_tbl(); //!< byte to readable token
+        /** Encode n bytes into 2n hex characters (no terminator) .
+         *
+         * Scalar tail is table driven, bulk is done by pshufb nibble lookup when SSSE3/AVX2 is enabled
+         *  \retval pointer of after the last written character
+         */
+        inline char* hex_encode(const char* src, size_type n, char* dst) noexcept
+        {
+            auto s = reinterpret_cast<const std::uint8_t*>(src);
+            auto e = s + n;
+# if defined (__AVX2__)
+            const __m256i lut  = _mm256_setr_epi8('0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f',
+                                                  '0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f');
+            const __m256i mask = _mm256_set1_epi8(0x0f);
+            for (; e - s >= 32; s += 32, dst += 64) {
+                auto in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+                auto hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(in, 4), mask));
+                auto lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(in, mask));
+                auto a  = _mm256_unpacklo_epi8(hi, lo); // bytes 0-7 | 16-23
+                auto b  = _mm256_unpackhi_epi8(hi, lo); // bytes 8-15 | 24-31
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst),      _mm256_permute2x128_si256(a, b, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32), _mm256_permute2x128_si256(a, b, 0x31));
+            }
+# endif
+# if defined (__SSSE3__)
+            const __m128i lut16  = _mm_setr_epi8('0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f');
+            const __m128i mask16 = _mm_set1_epi8(0x0f);
+            for (; e - s >= 16; s += 16, dst += 32) {
+                auto in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+                auto hi = _mm_shuffle_epi8(lut16, _mm_and_si128(_mm_srli_epi16(in, 4), mask16));
+                auto lo = _mm_shuffle_epi8(lut16, _mm_and_si128(in, mask16));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),      _mm_unpacklo_epi8(hi, lo));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi8(hi, lo));
+            }
+# endif
+            for (; s != e; ++s) {
+                *dst++ = hexDigitTbl[*s >> 4];
+                *dst++ = hexDigitTbl[*s & 0x0f];
+            }
+            return dst;
+        }
+        /** Render one xxd line ("00000000: 4865 6c6c 6f0a  ... Hello.") .
+         *
+         *  \retval pointer of after the last written character
+         */
+        inline char* xxd_line(const char* src, size_type n, std::uint64_t offset, char* dst) noexcept
+        {
+            int digits = (offset > 0xffffffffULL) ? 16 : 8;
+            for (int i = digits - 1; i >= 0; --i) {
+                *dst++ = hexDigitTbl[(offset >> (i * 4)) & 0x0f];
+            }
+            *dst++ = ':';
+            *dst++ = ' ';
+            char hex[XXD_LINE_BYTES * 2];
+            std::memset(hex, ' ', sizeof(hex));
+            hex_encode(src, n, hex);
+            for (size_type i = 0; i < XXD_LINE_BYTES * 2; i += 4, dst += 5) {
+                std::memcpy(dst, hex + i, 4);
+                dst[4] = ' ';
+            }
+            *dst++ = ' ';
+            for (size_type i = 0; i < n; ++i) {
+                auto c = static_cast<std::uint8_t>(src[i]);
+                *dst++ = (c >= 0x20 && c < 0x7f) ? static_cast<char>(c) : '.';
+            }
+            *dst++ = '\n';
+            return dst;
+        }
+        static constexpr size_type XXD_LINE_MAX = 16 + 2 + XXD_LINE_BYTES * 2 + XXD_LINE_BYTES / 2 + 1 + XXD_LINE_BYTES + 1;
+    } //<-- namespace Internal ends here.
+
+    /** Sink to caller provided memory .
+     *
+     * Return OVER_FLOW when the memory is exhausted (written() keeps the accepted length)
+     */
+    class MemorySink
+    {
+    public:
+        MemorySink(char* dst, size_type capacity) noexcept : m_dst(dst), m_capacity(capacity) {}
+        return_code operator()(const char* p, size_type n) noexcept
+        {
+            if (m_capacity - m_written < n) return OVER_FLOW;
+            std::memcpy(m_dst + m_written, p, n);
+            m_written += n;
+            return OK;
+        }
+        auto written() const noexcept -> size_type {return m_written;}
+    private:
+        char*     m_dst;
+        size_type m_capacity;
+        size_type m_written = 0;
+    }; //<-- class MemorySink ends here.
+    /** Sink to file descriptor .
+     *
+     * Return IO_ERROR_BASE - errno when write(2) fails
+     */
+    class FdSink
+    {
+    public:
+        explicit FdSink(int fd) noexcept : m_fd(fd) {}
+        return_code operator()(const char* p, size_type n) noexcept
+        {
+            while (n > 0) {
+                auto w = ::write(m_fd, p, n);
+                if (w < 0) {
+                    if (errno == EINTR) continue;
+                    return IO_ERROR_BASE - errno;
+                }
+                p += w;
+                n -= static_cast<size_type>(w);
+            }
+            return OK;
+        }
+    private:
+        int m_fd;
+    }; //<-- class FdSink ends here.
+    /** Sink to std::ostream .
+     */
+    class StreamSink
+    {
+    public:
+        explicit StreamSink(std::ostream& os) noexcept : m_os(os) {}
+        return_code operator()(const char* p, size_type n) noexcept
+        {
+            m_os.write(p, static_cast<std::streamsize>(n));
+            return (m_os) ? OK : IO_ERROR_BASE;
+        }
+    private:
+        std::ostream& m_os;
+    }; //<-- class StreamSink ends here.
+
+    /** Hex dump (plain "48656c6c6f") into the sink .
+     *
+     *  \param[in] src dump target
+     *  \param[in] n length of src
+     *  \param[inout] sink output
+     *  \retval OK dumped
+     *  \retval other error code from the sink
+     */
+    template <typename Sink>
+    inline auto hex_dump_to(const char* src, size_type n, Sink&& sink) -> return_code
+    {
+        static_assert(is_dump_sink_requirement<std::remove_reference_t<Sink>>::value, "Sink must be callable as return_code(const char*, size_type)");
+        char chunk[HEX_DUMP_CHUNK];
+        constexpr size_type step = HEX_DUMP_CHUNK / 2;
+        while (n > 0) {
+            auto l = (n < step) ? n : step;
+            auto e = Internal::hex_encode(src, l, chunk);
+            if (auto r = sink(chunk, static_cast<size_type>(e - chunk)); r != OK) return r;
+            src += l;
+            n   -= l;
+        }
+        return OK;
+    }
+    /** Hex dump in xxd style (offset, grouped hex and ASCII column) into the sink .
+     *
+     *  \param[in] src dump target
+     *  \param[in] n length of src
+     *  \param[inout] sink output
+     *  \param[in] offset printed offset of src[0]
+     */
+    template <typename Sink>
+    inline auto xxd_dump_to(const char* src, size_type n, Sink&& sink, std::uint64_t offset = 0) -> return_code
+    {
+        static_assert(is_dump_sink_requirement<std::remove_reference_t<Sink>>::value, "Sink must be callable as return_code(const char*, size_type)");
+        char chunk[HEX_DUMP_CHUNK];
+        char* p = chunk;
+        while (n > 0) {
+            auto l = (n < XXD_LINE_BYTES) ? n : XXD_LINE_BYTES;
+            p = Internal::xxd_line(src, l, offset, p);
+            src    += l;
+            n      -= l;
+            offset += l;
+            if (static_cast<size_type>(chunk + HEX_DUMP_CHUNK - p) < Internal::XXD_LINE_MAX || n == 0) {
+                if (auto r = sink(chunk, static_cast<size_type>(p - chunk)); r != OK) return r;
+                p = chunk;
+            }
+        }
+        return OK;
+    }
+    /** Control codes to readable tokens ("[STX]Hello[ETX]") into the sink .
+     *
+     *  \param[in] src target
+     *  \param[in] n length of src
+     *  \param[inout] sink output
+     */
+    template <typename Sink>
+    inline auto readable_ctrl_code_to(const char* src, size_type n, Sink&& sink) -> return_code
+    {
+        static_assert(is_dump_sink_requirement<std::remove_reference_t<Sink>>::value, "Sink must be callable as return_code(const char*, size_type)");
+        char chunk[HEX_DUMP_CHUNK];
+        char* p = chunk;
+        for (size_type i = 0; i < n; ++i) {
+            const auto& t = Internal::readableTbl[static_cast<std::uint8_t>(src[i])];
+            std::memcpy(p, t.text, sizeof(t.text));
+            p += t.length;
+            if (static_cast<size_type>(chunk + HEX_DUMP_CHUNK - p) < sizeof(t.text)) {
+                if (auto r = sink(chunk, static_cast<size_type>(p - chunk)); r != OK) return r;
+                p = chunk;
+            }
+        }
+        if (p != chunk) return sink(chunk, static_cast<size_type>(p - chunk));
+        return OK;
+    }
+    /** Length of readable_ctrl_code_to output .
+     */
+    inline auto readable_ctrl_code_length(const char* src, size_type n) noexcept -> size_type
+    {
+        size_type l = 0;
+        for (size_type i = 0; i < n; ++i) {
+            l += Internal::readableTbl[static_cast<std::uint8_t>(src[i])].length;
+        }
+        return l;
+    }
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_HEX_DUMP_Hpp ends here.
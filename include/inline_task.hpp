@@ -0,0 +1,137 @@
+/**
+ * @file inline_task.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Move only void() callable with inline storage (small buffer), no virtual call
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_INLINE_TASK_Hpp
+# define  MULT_INLINE_TASK_Hpp
+
+# include <concepts>
+# include <cstddef>
+# include <cstring>
+# include <new>
+# include <type_traits>
+# include <utility>
+
+# include "mult.hpp"
+
+namespace Mult {
+    /** Move only task (void()) .
+     *
+     * Callables up to INLINE_SIZE bytes (nothrow movable, fundamental alignment) are stored inline,
+     * bigger ones on the heap. Calling is one indirect call through a function pointer, trivially
+     * copyable callables are moved with memcpy and need no destructor call.
+     * The object is one cache line (64 bytes on LP64).
+     * @code
+     * InlineTask t([p = ptr, n] {p->consume(n);}); // no allocation
+     * thread_pool.post(std::move(t));
+     * @endcode
+     */
+    class InlineTask final
+    {
+        struct ops
+        {
+            void (*relocate)(void* dst, void* src) noexcept; //!< move construct dst, destroy src (nullptr = memcpy)
+            void (*destroy)(void* p) noexcept;               //!< nullptr = trivial
+        };
+    public:
+        static constexpr size_type INLINE_SIZE = 48;
+        /** true when F is stored without allocation .
+         */
+        template <typename F>
+        static constexpr bool stored_inline = sizeof(F) <= INLINE_SIZE
+                                             && alignof(F) <= alignof(std::max_align_t)
+                                             && std::is_nothrow_move_constructible_v<F>;
+
+        InlineTask() noexcept = default;
+        template <typename F>
+        requires (! std::same_as<std::decay_t<F>, InlineTask>) && std::is_invocable_v<std::decay_t<F>&>
+        InlineTask(F&& f) // NOLINT implicit like std::function
+        {
+            using D = std::decay_t<F>;
+            if constexpr (stored_inline<D>) {
+                ::new (static_cast<void*>(m_buffer)) D(std::forward<F>(f));
+                m_invoke = [](void* p) {(*static_cast<D*>(p))();};
+                m_ops = inline_ops<D>();
+            } else {
+                *reinterpret_cast<D**>(m_buffer) = new D(std::forward<F>(f));
+                m_invoke = [](void* p) {(**static_cast<D**>(p))();};
+                m_ops = heap_ops<D>();
+            }
+        }
+        InlineTask(const InlineTask&) = delete;
+        InlineTask& operator=(const InlineTask&) = delete;
+        InlineTask(InlineTask&& rhs) noexcept {take(rhs);}
+        InlineTask& operator=(InlineTask&& rhs) noexcept
+        {
+            if (this != &rhs) {
+                reset();
+                take(rhs);
+            }
+            return *this;
+        }
+        ~InlineTask() {reset();}
+        /** Run the task (it stays valid and can run again) .
+         *
+         * Calling an empty task is undefined, check with operator bool.
+         */
+        void operator()() {m_invoke(m_buffer);}
+        explicit operator bool() const noexcept {return m_invoke != nullptr;}
+        /** Destroy the callable, the task becomes empty .
+         */
+        void reset() noexcept
+        {
+            if (m_ops && m_ops->destroy) m_ops->destroy(m_buffer);
+            m_invoke = nullptr;
+            m_ops = nullptr;
+        }
+    private:
+        template <typename D>
+        static auto inline_ops() noexcept -> const ops*
+        {
+            if constexpr (std::is_trivially_copyable_v<D> && std::is_trivially_destructible_v<D>) {
+                static constexpr ops o {nullptr, nullptr};
+                return &o;
+            } else {
+                static constexpr ops o {
+                    [](void* dst, void* src) noexcept {
+                        ::new (dst) D(std::move(*static_cast<D*>(src)));
+                        static_cast<D*>(src)->~D();
+                    },
+                    [](void* p) noexcept {static_cast<D*>(p)->~D();}
+                };
+                return &o;
+            }
+        }
+        template <typename D>
+        static auto heap_ops() noexcept -> const ops*
+        {
+            static constexpr ops o {nullptr, [](void* p) noexcept {delete *static_cast<D**>(p);}}; // the pointer is memcpy'd
+            return &o;
+        }
+        void take(InlineTask& rhs) noexcept
+        {
+            if (! rhs.m_ops) return;
+            if (rhs.m_ops->relocate) rhs.m_ops->relocate(m_buffer, rhs.m_buffer);
+            else std::memcpy(m_buffer, rhs.m_buffer, INLINE_SIZE);
+            m_invoke = rhs.m_invoke;
+            m_ops = rhs.m_ops;
+            rhs.m_invoke = nullptr;
+            rhs.m_ops = nullptr;
+        }
+        alignas(std::max_align_t) unsigned char m_buffer[INLINE_SIZE];
+        void (*m_invoke)(void*) = nullptr;
+        const ops* m_ops = nullptr;
+    }; //<-- class InlineTask ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_INLINE_TASK_Hpp ends here.
@@ -0,0 +1,106 @@
+/**
+ * @file block_pool.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Per thread recycling of small fixed size blocks (future states, jobs, coroutine frames)
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef BLOCK_POOL_Hpp
+# define  BLOCK_POOL_Hpp
+
+# include <cstddef>
+# include <new>
+
+# include "mult.hpp"
+
+namespace Mult {
+    namespace Internal {
+        /** Per thread free list of fixed size blocks .
+         *
+         * A block goes to the list of the thread that frees it, not back to its allocator.
+         * Reuse pays when the same threads allocate and free (pool workers posting nested jobs),
+         * a thread that only allocates (posting to a pool from outside) still calls operator new
+         * every time. Falls back to operator new/delete when the list is full or the thread is exiting.
+         */
+        template <size_type Size>
+        struct block_pool
+        {
+            static constexpr size_type LIMIT = 1024;
+            struct node {node* next;};
+            struct cache
+            {
+                node*     head  = nullptr;
+                size_type count = 0;
+                ~cache()
+                {
+                    while (head) {
+                        auto n = head->next;
+                        ::operator delete(head);
+                        head = n;
+                    }
+                    dead() = true;
+                }
+            };
+            static auto dead() noexcept -> bool& {thread_local bool d = false; return d;}
+            static auto local() noexcept -> cache& {thread_local cache c; return c;}
+            static auto allocate() -> void*
+            {
+                if (! dead()) {
+                    auto& c = local();
+                    if (auto n = c.head) {
+                        c.head = n->next;
+                        --c.count;
+                        return n;
+                    }
+                }
+                return ::operator new(Size);
+            }
+            static auto deallocate(void* p) noexcept -> void
+            {
+                if (! dead()) {
+                    auto& c = local();
+                    if (c.count < LIMIT) {
+                        auto n = static_cast<node*>(p);
+                        n->next = c.head;
+                        c.head = n;
+                        ++c.count;
+                        return;
+                    }
+                }
+                ::operator delete(p);
+            }
+        };
+        /** Class specific new/delete through block_pool size classes .
+         */
+        struct pooled
+        {
+            static auto operator new(std::size_t n) -> void*
+            {
+                if (n <= 64)  return block_pool<64>::allocate();
+                if (n <= 128) return block_pool<128>::allocate();
+                if (n <= 256) return block_pool<256>::allocate();
+                if (n <= 512) return block_pool<512>::allocate();
+                if (n <= 1024) return block_pool<1024>::allocate();
+                return ::operator new(n);
+            }
+            static auto operator delete(void* p, std::size_t n) noexcept -> void
+            {
+                if (n <= 64)  return block_pool<64>::deallocate(p);
+                if (n <= 128) return block_pool<128>::deallocate(p);
+                if (n <= 256) return block_pool<256>::deallocate(p);
+                if (n <= 512) return block_pool<512>::deallocate(p);
+                if (n <= 1024) return block_pool<1024>::deallocate(p);
+                ::operator delete(p);
+            }
+        };
+    } //<-- namespace Internal ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  BLOCK_POOL_Hpp ends here.
@@ -0,0 +1,220 @@
+/**
+ * @file mapped_file.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Memory mapped file as ByteBuffer source
+ *
+ * The file is mapped privately (the file is never modified, writing through the buffer is copy on write)
+ * and read through the ByteBuffer read cursor. Pages ahead of the cursor are requested by
+ * MADV_WILLNEED window by window, pages behind the cursor are dropped by MADV_DONTNEED,
+ * so resident memory stays around a few windows for any file size. Dropping stops once share()
+ * handed out a writable alias, it would throw away the alias' copy on write changes.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_MAPPED_FILE_Hpp
+# define  MULT_MAPPED_FILE_Hpp
+
+# include <cerrno>
+# include <string>
+# include <string_view>
+
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+
+# include "byte_buffer.hpp"
+
+namespace Mult {
+    /** Options for MappedFile::open .
+     */
+    struct map_options
+    {
+        size_type window           {4 * 1024 * 1024}; //!< read ahead / release unit [byte]
+        bool      sequential       {true};            //!< MADV_SEQUENTIAL for whole mapping
+        bool      release_consumed {true};            //!< MADV_DONTNEED for pages behind the read cursor (until share())
+    };
+    /** Read only memory mapped file .
+     *
+     * buffer() is a ByteBuffer which refers to the mapping (is_borrowed(), size() == file size).
+     * read()/position()/put_back() move its read cursor and advise the kernel by window.
+     * share() makes another ByteBuffer on the same mapping (independent cursor, the mapping lives
+     * until the last one is gone).
+     * @code
+     * MappedFile f;
+     * if (f.open("capture.bin") != OK) ...
+     * while (f.remain() >= sizeof(header)) {
+     *     auto h = f.read(sizeof(header));  // std::string_view, no copy
+     *     ...
+     * }
+     * @endcode
+     */
+    class MappedFile
+    {
+    public:
+        MappedFile() noexcept : m_buffer(ZERO) {}
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) noexcept = default;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&&) noexcept = default;
+        ~MappedFile() = default;
+        /** Map file .
+         *
+         *  \param[in] path file path
+         *  \param[in] opt options
+         *  \retval OK mapped (empty file is mapped as empty buffer)
+         *  \retval IO_ERROR_BASE - errno open/fstat/mmap failed
+         */
+        auto open(const std::string& path, const map_options& opt = map_options{}) noexcept -> return_code
+        {
+            close();
+            auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return IO_ERROR_BASE - errno;
+            struct stat st;
+            if (::fstat(fd, &st) != 0) {
+                auto e = errno;
+                ::close(fd);
+                return IO_ERROR_BASE - e;
+            }
+            auto n = static_cast<size_type>(st.st_size);
+            if (n == 0) {
+                ::close(fd);
+                m_options = opt;
+                return OK;
+            }
+            auto p = ::mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            auto e = errno;
+            ::close(fd); // mapping keeps the file
+            if (p == MAP_FAILED) return IO_ERROR_BASE - e;
+            m_keeper = ByteBuffer::keeper_type(p, [n](void* q) {::munmap(q, n);});
+            m_buffer = ByteBuffer(ByteBuffer::released{static_cast<char*>(p), n, n, m_keeper});
+            m_options = opt;
+            m_options.window = align_down(m_options.window + page_size() - 1); // madvise needs page aligned address
+            if (m_options.window == 0) m_options.window = page_size();
+            if (m_options.sequential) ::madvise(p, n, MADV_SEQUENTIAL);
+            m_released = 0;
+            m_advised = 0;
+            m_next = 0;
+            m_shared = false;
+            advise();
+            return OK;
+        }
+        /** Unmap (shared buffers keep the mapping alive) .
+         */
+        auto close() noexcept -> void
+        {
+            m_buffer = ByteBuffer(ZERO);
+            m_keeper.reset();
+            m_shared = false;
+            m_released = 0;
+            m_advised = 0;
+            m_next = 0;
+        }
+        auto is_open() const noexcept -> bool {return static_cast<bool>(m_keeper);}
+        auto size() const noexcept {return m_buffer.size();}
+        auto const_ptr() const noexcept {return m_buffer.const_ptr();}
+        /** Mapped contents as ByteBuffer .
+         *
+         * \note Contents behind the read cursor may be dropped (release_consumed), touching them reads the file again.
+         */
+        auto buffer() const noexcept -> const ByteBuffer& {return m_buffer;}
+        /** Another ByteBuffer on the same mapping (no copy) .
+         *
+         * The alias is writable (copy on write), from now on consumed pages are no longer dropped.
+         */
+        auto share() const noexcept -> ByteBuffer
+        {
+            if (! is_open()) return ByteBuffer(ZERO);
+            m_shared = true;
+            return ByteBuffer(ByteBuffer::released{const_cast<char*>(m_buffer.const_ptr()), size(), size(), m_keeper});
+        }
+        /** Read 1 byte at cursor .
+         *
+         * \exception std::out_of_range no more data
+         */
+        auto read() -> char
+        {
+            auto c = m_buffer.read();
+            if (m_buffer.position() >= m_next) advise();
+            return c;
+        }
+        /** Read n bytes at cursor without copy .
+         *
+         *  \retval view of read bytes (shorter than n at end of file)
+         */
+        auto read(size_type n) noexcept -> std::string_view
+        {
+            auto pos = m_buffer.position();
+            if (n > size() - pos) n = size() - pos;
+            m_buffer.position(pos + n);
+            if (pos + n >= m_next) advise();
+            return std::string_view(m_buffer.const_ptr() + pos, n);
+        }
+        auto put_back() noexcept -> return_code {return m_buffer.put_back();}
+        auto position() const noexcept {return m_buffer.position();}
+        /** Set read cursor .
+         *
+         *  \retval OK moved
+         *  \retval OUT_OF_RANGE newPos is over size()
+         */
+        auto position(size_type newPos) noexcept -> return_code
+        {
+            auto rc = m_buffer.position(newPos);
+            if (rc == OK) {
+                if (newPos < m_released) m_released = align_down(newPos); // moving back re-faults pages
+                m_advised = align_down(newPos);
+                advise();
+            }
+            return rc;
+        }
+        auto remain() const noexcept {return size() - position();}
+        static auto page_size() noexcept -> size_type
+        {
+            static const size_type s = static_cast<size_type>(::sysconf(_SC_PAGESIZE));
+            return s;
+        }
+    private:
+        auto align_down(size_type v) const noexcept -> size_type {return v - v % page_size();}
+        /** Request the window ahead of cursor and drop pages behind it .
+         */
+        auto advise() noexcept -> void
+        {
+            auto base = const_cast<char*>(m_buffer.const_ptr());
+            if (! base) return;
+            auto pos = m_buffer.position();
+            auto w = m_options.window;
+            if (m_advised < size() && pos + w / 2 >= m_advised) {
+                auto from = (m_advised > pos) ? m_advised : align_down(pos);
+                auto to = (from + w < size()) ? from + w : size();
+                ::madvise(base + from, to - from, MADV_WILLNEED);
+                m_advised = to;
+            }
+            auto release = m_options.release_consumed && ! m_shared;
+            if (release && pos >= m_released + 2 * w) {
+                auto to = align_down(pos - w); // keep one window behind the cursor for put_back/peek
+                ::madvise(base + m_released, to - m_released, MADV_DONTNEED);
+                m_released = to;
+            }
+            // next call is when cursor reaches the middle of the window or 2 windows from released pages
+            auto ahead = (m_advised < size()) ? m_advised - w / 2 : size() + 1;
+            auto behind = release ? m_released + 2 * w : size() + 1;
+            m_next = (ahead < behind) ? ahead : behind;
+        }
+        ByteBuffer  m_buffer;
+        ByteBuffer::keeper_type m_keeper {}; //!< unmaps when the last buffer on the mapping is gone
+        map_options m_options {};
+        size_type   m_released {0}; //!< pages before this offset were dropped
+        size_type   m_advised  {0}; //!< pages before this offset were requested
+        size_type   m_next     {0}; //!< cursor offset which needs next advise()
+        mutable bool m_shared  {false}; //!< share() handed out a writable alias, keep every page
+    }; //<-- class MappedFile ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_MAPPED_FILE_Hpp ends here.
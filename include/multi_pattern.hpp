@@ -0,0 +1,341 @@
+/**
+ * @file multi_pattern.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Multi pattern matcher (Aho-Corasick) for ByteBuffer
+ *
+ * Patterns are compiled to a DFA over byte classes (bytes not in any pattern share one class),
+ * transitions are premultiplied state offsets in one flat table and the state which has
+ * output is flagged in its high bit, so the scan loop is one load per byte.
+ * While the automaton is at root, bytes which cannot start a pattern are skipped by
+ * SIMD set membership test (nibble lookup by pshufb) on AVX2 or SSSE3.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_MULTI_PATTERN_Hpp
+# define  MULT_MULTI_PATTERN_Hpp
+
+# include <cstdint>
+# include <cstring>
+# include <string>
+# include <string_view>
+# include <type_traits>
+# include <vector>
+
+# if defined (__AVX2__) || defined (__SSSE3__)
+#  include <immintrin.h>
+# endif
+
+# include "byte_buffer.hpp"
+# include "result.hpp"
+
+namespace Mult {
+    /** Reported match .
+     */
+    struct pattern_match
+    {
+        size_type id;     //!< pattern id (order of add())
+        size_type offset; //!< offset of the first byte in the scanned stream
+        size_type length; //!< pattern length
+    };
+    /** Sink requirement, return other than OK stops scanning .
+     */
+    template <typename S>
+    using is_match_sink_requirement = std::is_invocable_r<return_code, S&, const pattern_match&>;
+
+    namespace Internal {
+        /** Byte set as nibble tables (bit h of lo[l] is set when byte (h << 4 | l) is member, h < 8 and h >= 8 separated) .
+         */
+        struct byte_set_tables
+        {
+            alignas(16) std::uint8_t lo0[16] {};
+            alignas(16) std::uint8_t lo1[16] {};
+            alignas(16) std::uint8_t hi0[16] {};
+            alignas(16) std::uint8_t hi1[16] {};
+        };
+        inline byte_set_tables make_byte_set_tables(const bool (&member)[256]) noexcept
+        {
+            byte_set_tables t;
+            for (int b = 0; b < 256; ++b) {
+                if (! member[b]) continue;
+                auto h = b >> 4, l = b & 0x0f;
+                if (h < 8) t.lo0[l] |= static_cast<std::uint8_t>(1 << h);
+                else       t.lo1[l] |= static_cast<std::uint8_t>(1 << (h - 8));
+            }
+            for (int h = 0; h < 16; ++h) {
+                t.hi0[h] = (h < 8) ? static_cast<std::uint8_t>(1 << h) : 0;
+                t.hi1[h] = (h < 8) ? 0 : static_cast<std::uint8_t>(1 << (h - 8));
+            }
+            return t;
+        }
+        /** Offset of the first member byte in [p, p + n), n when no member .
+         */
+        inline size_type find_byte_in_set(const std::uint8_t* p, size_type n, const byte_set_tables& t, const bool* member) noexcept
+        {
+            size_type i = 0;
+# if defined (__AVX2__)
+            auto lo0 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.lo0)));
+            auto lo1 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.lo1)));
+            auto hi0 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.hi0)));
+            auto hi1 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.hi1)));
+            auto nib = _mm256_set1_epi8(0x0f);
+            for (; i + 32 <= n; i += 32) {
+                auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                auto l = _mm256_and_si256(v, nib);
+                auto h = _mm256_and_si256(_mm256_srli_epi16(v, 4), nib);
+                auto r = _mm256_or_si256(_mm256_and_si256(_mm256_shuffle_epi8(lo0, l), _mm256_shuffle_epi8(hi0, h)),
+                                         _mm256_and_si256(_mm256_shuffle_epi8(lo1, l), _mm256_shuffle_epi8(hi1, h)));
+                auto m = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(r, _mm256_setzero_si256())));
+                if (m) return i + static_cast<size_type>(__builtin_ctz(m));
+            }
+# elif defined (__SSSE3__)
+            auto lo0 = _mm_load_si128(reinterpret_cast<const __m128i*>(t.lo0));
+            auto lo1 = _mm_load_si128(reinterpret_cast<const __m128i*>(t.lo1));
+            auto hi0 = _mm_load_si128(reinterpret_cast<const __m128i*>(t.hi0));
+            auto hi1 = _mm_load_si128(reinterpret_cast<const __m128i*>(t.hi1));
+            auto nib = _mm_set1_epi8(0x0f);
+            for (; i + 16 <= n; i += 16) {
+                auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                auto l = _mm_and_si128(v, nib);
+                auto h = _mm_and_si128(_mm_srli_epi16(v, 4), nib);
+                auto r = _mm_or_si128(_mm_and_si128(_mm_shuffle_epi8(lo0, l), _mm_shuffle_epi8(hi0, h)),
+                                      _mm_and_si128(_mm_shuffle_epi8(lo1, l), _mm_shuffle_epi8(hi1, h)));
+                auto m = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(r, _mm_setzero_si128()))) ^ 0xffffu;
+                if (m) return i + static_cast<size_type>(__builtin_ctz(m));
+            }
+# else
+            (void)t;
+# endif
+            for (; i < n; ++i) {
+                if (member[p[i]]) return i;
+            }
+            return n;
+        }
+    } //<-- namespace Internal ends here.
+
+    /** Compiled multi pattern matcher .
+     *
+     * @code
+     * MultiPatternMatcher m;
+     * m.add("GET ");
+     * m.add("POST ");
+     * m.compile();
+     * m.scan(buffer, [](const pattern_match& r) {...; return OK;});
+     * @endcode
+     * Overlapping matches are all reported, in order of their end position
+     * (longer first for the same end).
+     */
+    class MultiPatternMatcher
+    {
+    public:
+        /** Scan state for streaming (a match can cross chunks) .
+         */
+        struct scan_state
+        {
+            std::uint32_t state  {0};
+            size_type     offset {0}; //!< stream offset of the next chunk
+        };
+        MultiPatternMatcher() = default;
+        /** Add pattern (before compile) .
+         *
+         *  \retval pattern id
+         *  \retval FAIL_ARG empty pattern or already compiled
+         */
+        auto add(std::string_view pattern) -> Result<size_type>
+        {
+            if (pattern.empty() || m_compiled) return Result<size_type>(error_type(FAIL_ARG));
+            m_patterns.emplace_back(pattern);
+            return Result<size_type>(m_patterns.size() - 1);
+        }
+        /** Build automaton .
+         *
+         *  \retval OK
+         *  \retval NO_DATA no pattern
+         *  \retval OVER_FLOW too many states
+         */
+        auto compile() -> return_code
+        {
+            if (m_patterns.empty()) return NO_DATA;
+            build_classes();
+            return build_automaton();
+        }
+        auto is_compiled() const noexcept -> bool {return m_compiled;}
+        auto pattern_count() const noexcept -> size_type {return m_patterns.size();}
+        auto pattern(size_type id) const noexcept -> std::string_view {return m_patterns[id];}
+        auto state_count() const noexcept -> size_type {return m_state_count;}
+        /** Scan a chunk of stream .
+         *
+         *  \param[in,out] st scan state (initial state for the first chunk)
+         *  \retval OK
+         *  \retval NO_RESOURCE not compiled
+         *  \retval other sink result
+         */
+        template <typename Sink>
+        auto scan(scan_state& st, const char* src, size_type n, Sink&& sink) const -> return_code
+        {
+            static_assert(is_match_sink_requirement<std::remove_reference_t<Sink>>::value, "Sink must be callable as return_code(const pattern_match&)");
+            if (! m_compiled) return NO_RESOURCE;
+            auto p = reinterpret_cast<const std::uint8_t*>(src);
+            auto s = st.state;
+            const auto* next = m_next.data();
+            const auto* cls = m_class;
+            size_type i = 0;
+            while (i < n) {
+                if (s == 0 && m_prefilter) {
+                    i += Internal::find_byte_in_set(p + i, n - i, m_first_tables, m_first);
+                    if (i >= n) break;
+                }
+                s = next[(s & ~OUTPUT_FLAG) + cls[p[i]]];
+                ++i;
+                if (s & OUTPUT_FLAG) {
+                    auto rc = report(s & ~OUTPUT_FLAG, st.offset + i, sink);
+                    if (rc != OK) {
+                        st.state = s & ~OUTPUT_FLAG;
+                        st.offset += i;
+                        return rc;
+                    }
+                    s &= ~OUTPUT_FLAG;
+                }
+            }
+            st.state = s;
+            st.offset += n;
+            return OK;
+        }
+        template <typename Sink>
+        auto scan(const char* src, size_type n, Sink&& sink) const -> return_code
+        {
+            scan_state st;
+            return scan(st, src, n, std::forward<Sink>(sink));
+        }
+        template <typename Sink>
+        auto scan(const ByteBuffer& b, Sink&& sink) const -> return_code
+        {
+            return scan(b.const_ptr(), b.size(), std::forward<Sink>(sink));
+        }
+        template <typename Sink>
+        auto scan(scan_state& st, const ByteBuffer& b, Sink&& sink) const -> return_code
+        {
+            return scan(st, b.const_ptr(), b.size(), std::forward<Sink>(sink));
+        }
+        /** Any pattern is in [src, src + n) .
+         */
+        auto contains(const char* src, size_type n) const -> bool
+        {
+            return scan(src, n, [](const pattern_match&) {return FAILURE;}) == FAILURE;
+        }
+    private:
+        static constexpr std::uint32_t OUTPUT_FLAG = 0x80000000u;
+        template <typename Sink>
+        auto report(std::uint32_t s, size_type end, Sink& sink) const -> return_code
+        {
+            auto index = s / m_class_count;
+            for (auto k = m_out_begin[index]; k < m_out_begin[index + 1]; ++k) {
+                auto id = m_out[k];
+                auto len = m_patterns[id].size();
+                auto rc = sink(static_cast<const pattern_match&>(pattern_match{id, end - len, len}));
+                if (rc != OK) return rc;
+            }
+            return OK;
+        }
+        auto build_classes() -> void
+        {
+            // bytes which appear in no pattern share class 0, each other byte has own class
+            std::memset(m_class, 0, sizeof(m_class));
+            std::memset(m_first, 0, sizeof(m_first));
+            bool used[256] = {};
+            for (const auto& p : m_patterns) {
+                for (auto c : p) used[static_cast<std::uint8_t>(c)] = true;
+                m_first[static_cast<std::uint8_t>(p[0])] = true;
+            }
+            std::uint32_t n = 1;
+            for (int b = 0; b < 256; ++b) {
+                if (used[b]) m_class[b] = n++;
+            }
+            m_class_count = n;
+            size_type first = 0;
+            for (auto f : m_first) first += f ? 1 : 0;
+            m_first_tables = Internal::make_byte_set_tables(m_first);
+            m_prefilter = first <= 64; // skipping pays only when start bytes are selective
+        }
+        auto build_automaton() -> return_code
+        {
+            const auto C = m_class_count;
+            // trie (-1 is no edge)
+            std::vector<std::int64_t> go(C, -1);
+            std::vector<std::vector<size_type>> own(1);
+            for (size_type id = 0; id < m_patterns.size(); ++id) {
+                size_type s = 0;
+                for (auto c : m_patterns[id]) {
+                    auto e = s * C + m_class[static_cast<std::uint8_t>(c)];
+                    if (go[e] < 0) {
+                        go[e] = static_cast<std::int64_t>(own.size());
+                        own.emplace_back();
+                        go.resize(go.size() + C, -1);
+                    }
+                    s = static_cast<size_type>(go[e]);
+                }
+                own[s].push_back(id);
+            }
+            auto states = own.size();
+            if (states * C >= OUTPUT_FLAG) return OVER_FLOW;
+            // BFS for fail links, complete transitions and output lists
+            std::vector<size_type> fail(states, 0), order;
+            order.reserve(states);
+            for (size_type c = 0; c < C; ++c) {
+                if (go[c] < 0) go[c] = 0;
+                else if (go[c] > 0) order.push_back(static_cast<size_type>(go[c]));
+            }
+            std::vector<std::vector<size_type>> out(states);
+            for (size_type k = 0; k < order.size(); ++k) {
+                auto s = order[k];
+                out[s] = own[s];
+                out[s].insert(out[s].end(), out[fail[s]].begin(), out[fail[s]].end());
+                for (size_type c = 0; c < C; ++c) {
+                    auto& e = go[s * C + c];
+                    auto f = static_cast<size_type>(go[fail[s] * C + c]);
+                    if (e < 0) {
+                        e = static_cast<std::int64_t>(f);
+                    } else {
+                        fail[static_cast<size_type>(e)] = f;
+                        order.push_back(static_cast<size_type>(e));
+                    }
+                }
+            }
+            m_next.assign(states * C, 0);
+            for (size_type i = 0; i < states * C; ++i) {
+                auto t = static_cast<size_type>(go[i]);
+                auto v = static_cast<std::uint32_t>(t * C);
+                m_next[i] = out[t].empty() ? v : (v | OUTPUT_FLAG);
+            }
+            m_out_begin.assign(states + 1, 0);
+            m_out.clear();
+            for (size_type s = 0; s < states; ++s) {
+                m_out_begin[s] = static_cast<std::uint32_t>(m_out.size());
+                for (auto id : out[s]) m_out.push_back(static_cast<std::uint32_t>(id));
+            }
+            m_out_begin[states] = static_cast<std::uint32_t>(m_out.size());
+            m_state_count = states;
+            m_compiled = true;
+            return OK;
+        }
+        std::vector<std::string>   m_patterns;
+        std::vector<std::uint32_t> m_next;      //!< [state * classes + class] -> next state * classes (| OUTPUT_FLAG)
+        std::vector<std::uint32_t> m_out_begin; //!< output list of state is m_out[m_out_begin[s], m_out_begin[s + 1])
+        std::vector<std::uint32_t> m_out;
+        std::uint32_t m_class[256] {};          //!< byte -> class
+        bool          m_first[256] {};          //!< byte can start a pattern
+        Internal::byte_set_tables m_first_tables {};
+        std::uint32_t m_class_count {0};
+        size_type     m_state_count {0};
+        bool          m_prefilter {false};
+        bool          m_compiled {false};
+    }; //<-- class MultiPatternMatcher ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_MULTI_PATTERN_Hpp ends here.
@@ -0,0 +1,364 @@
+/**
+ * @file parallel.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Parallel for / reduce / transform / scan / sort over contiguous ranges on ThreadPool
+ *
+ * Ranges are split into chunks of grain items, idle workers and the caller take chunks from a
+ * shared counter. Inputs not larger than one grain run serially on the caller.
+ * Bodies must not throw.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_PARALLEL_Hpp
+# define  MULT_PARALLEL_Hpp
+
+# include <algorithm>
+# include <atomic>
+# include <cstdint>
+# include <functional>
+# include <iterator>
+# include <span>
+# include <type_traits>
+# include <utility>
+# include <vector>
+
+# include "mult.hpp"
+# include "storage.hpp"
+# include "thread_pool.hpp"
+
+namespace Mult {
+    /** Smallest default chunk, below this a task costs more than it saves .
+     */
+    inline constexpr size_type PARALLEL_MIN_GRAIN = 4096;
+
+    namespace Internal {
+        /** Default grain : about 8 chunks per participant, at least PARALLEL_MIN_GRAIN .
+         */
+        inline auto parallel_grain(const ThreadPool& pool, size_type n, size_type grain) noexcept -> size_type
+        {
+            if (grain) return grain;
+            auto per = n / ((pool.worker_count() + 1) * 8);
+            return per > PARALLEL_MIN_GRAIN ? per : PARALLEL_MIN_GRAIN;
+        }
+        /** Call f(c) for c in [0, chunks) on the pool and the caller .
+         */
+        template <typename F>
+        auto run_chunks(ThreadPool& pool, size_type chunks, F&& f) -> void
+        {
+            if (chunks == 0) return;
+            if (chunks == 1) {
+                f(size_type{0});
+                return;
+            }
+            std::atomic<size_type> next {0};
+            auto drain = [&next, chunks, &f] {
+                for (auto c = next.fetch_add(1, std::memory_order_relaxed); c < chunks; c = next.fetch_add(1, std::memory_order_relaxed)) f(c);
+            };
+            WorkGroup g(pool);
+            auto helpers = std::min(pool.worker_count(), chunks - 1);
+            for (size_type k = 0; k < helpers; ++k) {
+                if (g.run(drain) != OK) break; // stopping pool, the caller does the rest
+            }
+            drain();
+            g.wait();
+        }
+        /** Signed or unsigned integer key mapped to unsigned with the same order .
+         */
+        template <typename T>
+        constexpr auto radix_key(T v) noexcept -> std::make_unsigned_t<T>
+        {
+            using U = std::make_unsigned_t<T>;
+            if constexpr (std::is_signed_v<T>) return static_cast<U>(v) ^ (U{1} << (sizeof(T) * 8 - 1));
+            else return v;
+        }
+        /** LSD radix sort, 8 bits per pass, passes where every key has the same digit are skipped .
+         */
+        template <typename T>
+        auto radix_sort(ThreadPool& pool, std::span<T> data, size_type grain) -> void
+        {
+            auto n = data.size();
+            auto chunks = (n + grain - 1) / grain;
+            std::vector<T> tmp(n);
+            std::vector<size_type> counts(chunks * 256);
+            T* src = data.data();
+            T* dst = tmp.data();
+            for (unsigned shift = 0; shift < sizeof(T) * 8; shift += 8) {
+                run_chunks(pool, chunks, [&](size_type c) {
+                    auto h = &counts[c * 256];
+                    std::fill(h, h + 256, size_type{0});
+                    for (size_type i = c * grain, e = std::min(n, i + grain); i < e; ++i) ++h[(radix_key(src[i]) >> shift) & 0xff];
+                });
+                size_type used = 0;
+                for (size_type d = 0; d < 256; ++d) {
+                    size_type total = 0;
+                    for (size_type c = 0; c < chunks; ++c) total += counts[c * 256 + d];
+                    used += total != 0;
+                }
+                if (used == 1) continue; // digit is the same everywhere
+                size_type sum = 0;
+                for (size_type d = 0; d < 256; ++d) { // digit major, chunk minor : stable
+                    for (size_type c = 0; c < chunks; ++c) {
+                        auto v = counts[c * 256 + d];
+                        counts[c * 256 + d] = sum;
+                        sum += v;
+                    }
+                }
+                run_chunks(pool, chunks, [&](size_type c) {
+                    auto o = &counts[c * 256];
+                    for (size_type i = c * grain, e = std::min(n, i + grain); i < e; ++i) dst[o[(radix_key(src[i]) >> shift) & 0xff]++] = src[i];
+                });
+                std::swap(src, dst);
+            }
+            if (src != data.data()) std::copy(src, src + n, data.data());
+        }
+        /** Sample sort : splitters from a sorted sample, parallel bucket scatter, parallel bucket sort .
+         */
+        template <typename T, typename C>
+        auto sample_sort(ThreadPool& pool, std::span<T> data, size_type grain, C comp) -> void
+        {
+            constexpr size_type OVERSAMPLE = 32;
+            auto n = data.size();
+            auto chunks = (n + grain - 1) / grain;
+            auto buckets = std::min<size_type>(std::max<size_type>((pool.worker_count() + 1) * 4, 2), n / OVERSAMPLE + 1);
+            std::vector<T> sample;
+            sample.reserve(buckets * OVERSAMPLE);
+            for (size_type k = 0; k < buckets * OVERSAMPLE; ++k) sample.push_back(data[k * n / (buckets * OVERSAMPLE)]);
+            std::sort(sample.begin(), sample.end(), comp);
+            std::vector<T> splitters;
+            for (size_type b = 1; b < buckets; ++b) splitters.push_back(sample[b * OVERSAMPLE]);
+            auto bucket_of = [&](const T& v) {
+                return static_cast<size_type>(std::upper_bound(splitters.begin(), splitters.end(), v, comp) - splitters.begin());
+            };
+            std::vector<std::uint32_t> where(n);
+            std::vector<size_type> counts(chunks * buckets);
+            run_chunks(pool, chunks, [&](size_type c) {
+                auto h = &counts[c * buckets];
+                for (size_type i = c * grain, e = std::min(n, i + grain); i < e; ++i) {
+                    auto b = bucket_of(data[i]);
+                    where[i] = static_cast<std::uint32_t>(b);
+                    ++h[b];
+                }
+            });
+            std::vector<size_type> bounds(buckets + 1);
+            size_type sum = 0;
+            for (size_type b = 0; b < buckets; ++b) {
+                bounds[b] = sum;
+                for (size_type c = 0; c < chunks; ++c) {
+                    auto v = counts[c * buckets + b];
+                    counts[c * buckets + b] = sum;
+                    sum += v;
+                }
+            }
+            bounds[buckets] = n;
+            std::vector<T> tmp(n);
+            run_chunks(pool, chunks, [&](size_type c) {
+                auto o = &counts[c * buckets];
+                for (size_type i = c * grain, e = std::min(n, i + grain); i < e; ++i) tmp[o[where[i]]++] = std::move(data[i]);
+            });
+            run_chunks(pool, buckets, [&](size_type b) {
+                auto f = tmp.begin() + static_cast<std::ptrdiff_t>(bounds[b]);
+                auto l = tmp.begin() + static_cast<std::ptrdiff_t>(bounds[b + 1]);
+                std::sort(f, l, comp);
+                std::move(f, l, data.begin() + static_cast<std::ptrdiff_t>(bounds[b]));
+            });
+        }
+        template <typename T, typename A>
+        auto span_of(StorageBase<T, A>& s) noexcept -> std::span<T> {return {s.ptr(), s.size()};}
+        template <typename T, typename A>
+        auto span_of(const StorageBase<T, A>& s) noexcept -> std::span<const T> {return {s.const_ptr(), s.size()};}
+    } //<-- namespace Internal ends here.
+
+    /** Call body(begin, end) for chunks of [first, last) .
+     *
+     * @code
+     * parallel_for(pool, 0, buf.size(), [&](size_type b, size_type e) {
+     *     for (auto i = b; i < e; ++i) p[i] = scale * p[i];
+     * });
+     * @endcode
+     *  \param[in] grain items per chunk (0 = auto), ranges up to one grain run on the caller
+     */
+    template <typename F>
+    auto parallel_for(ThreadPool& pool, size_type first, size_type last, F&& body, size_type grain = 0) -> void
+    {
+        if (last <= first) return;
+        auto n = last - first;
+        grain = Internal::parallel_grain(pool, n, grain);
+        if (n <= grain) {
+            body(first, last);
+            return;
+        }
+        Internal::run_chunks(pool, (n + grain - 1) / grain, [&](size_type c) {
+            auto b = first + c * grain;
+            body(b, std::min(last, b + grain));
+        });
+    }
+    /** Call f(item) for every item of data .
+     */
+    template <typename T, typename F>
+    auto parallel_for_each(ThreadPool& pool, std::span<T> data, F&& f, size_type grain = 0) -> void
+    {
+        parallel_for(pool, 0, data.size(), [&](size_type b, size_type e) {
+            for (auto i = b; i < e; ++i) f(data[i]);
+        }, grain);
+    }
+    template <typename T, typename A, typename F>
+    auto parallel_for_each(ThreadPool& pool, StorageBase<T, A>& s, F&& f, size_type grain = 0) -> void
+    {
+        parallel_for_each(pool, Internal::span_of(s), std::forward<F>(f), grain);
+    }
+    /** Reduce chunk results .
+     *
+     * chunk(begin, end) -> R reduces one chunk, combine(R, R) -> R joins chunk results in index
+     * order (deterministic for a given grain, also for floating point).
+     *  \param[in] identity result of an empty range
+     */
+    template <typename R, typename Chunk, typename Combine>
+    auto parallel_reduce(ThreadPool& pool, size_type first, size_type last, R identity, Chunk&& chunk, Combine&& combine, size_type grain = 0) -> R
+    {
+        if (last <= first) return identity;
+        auto n = last - first;
+        grain = Internal::parallel_grain(pool, n, grain);
+        if (n <= grain) return combine(std::move(identity), chunk(first, last));
+        auto chunks = (n + grain - 1) / grain;
+        std::vector<R> partial(chunks, identity);
+        Internal::run_chunks(pool, chunks, [&](size_type c) {
+            auto b = first + c * grain;
+            partial[c] = chunk(b, std::min(last, b + grain));
+        });
+        for (auto& p : partial) identity = combine(std::move(identity), std::move(p));
+        return identity;
+    }
+    /** op-fold of data started from init (op associative) .
+     */
+    template <typename T, typename R, typename Op = std::plus<>>
+    auto parallel_reduce(ThreadPool& pool, std::span<T> data, R init, Op op = {}, size_type grain = 0) -> R
+    {
+        return parallel_reduce(pool, 0, data.size(), std::move(init),
+                               [&](size_type b, size_type e) {
+                                   auto acc = static_cast<R>(data[b]);
+                                   for (auto i = b + 1; i < e; ++i) acc = op(std::move(acc), data[i]);
+                                   return acc;
+                               }, op, grain);
+    }
+    template <typename T, typename A, typename R, typename Op = std::plus<>>
+    auto parallel_reduce(ThreadPool& pool, const StorageBase<T, A>& s, R init, Op op = {}, size_type grain = 0) -> R
+    {
+        return parallel_reduce(pool, Internal::span_of(s), std::move(init), std::move(op), grain);
+    }
+    /** out[i] = f(in[i]) .
+     *
+     *  \retval OK done
+     *  \retval FAIL_ARG out is shorter than in
+     */
+    template <typename T, typename U, typename F>
+    auto parallel_transform(ThreadPool& pool, std::span<T> in, std::span<U> out, F&& f, size_type grain = 0) -> return_code
+    {
+        if (out.size() < in.size()) return FAIL_ARG;
+        parallel_for(pool, 0, in.size(), [&](size_type b, size_type e) {
+            for (auto i = b; i < e; ++i) out[i] = f(in[i]);
+        }, grain);
+        return OK;
+    }
+    template <typename T, typename A, typename U, typename B, typename F>
+    auto parallel_transform(ThreadPool& pool, const StorageBase<T, A>& in, StorageBase<U, B>& out, F&& f, size_type grain = 0) -> return_code
+    {
+        return parallel_transform(pool, Internal::span_of(in), Internal::span_of(out), std::forward<F>(f), grain);
+    }
+    /** Inclusive scan out[i] = in[0] op ... op in[i] (out may be in) .
+     *
+     * Two passes : chunk totals in parallel, serial scan of totals, chunk rescans in parallel.
+     *  \retval OK done
+     *  \retval FAIL_ARG out is shorter than in
+     */
+    template <typename T, typename U, typename Op = std::plus<>>
+    auto parallel_scan(ThreadPool& pool, std::span<T> in, std::span<U> out, Op op = {}, size_type grain = 0) -> return_code
+    {
+        auto n = in.size();
+        if (out.size() < n) return FAIL_ARG;
+        if (n == 0) return OK;
+        grain = Internal::parallel_grain(pool, n, grain);
+        auto serial = [&](size_type b, size_type e, const U* carry) {
+            U acc = carry ? op(*carry, in[b]) : static_cast<U>(in[b]);
+            out[b] = acc;
+            for (auto i = b + 1; i < e; ++i) out[i] = acc = op(std::move(acc), in[i]);
+        };
+        if (n <= grain) {
+            serial(0, n, nullptr);
+            return OK;
+        }
+        auto chunks = (n + grain - 1) / grain;
+        std::vector<U> totals(chunks);
+        Internal::run_chunks(pool, chunks - 1, [&](size_type c) { // last chunk total is not needed
+            auto b = c * grain, e = b + grain;
+            U acc = static_cast<U>(in[b]);
+            for (auto i = b + 1; i < e; ++i) acc = op(std::move(acc), in[i]);
+            totals[c] = std::move(acc);
+        });
+        for (size_type c = 1; c + 1 < chunks; ++c) totals[c] = op(totals[c - 1], totals[c]);
+        Internal::run_chunks(pool, chunks, [&](size_type c) {
+            auto b = c * grain;
+            serial(b, std::min(n, b + grain), c ? &totals[c - 1] : nullptr);
+        });
+        return OK;
+    }
+    template <typename T, typename A, typename Op = std::plus<>>
+    auto parallel_scan(ThreadPool& pool, StorageBase<T, A>& s, Op op = {}, size_type grain = 0) -> return_code
+    {
+        auto sp = Internal::span_of(s);
+        return parallel_scan(pool, sp, sp, std::move(op), grain);
+    }
+    /** Sort data by comp (not stable) .
+     *
+     * Sample sort : buckets from a sorted sample, parallel scatter, buckets sorted in parallel.
+     * Needs n extra items of T.
+     */
+    template <typename T, typename C>
+    requires std::is_invocable_r_v<bool, C&, const T&, const T&>
+    auto parallel_sort(ThreadPool& pool, std::span<T> data, C comp, size_type grain = 0) -> void
+    {
+        auto n = data.size();
+        grain = Internal::parallel_grain(pool, n, grain);
+        if (n <= grain || n > 0xffffffffULL) {
+            std::sort(data.begin(), data.end(), comp);
+            return;
+        }
+        Internal::sample_sort(pool, data, grain, comp);
+    }
+    /** Ascending sort, LSD radix sort for integer keys (stable), sample sort otherwise .
+     */
+    template <typename T>
+    auto parallel_sort(ThreadPool& pool, std::span<T> data, size_type grain = 0) -> void
+    {
+        if constexpr (std::is_integral_v<T> && ! std::is_same_v<T, bool>) {
+            auto n = data.size();
+            grain = Internal::parallel_grain(pool, n, grain);
+            if (n <= grain) {
+                std::sort(data.begin(), data.end());
+                return;
+            }
+            Internal::radix_sort(pool, data, grain);
+        } else {
+            parallel_sort(pool, data, std::less<>{}, grain);
+        }
+    }
+    template <typename T, typename A>
+    auto parallel_sort(ThreadPool& pool, StorageBase<T, A>& s, size_type grain = 0) -> void
+    {
+        parallel_sort(pool, Internal::span_of(s), grain);
+    }
+    template <typename T, typename A, typename C>
+    requires std::is_invocable_r_v<bool, C&, const T&, const T&>
+    auto parallel_sort(ThreadPool& pool, StorageBase<T, A>& s, C comp, size_type grain = 0) -> void
+    {
+        parallel_sort(pool, Internal::span_of(s), std::move(comp), grain);
+    }
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_PARALLEL_Hpp ends here.
@@ -14,39 +14,95 @@
 #ifndef MULT_RESULT_Hpp
 # define  MULT_RESULT_Hpp
 
+# include <exception>
+# include <functional>
+# include <memory>
+# include <source_location>
+# include <string_view>
 # include <type_traits>
+# include <utility>
 # include "mult.hpp"
+# include "error_context.hpp"
 # if 0
 # define MULT_TRACE 1
 #endif
 # include "debug.hpp"
 
 namespace Mult {
-    class bad_result_access : public std::exception {
-    public:
-        explicit bad_result_access(std::string r) : m_reason(std::move(r)) {}
-        virtual auto what() const noexcept(true) -> const char* override
-        {
-            return m_reason.c_str();
-        }
-    private:
-        std::string m_reason;
-    };
-
     using return_code = std::int64_t;
-    struct error_type final
+    /** Error value .
+     *
+     * 8 bytes : code (32bit, every Mult code fits), interned site id of creation point (see error_context.hpp) and category.
+     * The site is interned once on creation (OK and constant evaluation take no site),
+     * copying / propagating never allocates. Aligned to 8 so Result<int> is two eightbytes (two registers).
+     * @code
+     * auto e = error_type(OUT_OF_RANGE);           // site = this line
+     * auto f = e.propagate();                       // same origin, recorded in ErrorTrace when enabled
+     * char msg[128]; e.describe(msg, sizeof(msg));  // "file.cpp:10 func: out of range (-10100)"
+     * @endcode
+     */
+    struct alignas(8) error_type final
     {
         constexpr error_type() = default;
-        constexpr explicit error_type(return_code e) : m_error(e) {}
+        constexpr explicit error_type(return_code e, std::source_location where = std::source_location::current())
+            : error_type(e, category_of(e), where) {}
+        constexpr explicit error_type(return_code e, error_category c, std::source_location where = std::source_location::current())
+            : m_error(static_cast<std::int32_t>(e)), m_category(c)
+        {
+            if (! std::is_constant_evaluated() && e != OK) {
+                m_site = intern_error_site(where);
+                ErrorTrace::record(m_error, m_site, m_site);
+            }
+        }
         constexpr explicit error_type(const error_type&) = default;
         constexpr explicit error_type(error_type&&) = default;
         constexpr error_type& operator=(const error_type& rhs) = default;
-        constexpr error_type& operator=(const error_type&& rhs) noexcept {if (this != &rhs) {m_error = rhs.m_error;} return *this;}
+        constexpr error_type& operator=(error_type&& rhs) noexcept = default;
         ~error_type() = default;
         constexpr auto code() const noexcept ->return_code {return m_error;}
         constexpr auto operator()() const noexcept -> return_code {return m_error;}
-        return_code m_error {-1};
+        constexpr auto category() const noexcept -> error_category {return m_category;}
+        /** Interned site id of creation point (0 unknown) .
+         */
+        constexpr auto site() const noexcept -> std::uint16_t {return m_site;}
+        auto where() const noexcept -> error_site {return error_site_of(m_site);}
+        /** Message text, looked up only when asked .
+         */
+        auto message() const noexcept -> std::string_view {return error_message(m_error);}
+        /** Format into buf (no allocation) .
+         */
+        auto describe(char* buf, size_type n) const noexcept -> size_type {return format_error(buf, n, m_error, m_site);}
+        /** Pass this error on, recording the hop when ErrorTrace is enabled .
+         */
+        auto propagate(std::source_location where = std::source_location::current()) const noexcept -> error_type
+        {
+            if (ErrorTrace::enabled()) ErrorTrace::record(m_error, m_site, intern_error_site(where));
+            return error_type(*this);
+        }
+        std::int32_t   m_error {-1};
+        std::uint16_t  m_site {0};
+        error_category m_category {error_category::generic};
     }; //<-- struct error_type ends here.
+    static_assert(sizeof(error_type) == 8, "error_type must stay 8 bytes");
+
+    /** Exception for invalid access, what() is formatted into fixed storage .
+     */
+    class bad_result_access : public std::exception {
+    public:
+        explicit bad_result_access(const error_type& e) noexcept {e.describe(m_reason, sizeof(m_reason));}
+        explicit bad_result_access(std::string_view r) noexcept
+        {
+            auto n = r.size() < sizeof(m_reason) - 1 ? r.size() : sizeof(m_reason) - 1;
+            r.copy(m_reason, n);
+            m_reason[n] = '\0';
+        }
+        virtual auto what() const noexcept(true) -> const char* override
+        {
+            return m_reason;
+        }
+    private:
+        char m_reason[192] {};
+    };
 
     template <typename T>
     using is_result_requirement = std::conjunction<
@@ -56,9 +112,46 @@ namespace Mult {
         , std::negation<std::is_pointer<T>>
         , std::negation<std::is_same<error_type, T>>
         >;
+    static_assert(std::is_trivially_copyable_v<error_type>, "error_type must stay trivially copyable");
+    template <typename T> class Result;
+    namespace Internal {
+        template <typename T> struct is_result : std::false_type {};
+        template <typename T> struct is_result<Result<T>> : std::true_type {};
+        /** Result<T> copy/move/destroy are trivial (returned in registers when small enough) .
+         */
+        template <typename T>
+        inline constexpr bool is_trivial_result = std::is_trivially_copy_constructible_v<T>
+            && std::is_trivially_move_constructible_v<T>
+            && std::is_trivially_destructible_v<T>;
+        template <typename T>
+        inline constexpr bool is_trivial_assign_result = is_trivial_result<T>
+            && std::is_trivially_copy_assignable_v<T>
+            && std::is_trivially_move_assignable_v<T>;
+        /** Invoke f and wrap its return into Result<U> (Result<void> for void) .
+         */
+        template <typename F, typename... A>
+        constexpr auto result_wrap(F&& f, A&&... a);
+        /** Arguments for in place construction (not a Result / error_type itself) .
+         */
+        template <typename T, typename... Args>
+        inline constexpr bool is_result_emplace_args = std::is_constructible_v<T, Args&&...>
+            && (! std::is_same_v<std::remove_cvref_t<Args>, error_type> && ...)
+            && (! is_result<std::remove_cvref_t<Args>>::value && ...);
+    } //<-- namespace Internal ends here.
     /** Result class .
      *
      * This class can propagate value_type or error_type to caller as appropriate.
+     * Accessors return reference (or move out from rvalue), so heavy value_type is never copied
+     * unless the caller copies it.
+     * @code
+     * auto r = buf.extract(0, 4)                                         // Result<ByteBuffer>
+     *     .transform([](ByteBuffer&& b) {return b.size();})               // Result<size_type>
+     *     .and_then([](size_type n) {return n ? Result<int>(1) : Result<int>(error_type(NO_DATA));})
+     *     .or_else([](const error_type&) {return Result<int>(0);});
+     * @endcode
+     *
+     * When T is trivially copyable and destructible, so is Result<T> (Result<int> comes back in registers).
+     * Result<void> (status only) and Result<T&> (no copy of the referred object) are specialized below.
      *
      *  \tparam T value_type has constraint, that is movable, copyable, not error_type, not pointer and not reference.
      */
@@ -85,12 +178,14 @@ namespace Mult {
          *
          * for create result value from value_type rvalue reference
          */
-        constexpr explicit Result(value_type&& v) : m_has_value(true) {construct_value(v);}
+        constexpr explicit Result(value_type&& v) : m_has_value(true) {construct_value(std::move(v));}
         /** constructor 4 .
          *
          * for create result value with the result object constructing
          */
-        template <class... Args> constexpr Result(Args... args) : m_has_value(true) {construct_value(args ...);}
+        template <class... Args>
+        requires Internal::is_result_emplace_args<T, Args...>
+        constexpr Result(Args&&... args) : m_has_value(true) {construct_value(std::forward<Args>(args)...);}
         // error_type result
         /** constructor 5 .
          *
@@ -101,33 +196,83 @@ namespace Mult {
          *
          * for create error value from error_type rvalue reference
          */
-        constexpr explicit Result(error_type&& e) : m_has_value(false) {construct_error(e);}
-        // /** constructor 7 .
-        //  *
-        //  * for create result value with the result object constructing
-        //  */
-        // template <class Arg> constexpr Result(Arg arg) : m_has_value(false) {construct_error(arg);}
-        // copy move delete
-        //Result(const_reference) = delete;
-        //Result(rvalue_reference) = delete;
-        // reference operator=(const_reference) = delete;
-        // reference operator=(rvalue_reference) = delete;
-        ~Result()
+        constexpr explicit Result(error_type&& e) : m_has_value(false) {construct_error(std::move(e));}
+        /** Copy constructor (trivial when T is trivial) .
+         */
+        constexpr Result(const_reference rhs) requires Internal::is_trivial_result<T> = default;
+        constexpr Result(const_reference rhs) : m_has_value(rhs.m_has_value)
         {
-            if constexpr (! std::is_trivially_destructible_v<value_type>) {
-                // if !m_has_value maybe not constructed
-                if (m_has_value) m_value.~T();
+            if (m_has_value) construct_value(rhs.m_value);
+            else construct_error(rhs.m_error);
+        }
+        /** Move constructor (value is moved, rhs keeps moved from value) .
+         */
+        constexpr Result(rvalue_reference rhs) requires Internal::is_trivial_result<T> = default;
+        constexpr Result(rvalue_reference rhs) noexcept(std::is_nothrow_move_constructible_v<T>) : m_has_value(rhs.m_has_value)
+        {
+            if (m_has_value) construct_value(std::move(rhs.m_value));
+            else construct_error(rhs.m_error);
+        }
+        constexpr reference operator=(const_reference rhs) requires Internal::is_trivial_assign_result<T> = default;
+        constexpr reference operator=(const_reference rhs)
+        {
+            if (this != &rhs) {
+                destroy();
+                m_has_value = rhs.m_has_value;
+                if (m_has_value) construct_value(rhs.m_value);
+                else construct_error(rhs.m_error);
+            }
+            return *this;
+        }
+        constexpr reference operator=(rvalue_reference rhs) requires Internal::is_trivial_assign_result<T> = default;
+        constexpr reference operator=(rvalue_reference rhs) noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            if (this != &rhs) {
+                destroy();
+                m_has_value = rhs.m_has_value;
+                if (m_has_value) construct_value(std::move(rhs.m_value));
+                else construct_error(rhs.m_error);
             }
+            return *this;
+        }
+        /** Destructor (trivial when T is trivially destructible) .
+         */
+        ~Result() requires std::is_trivially_destructible_v<T> = default;
+        ~Result()
+        {
+            destroy();
             // error_type class allways trivially desutructible
             static_assert(std::is_trivially_destructible_v<error_type>, "All way true!!");
         }
         // accssessors
         /**  resut value getter.
          *
-         * if has_value is true
-         *  \retval value in value_type (T)
+         * if has_value is true (not checked)
+         *  \retval reference to value (lvalue Result)
+         *  \retval value moved out (rvalue Result)
          */
-        constexpr auto value() const noexcept -> value_type {return this->m_value;}
+        constexpr auto value() & noexcept -> value_type& {return this->m_value;}
+        constexpr auto value() const& noexcept -> const value_type& {return this->m_value;}
+        constexpr auto value() && noexcept(std::is_nothrow_move_constructible_v<T>) -> value_type {return std::move(this->m_value);}
+        constexpr auto operator*() & noexcept -> value_type& {return this->m_value;}
+        constexpr auto operator*() const& noexcept -> const value_type& {return this->m_value;}
+        constexpr auto operator*() && noexcept -> value_type&& {return std::move(this->m_value);}
+        constexpr auto operator->() noexcept -> value_type* {return std::addressof(this->m_value);}
+        constexpr auto operator->() const noexcept -> const value_type* {return std::addressof(this->m_value);}
+        /** Value or given default .
+         */
+        template <typename U>
+        constexpr auto value_or(U&& d) const& -> value_type
+        {
+            if (m_has_value) return m_value;
+            return static_cast<value_type>(std::forward<U>(d));
+        }
+        template <typename U>
+        constexpr auto value_or(U&& d) && -> value_type
+        {
+            if (m_has_value) return std::move(m_value);
+            return static_cast<value_type>(std::forward<U>(d));
+        }
         /** error Result getter .
          *
          * if !has_value
@@ -135,6 +280,9 @@ namespace Mult {
          * if you need value, use error_type::code() function
          */
         constexpr auto error() const noexcept {return this->m_error();}
+        /** Whole error_type (site, category, message) if !has_value .
+         */
+        constexpr auto error_info() const noexcept -> const error_type& {return this->m_error;}
         /** Check for existence of value.
          *
          *  \retval ture value existence
@@ -146,26 +294,71 @@ namespace Mult {
          *
          */
         constexpr operator bool() const noexcept {return m_has_value;}
+        // combinators
+        /** Chain f(value) -> Result<U> (error is passed through) .
+         */
+        template <typename F> constexpr auto and_then(F&& f) & {return bind<value_type&>(*this, std::forward<F>(f));}
+        template <typename F> constexpr auto and_then(F&& f) const& {return bind<const value_type&>(*this, std::forward<F>(f));}
+        template <typename F> constexpr auto and_then(F&& f) && {return bind<value_type&&>(*this, std::forward<F>(f));}
+        /** Map f(value) -> U into Result<U> (Result<void> for void U, error is passed through) .
+         */
+        template <typename F> constexpr auto transform(F&& f) & {return map<value_type&>(*this, std::forward<F>(f));}
+        template <typename F> constexpr auto transform(F&& f) const& {return map<const value_type&>(*this, std::forward<F>(f));}
+        template <typename F> constexpr auto transform(F&& f) && {return map<value_type&&>(*this, std::forward<F>(f));}
+        /** Recover by f(error) -> Result<T> (value is passed through) .
+         */
+        template <typename F> constexpr auto or_else(F&& f) const& -> Result {return recover<const value_type&>(*this, std::forward<F>(f));}
+        template <typename F> constexpr auto or_else(F&& f) && -> Result {return recover<value_type&&>(*this, std::forward<F>(f));}
     private:
+        template <typename V, typename Self, typename F>
+        static constexpr auto bind(Self& self, F&& f)
+        {
+            using R = std::remove_cvref_t<std::invoke_result_t<F, V>>;
+            static_assert(Internal::is_result<R>::value, "and_then: F must return Result<U>");
+            if (self.m_has_value) return std::invoke(std::forward<F>(f), static_cast<V>(self.m_value));
+            return R(self.m_error);
+        }
+        template <typename V, typename Self, typename F>
+        static constexpr auto map(Self& self, F&& f)
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, V>>;
+            if (self.m_has_value) return Internal::result_wrap(std::forward<F>(f), static_cast<V>(self.m_value));
+            return Result<U>(self.m_error);
+        }
+        template <typename V, typename Self, typename F>
+        static constexpr auto recover(Self& self, F&& f) -> Result
+        {
+            using R = std::remove_cvref_t<std::invoke_result_t<F, const error_type&>>;
+            static_assert(std::is_same_v<R, Result>, "or_else: F must return Result<T>");
+            if (self.m_has_value) return Result(static_cast<V>(self.m_value));
+            return std::invoke(std::forward<F>(f), static_cast<const error_type&>(self.m_error));
+        }
+        constexpr auto destroy() noexcept -> void
+        {
+            if constexpr (! std::is_trivially_destructible_v<value_type>) {
+                // if !m_has_value maybe not constructed
+                if (m_has_value) m_value.~T();
+            }
+        }
         //////////////////////////////////////////////
         // helper value_type / error_type constructors
         //////////////////////////////////////////////
         // value
         // direct construct
         template <class... Args>
-        constexpr auto construct_value(Args&&... args) noexcept -> void {new (std::addressof(m_value)) T(std::forward<Args>(args)...);}
+        constexpr auto construct_value(Args&&... args) noexcept -> void {std::construct_at(std::addressof(m_value), std::forward<Args>(args)...);}
         // copy construct
-        constexpr auto construct_value(const T& v) noexcept -> void {new (std::addressof(m_value)) T(v);}
+        constexpr auto construct_value(const T& v) noexcept -> void {std::construct_at(std::addressof(m_value), v);}
         // move construct
-        constexpr auto construct_value(T&& v) noexcept -> void {new (std::addressof(m_value)) T(std::move(v));}
+        constexpr auto construct_value(T&& v) noexcept -> void {std::construct_at(std::addressof(m_value), std::move(v));}
         // error
         // // direct construct
         // template <class Arg>
         // constexpr auto construct_error(Arg&& arg) noexcept -> void {new (std::addressof(m_error)) error_type(std::forward<Arg>(arg));}
         // copy construct
-        constexpr auto construct_error(const error_type& v) noexcept -> void {new (std::addressof(m_error)) error_type(v);}
+        constexpr auto construct_error(const error_type& v) noexcept -> void {std::construct_at(std::addressof(m_error), v);}
         // move construct
-        constexpr auto construct_error(error_type&& v) noexcept -> void {new (std::addressof(m_error)) error_type(std::move(v));}
+        constexpr auto construct_error(error_type&& v) noexcept -> void {std::construct_at(std::addressof(m_error), std::move(v));}
     private:
         bool m_has_value       = false;
         union {
@@ -174,6 +367,165 @@ namespace Mult {
             error_type m_error;
         };
     }; //<-- class Result ends here.
+
+    /** Result<void> status only result .
+     *
+     * Replacement of raw return_code, default constructed one is success.
+     * Only the code is held (same size as return_code), so error_type(OK) also means success.
+     * @code
+     * auto close_all() -> Result<void>
+     * {
+     *     if (! m_fd) return Result<void>(error_type(NO_RESOURCE));
+     *     return Result<void>();
+     * }
+     * @endcode
+     */
+    template <>
+    class Result<void>
+    {
+    public:
+        using value_type = void;
+        /** Success .
+         */
+        constexpr Result() noexcept = default;
+        /** Error .
+         */
+        constexpr explicit Result(const error_type& e) noexcept : m_error(e) {}
+        constexpr explicit Result(error_type&& e) noexcept : m_error(std::move(e)) {}
+        /** No value to get, only for symmetry with Result<T> .
+         */
+        constexpr auto value() const noexcept -> void {}
+        /** error Result getter (OK when has_value) .
+         */
+        constexpr auto error() const noexcept {return this->m_error();}
+        /** Whole error_type (site, category, message) if !has_value .
+         */
+        constexpr auto error_info() const noexcept -> const error_type& {return this->m_error;}
+        constexpr auto has_value() const noexcept -> bool {return m_error() == OK;}
+        constexpr operator bool() const noexcept {return has_value();}
+        /** Chain f() -> Result<U> .
+         */
+        template <typename F>
+        constexpr auto and_then(F&& f) const
+        {
+            using R = std::remove_cvref_t<std::invoke_result_t<F>>;
+            static_assert(Internal::is_result<R>::value, "and_then: F must return Result<U>");
+            if (has_value()) return std::invoke(std::forward<F>(f));
+            return R(m_error);
+        }
+        /** Map f() -> U into Result<U> .
+         */
+        template <typename F>
+        constexpr auto transform(F&& f) const
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F>>;
+            if (has_value()) return Internal::result_wrap(std::forward<F>(f));
+            return Result<U>(m_error);
+        }
+        /** Recover by f(error) -> Result<void> .
+         */
+        template <typename F>
+        constexpr auto or_else(F&& f) const -> Result
+        {
+            using R = std::remove_cvref_t<std::invoke_result_t<F, const error_type&>>;
+            static_assert(std::is_same_v<R, Result>, "or_else: F must return Result<void>");
+            if (has_value()) return Result();
+            return std::invoke(std::forward<F>(f), static_cast<const error_type&>(m_error));
+        }
+    private:
+        error_type m_error{OK};
+    }; //<-- class Result<void> ends here.
+
+    /** Result<T&> refers to an object owned by someone else .
+     *
+     * Never copies the referred object, the referred object must outlive the Result.
+     * Binding to temporary is rejected at compile time.
+     * @code
+     * auto find(const std::string& k) const -> Result<const Entry&>;
+     * @endcode
+     */
+    template <typename T>
+    class Result<T&>
+    {
+        using value_type = T&;
+    public:
+        constexpr Result() = default;
+        constexpr explicit Result(T& v) noexcept : m_has_value(true), m_ptr(std::addressof(v)) {}
+        Result(const T&&) = delete;
+        constexpr explicit Result(const error_type& e) noexcept : m_has_value(false), m_error(e) {}
+        constexpr explicit Result(error_type&& e) noexcept : m_has_value(false), m_error(std::move(e)) {}
+        /**  resut value getter.
+         *
+         * if has_value is true (not checked)
+         *  \retval reference to referred object
+         */
+        constexpr auto value() const noexcept -> T& {return *m_ptr;}
+        constexpr auto operator*() const noexcept -> T& {return *m_ptr;}
+        constexpr auto operator->() const noexcept -> T* {return m_ptr;}
+        /** Copy of value or given default .
+         */
+        template <typename U>
+        constexpr auto value_or(U&& d) const -> std::remove_cv_t<T>
+        {
+            if (m_has_value) return *m_ptr;
+            return static_cast<std::remove_cv_t<T>>(std::forward<U>(d));
+        }
+        constexpr auto error() const noexcept {return this->m_error();}
+        /** Whole error_type (site, category, message) if !has_value .
+         */
+        constexpr auto error_info() const noexcept -> const error_type& {return this->m_error;}
+        constexpr auto has_value() const noexcept -> bool {return m_has_value;}
+        constexpr operator bool() const noexcept {return m_has_value;}
+        /** Chain f(T&) -> Result<U> .
+         */
+        template <typename F>
+        constexpr auto and_then(F&& f) const
+        {
+            using R = std::remove_cvref_t<std::invoke_result_t<F, T&>>;
+            static_assert(Internal::is_result<R>::value, "and_then: F must return Result<U>");
+            if (m_has_value) return std::invoke(std::forward<F>(f), *m_ptr);
+            return R(m_error);
+        }
+        /** Map f(T&) -> U into Result<U> .
+         */
+        template <typename F>
+        constexpr auto transform(F&& f) const
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, T&>>;
+            if (m_has_value) return Internal::result_wrap(std::forward<F>(f), *m_ptr);
+            return Result<U>(m_error);
+        }
+        /** Recover by f(error) -> Result<T&> .
+         */
+        template <typename F>
+        constexpr auto or_else(F&& f) const -> Result
+        {
+            using R = std::remove_cvref_t<std::invoke_result_t<F, const error_type&>>;
+            static_assert(std::is_same_v<R, Result>, "or_else: F must return Result<T&>");
+            if (m_has_value) return *this;
+            return std::invoke(std::forward<F>(f), static_cast<const error_type&>(m_error));
+        }
+    private:
+        bool m_has_value = false;
+        union {
+            T*         m_ptr = nullptr;
+            error_type m_error;
+        };
+    }; //<-- class Result<T&> ends here.
+
+    namespace Internal {
+        template <typename F, typename... A>
+        constexpr auto result_wrap(F&& f, A&&... a)
+        {
+            using U = std::remove_cvref_t<std::invoke_result_t<F, A...>>;
+            if constexpr (std::is_void_v<U>) {
+                std::invoke(std::forward<F>(f), std::forward<A>(a)...);
+                return Result<void>();
+            } else {
+                return Result<U>(std::invoke(std::forward<F>(f), std::forward<A>(a)...));
+            }
+        }
+    } //<-- namespace Internal ends here.
 } //<-- namespace Mult ends here.
 
     // using error_code = return_code;
@@ -0,0 +1,222 @@
+/**
+ * @file result_batch.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Batch of results (values column + validity bitmap + sparse errors)
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_RESULT_BATCH_Hpp
+# define  MULT_RESULT_BATCH_Hpp
+
+# include <algorithm>
+# include <bit>
+# include <cstdint>
+# include <functional>
+# include <span>
+# include <utility>
+# include <vector>
+
+# include "mult.hpp"
+# include "result.hpp"
+# include "storage.hpp"
+
+namespace Mult {
+    /** Outcome of n items as struct of arrays .
+     *
+     * Values are kept in a StorageBase<T> column, the outcome in a validity bitmap (1 = ok),
+     * error_type only for failed items in a sparse side table. Batch level questions
+     * (all_ok, count_errors) read n / 8 bytes instead of n Results.
+     * Unset items are not ok and report NO_DATA.
+     * @code
+     * auto batch = ResultBatch<Record>::collect(rows.size(), [&](size_type i) {return validate(rows[i]);});
+     * if (! batch.all_ok()) {
+     *     batch.for_each_error([](size_type i, const error_type& e) {log(i, e.code());});
+     * }
+     * @endcode
+     *
+     *  \tparam T value_type (Result and StorageBase requirements)
+     */
+    template <typename T>
+    class ResultBatch
+    {
+        static_assert(is_result_requirement<T>::value, "Necessary the typename T can be copy and move constructible and Not pointer and reference");
+        static_assert(is_storage_contents_requirement<T>::value, "Necessary the typename T can be default constructible");
+    public:
+        using value_type = T;
+        using word_type  = std::uint64_t;
+        static constexpr size_type WORD_BITS = 64;
+        /** Failed item .
+         */
+        struct error_entry
+        {
+            error_entry(size_type i, const error_type& e) : index(i), error(e) {}
+            size_type  index;
+            error_type error;
+        };
+        /** Create n unset items .
+         */
+        explicit ResultBatch(size_type n)
+            : m_size(n)
+            , m_values(n, value_type{})
+            , m_valid(words(n), zero_word())
+        {}
+        /** Build from per item producer f(i) -> Result<T> (or Result<U> convertible) .
+         */
+        template <typename F>
+        static auto collect(size_type n, F&& f) -> ResultBatch
+        {
+            ResultBatch b(n);
+            auto values = b.m_values.ptr();
+            for (size_type k = 0; k < n; k += WORD_BITS) { // one bitmap store per 64 items
+                word_type w = 0;
+                for (size_type i = k, e = std::min(n, k + WORD_BITS); i < e; ++i) {
+                    auto r = std::invoke(f, i);
+                    if (r) {
+                        values[i] = std::move(r).value();
+                        w |= word_type{1} << (i - k);
+                    } else {
+                        b.set_error(i, r.error_info());
+                    }
+                }
+                b.m_valid.ptr()[k / WORD_BITS] = w;
+            }
+            return b;
+        }
+        /** Build from existing results .
+         */
+        static auto collect(std::span<const Result<T>> rs) -> ResultBatch
+        {
+            ResultBatch b(rs.size());
+            for (size_type i = 0; i < rs.size(); ++i) b.set(i, rs[i]);
+            return b;
+        }
+        // setters (setting an item again replaces its outcome)
+        auto set_value(size_type i, const value_type& v) -> void {m_values.ptr()[i] = v; mark(i);}
+        auto set_value(size_type i, value_type&& v) -> void {m_values.ptr()[i] = std::move(v); mark(i);}
+        /** errors stay sorted by index (in order setting appends) .
+         */
+        auto set_error(size_type i, const error_type& e) -> void
+        {
+            m_valid.ptr()[i / WORD_BITS] &= ~(word_type{1} << (i % WORD_BITS));
+            if (m_errors.empty() || m_errors.back().index < i) {
+                m_errors.emplace_back(i, e);
+                return;
+            }
+            auto it = find_error(i);
+            if (it != m_errors.end() && it->index == i) it->error = e;
+            else m_errors.emplace(it, i, e);
+        }
+        template <typename U>
+        auto set(size_type i, const Result<U>& r) -> void
+        {
+            if (r) set_value(i, r.value());
+            else set_error(i, r.error_info());
+        }
+        template <typename U>
+        auto set(size_type i, Result<U>&& r) -> void
+        {
+            if (r) set_value(i, std::move(r).value());
+            else set_error(i, r.error_info());
+        }
+        // per item access
+        auto size() const noexcept -> size_type {return m_size;}
+        auto ok(size_type i) const noexcept -> bool {return (m_valid.const_ptr()[i / WORD_BITS] >> (i % WORD_BITS)) & 1;}
+        auto value(size_type i) noexcept -> value_type& {return m_values.ptr()[i];}
+        auto value(size_type i) const noexcept -> const value_type& {return m_values.const_ptr()[i];}
+        /** Item as Result (no copy of value) .
+         */
+        auto at(size_type i) const -> Result<const value_type&>
+        {
+            if (i >= m_size) return Result<const value_type&>(error_type(OUT_OF_RANGE));
+            if (ok(i)) return Result<const value_type&>(value(i));
+            return Result<const value_type&>(error(i));
+        }
+        /** error of item i (NO_DATA when unset, only meaningful when ! ok(i)) .
+         */
+        auto error(size_type i) const -> const error_type&
+        {
+            auto it = std::lower_bound(m_errors.begin(), m_errors.end(), i, [](const error_entry& e, size_type k) {return e.index < k;});
+            if (it != m_errors.end() && it->index == i) return it->error;
+            return unset_error();
+        }
+        // batch level
+        /** True when every item is ok .
+         */
+        auto all_ok() const noexcept -> bool
+        {
+            if (m_size == 0) return true;
+            auto w = m_valid.const_ptr();
+            auto full = m_size / WORD_BITS;
+            word_type acc = ~word_type{0};
+            for (size_type k = 0; k < full; ++k) acc &= w[k]; // and-reduction, vectorized
+            if (auto rest = m_size % WORD_BITS) {
+                auto mask = (word_type{1} << rest) - 1;
+                acc &= w[full] | ~mask;
+            }
+            return acc == ~word_type{0};
+        }
+        auto count_ok() const noexcept -> size_type
+        {
+            auto w = m_valid.const_ptr();
+            size_type n = 0;
+            for (size_type k = 0, e = words(m_size); k < e; ++k) n += static_cast<size_type>(std::popcount(w[k]));
+            return n;
+        }
+        auto count_errors() const noexcept -> size_type {return m_size - count_ok();}
+        /** Call f(index, const error_type&) for every failed (or unset) item in index order .
+         */
+        template <typename F>
+        auto for_each_error(F&& f) const -> void
+        {
+            auto w = m_valid.const_ptr();
+            auto cursor = m_errors.begin();
+            for (size_type k = 0, e = words(m_size); k < e; ++k) {
+                auto bad = ~w[k];
+                if (k == e - 1 && m_size % WORD_BITS) bad &= (word_type{1} << (m_size % WORD_BITS)) - 1;
+                while (bad) {
+                    auto i = k * WORD_BITS + static_cast<size_type>(std::countr_zero(bad));
+                    bad &= bad - 1;
+                    while (cursor != m_errors.end() && cursor->index < i) ++cursor;
+                    if (cursor != m_errors.end() && cursor->index == i) f(i, cursor->error);
+                    else f(i, unset_error());
+                }
+            }
+        }
+        // raw columns
+        auto values() const noexcept -> const StorageBase<value_type>& {return m_values;}
+        auto validity() const noexcept -> std::span<const word_type> {return {m_valid.const_ptr(), words(m_size)};}
+        auto errors() const -> std::span<const error_entry> {return {m_errors.data(), m_errors.size()};}
+    private:
+        static constexpr auto words(size_type n) noexcept -> size_type {return (n + WORD_BITS - 1) / WORD_BITS;}
+        static auto zero_word() noexcept -> const word_type& {static constexpr word_type z = 0; return z;}
+        static auto unset_error() noexcept -> const error_type&
+        {
+            static constexpr error_type e(NO_DATA);
+            return e;
+        }
+        auto find_error(size_type i) -> typename std::vector<error_entry>::iterator
+        {
+            return std::lower_bound(m_errors.begin(), m_errors.end(), i, [](const error_entry& e, size_type k) {return e.index < k;});
+        }
+        auto mark(size_type i) -> void
+        {
+            m_valid.ptr()[i / WORD_BITS] |= word_type{1} << (i % WORD_BITS);
+            if (m_errors.empty() || m_errors.back().index < i) return; // no stale error possible
+            auto it = find_error(i);
+            if (it != m_errors.end() && it->index == i) m_errors.erase(it);
+        }
+        size_type                        m_size;
+        StorageBase<value_type>          m_values;
+        StorageBase<word_type>           m_valid;
+        std::vector<error_entry>         m_errors;  //!< sorted by index
+    }; //<-- class ResultBatch ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_RESULT_BATCH_Hpp ends here.
@@ -0,0 +1,444 @@
+/**
+ * @file serializer.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Aggregate serializer for ByteBuffer (no hand written encode/decode)
+ *
+ * Fields of an aggregate are found at compile time (brace initialization counts them,
+ * structured binding refers them), so a plain struct is serialized as is.
+ * Field kinds
+ * - scalar     : arithmetic or enum, sizeof(T) bytes in native (little endian) order
+ * - std::string, BufferBase<scalar> : u32 count + contents
+ * - aggregate  : its fields in order (no header)
+ * Adjacent scalar fields which lie without padding in memory (also nested packed aggregates)
+ * are copied by one memcpy, the wire format is same as field by field.
+ * \note Aggregates with base classes, C arrays or bit fields are not supported (up to 32 fields).
+ *
+ * @code
+ * struct order { std::uint64_t id; double price; std::uint32_t qty; std::string symbol; };
+ * ByteBuffer b;
+ * serialize(o, b);
+ * order r;
+ * deserialize(b, r);  // from read cursor
+ * @endcode
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_SERIALIZER_Hpp
+# define  MULT_SERIALIZER_Hpp
+
+# include <bit>
+# include <cstdint>
+# include <cstring>
+# include <string>
+# include <tuple>
+# include <type_traits>
+# include <utility>
+
+# include "buffer.hpp"
+# include "byte_buffer.hpp"
+
+namespace Mult {
+    static_assert(std::endian::native == std::endian::little, "serializer writes native byte order, little endian host only");
+
+    namespace Internal {
+        static constexpr size_type SERIAL_MAX_FIELDS = 32;
+        /** Converts to any field type (unevaluated only) .
+         */
+        struct any_field
+        {
+            template <typename U> operator U() const noexcept;
+        };
+        template <typename T, size_type... I>
+        constexpr bool brace_initializable(std::index_sequence<I...>) noexcept
+        {
+            return requires {T{(void(I), any_field{})...};};
+        }
+        template <typename T, size_type N = SERIAL_MAX_FIELDS>
+        constexpr size_type aggregate_field_count() noexcept
+        {
+            if constexpr (brace_initializable<T>(std::make_index_sequence<N>{})) return N;
+            else if constexpr (N == 0) return 0;
+            else return aggregate_field_count<T, N - 1>();
+        }
+        template <typename T> struct is_buffer_base : std::false_type {};
+        template <typename U> struct is_buffer_base<BufferBase<U>> : std::true_type {using element = U;};
+        inline const char* serial_elements(const std::string& s) noexcept {return s.data();}
+        template <typename U>
+        inline const U* serial_elements(const BufferBase<U>& b) noexcept {return b.const_ptr();}
+    } //<-- namespace Internal ends here.
+
+    /** Number of fields of aggregate T .
+     */
+    template <typename T>
+    inline constexpr size_type field_count_v = Internal::aggregate_field_count<T>();
+
+    /** References to the fields of aggregate t (std::tuple of references) .
+     */
+    template <typename T>
+    constexpr auto tie_fields(T& t) noexcept
+    {
+        constexpr auto N = field_count_v<std::remove_const_t<T>>;
+        static_assert(N >= 1 && N <= Internal::SERIAL_MAX_FIELDS, "T must be an aggregate of 1 to 32 fields");
+        if constexpr (N == 1) {
+            auto& [f0] = t;
+            return std::tie(f0);
+        } else if constexpr (N == 2) {
+            auto& [f0, f1] = t;
+            return std::tie(f0, f1);
+        } else if constexpr (N == 3) {
+            auto& [f0, f1, f2] = t;
+            return std::tie(f0, f1, f2);
+        } else if constexpr (N == 4) {
+            auto& [f0, f1, f2, f3] = t;
+            return std::tie(f0, f1, f2, f3);
+        } else if constexpr (N == 5) {
+            auto& [f0, f1, f2, f3, f4] = t;
+            return std::tie(f0, f1, f2, f3, f4);
+        } else if constexpr (N == 6) {
+            auto& [f0, f1, f2, f3, f4, f5] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5);
+        } else if constexpr (N == 7) {
+            auto& [f0, f1, f2, f3, f4, f5, f6] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6);
+        } else if constexpr (N == 8) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7);
+        } else if constexpr (N == 9) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8);
+        } else if constexpr (N == 10) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9);
+        } else if constexpr (N == 11) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10);
+        } else if constexpr (N == 12) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11);
+        } else if constexpr (N == 13) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12);
+        } else if constexpr (N == 14) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13);
+        } else if constexpr (N == 15) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14);
+        } else if constexpr (N == 16) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15);
+        } else if constexpr (N == 17) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16);
+        } else if constexpr (N == 18) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17);
+        } else if constexpr (N == 19) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18);
+        } else if constexpr (N == 20) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19);
+        } else if constexpr (N == 21) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20);
+        } else if constexpr (N == 22) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21);
+        } else if constexpr (N == 23) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22);
+        } else if constexpr (N == 24) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23);
+        } else if constexpr (N == 25) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24);
+        } else if constexpr (N == 26) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25);
+        } else if constexpr (N == 27) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26);
+        } else if constexpr (N == 28) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27);
+        } else if constexpr (N == 29) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28);
+        } else if constexpr (N == 30) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29);
+        } else if constexpr (N == 31) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30);
+        } else if constexpr (N == 32) {
+            auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30, f31] = t;
+            return std::tie(f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30, f31);
+        }
+    }
+
+    namespace Internal {
+        template <typename T>
+        using field_types_t = decltype(tie_fields(std::declval<T&>()));
+        template <typename T, size_type I>
+        using field_type_t = std::remove_reference_t<std::tuple_element_t<I, field_types_t<T>>>;
+
+        template <typename T>
+        constexpr bool is_serial_scalar() noexcept {return std::is_arithmetic_v<T> || std::is_enum_v<T>;}
+        template <typename T>
+        constexpr bool is_serial_aggregate() noexcept
+        {
+            return std::is_aggregate_v<T> && ! std::is_array_v<T> && ! std::is_union_v<T>
+                && field_count_v<T> >= 1 && field_count_v<T> <= SERIAL_MAX_FIELDS;
+        }
+        template <typename T> constexpr bool is_serializable() noexcept;
+        template <typename T, size_type... I>
+        constexpr bool fields_serializable(std::index_sequence<I...>) noexcept {return (is_serializable<field_type_t<T, I>>() && ...);}
+        template <typename T>
+        constexpr bool is_serializable() noexcept
+        {
+            if constexpr (is_serial_scalar<T>()) return true;
+            else if constexpr (std::is_same_v<T, std::string>) return true;
+            else if constexpr (is_buffer_base<T>::value) return is_serial_scalar<typename is_buffer_base<T>::element>();
+            else if constexpr (is_serial_aggregate<T>()) return fields_serializable<T>(std::make_index_sequence<field_count_v<T>>{});
+            else return false;
+        }
+        /** Copied as raw bytes (memory image is same as wire image) .
+         *
+         * bool is excluded (a broken byte must not become a bool)
+         */
+        template <typename T> constexpr bool is_blittable() noexcept;
+        template <typename T, size_type... I>
+        constexpr bool fields_packed(std::index_sequence<I...>) noexcept
+        {
+            if constexpr (! (is_blittable<field_type_t<T, I>>() && ...)) return false;
+            else return std::is_trivially_copyable_v<T> && (sizeof(field_type_t<T, I>) + ...) == sizeof(T);
+        }
+        template <typename T>
+        constexpr bool is_blittable() noexcept
+        {
+            if constexpr (std::is_same_v<T, bool>) return false;
+            else if constexpr (is_serial_scalar<T>()) return true;
+            else if constexpr (is_serial_aggregate<T>()) return fields_packed<T>(std::make_index_sequence<field_count_v<T>>{});
+            else return false;
+        }
+        /** Offset of field I (declaration order layout) .
+         */
+        template <typename T, size_type I>
+        constexpr size_type field_offset() noexcept
+        {
+            if constexpr (I == 0) return 0;
+            else {
+                constexpr auto end = field_offset<T, I - 1>() + sizeof(field_type_t<T, I - 1>);
+                constexpr auto a = alignof(field_type_t<T, I>);
+                return (end + a - 1) / a * a;
+            }
+        }
+        /** End (exclusive) of the memcpy run which starts at field I .
+         */
+        template <typename T, size_type I>
+        constexpr size_type run_end() noexcept
+        {
+            if constexpr (I + 1 >= field_count_v<T>) return I + 1;
+            else if constexpr (! is_blittable<field_type_t<T, I + 1>>()
+                               || field_offset<T, I + 1>() != field_offset<T, I>() + sizeof(field_type_t<T, I>)) return I + 1;
+            else return run_end<T, I + 1>();
+        }
+
+        template <typename F>
+        inline size_type serial_size(const F& f) noexcept;
+        template <typename T, size_type... I>
+        inline size_type fields_serial_size(const T& t, std::index_sequence<I...>) noexcept
+        {
+            auto f = tie_fields(t);
+            return (serial_size(std::get<I>(f)) + ... + 0);
+        }
+        template <typename F>
+        inline size_type serial_size(const F& f) noexcept
+        {
+            if constexpr (is_serial_scalar<F>()) return sizeof(F);
+            else if constexpr (std::is_same_v<F, std::string>) return 4 + f.size();
+            else if constexpr (is_buffer_base<F>::value) return 4 + f.size() * sizeof(typename is_buffer_base<F>::element);
+            else return fields_serial_size(f, std::make_index_sequence<field_count_v<F>>{});
+        }
+
+        template <typename F>
+        inline bool serial_fits(const F& f) noexcept;
+        template <typename T, size_type... I>
+        inline bool fields_serial_fits(const T& t, std::index_sequence<I...>) noexcept
+        {
+            auto f = tie_fields(t);
+            return (serial_fits(std::get<I>(f)) && ...);
+        }
+        /** Every string / buffer length fits the 32 bit length prefix .
+         */
+        template <typename F>
+        inline bool serial_fits(const F& f) noexcept
+        {
+            if constexpr (is_serial_scalar<F>()) return true;
+            else if constexpr (std::is_same_v<F, std::string> || is_buffer_base<F>::value) return f.size() <= UINT32_MAX;
+            else if constexpr (is_blittable<F>()) return true;
+            else return fields_serial_fits(f, std::make_index_sequence<field_count_v<F>>{});
+        }
+
+        template <typename F>
+        inline char* serial_write(const F& f, char* p) noexcept;
+        template <typename T, size_type I>
+        inline char* fields_write(const T& t, char* p) noexcept
+        {
+            if constexpr (I >= field_count_v<T>) return p;
+            else {
+                auto f = tie_fields(t);
+                if constexpr (is_blittable<field_type_t<T, I>>()) {
+                    constexpr auto J = run_end<T, I>();
+                    constexpr auto n = field_offset<T, J - 1>() + sizeof(field_type_t<T, J - 1>) - field_offset<T, I>();
+                    std::memcpy(p, &std::get<I>(f), n);
+                    return fields_write<T, J>(t, p + n);
+                } else {
+                    return fields_write<T, I + 1>(t, serial_write(std::get<I>(f), p));
+                }
+            }
+        }
+        template <typename F>
+        inline char* serial_write(const F& f, char* p) noexcept
+        {
+            if constexpr (std::is_same_v<F, bool>) {
+                *p = f ? 1 : 0;
+                return p + 1;
+            } else if constexpr (is_serial_scalar<F>()) {
+                std::memcpy(p, &f, sizeof(F));
+                return p + sizeof(F);
+            } else if constexpr (std::is_same_v<F, std::string> || is_buffer_base<F>::value) {
+                auto n = static_cast<std::uint32_t>(f.size());
+                std::memcpy(p, &n, 4);
+                auto bytes = f.size() * sizeof(*serial_elements(f));
+                if (bytes) std::memcpy(p + 4, serial_elements(f), bytes);
+                return p + 4 + bytes;
+            } else {
+                return fields_write<F, 0>(f, p);
+            }
+        }
+        inline const char* serial_take(const char*& p, const char* end, size_type n) noexcept
+        {
+            if (static_cast<size_type>(end - p) < n) return nullptr;
+            auto q = p;
+            p += n;
+            return q;
+        }
+        template <typename F>
+        inline bool serial_read(F& f, const char*& p, const char* end);
+        template <typename T, size_type I>
+        inline bool fields_read(T& t, const char*& p, const char* end)
+        {
+            if constexpr (I >= field_count_v<T>) return true;
+            else {
+                auto f = tie_fields(t);
+                if constexpr (is_blittable<field_type_t<T, I>>()) {
+                    constexpr auto J = run_end<T, I>();
+                    constexpr auto n = field_offset<T, J - 1>() + sizeof(field_type_t<T, J - 1>) - field_offset<T, I>();
+                    auto q = serial_take(p, end, n);
+                    if (! q) return false;
+                    std::memcpy(&std::get<I>(f), q, n);
+                    return fields_read<T, J>(t, p, end);
+                } else {
+                    return serial_read(std::get<I>(f), p, end) && fields_read<T, I + 1>(t, p, end);
+                }
+            }
+        }
+        template <typename F>
+        inline bool serial_read(F& f, const char*& p, const char* end)
+        {
+            if constexpr (std::is_same_v<F, bool>) {
+                auto q = serial_take(p, end, 1);
+                if (! q) return false;
+                f = (*q != 0);
+                return true;
+            } else if constexpr (is_serial_scalar<F>()) {
+                auto q = serial_take(p, end, sizeof(F));
+                if (! q) return false;
+                std::memcpy(&f, q, sizeof(F));
+                return true;
+            } else if constexpr (std::is_same_v<F, std::string> || is_buffer_base<F>::value) {
+                auto q = serial_take(p, end, 4);
+                if (! q) return false;
+                std::uint32_t n;
+                std::memcpy(&n, q, 4);
+                using E = std::remove_cvref_t<decltype(*serial_elements(f))>;
+                if (static_cast<size_type>(end - p) / sizeof(E) < n) return false;
+                q = serial_take(p, end, n * sizeof(E));
+                if constexpr (std::is_same_v<F, std::string>) {
+                    f.assign(q, n);
+                } else {
+                    f.clear();
+                    if (n) std::memcpy(f.prepare(n), q, n * sizeof(E));
+                    f.commit(n);
+                }
+                return true;
+            } else {
+                return fields_read<F, 0>(f, p, end);
+            }
+        }
+        /** Layout check : computed offsets must be same as the compiler's (whole packed aggregate) .
+         */
+        template <typename T>
+        constexpr bool layout_consistent() noexcept
+        {
+            if constexpr (! is_serial_aggregate<T>()) return true;
+            else {
+                constexpr auto N = field_count_v<T>;
+                constexpr auto a = alignof(T);
+                constexpr auto end = field_offset<T, N - 1>() + sizeof(field_type_t<T, N - 1>);
+                return (end + a - 1) / a * a == sizeof(T);
+            }
+        }
+    } //<-- namespace Internal ends here.
+
+    /** Aggregate which serialize()/deserialize() accept .
+     */
+    template <typename T>
+    concept serializable_aggregate = Internal::is_serial_aggregate<T>() && Internal::is_serializable<T>();
+
+    /** Wire size of t [byte] .
+     */
+    template <serializable_aggregate T>
+    inline size_type serialized_size(const T& t) noexcept {return Internal::serial_size(t);}
+    /** Append t to out .
+     *
+     *  \retval OK
+     *  \retval OVER_FLOW string or buffer field is over 4G elements
+     */
+    template <serializable_aggregate T>
+    inline return_code serialize(const T& t, ByteBuffer& out) noexcept
+    {
+        static_assert(Internal::layout_consistent<T>(), "unexpected layout (base class, bit field or no_unique_address ?)");
+        if (! Internal::serial_fits(t)) return OVER_FLOW;
+        auto n = Internal::serial_size(t);
+        auto p = out.prepare(n);
+        Internal::serial_write(t, p);
+        return out.commit(n);
+    }
+    /** Read t from the read cursor of in (cursor moves over it) .
+     *
+     *  \retval OK
+     *  \retval OUT_OF_RANGE in is too short (cursor does not move, t may be partly assigned)
+     */
+    template <serializable_aggregate T>
+    inline return_code deserialize(ByteBuffer& in, T& t)
+    {
+        static_assert(Internal::layout_consistent<T>(), "unexpected layout (base class, bit field or no_unique_address ?)");
+        auto p = in.const_ptr() + in.position();
+        auto begin = p;
+        if (! Internal::serial_read(t, p, in.const_ptr() + in.size())) return OUT_OF_RANGE;
+        return in.position(in.position() + static_cast<size_type>(p - begin));
+    }
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_SERIALIZER_Hpp ends here.
@@ -0,0 +1,223 @@
+/**
+ * @file sha256.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief SHA-256 (FIPS 180-4)
+ *
+ * Compression uses the SHA extensions (SHA-NI) when compiled with them, otherwise scalar.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_SHA256_Hpp
+# define  MULT_SHA256_Hpp
+
+# include <array>
+# include <cstdint>
+# include <cstring>
+# include <string>
+# include <utility>
+
+# if defined (__SHA__) && defined (__SSE4_1__)
+#  include <immintrin.h>
+# endif
+
+# include "mult.hpp"
+
+namespace Mult {
+    using sha256_digest = std::array<std::uint8_t, 32>;
+
+    namespace Internal {
+        alignas(16) static constexpr std::uint32_t sha256K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+        };
+        static constexpr std::uint32_t sha256Init[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+        };
+# if defined (__SHA__) && defined (__SSE4_1__)
+        /** 4 rounds of SHA-NI compression (message schedule of 4 words ahead) .
+         */
+        template <int G>
+        inline void sha256_ni_rounds(__m128i& s0, __m128i& s1, __m128i (&m)[4], const std::uint8_t* data, __m128i mask) noexcept
+        {
+            auto& cur  = m[G % 4];
+            auto& prev = m[(G + 3) % 4];
+            auto& next = m[(G + 1) % 4];
+            if constexpr (G < 4) cur = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * G)), mask);
+            auto msg = _mm_add_epi32(cur, _mm_load_si128(reinterpret_cast<const __m128i*>(sha256K + 4 * G)));
+            s1 = _mm_sha256rnds2_epu32(s1, s0, msg);
+            if constexpr (G >= 3 && G <= 14) {
+                next = _mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4));
+                next = _mm_sha256msg2_epu32(next, cur);
+            }
+            msg = _mm_shuffle_epi32(msg, 0x0e);
+            s0 = _mm_sha256rnds2_epu32(s0, s1, msg);
+            if constexpr (G >= 1 && G <= 12) prev = _mm_sha256msg1_epu32(prev, cur);
+        }
+        template <int... G>
+        inline void sha256_ni_block(__m128i& s0, __m128i& s1, const std::uint8_t* data, __m128i mask, std::integer_sequence<int, G...>) noexcept
+        {
+            __m128i m[4];
+            (sha256_ni_rounds<G>(s0, s1, m, data, mask), ...);
+        }
+        inline void sha256_compress(std::uint32_t* state, const std::uint8_t* data, size_type blocks) noexcept
+        {
+#  if defined (__AVX__)
+            _mm256_zeroupper(); // SHA instructions are legacy SSE only, avoid AVX-SSE transition penalty
+#  endif
+            const auto mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+            auto tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xb1); // CDAB
+            auto s1  = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1b); // EFGH
+            auto s0  = _mm_alignr_epi8(tmp, s1, 8);    // ABEF
+            s1 = _mm_blend_epi16(s1, tmp, 0xf0);       // CDGH
+            for (; blocks > 0; --blocks, data += 64) {
+                auto abef = s0;
+                auto cdgh = s1;
+                sha256_ni_block(s0, s1, data, mask, std::make_integer_sequence<int, 16>{});
+                s0 = _mm_add_epi32(s0, abef);
+                s1 = _mm_add_epi32(s1, cdgh);
+            }
+            tmp = _mm_shuffle_epi32(s0, 0x1b);         // FEBA
+            s1  = _mm_shuffle_epi32(s1, 0xb1);         // DCHG
+            s0  = _mm_blend_epi16(tmp, s1, 0xf0);      // DCBA
+            s1  = _mm_alignr_epi8(s1, tmp, 8);         // HGFE
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state), s0);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), s1);
+        }
+# else
+        constexpr std::uint32_t sha256_rotr(std::uint32_t x, int n) noexcept {return (x >> n) | (x << (32 - n));}
+        inline void sha256_compress(std::uint32_t* state, const std::uint8_t* data, size_type blocks) noexcept
+        {
+            for (; blocks > 0; --blocks, data += 64) {
+                std::uint32_t w[64];
+                for (int i = 0; i < 16; ++i) {
+                    w[i] = (std::uint32_t(data[i * 4]) << 24) | (std::uint32_t(data[i * 4 + 1]) << 16)
+                        | (std::uint32_t(data[i * 4 + 2]) << 8) | std::uint32_t(data[i * 4 + 3]);
+                }
+                for (int i = 16; i < 64; ++i) {
+                    auto s0 = sha256_rotr(w[i - 15], 7) ^ sha256_rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                    auto s1 = sha256_rotr(w[i - 2], 17) ^ sha256_rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+                }
+                auto a = state[0], b = state[1], c = state[2], d = state[3];
+                auto e = state[4], f = state[5], g = state[6], h = state[7];
+                for (int i = 0; i < 64; ++i) {
+                    auto t1 = h + (sha256_rotr(e, 6) ^ sha256_rotr(e, 11) ^ sha256_rotr(e, 25)) + ((e & f) ^ (~e & g)) + sha256K[i] + w[i];
+                    auto t2 = (sha256_rotr(a, 2) ^ sha256_rotr(a, 13) ^ sha256_rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                    h = g; g = f; f = e; e = d + t1;
+                    d = c; c = b; b = a; a = t1 + t2;
+                }
+                state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+                state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+            }
+        }
+# endif
+    } //<-- namespace Internal ends here.
+
+    /** Incremental SHA-256 .
+     *
+     * @code
+     * Sha256 h;
+     * h.update(p, n);
+     * h.update(q, m);
+     * auto digest = h.finish();
+     * @endcode
+     */
+    class Sha256
+    {
+    public:
+        Sha256() noexcept {reset();}
+        void reset() noexcept
+        {
+            std::memcpy(m_state, Internal::sha256Init, sizeof(m_state));
+            m_length = 0;
+            m_used = 0;
+        }
+        void update(const void* src, size_type n) noexcept
+        {
+            auto p = static_cast<const std::uint8_t*>(src);
+            m_length += n;
+            if (m_used) {
+                auto take = (n < 64 - m_used) ? n : 64 - m_used;
+                std::memcpy(m_block + m_used, p, take);
+                m_used += take;
+                p += take;
+                n -= take;
+                if (m_used < 64) return;
+                Internal::sha256_compress(m_state, m_block, 1);
+                m_used = 0;
+            }
+            if (n >= 64) {
+                Internal::sha256_compress(m_state, p, n / 64);
+                p += n & ~size_type(63);
+                n &= 63;
+            }
+            std::memcpy(m_block, p, n);
+            m_used = n;
+        }
+        /** Digest (object is reset for the next message) .
+         */
+        sha256_digest finish() noexcept
+        {
+            auto bits = static_cast<std::uint64_t>(m_length) * 8;
+            m_block[m_used++] = 0x80;
+            if (m_used > 56) {
+                std::memset(m_block + m_used, 0, 64 - m_used);
+                Internal::sha256_compress(m_state, m_block, 1);
+                m_used = 0;
+            }
+            std::memset(m_block + m_used, 0, 56 - m_used);
+            for (int i = 0; i < 8; ++i) m_block[56 + i] = static_cast<std::uint8_t>(bits >> (56 - 8 * i));
+            Internal::sha256_compress(m_state, m_block, 1);
+            sha256_digest d;
+            for (int i = 0; i < 8; ++i) {
+                d[i * 4]     = static_cast<std::uint8_t>(m_state[i] >> 24);
+                d[i * 4 + 1] = static_cast<std::uint8_t>(m_state[i] >> 16);
+                d[i * 4 + 2] = static_cast<std::uint8_t>(m_state[i] >> 8);
+                d[i * 4 + 3] = static_cast<std::uint8_t>(m_state[i]);
+            }
+            reset();
+            return d;
+        }
+    private:
+        std::uint32_t m_state[8];
+        std::uint8_t  m_block[64];
+        size_type     m_length;
+        size_type     m_used;
+    }; //<-- class Sha256 ends here.
+
+    /** SHA-256 of n bytes .
+     */
+    inline sha256_digest sha256(const void* src, size_type n) noexcept
+    {
+        Sha256 h;
+        h.update(src, n);
+        return h.finish();
+    }
+    /** Digest as lower case hex string .
+     */
+    inline std::string to_string(const sha256_digest& d)
+    {
+        static constexpr char hex[] = "0123456789abcdef";
+        std::string s(64, '0');
+        for (size_type i = 0; i < 32; ++i) {
+            s[i * 2]     = hex[d[i] >> 4];
+            s[i * 2 + 1] = hex[d[i] & 0x0f];
+        }
+        return s;
+    }
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_SHA256_Hpp ends here.
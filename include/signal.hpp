@@ -21,6 +21,7 @@
 # include <mutex>
 
 # include "mult.hpp"
+# include "thread_stats.hpp"
 
 namespace Mult {
     /** signal wait cancel exception .
@@ -42,6 +43,19 @@ namespace Mult {
         using cv        = std::condition_variable;
         static constexpr signal_id TIMEOUT = Mult::TIMEOUT;
     public:
+        /** Non blocking waiter (e.g. coroutine awaitable) .
+         *
+         * Queued by wait_async(), takes one update (or the cancel) and is woken outside the lock.
+         */
+        struct waiter
+        {
+            virtual void wake() noexcept = 0;
+            signal_id id       = Mult::OK; //!< taken signal id
+            bool      canceled = false;    //!< true: woken by cancel()
+            waiter*   next     = nullptr;
+        protected:
+            ~waiter() = default;
+        };
         /** Constructor 1 .
          *
          * nessesary default constructable SignalCode as m_id
@@ -56,23 +70,57 @@ namespace Mult {
         ~Signal() = default;
         /**  Update new signal code.
          *
-         *
+         * One update has one taker: the oldest async waiter when one is queued,
+         * a blocking waiter (or the next wait) otherwise.
          */
         void update(const signal_id& x)
         {
             locker guard(m_guard);
+            if (auto w = m_waiters) { // async waiters first, one update each
+                m_waiters = w->next;
+                if (! m_waiters) m_last = nullptr;
+                w->id = x;
+                w->canceled = false;
+                guard.unlock();
+                w->wake();
+                return;
+            }
             m_updated = true;
             m_id = x;
             m_monitor.notify_all();
         }
+        /** Take a pending update / cancel or queue w .
+         *
+         *  \retval true queued, w->wake() is called later
+         *  \retval false taken now (w.id / w.canceled are set), w is not queued
+         */
+        bool wait_async(waiter& w)
+        {
+            locker guard(m_guard);
+            if (m_canceled || m_updated) {
+                w.canceled = m_canceled;
+                w.id = m_id;
+                if (m_canceled) m_canceled = false;
+                else m_updated = false;
+                return false;
+            }
+            w.next = nullptr;
+            if (m_last) m_last->next = &w;
+            else m_waiters = &w;
+            m_last = &w;
+            return true;
+        }
         /** Wait update .
          *
          *
          */
         signal_id wait_update() noexcept(false)
         {
+            Internal::blocked_scope blocked;
             locker guard(m_guard);
+            ++m_blocking;
             m_monitor.wait(guard, [&] {return m_updated || m_canceled;});
+            --m_blocking;
             if (m_canceled) {
                 m_canceled = false;
                 throw canceled_wait_event();
@@ -86,10 +134,13 @@ namespace Mult {
          */
         signal_id wait_for(millisec_interval tout) noexcept(false)
         {
+            Internal::blocked_scope blocked;
             locker guard(m_guard);
+            ++m_blocking;
             auto ret = m_monitor.wait_for(guard
                                        , std::chrono::milliseconds(tout)
                                        , [&] {return m_updated || m_canceled;});
+            --m_blocking;
             if (m_canceled) {
                 m_canceled = false;
                 throw canceled_wait_event();
@@ -106,13 +157,25 @@ namespace Mult {
         }
         /** cancel for wait .
          *
-         *
+         * Every queued async waiter and a blocking waiter take the cancel,
+         * without any waiter it is kept for the next wait.
          */
         void cancel()
         {
             locker guard(m_guard);
-            m_canceled = true;
-            m_monitor.notify_all();
+            auto w = m_waiters;
+            m_waiters = m_last = nullptr;
+            if (! w || m_blocking) {
+                m_canceled = true;
+                m_monitor.notify_all();
+            }
+            guard.unlock(); // async waiters are woken outside the lock
+            while (w) {
+                auto n = w->next;
+                w->canceled = true;
+                w->wake();
+                w = n;
+            }
         }
     private:
         bool      m_updated;  //!< updated flag true: update occurred, false: no update
@@ -120,6 +183,9 @@ namespace Mult {
         signal_id m_id;       //!< signal id
         lock_type m_guard;    //!< resource guard
         cv        m_monitor;  //!< monitor with condition variable
+        waiter*   m_waiters = nullptr; //!< async waiters (FIFO)
+        waiter*   m_last    = nullptr;
+        int       m_blocking = 0;      //!< threads in wait_update() / wait_for()
     }; //<-- class Signal ends here.
 
     /** \class Signal
@@ -0,0 +1,367 @@
+/**
+ * @file snapshot.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Binary snapshot / restore of StorageBase<T> (T is trivially copyable)
+ *
+ * @code
+ * +0  u32 magic "MSNP"      +4  u16 version     +6  u16 header size (64)
+ * +8  u64 type tag          +16 u32 element size +20 u32 element align
+ * +24 u64 count             +32 u32 payload CRC-32C +36 u32 header CRC-32C (this field as 0)
+ * +40 reserved (0) .. +64   payload (count x element size, native byte order)
+ * @endcode
+ * save writes header and payload with one writev to "path.tmp" and renames it to path,
+ * load reads the whole file with one read, map maps it (no copy at all).
+ * SnapshotWriter writes in a child process which sees the storage as a copy on write image,
+ * so the owner keeps modifying it without waiting for the disk.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_SNAPSHOT_Hpp
+# define  MULT_SNAPSHOT_Hpp
+
+# include <climits>
+# include <cerrno>
+# include <cstdint>
+# include <cstring>
+# include <new>
+# include <source_location>
+# include <string>
+# include <string_view>
+# include <type_traits>
+
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/uio.h>
+# include <sys/wait.h>
+# include <unistd.h>
+
+# include "crc32c.hpp"
+# include "storage.hpp"
+
+namespace Mult {
+    static constexpr std::uint32_t SNAPSHOT_MAGIC   = 0x504e534d; // "MSNP"
+    static constexpr std::uint16_t SNAPSHOT_VERSION = 1;
+
+    /** Fixed header of snapshot file .
+     */
+    struct snapshot_header
+    {
+        std::uint32_t magic;
+        std::uint16_t version;
+        std::uint16_t header_size;
+        std::uint64_t type_tag;
+        std::uint32_t element_size;
+        std::uint32_t element_align;
+        std::uint64_t count;
+        std::uint32_t payload_crc;
+        std::uint32_t header_crc;
+        std::uint8_t  reserved[24];
+    };
+    static_assert(sizeof(snapshot_header) == 64 && std::is_trivially_copyable_v<snapshot_header>);
+
+    template <typename T>
+    using is_snapshot_requirement = std::is_trivially_copyable<T>;
+
+    namespace Internal {
+        template <typename T>
+        constexpr std::uint64_t type_hash() noexcept
+        {
+            std::uint64_t h = 0xcbf29ce484222325ULL; // FNV-1a of the signature which names T
+            for (auto p = std::source_location::current().function_name(); *p; ++p) h = (h ^ static_cast<std::uint8_t>(*p)) * 0x100000001b3ULL;
+            return h;
+        }
+    } //<-- namespace Internal ends here.
+
+    /** Type tag written in snapshot .
+     *
+     * Default is made from the type name by the compiler, specialize it when snapshots are shared
+     * between programs built by different compilers.
+     */
+    template <typename T>
+    struct snapshot_tag
+    {
+        static constexpr std::uint64_t value = Internal::type_hash<T>();
+    };
+
+    /** Options for snapshot save / load .
+     */
+    struct snapshot_options
+    {
+        bool sync   {true}; //!< fsync before rename (save)
+        bool verify {true}; //!< check payload CRC (load / map)
+    };
+
+    namespace Internal {
+        template <typename T>
+        inline snapshot_header make_snapshot_header(const T* p, size_type n) noexcept
+        {
+            snapshot_header h{};
+            h.magic         = SNAPSHOT_MAGIC;
+            h.version       = SNAPSHOT_VERSION;
+            h.header_size   = sizeof(snapshot_header);
+            h.type_tag      = snapshot_tag<T>::value;
+            h.element_size  = sizeof(T);
+            h.element_align = alignof(T);
+            h.count         = n;
+            h.payload_crc   = crc32c(p, n * sizeof(T));
+            h.header_crc    = crc32c(&h, sizeof(h));
+            return h;
+        }
+        /** Check header for T and file size .
+         *
+         *  \retval OK
+         *  \retval FAIL_ARG not a snapshot of T
+         *  \retval OUT_OF_RANGE file is truncated
+         */
+        template <typename T>
+        inline return_code check_snapshot_header(snapshot_header h, size_type file_size) noexcept
+        {
+            if (file_size < sizeof(h)) return OUT_OF_RANGE;
+            auto crc = h.header_crc;
+            h.header_crc = 0;
+            if (h.magic != SNAPSHOT_MAGIC || h.version != SNAPSHOT_VERSION || h.header_size != sizeof(h)
+                || crc32c(&h, sizeof(h)) != crc) return FAIL_ARG;
+            if (h.type_tag != snapshot_tag<T>::value || h.element_size != sizeof(T) || h.element_align != alignof(T)) return FAIL_ARG;
+            if (h.count > (file_size - sizeof(h)) / sizeof(T) || file_size - sizeof(h) != h.count * sizeof(T)) return OUT_OF_RANGE;
+            return OK;
+        }
+        /** Write header and payload to path.tmp, then rename to path (async signal safe) .
+         *
+         *  \retval 0 or errno
+         */
+        inline int write_snapshot(const char* tmp, const char* path, const snapshot_header& h, const void* p, size_type bytes, bool sync) noexcept
+        {
+            auto fd = ::open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) return errno;
+            iovec iov[2] = {{const_cast<snapshot_header*>(&h), sizeof(h)}, {const_cast<void*>(p), bytes}};
+            auto io = iov;
+            int cnt = 2;
+            while (cnt > 0) {
+                auto w = ::writev(fd, io, cnt);
+                if (w < 0) {
+                    if (errno == EINTR) continue;
+                    auto e = errno;
+                    ::close(fd);
+                    ::unlink(tmp);
+                    return e;
+                }
+                auto done = static_cast<size_type>(w);
+                while (cnt > 0 && done >= io->iov_len) {
+                    done -= io->iov_len;
+                    ++io;
+                    --cnt;
+                }
+                if (cnt > 0) {
+                    io->iov_base = static_cast<char*>(io->iov_base) + done;
+                    io->iov_len -= done;
+                }
+            }
+            if ((sync && ::fsync(fd) != 0) || ::close(fd) != 0 || ::rename(tmp, path) != 0) {
+                auto e = errno;
+                ::unlink(tmp);
+                return e;
+            }
+            return 0;
+        }
+    } //<-- namespace Internal ends here.
+
+    /** Save contents of s to path .
+     *
+     *  \retval OK
+     *  \retval IO_ERROR_BASE - errno open/write/fsync/rename failed (path is not changed)
+     *  \retval IO_ERROR_BASE - ENAMETOOLONG path + ".tmp" is over PATH_MAX
+     */
+    template <typename T, typename A>
+    inline return_code save_snapshot(const StorageBase<T, A>& s, const std::string& path, const snapshot_options& opt = snapshot_options{}) noexcept
+    {
+        static_assert(is_snapshot_requirement<T>::value, "T must be trivially copyable");
+        auto h = Internal::make_snapshot_header(s.const_ptr(), s.size());
+        char tmp[PATH_MAX];                     // no allocation, keeps noexcept
+        constexpr char suffix[] = ".tmp";
+        if (path.size() + sizeof(suffix) > sizeof(tmp)) return IO_ERROR_BASE - ENAMETOOLONG;
+        std::memcpy(tmp, path.data(), path.size());
+        std::memcpy(tmp + path.size(), suffix, sizeof(suffix));
+        auto e = Internal::write_snapshot(tmp, path.c_str(), h, s.const_ptr(), s.size() * sizeof(T), opt.sync);
+        return e ? IO_ERROR_BASE - e : OK;
+    }
+    /** Restore path into out by one read (out is replaced) .
+     *
+     *  \retval OK
+     *  \retval FAIL_ARG not a snapshot of T
+     *  \retval OUT_OF_RANGE file is truncated
+     *  \retval FAILURE payload CRC does not match
+     *  \retval IO_ERROR_BASE - errno open/read failed
+     */
+    template <typename T>
+    inline return_code load_snapshot(const std::string& path, StorageBase<T>& out, const snapshot_options& opt = snapshot_options{}) noexcept
+    {
+        static_assert(is_snapshot_requirement<T>::value, "T must be trivially copyable");
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return IO_ERROR_BASE - errno;
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            auto e = errno;
+            ::close(fd);
+            return IO_ERROR_BASE - e;
+        }
+        auto n = static_cast<size_type>(st.st_size);
+        constexpr auto align = std::align_val_t(alignof(T) > sizeof(snapshot_header) ? alignof(T) : sizeof(snapshot_header));
+        auto base = static_cast<char*>(::operator new(n < sizeof(snapshot_header) ? sizeof(snapshot_header) : n, align, std::nothrow));
+        if (! base) {
+            ::close(fd);
+            return NO_RESOURCE;
+        }
+        typename StorageBase<T>::keeper_type keeper(base, [align](void* q) {::operator delete(q, align);});
+        size_type got = 0;
+        int e = 0;
+        while (got < n) { // one read unless interrupted
+            auto r = ::read(fd, base + got, n - got);
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0) e = errno;
+            if (r <= 0) break;
+            got += static_cast<size_type>(r);
+        }
+        ::close(fd);
+        if (e) return IO_ERROR_BASE - e;
+        if (got < n) return OUT_OF_RANGE;
+        snapshot_header h;
+        std::memcpy(&h, base, sizeof(h));
+        auto rc = Internal::check_snapshot_header<T>(h, n);
+        if (rc != OK) return rc;
+        auto p = reinterpret_cast<T*>(base + sizeof(h));
+        if (opt.verify && crc32c(p, h.count * sizeof(T)) != h.payload_crc) return FAILURE;
+        out = StorageBase<T>(typename StorageBase<T>::released{p, h.count, h.count, std::move(keeper)});
+        return OK;
+    }
+    /** Restore path into out by mmap (no copy, pages are read on touch, writing is private) .
+     *
+     *  \retval same as load_snapshot
+     */
+    template <typename T>
+    inline return_code map_snapshot(const std::string& path, StorageBase<T>& out, const snapshot_options& opt = snapshot_options{}) noexcept
+    {
+        static_assert(is_snapshot_requirement<T>::value, "T must be trivially copyable");
+        static_assert(alignof(T) <= sizeof(snapshot_header), "payload of mapped snapshot is aligned to 64");
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return IO_ERROR_BASE - errno;
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            auto e = errno;
+            ::close(fd);
+            return IO_ERROR_BASE - e;
+        }
+        auto n = static_cast<size_type>(st.st_size);
+        if (n < sizeof(snapshot_header)) {
+            ::close(fd);
+            return OUT_OF_RANGE;
+        }
+        auto m = ::mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        auto e = errno;
+        ::close(fd);
+        if (m == MAP_FAILED) return IO_ERROR_BASE - e;
+        typename StorageBase<T>::keeper_type keeper(m, [n](void* q) {::munmap(q, n);});
+        auto base = static_cast<char*>(m);
+        snapshot_header h;
+        std::memcpy(&h, base, sizeof(h));
+        auto rc = Internal::check_snapshot_header<T>(h, n);
+        if (rc != OK) return rc;
+        auto p = reinterpret_cast<T*>(base + sizeof(h));
+        if (opt.verify && crc32c(p, h.count * sizeof(T)) != h.payload_crc) return FAILURE;
+        out = StorageBase<T>(typename StorageBase<T>::released{p, h.count, h.count, std::move(keeper)});
+        return OK;
+    }
+
+    /** Background snapshot writer .
+     *
+     * start() forks, the child writes the copy on write image of the storage and exits.
+     * The owner continues right after fork (cost is copying page tables, not contents).
+     * @code
+     * SnapshotWriter w;
+     * w.start(column, "column.snap");
+     * ... keep modifying column ...
+     * if (w.wait() != OK) ...
+     * @endcode
+     * \note Memory shared with others (MAP_SHARED, shared memory) is not copied on write.
+     */
+    class SnapshotWriter
+    {
+    public:
+        SnapshotWriter() noexcept = default;
+        SnapshotWriter(const SnapshotWriter&) = delete;
+        SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+        ~SnapshotWriter() {wait();}
+        /** Start writing s to path .
+         *
+         *  \retval OK started
+         *  \retval FAIL_CMD previous writing is running
+         *  \retval IO_ERROR_BASE - errno fork failed
+         */
+        template <typename T, typename A>
+        auto start(const StorageBase<T, A>& s, const std::string& path, const snapshot_options& opt = snapshot_options{}) -> return_code
+        {
+            static_assert(is_snapshot_requirement<T>::value, "T must be trivially copyable");
+            if (running()) return FAIL_CMD;
+            m_path = path;
+            m_tmp = path + ".tmp"; // no allocation in child
+            auto p = s.const_ptr();
+            auto n = s.size();
+            auto pid = ::fork();
+            if (pid < 0) return IO_ERROR_BASE - errno;
+            if (pid == 0) {
+                auto h = Internal::make_snapshot_header(p, n);
+                auto e = Internal::write_snapshot(m_tmp.c_str(), m_path.c_str(), h, p, n * sizeof(T), opt.sync);
+                ::_exit(e > 255 ? 255 : e);
+            }
+            m_pid = pid;
+            m_result = OK;
+            return OK;
+        }
+        auto running() const noexcept -> bool {return m_pid > 0;}
+        /** Result without waiting .
+         *
+         *  \retval TIMEOUT still writing
+         *  \retval other same as wait()
+         */
+        auto poll() noexcept -> return_code {return reap(WNOHANG);}
+        /** Wait for the end of writing .
+         *
+         *  \retval OK written (or nothing was started)
+         *  \retval IO_ERROR_BASE - errno writing failed
+         *  \retval FAILURE writer was killed
+         */
+        auto wait() noexcept -> return_code {return reap(0);}
+    private:
+        auto reap(int flags) noexcept -> return_code
+        {
+            if (m_pid <= 0) return m_result;
+            int status = 0;
+            auto r = ::waitpid(m_pid, &status, flags);
+            if (r == 0) return TIMEOUT;
+            if (r < 0) {
+                if (errno == EINTR) return (flags & WNOHANG) ? TIMEOUT : reap(flags);
+                m_result = IO_ERROR_BASE - errno;
+            } else if (WIFEXITED(status)) {
+                auto e = WEXITSTATUS(status);
+                m_result = e ? IO_ERROR_BASE - e : OK;
+            } else {
+                m_result = FAILURE;
+            }
+            m_pid = -1;
+            return m_result;
+        }
+        std::string m_path;
+        std::string m_tmp;
+        pid_t       m_pid {-1};
+        return_code m_result {OK};
+    }; //<-- class SnapshotWriter ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_SNAPSHOT_Hpp ends here.
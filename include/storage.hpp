@@ -65,6 +65,8 @@ namespace Mult {
      * head----+ |                 +----end
      * tail------+
      * @endcode
+     * @note Storage can also refer to memory which is kept alive by a keeper object (adopted or released storage).
+     *       Such storage is never destroyed nor deallocated by this class, it is copied to own rooms before resizing.
      */
     template <typename T, typename A = std::allocator<T>>
     class StorageBase
@@ -81,6 +83,18 @@ namespace Mult {
         using allocator_type  = A;
         using init_list_type  = std::initializer_list<value_type>; 
     public:
+        using keeper_type     = std::shared_ptr<void>;
+        /** Storage handed out by release() .
+         *
+         * ptr is valid while keeper is alive, the contents are destroyed and deallocated with keeper
+         */
+        struct released
+        {
+            pointer     ptr      {nullptr};
+            size_type   size     {0};
+            size_type   capacity {0};
+            keeper_type keeper   {};
+        };
         //
         // StorageBase() = default;
         /** Constractor 1 (default only reserve 64rooms).
@@ -131,6 +145,15 @@ namespace Mult {
                 *m_tail++ = x;
             }
         }
+        /** Constructor adopt released storage .
+         *
+         * No copy, the storage refers to r.ptr and keeps r.keeper
+         */
+        explicit StorageBase(released&& r) noexcept
+        {
+            TRACE("ctor adopt");
+            adopt(r.ptr, r.size, r.capacity, std::move(r.keeper));
+        }
         /** Copy constructor .
          */
         explicit StorageBase(const StorageBase& rhs)
@@ -150,6 +173,7 @@ namespace Mult {
             , m_capacity(rhs.m_capacity)
             , m_at(rhs.m_at)
             , m_init(rhs.m_init)
+            , m_keeper(std::move(rhs.m_keeper))
         {
             TRACE("ctor move");
             rhs.m_head = nullptr;
@@ -163,23 +187,27 @@ namespace Mult {
         {
             TRACE("copy assign");
             if (this != &rhs && m_capacity >= rhs.m_capacity) {
+                m_tail = m_head;
                 copy(rhs);
             }
             return *this;
         }
         /** Move assign operator .
+         *
+         * takes over rhs storage whatever the capacity is (no room of this is used)
          */
         StorageBase& operator=(StorageBase&& rhs) noexcept
         {
             TRACE("move assign");
-            if (this != &rhs && this->m_capacity >= rhs.m_capacity) {
-                destroy_all();
-                deallocate();
+            if (this != &rhs) {
+                release_memory();
                 m_head     = rhs.m_head;
                 m_tail     = rhs.m_tail;
                 m_end      = rhs.m_end;
+                m_capacity = rhs.m_capacity;
                 m_at       = rhs.m_at;
-                m_init     = true;
+                m_init     = rhs.m_init;
+                m_keeper   = std::move(rhs.m_keeper);
                 // clear rhs but no call destructor
                 rhs.m_init = false;
                 rhs.m_head = nullptr;
@@ -193,14 +221,60 @@ namespace Mult {
         ~StorageBase()
         {
             if (m_init) {
-                destroy_all();
-                deallocate();
+                release_memory();
                 m_init = false;
             }
         }
         /** Evalute allocated or not .
          */
         operator bool() const noexcept {return m_init;}
+        /** Evalute storage is refered memory kept by keeper (adopted) .
+         */
+        auto is_borrowed() const noexcept -> bool {return static_cast<bool>(m_keeper);}
+        /** Hand out the storage without copy .
+         *
+         * After release this storage is empty (not inited)
+         *  \retval released storage (ptr, size, capacity and keeper which destroys contents)
+         *  \retval empty released when the keeper can not be allocated (this storage is unchanged)
+         */
+        auto release() noexcept -> released
+        {
+            released r;
+            if (! m_init) return r;
+            r.ptr      = m_head;
+            r.size     = size();
+            r.capacity = m_capacity;
+            if (m_keeper) {
+                r.keeper = std::move(m_keeper);
+            } else {
+                struct holder
+                {
+                    holder(const allocator_type& a, size_type c) : at(a), cap(c) {}
+                    ~holder()
+                    {
+                        if (! p) return;
+                        for (size_type i = 0; i != cap; ++i) traits::destroy(at, p + i);
+                        traits::deallocate(at, p, cap);
+                    }
+                    allocator_type at;
+                    size_type      cap;
+                    pointer        p = nullptr;
+                };
+                std::shared_ptr<holder> h;
+                try {
+                    h = std::make_shared<holder>(m_at, m_capacity); // control block first, we still own the contents
+                } catch (std::bad_alloc& e) {
+                    MULT_FATAL(e.what());
+                    return released{};
+                }
+                h->p = m_head;
+                r.keeper = keeper_type(std::move(h), static_cast<void*>(m_head));
+            }
+            m_head = m_tail = m_end = nullptr;
+            m_capacity = 0;
+            m_init = false;
+            return r;
+        }
         /** Evalute allocated or not .
          */
         constexpr auto is_inited() const noexcept {return m_init;}
@@ -264,21 +338,53 @@ namespace Mult {
         }
     protected:
         using traits = std::allocator_traits<allocator_type>;
+        /** Refer external memory (no copy) .
+         *
+         *  \param[in] p head of contents (size s, writable rooms c)
+         *  \param[in] s number of contents
+         *  \param[in] c number of rooms
+         *  \param[in] keeper keeps p alive
+         */
+        auto adopt(pointer p, size_type s, size_type c, keeper_type keeper) noexcept -> void
+        {
+            if (m_init) release_memory();
+            m_head     = p;
+            m_tail     = p + s;
+            m_end      = p + c;
+            m_capacity = c;
+            m_keeper   = std::move(keeper);
+            m_init     = (p != nullptr);
+        }
+        /** Give back the memory (destroy and deallocate or drop keeper) .
+         */
+        auto release_memory() -> void
+        {
+            if (m_keeper) { // the memory is gone with the keeper, no pointer may survive it
+                m_keeper.reset();
+                m_head = m_tail = m_end = nullptr;
+                m_capacity = 0;
+                m_init = false;
+                return;
+            }
+            if (! m_head) return;
+            destroy_all();
+            deallocate();
+        }
         /** Tail pointer updater .
          */
         auto update_tail(size_type l) noexcept {m_tail += l;}
-        /**  Copy storage.
+        /**  Copy storage (to tail).
          */
         auto copy(const StorageBase& rhs) -> void
         {
-            std::copy(rhs.const_begin(), rhs.const_end(), begin());
+            std::copy(rhs.const_begin(), rhs.const_end(), end());
             update_tail(rhs.size());
         }
-        /** Copy storage .
+        /** Copy storage (to tail) .
          */
         auto copy(const_iterator b, const_iterator e) -> void
         {
-            std::copy(b, e, begin());
+            std::copy(b, e, end());
             update_tail(std::distance(b, e));
         }
         /** Initialize pointers .
@@ -348,8 +454,7 @@ namespace Mult {
             if (capacity() >= s) {return;}
             if (is_inited()) {
                 StorageBase t(*this);
-                destroy_all();
-                deallocate();
+                release_memory();
                 reserve(s);
                 copy(t);
             } else {
@@ -358,11 +463,11 @@ namespace Mult {
         }
         /** Resize storage twice .
          *
-         * new capacity = now capacity + now capacity
+         * new capacity = now capacity + now capacity (at least 1)
          */
         auto resize() noexcept -> void
         {
-            resize(m_capacity * 2);
+            resize(m_capacity ? m_capacity * 2 : 1);
         }
         /** Shrink .
          *
@@ -373,8 +478,7 @@ namespace Mult {
             if (capacity() <= size() && size() != 0) return;
             if (is_inited()) {
                 StorageBase t(*this);
-                destroy_all();
-                deallocate();
+                release_memory();
                 reserve(size());
                 copy(t);
             }
@@ -430,6 +534,7 @@ namespace Mult {
         size_type      m_capacity {0};                //!< capacity index
         allocator_type m_at       {allocator_type()}; //!< allocaotr default std::allocator<T>
         bool           m_init     {false};            //!< flag of allocated
+        keeper_type    m_keeper   {};                 //!< keeper of adopted memory (empty when own allocation)
     }; //<-- class StorageBase ends here.
 } //<-- namespace Mult ends here.
 
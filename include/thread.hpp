@@ -15,13 +15,111 @@
 #ifndef MULT_THREAD_Hpp
 # define  MULT_THREAD_Hpp
 
+# include <algorithm>
+# include <atomic>
+# include <cerrno>
+# include <cstring>
+# include <future>
 # include <memory>
+# include <optional>
+# include <string_view>
 # include <thread>
+# include <vector>
+
+# ifdef __linux__
+#  include <pthread.h>
+#  include <sched.h>
+#  include <sys/resource.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+# endif
 
 # include "base.hpp"
 # include "debug.hpp"
+# include "inline_task.hpp"
+# include "thread_stats.hpp"
 
 namespace Mult{
+    /** Scheduling class .
+     */
+    enum class sched_policy : std::uint8_t
+    {
+        inherit,     //!< keep the creator's policy
+        other,       //!< SCHED_OTHER
+        batch,       //!< SCHED_BATCH
+        idle,        //!< SCHED_IDLE
+        fifo,        //!< SCHED_FIFO (priority 1 .. 99, needs CAP_SYS_NICE)
+        round_robin, //!< SCHED_RR (priority 1 .. 99, needs CAP_SYS_NICE)
+    };
+    /** Where and how a thread runs .
+     *
+     * Default constructed options change nothing.
+     */
+    struct thread_options
+    {
+        std::vector<unsigned> cpus;                       //!< allowed CPUs (empty = inherit)
+        sched_policy          policy = sched_policy::inherit;
+        int                   priority = 0;               //!< real time priority for fifo / round_robin
+        std::optional<int>    nice;                       //!< per thread nice value (-20 .. 19)
+        bool                  set_name = true;            //!< pthread_setname_np (first 15 bytes)
+        bool                  account = false;            //!< record usage in ThreadRegistry::global()
+        auto changes_placement() const noexcept -> bool
+        {
+            return ! cpus.empty() || policy != sched_policy::inherit || nice.has_value();
+        }
+    };
+    /** Apply options to the calling thread .
+     *
+     *  \param[in] o options
+     *  \param[in] name thread name (empty or set_name false skips naming)
+     *  \retval OK applied
+     *  \retval FAIL_ARG CPU number or priority out of range
+     *  \retval IO_ERROR_BASE - errno system call refused (EPERM for real time without privilege)
+     *  \retval FAILURE options are not supported on this platform
+     */
+    inline auto apply_thread_options(const thread_options& o, std::string_view name = {}) noexcept -> return_code
+    {
+# ifdef __linux__
+        if (! o.cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (auto c : o.cpus) {
+                if (c >= CPU_SETSIZE) return FAIL_ARG;
+                CPU_SET(c, &set);
+            }
+            if (auto e = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) return IO_ERROR_BASE - e;
+        }
+        if (o.policy != sched_policy::inherit) {
+            int policy = SCHED_OTHER;
+            switch (o.policy) {
+            case sched_policy::batch:       policy = SCHED_BATCH; break;
+            case sched_policy::idle:        policy = SCHED_IDLE;  break;
+            case sched_policy::fifo:        policy = SCHED_FIFO;  break;
+            case sched_policy::round_robin: policy = SCHED_RR;    break;
+            default: break;
+            }
+            if (o.priority < sched_get_priority_min(policy) || o.priority > sched_get_priority_max(policy)) return FAIL_ARG;
+            sched_param param {};
+            param.sched_priority = o.priority;
+            if (auto e = pthread_setschedparam(pthread_self(), policy, &param)) return IO_ERROR_BASE - e;
+        }
+        if (o.nice) {
+            if (*o.nice < -20 || *o.nice > 19) return FAIL_ARG;
+            auto tid = static_cast<id_t>(::syscall(SYS_gettid)); // nice is per thread on Linux
+            if (::setpriority(PRIO_PROCESS, tid, *o.nice) != 0) return IO_ERROR_BASE - errno;
+        }
+        if (o.set_name && ! name.empty()) {
+            char buf[16] {};
+            std::memcpy(buf, name.data(), std::min<size_type>(name.size(), sizeof(buf) - 1));
+            if (auto e = pthread_setname_np(pthread_self(), buf)) return IO_ERROR_BASE - e;
+        }
+        return OK;
+# else
+        (void)name;
+        return o.changes_placement() ? FAILURE : OK;
+# endif
+    }
+
     /**  Runnable Interface class.
      *
      * スレッドのエントリーポイント
@@ -101,11 +199,36 @@ namespace Mult{
             }
             return *this;
         }
+        auto instance() const noexcept -> const instance_p& {return m_instance;}
+        auto entrypoint() const noexcept -> entrypoint_t {return m_entrypoint;}
     private:
         instance_p   m_instance;    //!< target class instance
         entrypoint_t m_entrypoint;  //!< adapted runner
     }; //<-- class RunnableAdapter ends here.
 
+    /** InlineTask calling (*obj.*entrypoint)(vp) .
+     *
+     * obj, entrypoint and vp fit inline, no adapter object and no virtual call.
+     */
+    template <class C>
+    auto make_task(std::shared_ptr<C> obj, void (C::*entrypoint)(void_ptr), void_ptr vp = nullptr) -> InlineTask
+    {
+        return InlineTask([obj = std::move(obj), entrypoint, vp] {(*obj.*entrypoint)(vp);});
+    }
+    /** InlineTask from an existing RunnableAdapter (calls its target directly) .
+     */
+    template <class C>
+    auto make_task(const RunnableAdapter<C>& adapter, void_ptr vp = nullptr) -> InlineTask
+    {
+        return make_task(adapter.instance(), adapter.entrypoint(), vp);
+    }
+    /** InlineTask calling r->run(vp) (any Runnable) .
+     */
+    inline auto make_task(std::shared_ptr<Runnable> r, void_ptr vp = nullptr) -> InlineTask
+    {
+        return InlineTask([r = std::move(r), vp] {r->run(vp);});
+    }
+
     /**  \class Thread
      * \brief Thread class for evry class
      *
@@ -127,6 +250,10 @@ namespace Mult{
             , m_thread{nullptr}
             , m_started{false} {}
         explicit Thread(runnable_p runnable, const std::string& name) noexcept : Thread(runnable, 0, name) {}
+        /** Thread running task (start()'s argument is not used) .
+         */
+        Thread(InlineTask task, ID_t id, const std::string& name) noexcept : Thread(nullptr, id, name) {m_task = std::move(task);}
+        explicit Thread(InlineTask task, const std::string& name) noexcept : Thread(std::move(task), 0, name) {}
         explicit Thread(runnable_p runnable) noexcept : Thread(runnable, "some thread") {}
         Thread() noexcept : Thread(nullptr) {}
 
@@ -145,19 +272,43 @@ namespace Mult{
          *
          *  runnnable runner go to other thread space
          *  to move another memory context
+         *  options() are applied by the new thread before the runnable runs,
+         *  when they are refused the runnable does not run and the thread is joined.
          *
          *  \param[inout] vp thread argument(s)
          *  \retval OK thread lunched
          *  \retval NO_RESOURCE We have not the RUNNABLE
+         *  \retval other apply_thread_options() failure
          */
         auto start(void* vp) noexcept
         {
             return_code ret = NO_RESOURCE;
-            if (m_runnable) {
+            if (m_runnable || m_task) {
                 m_started = true;
                 MULT_LOG(name() + " start thread");
-                m_thread.reset(new std::thread([this,vp]{m_runnable->run(vp);}));
-                return OK;
+                m_account = m_options.account ? ThreadRegistry::global().attach(id(), name()) : nullptr;
+                if (! m_options.changes_placement()) { // naming cannot fail, no hand shake
+                    m_thread.reset(new std::thread([this, vp, a = m_account]{
+                        ThreadRegistry::scope accounted(a);
+                        if (m_options.set_name) apply_thread_options(m_options, name());
+                        launch(vp);
+                    }));
+                    return OK;
+                }
+                std::promise<return_code> applied; // the shared state outlives this frame
+                auto result = applied.get_future();
+                m_thread.reset(new std::thread([this, vp, applied = std::move(applied), a = m_account] () mutable {
+                    ThreadRegistry::scope accounted(a);
+                    auto rc = apply_thread_options(m_options, name());
+                    applied.set_value(rc);
+                    if (rc == OK) launch(vp);
+                }));
+                auto rc = result.get();
+                if (rc != OK) {
+                    MULT_LOG(name() + " =====> thread options refused : " + std::to_string(rc));
+                    join();
+                }
+                return rc;
             } else {
                 MULT_LOG("=====> No setup Runnable object < " + name());
                 return ret; // NO_RESOURCE
@@ -169,17 +320,37 @@ namespace Mult{
          *  \param[in] r for threading target
          */
         void runnable(runnable_p r) noexcept {m_runnable = r;}
+        /*! set task for new thread (used instead of the runnable)
+         *
+         *  \param[in] t for threading target
+         */
+        void task(InlineTask t) noexcept {m_task = std::move(t);}
         /*! set runnable for new thread
          *
          *  \param[in] r for threading target
          */
         void operator ()(runnable_p r) noexcept {m_runnable = r;}
+        /*! set placement / scheduling options for the next start()
+         *
+         *  \param[in] o options (name comes from Base::name())
+         */
+        void options(thread_options o) noexcept {m_options = std::move(o);}
+        auto options() const noexcept -> const thread_options& {return m_options;}
+        /*! usage of the last start() (options().account must be set)
+         *
+         *  sampled without stopping the thread, the same record is in ThreadRegistry::global()
+         */
+        auto usage() const -> std::optional<thread_usage>
+        {
+            if (! m_account) return std::nullopt;
+            return m_account->usage();
+        }
         /** 有効なrunnableを保持しているか .
          *
          *  \retval true leagal runnable
          *  \retval false hasn't runnable
          */
-        operator bool() const noexcept {return (m_runnable) ? true : false;}
+        operator bool() const noexcept {return (m_runnable || m_task) ? true : false;}
         /*! wait for join terminate thread
          *
          *  \retval OK joined
@@ -244,9 +415,26 @@ namespace Mult{
             std::this_thread::yield();
         }
     protected:
+        void launch(void_ptr vp) noexcept
+        {
+            if (! m_task) {
+                m_runnable->run(vp);
+                return;
+            }
+            try {
+                m_task();
+            } catch (std::exception& e) {
+                MULT_FATAL(name() + " =====> task throws : " + e.what());
+            } catch (...) {
+                MULT_FATAL(name() + " =====> task throws : Catch unknown EXCEPTION");
+            }
+        }
         runnable_p  m_runnable; //!< real thread runner
+        InlineTask  m_task;     //!< task runner (preferred over m_runnable)
         thread_u    m_thread;   //!< thread holder
         bool        m_started;  //!< running flag
+        thread_options m_options; //!< applied in the new thread
+        ThreadRegistry::account_p m_account; //!< usage record (options().account)
     }; // class Thread
 
 /*! \class Thread
@@ -0,0 +1,507 @@
+/**
+ * @file thread_pool.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Work stealing thread pool
+ *
+ * Each worker owns a Chase-Lev deque (owner push/pop at bottom, thieves steal at top),
+ * jobs from outside the pool go through a global injection queue.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_THREAD_POOL_Hpp
+# define  MULT_THREAD_POOL_Hpp
+
+# include <atomic>
+# include <cstdint>
+# include <deque>
+# include <memory>
+# include <mutex>
+# include <string>
+# include <thread>
+# include <type_traits>
+# include <utility>
+# include <vector>
+
+# include "mult.hpp"
+# include "thread.hpp"
+# include "debug.hpp"
+# include "internal/block_pool.hpp"
+
+namespace Mult {
+    namespace Internal {
+        /** Job queued in the pool (owned by the queue until executed) .
+         */
+        struct pool_job
+        {
+            virtual ~pool_job() = default;
+            virtual void execute() noexcept = 0;
+        };
+        /** Callable job, recycled by block_pool when a worker posts it (external posts allocate) .
+         */
+        template <typename F>
+        struct callable_job final : pool_job, pooled
+        {
+            explicit callable_job(F&& f) : fn(std::move(f)) {}
+            explicit callable_job(const F& f) : fn(f) {}
+            void execute() noexcept override
+            {
+                try {
+                    fn();
+                } catch (std::exception& e) {
+                    MULT_FATAL(std::string("=====> pool job throws : ") + e.what());
+                } catch (...) {
+                    MULT_FATAL("=====> pool job throws : Catch unknown EXCEPTION");
+                }
+            }
+            F fn;
+        };
+        struct runnable_job final : pool_job, pooled
+        {
+            runnable_job(std::shared_ptr<Runnable> r, void_ptr p) : runnable(std::move(r)), vp(p) {}
+            void execute() noexcept override {runnable->run(vp);}
+            std::shared_ptr<Runnable> runnable;
+            void_ptr                  vp;
+        };
+
+        /** Chase-Lev work stealing deque .
+         *
+         * push/pop only by owner thread, steal by any thread.
+         * Grows by doubling, old rings are kept until destruction (thieves may still read them).
+         * seq_cst operations stand in for the fences of the paper (same code on x86, visible to tsan).
+         */
+        class WorkStealingDeque
+        {
+            struct ring
+            {
+                explicit ring(std::int64_t c) : capacity(c), mask(c - 1), slots(new std::atomic<pool_job*>[c]) {}
+                auto get(std::int64_t i) const noexcept -> pool_job* {return slots[i & mask].load(std::memory_order_relaxed);}
+                auto put(std::int64_t i, pool_job* j) noexcept -> void {slots[i & mask].store(j, std::memory_order_relaxed);}
+                std::int64_t                               capacity;
+                std::int64_t                               mask;
+                std::unique_ptr<std::atomic<pool_job*>[]> slots;
+            };
+        public:
+            explicit WorkStealingDeque(std::int64_t capacity = 256)
+            {
+                m_rings.emplace_back(std::make_unique<ring>(capacity));
+                m_ring.store(m_rings.back().get(), std::memory_order_relaxed);
+            }
+            WorkStealingDeque(const WorkStealingDeque&) = delete;
+            WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+            /** Owner push .
+             */
+            auto push(pool_job* j) -> void
+            {
+                auto b = m_bottom.load(std::memory_order_relaxed);
+                auto t = m_top.load(std::memory_order_acquire);
+                auto a = m_ring.load(std::memory_order_relaxed);
+                if (b - t > a->capacity - 1) a = grow(a, b, t);
+                a->put(b, j);
+                m_bottom.store(b + 1, std::memory_order_release);
+            }
+            /** Owner pop (LIFO) .
+             */
+            auto pop() noexcept -> pool_job*
+            {
+                auto b = m_bottom.load(std::memory_order_relaxed) - 1;
+                auto a = m_ring.load(std::memory_order_relaxed);
+                m_bottom.store(b, std::memory_order_seq_cst);
+                auto t = m_top.load(std::memory_order_seq_cst);
+                if (t > b) { // empty
+                    m_bottom.store(b + 1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                auto j = a->get(b);
+                if (t == b) { // last one, race with thieves
+                    if (! m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) j = nullptr;
+                    m_bottom.store(b + 1, std::memory_order_relaxed);
+                }
+                return j;
+            }
+            /** Steal (FIFO) from any thread, nullptr when empty or lost the race .
+             */
+            auto steal() noexcept -> pool_job*
+            {
+                auto t = m_top.load(std::memory_order_seq_cst);
+                auto b = m_bottom.load(std::memory_order_seq_cst);
+                if (t >= b) return nullptr;
+                auto a = m_ring.load(std::memory_order_acquire);
+                auto j = a->get(t);
+                if (! m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+                return j;
+            }
+            auto size() const noexcept -> size_type
+            {
+                auto b = m_bottom.load(std::memory_order_relaxed);
+                auto t = m_top.load(std::memory_order_relaxed);
+                return b > t ? static_cast<size_type>(b - t) : 0;
+            }
+            auto empty() const noexcept -> bool {return size() == 0;}
+        private:
+            auto grow(ring* a, std::int64_t b, std::int64_t t) -> ring*
+            {
+                auto n = std::make_unique<ring>(a->capacity * 2);
+                for (auto i = t; i < b; ++i) n->put(i, a->get(i));
+                auto p = n.get();
+                m_rings.emplace_back(std::move(n));
+                m_ring.store(p, std::memory_order_release);
+                return p;
+            }
+            alignas(64) std::atomic<std::int64_t> m_top {0};
+            alignas(64) std::atomic<std::int64_t> m_bottom {0};
+            std::atomic<ring*>                    m_ring {nullptr};
+            std::vector<std::unique_ptr<ring>>    m_rings; // owner only
+        }; //<-- class WorkStealingDeque ends here.
+    } //<-- namespace Internal ends here.
+
+    /** Work stealing thread pool .
+     *
+     * A fixed number of workers execute posted jobs. Jobs posted from a worker go to its own deque
+     * (LIFO for the owner, stolen FIFO by idle workers), jobs from other threads go to the
+     * injection queue. Idle workers sleep on an atomic wait and are woken per post.
+     * @code
+     * ThreadPool pool(4);
+     * pool.post([] {work();});                                  // lightweight callable
+     * pool.post(std::make_shared<RunnableAdapter<Some>>(some, &Some::run)); // Runnable
+     * WorkGroup g(pool);
+     * for (auto& part : parts) g.run([&part] {process(part);});
+     * g.wait();                                                 // helps while waiting
+     * @endcode
+     * @note A Runnable which loops until stop() occupies one worker for its lifetime.
+     */
+    class ThreadPool final
+    {
+    public:
+        using runnable_p = std::shared_ptr<Runnable>;
+        static constexpr size_type NOT_WORKER = ~size_type{0};
+        /** Default worker count (hardware threads, at least 1) .
+         */
+        static auto default_workers() noexcept -> size_type
+        {
+            auto n = std::thread::hardware_concurrency();
+            return n ? n : 1;
+        }
+        /** Start workers .
+         *
+         *  \param[in] workers number of worker threads (0 means default_workers())
+         */
+        explicit ThreadPool(size_type workers = default_workers()) : ThreadPool(workers, thread_options{}) {}
+        /** Start workers with placement .
+         *
+         * Worker i applies options with cpus = {placement[i % placement.size()]} (options.cpus when
+         * placement is empty) and is named "pool/i" (its ThreadRegistry name with options.account).
+         * Returns after every worker applied its options, refused options do not stop the worker,
+         * see setup_result().
+         * @code
+         * auto topo = CpuTopology::discover();
+         * ThreadPool pool(topo.core_count(), thread_options{}, topo.placement(topo.core_count()));
+         * @endcode
+         *  \param[in] workers number of worker threads (0 means default_workers())
+         *  \param[in] options scheduling options for every worker
+         *  \param[in] placement CPU per worker
+         */
+        ThreadPool(size_type workers, const thread_options& options, const std::vector<unsigned>& placement = {})
+        {
+            if (workers == 0) workers = default_workers();
+            m_workers.reserve(workers);
+            for (size_type i = 0; i < workers; ++i) m_workers.emplace_back(std::make_unique<worker>(i));
+            for (size_type i = 0; i < workers; ++i) {
+                auto o = options;
+                if (! placement.empty()) o.cpus.assign(1, placement[i % placement.size()]);
+                m_workers[i]->thread = std::thread([this, i, o = std::move(o)] {
+                    auto name = "pool/" + std::to_string(i);
+                    ThreadRegistry::scope accounted(o.account ? ThreadRegistry::global().attach(i, name) : nullptr);
+                    auto rc = apply_thread_options(o, name);
+                    if (rc != OK) {
+                        return_code none = OK;
+                        m_setup.compare_exchange_strong(none, rc, std::memory_order_relaxed);
+                    }
+                    m_started.fetch_add(1, std::memory_order_release);
+                    m_started.notify_one();
+                    loop(i);
+                });
+            }
+            for (auto n = m_started.load(std::memory_order_acquire); n < workers; n = m_started.load(std::memory_order_acquire)) {
+                m_started.wait(n, std::memory_order_acquire);
+            }
+        }
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        /** Runs every queued job, then joins workers .
+         */
+        ~ThreadPool()
+        {
+            m_stop.store(true, std::memory_order_seq_cst);
+            m_epoch.fetch_add(1, std::memory_order_seq_cst);
+            m_epoch.notify_all();
+            for (auto& w : m_workers) {
+                if (w->thread.joinable()) w->thread.join();
+            }
+        }
+        /** Post callable f() (lambda, InlineTask, ...) .
+         *
+         *  \retval OK queued
+         *  \retval NO_RESOURCE pool is stopping
+         */
+        template <typename F>
+        requires std::is_invocable_v<std::decay_t<F>&>
+        auto post(F&& f) -> return_code
+        {
+            auto j = new Internal::callable_job<std::decay_t<F>>(std::forward<F>(f));
+            auto rc = enqueue(j);
+            if (rc != OK) delete j;
+            return rc;
+        }
+        /** Post Runnable r->run(vp) .
+         *
+         *  \retval OK queued
+         *  \retval FAIL_ARG r is nullptr
+         *  \retval NO_RESOURCE pool is stopping
+         */
+        auto post(runnable_p r, void_ptr vp = nullptr) -> return_code
+        {
+            if (! r) return FAIL_ARG;
+            auto j = new Internal::runnable_job(std::move(r), vp);
+            auto rc = enqueue(j);
+            if (rc != OK) delete j;
+            return rc;
+        }
+        /** Post prepared job (deleted by the pool after execute()) .
+         *
+         *  \retval OK queued, the pool owns j
+         *  \retval NO_RESOURCE pool is stopping, the caller still owns j
+         */
+        auto post_job(Internal::pool_job* j) -> return_code {return enqueue(j);}
+        auto worker_count() const noexcept -> size_type {return m_workers.size();}
+        /** First apply_thread_options() failure of any worker (OK when every worker applied its options) .
+         */
+        auto setup_result() const noexcept -> return_code {return m_setup.load(std::memory_order_relaxed);}
+        /** Index of calling worker in this pool (NOT_WORKER for other threads) .
+         */
+        auto current_index() const noexcept -> size_type
+        {
+            auto& c = context();
+            return c.pool == this ? c.index : NOT_WORKER;
+        }
+        /** Jobs posted but not finished .
+         */
+        auto pending() const noexcept -> size_type {return m_pending.load(std::memory_order_acquire);}
+        /** Total successful steals .
+         */
+        auto steals() const noexcept -> std::uint64_t
+        {
+            std::uint64_t n = 0;
+            for (auto& w : m_workers) n += w->steals.load(std::memory_order_relaxed);
+            return n;
+        }
+        /** Run one queued job on calling thread (own deque, injection queue, then steal) .
+         *
+         *  \retval true a job was executed
+         */
+        auto try_run_one() noexcept -> bool
+        {
+            auto j = find(current_index());
+            if (! j) return false;
+            run(j);
+            return true;
+        }
+        /** Wait until every posted job finished, helping meanwhile .
+         */
+        auto wait_idle() noexcept -> void {help_until(m_pending);}
+        /** Help until counter becomes 0 (used by WorkGroup) .
+         */
+        auto help_until(const std::atomic<size_type>& counter) noexcept -> void
+        {
+            size_type idle = 0;
+            while (true) {
+                auto c = counter.load(std::memory_order_acquire);
+                if (c == 0) return;
+                if (try_run_one()) {
+                    idle = 0;
+                    continue;
+                }
+                if (++idle < 64) {
+                    std::this_thread::yield();
+                } else {
+                    counter.wait(c, std::memory_order_acquire);
+                    idle = 0;
+                }
+            }
+        }
+    private:
+        struct worker
+        {
+            explicit worker(size_type i) : rng(0x9e3779b97f4a7c15ULL * (i + 1)) {}
+            Internal::WorkStealingDeque deque;
+            std::thread                 thread;
+            std::uint64_t               rng;
+            std::atomic<std::uint64_t>  steals {0};
+        };
+        struct worker_context
+        {
+            ThreadPool* pool  = nullptr;
+            size_type   index = NOT_WORKER;
+        };
+        static auto context() noexcept -> worker_context&
+        {
+            thread_local worker_context c;
+            return c;
+        }
+        auto enqueue(Internal::pool_job* j) -> return_code
+        {
+            if (m_stop.load(std::memory_order_relaxed)) return NO_RESOURCE;
+            m_pending.fetch_add(1, std::memory_order_relaxed);
+            auto self = current_index();
+            if (self != NOT_WORKER) {
+                m_workers[self]->deque.push(j);
+            } else {
+                std::lock_guard<std::mutex> lock(m_inject_guard);
+                m_inject.push_back(j);
+                m_inject_size.store(m_inject.size(), std::memory_order_relaxed);
+            }
+            wake();
+            return OK;
+        }
+        auto wake() noexcept -> void
+        {
+            // RMW orders the push before this read, pairs with sleepers increment in loop()
+            if (m_sleepers.fetch_add(0, std::memory_order_seq_cst) > 0) {
+                m_epoch.fetch_add(1, std::memory_order_seq_cst);
+                m_epoch.notify_one();
+            }
+        }
+        auto take_injected() noexcept -> Internal::pool_job*
+        {
+            if (m_inject_size.load(std::memory_order_relaxed) == 0) return nullptr;
+            std::lock_guard<std::mutex> lock(m_inject_guard);
+            if (m_inject.empty()) return nullptr;
+            auto j = m_inject.front();
+            m_inject.pop_front();
+            m_inject_size.store(m_inject.size(), std::memory_order_relaxed);
+            return j;
+        }
+        auto find(size_type self) noexcept -> Internal::pool_job*
+        {
+            if (self != NOT_WORKER) {
+                if (auto j = m_workers[self]->deque.pop()) return j;
+            }
+            if (auto j = take_injected()) return j;
+            auto n = m_workers.size();
+            std::uint64_t r;
+            if (self != NOT_WORKER) {
+                auto& s = m_workers[self]->rng;
+                s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+                r = s;
+            } else {
+                r = m_outside_rng.fetch_add(0x9e3779b97f4a7c15ULL, std::memory_order_relaxed);
+            }
+            for (size_type k = 0, start = static_cast<size_type>(r % n); k < n; ++k) {
+                auto v = (start + k) % n;
+                if (v == self) continue;
+                if (auto j = m_workers[v]->deque.steal()) {
+                    if (self != NOT_WORKER) m_workers[self]->steals.fetch_add(1, std::memory_order_relaxed);
+                    return j;
+                }
+            }
+            return nullptr;
+        }
+        auto run(Internal::pool_job* j) noexcept -> void
+        {
+            j->execute();
+            delete j;
+            if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) m_pending.notify_all();
+        }
+        auto loop(size_type self) noexcept -> void
+        {
+            auto& c = context();
+            c.pool = this;
+            c.index = self;
+            size_type idle = 0;
+            while (true) {
+                if (auto j = find(self)) {
+                    run(j);
+                    idle = 0;
+                    continue;
+                }
+                if (m_stop.load(std::memory_order_acquire) && m_pending.load(std::memory_order_acquire) == 0) break;
+                if (++idle < 32) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                auto e = m_epoch.load(std::memory_order_seq_cst);
+                m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+                if (auto j = find(self)) { // posted between the last look and the increment
+                    m_sleepers.fetch_sub(1, std::memory_order_seq_cst);
+                    run(j);
+                    idle = 0;
+                    continue;
+                }
+                if (! m_stop.load(std::memory_order_acquire)) m_epoch.wait(e, std::memory_order_seq_cst);
+                m_sleepers.fetch_sub(1, std::memory_order_seq_cst);
+                idle = 0;
+            }
+            c = worker_context{};
+        }
+        std::vector<std::unique_ptr<worker>> m_workers;
+        std::mutex                           m_inject_guard;
+        std::deque<Internal::pool_job*>      m_inject;
+        std::atomic<size_type>               m_inject_size {0};
+        std::atomic<std::uint64_t>           m_outside_rng {0};
+        alignas(64) std::atomic<size_type>   m_pending {0};
+        alignas(64) std::atomic<std::uint32_t> m_epoch {0};
+        std::atomic<int>                     m_sleepers {0};
+        std::atomic<bool>                    m_stop {false};
+        std::atomic<return_code>             m_setup {OK};
+        std::atomic<size_type>               m_started {0};   //!< workers past apply_thread_options()
+    }; //<-- class ThreadPool ends here.
+
+    /** Fork / join group on a ThreadPool .
+     *
+     * wait() executes queued jobs while the group is not finished, so nested groups
+     * inside pool jobs do not block workers.
+     */
+    class WorkGroup final
+    {
+    public:
+        explicit WorkGroup(ThreadPool& pool) noexcept : m_pool(pool) {}
+        WorkGroup(const WorkGroup&) = delete;
+        WorkGroup& operator=(const WorkGroup&) = delete;
+        ~WorkGroup() {wait();}
+        /** Run f() in the pool as a member of this group .
+         *
+         *  \retval OK queued
+         *  \retval NO_RESOURCE pool is stopping (f is not run)
+         */
+        template <typename F>
+        auto run(F&& f) -> return_code
+        {
+            m_count.fetch_add(1, std::memory_order_relaxed);
+            auto rc = m_pool.post([this, fn = std::forward<F>(f)]() mutable {
+                struct finish {WorkGroup* g; ~finish() {g->done();}} guard {this}; // also when fn throws
+                fn();
+            });
+            if (rc != OK) done();
+            return rc;
+        }
+        /** Wait for every member (helping) .
+         */
+        auto wait() noexcept -> void {m_pool.help_until(m_count);}
+        auto pending() const noexcept -> size_type {return m_count.load(std::memory_order_acquire);}
+    private:
+        auto done() noexcept -> void
+        {
+            if (m_count.fetch_sub(1, std::memory_order_acq_rel) == 1) m_count.notify_all();
+        }
+        ThreadPool&            m_pool;
+        std::atomic<size_type> m_count {0};
+    }; //<-- class WorkGroup ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_THREAD_POOL_Hpp ends here.
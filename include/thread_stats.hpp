@@ -0,0 +1,307 @@
+/**
+ * @file thread_stats.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Per thread resource accounting (CPU time, context switches, run period, blocked time)
+ *
+ * An accounted thread owns a ThreadAccount registered in ThreadRegistry::global().
+ * The owner publishes counters with relaxed stores, snapshot() reads them (and the live
+ * CPU clock of running threads) without stopping anybody.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_THREAD_STATS_Hpp
+# define  MULT_THREAD_STATS_Hpp
+
+# include <atomic>
+# include <chrono>
+# include <ctime>
+# include <memory>
+# include <mutex>
+# include <string>
+# include <vector>
+
+# ifdef __linux__
+#  include <pthread.h>
+#  include <sys/resource.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+# endif
+
+# include "mult.hpp"
+
+namespace Mult {
+    /** Usage of one thread at snapshot time .
+     */
+    struct thread_usage
+    {
+        using time_point = std::chrono::system_clock::time_point;
+        ID_t                     id = 0;
+        std::string              name;
+        long                     tid = 0;          //!< kernel thread id (0 before start)
+        bool                     running = false;
+        time_point               started {};       //!< run start (epoch when not started)
+        time_point               stopped {};       //!< run stop (epoch while running)
+        std::chrono::nanoseconds cpu {0};          //!< CLOCK_THREAD_CPUTIME_ID
+        std::chrono::nanoseconds blocked {0};      //!< time spent in Signal waits
+        std::uint64_t            waits = 0;        //!< number of Signal waits
+        std::uint64_t            voluntary = 0;    //!< voluntary context switches (at the last checkpoint)
+        std::uint64_t            involuntary = 0;  //!< involuntary context switches (at the last checkpoint)
+        /** Run time up to stop (or now) .
+         */
+        auto wall(time_point now = std::chrono::system_clock::now()) const noexcept -> std::chrono::nanoseconds
+        {
+            if (started == time_point{}) return std::chrono::nanoseconds(0);
+            return std::chrono::duration_cast<std::chrono::nanoseconds>((running ? now : stopped) - started);
+        }
+        /** cpu / wall (1.0 = one core saturated) .
+         */
+        auto utilization(time_point now = std::chrono::system_clock::now()) const noexcept -> double
+        {
+            auto w = wall(now).count();
+            return w > 0 ? static_cast<double>(cpu.count()) / static_cast<double>(w) : 0.0;
+        }
+    };
+
+    /** Counters of one accounted thread .
+     *
+     * begin() / end() / checkpoint() / add_blocked() are called by the owner thread only,
+     * usage() from any thread.
+     */
+    class ThreadAccount final
+    {
+        using ns_rep = std::chrono::nanoseconds::rep;
+    public:
+        ThreadAccount(ID_t id, std::string name) : m_id(id), m_name(std::move(name)) {}
+        ThreadAccount(const ThreadAccount&) = delete;
+        ThreadAccount& operator=(const ThreadAccount&) = delete;
+        /** Account of the calling thread (nullptr when it is not accounted) .
+         */
+        static auto current() noexcept -> ThreadAccount*& {thread_local ThreadAccount* a = nullptr; return a;}
+        /** Start accounting the calling thread .
+         */
+        auto begin() noexcept -> void
+        {
+            std::lock_guard<std::mutex> l(m_guard);
+# ifdef __linux__
+            m_tid = static_cast<long>(::syscall(SYS_gettid));
+            m_has_clock = pthread_getcpuclockid(pthread_self(), &m_clock) == 0;
+# endif
+            m_started = std::chrono::system_clock::now();
+            m_stopped = {};
+            m_running = true;
+            current() = this;
+        }
+        /** Final sample, the calling thread is no longer accounted .
+         */
+        auto end() noexcept -> void
+        {
+            checkpoint();
+            std::lock_guard<std::mutex> l(m_guard);
+            m_cpu = self_cpu();
+            m_stopped = std::chrono::system_clock::now();
+            m_running = false;
+            if (current() == this) current() = nullptr;
+        }
+        /** Publish the context switch counters of the calling thread (one getrusage) .
+         *
+         * Done after every accounted wait and at end(), call it from long busy loops.
+         */
+        auto checkpoint() noexcept -> void
+        {
+# ifdef __linux__
+            rusage ru {};
+            if (::getrusage(RUSAGE_THREAD, &ru) == 0) {
+                m_voluntary.store(static_cast<std::uint64_t>(ru.ru_nvcsw), std::memory_order_relaxed);
+                m_involuntary.store(static_cast<std::uint64_t>(ru.ru_nivcsw), std::memory_order_relaxed);
+            }
+# endif
+        }
+        auto add_blocked(std::chrono::nanoseconds d) noexcept -> void
+        {
+            m_blocked.store(m_blocked.load(std::memory_order_relaxed) + d.count(), std::memory_order_relaxed);
+            m_waits.store(m_waits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        auto id() const noexcept -> ID_t {return m_id;}
+        auto name() const noexcept -> const std::string& {return m_name;}
+        auto running() const noexcept -> bool
+        {
+            std::lock_guard<std::mutex> l(m_guard);
+            return m_running;
+        }
+        auto finished() const noexcept -> bool
+        {
+            std::lock_guard<std::mutex> l(m_guard);
+            return ! m_running && m_stopped != thread_usage::time_point{};
+        }
+        /** Sample (any thread, the owner keeps running) .
+         */
+        auto usage() const noexcept -> thread_usage
+        {
+            thread_usage u;
+            u.id = m_id;
+            u.name = m_name;
+            {
+                std::lock_guard<std::mutex> l(m_guard); // the owner can not pass end() meanwhile, its clock stays valid
+                u.tid = m_tid;
+                u.running = m_running;
+                u.started = m_started;
+                u.stopped = m_stopped;
+                u.cpu = m_running ? live_cpu() : m_cpu;
+            }
+            u.blocked = std::chrono::nanoseconds(m_blocked.load(std::memory_order_relaxed));
+            u.waits = m_waits.load(std::memory_order_relaxed);
+            u.voluntary = m_voluntary.load(std::memory_order_relaxed);
+            u.involuntary = m_involuntary.load(std::memory_order_relaxed);
+            return u;
+        }
+    private:
+        static auto to_ns(const timespec& t) noexcept -> std::chrono::nanoseconds
+        {
+            return std::chrono::seconds(t.tv_sec) + std::chrono::nanoseconds(t.tv_nsec);
+        }
+        static auto self_cpu() noexcept -> std::chrono::nanoseconds
+        {
+            timespec t {};
+            if (::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t) != 0) return std::chrono::nanoseconds(0);
+            return to_ns(t);
+        }
+        auto live_cpu() const noexcept -> std::chrono::nanoseconds
+        {
+            timespec t {};
+# ifdef __linux__
+            if (m_has_clock && ::clock_gettime(m_clock, &t) == 0) return to_ns(t);
+# endif
+            return m_cpu;
+        }
+        const ID_t                       m_id;
+        const std::string                m_name;
+        mutable std::mutex               m_guard;     //!< run state (begin / end against usage)
+        long                             m_tid = 0;
+        bool                             m_running = false;
+# ifdef __linux__
+        bool                             m_has_clock = false;
+        clockid_t                        m_clock {};
+# endif
+        thread_usage::time_point         m_started {};
+        thread_usage::time_point         m_stopped {};
+        std::chrono::nanoseconds         m_cpu {0};   //!< final CPU time after end()
+        std::atomic<ns_rep>              m_blocked {0};
+        std::atomic<std::uint64_t>       m_waits {0};
+        std::atomic<std::uint64_t>       m_voluntary {0};
+        std::atomic<std::uint64_t>       m_involuntary {0};
+    }; //<-- class ThreadAccount ends here.
+
+    /** Set of thread accounts .
+     *
+     * @code
+     * for (auto& u : ThreadRegistry::global().snapshot()) {
+     *     std::cout << u.name << " cpu " << u.utilization() << " blocked " << u.blocked.count() << '\n';
+     * }
+     * @endcode
+     */
+    class ThreadRegistry final
+    {
+    public:
+        using account_p = std::shared_ptr<ThreadAccount>;
+        /** Start / end accounting of the calling thread for a scope .
+         */
+        class scope final
+        {
+        public:
+            explicit scope(account_p a) noexcept : m_account(std::move(a)) {if (m_account) m_account->begin();}
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+            ~scope() {if (m_account) m_account->end();}
+        private:
+            account_p m_account;
+        };
+        ThreadRegistry() = default;
+        ThreadRegistry(const ThreadRegistry&) = delete;
+        ThreadRegistry& operator=(const ThreadRegistry&) = delete;
+        /** Process wide registry used by Thread and ThreadPool .
+         */
+        static auto global() -> ThreadRegistry&
+        {
+            static ThreadRegistry r;
+            return r;
+        }
+        /** New account (not started), begin() it in the thread to account .
+         */
+        auto attach(ID_t id, std::string name) -> account_p
+        {
+            auto a = std::make_shared<ThreadAccount>(id, std::move(name));
+            std::lock_guard<std::mutex> l(m_guard);
+            m_accounts.push_back(a);
+            return a;
+        }
+        /** Account the calling thread until the returned scope ends .
+         */
+        auto track(ID_t id, std::string name) -> scope {return scope(attach(id, std::move(name)));}
+        /** Usage of every account, running ones are sampled live .
+         */
+        auto snapshot() const -> std::vector<thread_usage>
+        {
+            std::vector<account_p> as;
+            {
+                std::lock_guard<std::mutex> l(m_guard);
+                as = m_accounts;
+            }
+            std::vector<thread_usage> out;
+            out.reserve(as.size());
+            for (auto& a : as) out.push_back(a->usage());
+            return out;
+        }
+        /** Drop the accounts of stopped threads .
+         *
+         *  \retval dropped count
+         */
+        auto prune() -> size_type
+        {
+            std::lock_guard<std::mutex> l(m_guard);
+            auto before = m_accounts.size();
+            std::erase_if(m_accounts, [](const account_p& a) {return a->finished();});
+            return before - m_accounts.size();
+        }
+        auto size() const -> size_type
+        {
+            std::lock_guard<std::mutex> l(m_guard);
+            return m_accounts.size();
+        }
+    private:
+        mutable std::mutex     m_guard;
+        std::vector<account_p> m_accounts;
+    }; //<-- class ThreadRegistry ends here.
+
+    namespace Internal {
+        /** Adds the scope's duration to the blocked time of an accounted thread .
+         */
+        class blocked_scope final
+        {
+        public:
+            blocked_scope() noexcept : m_account(ThreadAccount::current())
+            {
+                if (m_account) m_begin = std::chrono::steady_clock::now();
+            }
+            blocked_scope(const blocked_scope&) = delete;
+            blocked_scope& operator=(const blocked_scope&) = delete;
+            ~blocked_scope()
+            {
+                if (! m_account) return;
+                m_account->add_blocked(std::chrono::steady_clock::now() - m_begin);
+                m_account->checkpoint();
+            }
+        private:
+            ThreadAccount*                        m_account;
+            std::chrono::steady_clock::time_point m_begin {};
+        };
+    } //<-- namespace Internal ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_THREAD_STATS_Hpp ends here.
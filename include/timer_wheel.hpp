@@ -0,0 +1,508 @@
+/**
+ * @file timer_wheel.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Hierarchical timing wheel (TimerWheel) and timer thread service (TimerService)
+ *
+ * 4 levels of 256 slots, level L slot spans 256^L ticks, deadlines beyond 2^32 ticks wait in an
+ * overflow list. Arm and cancel are O(1) (slab node + intrusive list), advancing skips empty slots
+ * through per level occupancy bitmaps.
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_TIMER_WHEEL_Hpp
+# define  MULT_TIMER_WHEEL_Hpp
+
+# include <algorithm>
+# include <array>
+# include <bit>
+# include <chrono>
+# include <condition_variable>
+# include <cstdint>
+# include <functional>
+# include <mutex>
+# include <optional>
+# include <thread>
+# include <utility>
+# include <vector>
+
+# include "mult.hpp"
+# include "thread_pool.hpp"
+
+namespace Mult {
+    /** Timer handle (0 = none), stale handles are detected by a generation counter .
+     */
+    using timer_id = std::uint64_t;
+
+    /** Hierarchical timing wheel .
+     *
+     * Not thread safe, drive it from one thread (event loop or TimerService):
+     * @code
+     * TimerWheel wheel(std::chrono::milliseconds(1));
+     * auto id = wheel.arm(std::chrono::milliseconds(250), [] {retransmit();});
+     * while (run) {
+     *     poll(fds, wheel.timeout_ms(clock::now()));
+     *     wheel.advance(clock::now());              // callbacks run here
+     * }
+     * @endcode
+     * Deadlines are rounded up to the tick. With slack s, they are also rounded up to a multiple of s
+     * so timers due close together land in one slot and fire in one wake up (coalescing).
+     */
+    class TimerWheel
+    {
+    public:
+        using clock      = std::chrono::steady_clock;
+        using time_point = clock::time_point;
+        using duration   = clock::duration;
+        using callback   = std::function<void()>;
+        static constexpr unsigned LEVELS = 4;
+        static constexpr unsigned SLOTS  = 256;
+        /** Create wheel .
+         *
+         *  \param[in] tick resolution (at least 1ns)
+         *  \param[in] slack coalescing window (0 = none), rounded to ticks
+         *  \param[in] origin time of tick 0
+         */
+        explicit TimerWheel(duration tick = std::chrono::milliseconds(1), duration slack = duration::zero(), time_point origin = clock::now())
+            : m_tick(tick.count() > 0 ? tick : duration(1))
+            , m_slack(static_cast<std::uint64_t>(slack / m_tick))
+            , m_origin(origin)
+        {
+            for (auto& l : m_heads) l.fill(NIL);
+        }
+        TimerWheel(const TimerWheel&) = delete;
+        TimerWheel& operator=(const TimerWheel&) = delete;
+        /** Arm one shot timer, delay counts from the last advance() .
+         *
+         *  \retval id for cancel()
+         */
+        auto arm(duration delay, callback f) -> timer_id {return arm_at_tick(ticks_after(delay), 0, std::move(f));}
+        /** Arm periodic timer, first expiry after period (phase is kept, no drift) .
+         */
+        auto arm_every(duration period, callback f) -> timer_id
+        {
+            auto p = to_ticks(period);
+            return arm_at_tick(ticks_after(period), p ? p : 1, std::move(f));
+        }
+        /** Arm one shot timer at absolute time .
+         */
+        auto arm_at(time_point when, callback f) -> timer_id {return arm_at_tick(tick_of(when), 0, std::move(f));}
+        /** Arm periodic timer, first expiry at first .
+         */
+        auto arm_every_from(time_point first, duration period, callback f) -> timer_id
+        {
+            auto p = to_ticks(period);
+            return arm_at_tick(tick_of(first), p ? p : 1, std::move(f));
+        }
+        /** Cancel timer (also from its own callback) .
+         *
+         *  \retval OK cancelled
+         *  \retval NO_DATA unknown, fired (one shot) or already cancelled
+         */
+        auto cancel(timer_id id) noexcept -> return_code
+        {
+            auto i = index_of(id);
+            if (i == NIL) return NO_DATA;
+            auto& n = m_nodes[i];
+            if (n.state == FIRING || n.state == DUE) { // in the slot being fired, freed by fire()
+                unlink(i);
+                n.state = CANCELLED;
+                --m_armed;
+                return OK;
+            }
+            unlink(i);
+            release(i);
+            --m_armed;
+            return OK;
+        }
+        auto armed(timer_id id) const noexcept -> bool {return index_of(id) != NIL;}
+        /** Number of armed timers .
+         */
+        auto size() const noexcept -> size_type {return m_armed;}
+        auto tick() const noexcept -> duration {return m_tick;}
+        auto now_tick() const noexcept -> std::uint64_t {return m_now;}
+        /** Run every timer due at now, callbacks are invoked inline .
+         *
+         *  \retval number of fired callbacks
+         */
+        auto advance(time_point now) -> size_type
+        {
+            return advance(now, [](timer_id, callback& f) {f();});
+        }
+        /** Run every timer due at now through sink(timer_id, callback&) .
+         *
+         * sink may move the callback out for one shot timers (the node is already free),
+         * for periodic ones it must leave it in place (copy it).
+         * arm() and cancel() may be called from sink.
+         */
+        template <typename Sink>
+        auto advance(time_point now, Sink&& sink) -> size_type
+        {
+            if (now <= m_origin) return 0;
+            auto target = static_cast<std::uint64_t>((now - m_origin) / m_tick);
+            size_type fired = 0;
+            while (m_now < target) {
+                if (m_armed == 0) { // nothing to cascade or fire
+                    m_now = target;
+                    break;
+                }
+                auto next = next_event_tick();
+                if (next > target) {
+                    m_now = target;
+                    break;
+                }
+                m_now = next;
+                cascade();
+                fired += fire(static_cast<unsigned>(m_now & (SLOTS - 1)), sink);
+            }
+            return fired;
+        }
+        /** Lower bound of the next deadline (nullopt when nothing is armed) .
+         *
+         * Exact for timers in the lowest level, a cascade boundary otherwise (wake, advance, ask again).
+         */
+        auto next_deadline() const noexcept -> std::optional<time_point>
+        {
+            if (m_armed == 0) return std::nullopt;
+            return m_origin + m_tick * static_cast<duration::rep>(next_event_tick());
+        }
+        /** Milliseconds until next_deadline() for poll(2)/epoll_wait(2) (-1 = infinite) .
+         */
+        auto timeout_ms(time_point now) const noexcept -> int
+        {
+            auto d = next_deadline();
+            if (! d) return -1;
+            if (*d <= now) return 0;
+            auto ms = std::chrono::ceil<std::chrono::milliseconds>(*d - now).count();
+            return ms > 0x7fffffff ? 0x7fffffff : static_cast<int>(ms);
+        }
+    private:
+        static constexpr std::uint32_t NIL       = ~std::uint32_t{0};
+        static constexpr std::uint16_t OVERFLOW_SLOT = LEVELS * SLOTS;
+        static constexpr std::uint16_t NO_SLOT   = OVERFLOW_SLOT + 1;
+        enum : std::uint8_t {FREE = 0, ARMED, DUE, FIRING, CANCELLED};
+        struct node
+        {
+            std::uint64_t expiry = 0;          //!< nominal tick, slack only rounds the slot
+            std::uint64_t period = 0;
+            std::uint32_t prev = NIL;
+            std::uint32_t next = NIL;
+            std::uint32_t generation = 0;
+            std::uint16_t slot = NO_SLOT;
+            std::uint8_t  state = FREE;
+            callback      fn;
+        };
+        auto to_ticks(duration d) const noexcept -> std::uint64_t {return d.count() <= 0 ? 0 : static_cast<std::uint64_t>(d / m_tick);}
+        auto ceil_ticks(duration d) const noexcept -> std::uint64_t {return static_cast<std::uint64_t>((d + m_tick - duration(1)) / m_tick);}
+        auto tick_of(time_point when) const noexcept -> std::uint64_t
+        {
+            auto t = when <= m_origin ? 0 : ceil_ticks(when - m_origin);
+            return std::max(t, m_now + 1);
+        }
+        auto ticks_after(duration delay) const noexcept -> std::uint64_t {return m_now + (delay.count() <= 0 ? 1 : std::max<std::uint64_t>(ceil_ticks(delay), 1));}
+        auto arm_at_tick(std::uint64_t expiry, std::uint64_t period, callback&& f) -> timer_id
+        {
+            auto i = acquire();
+            auto& n = m_nodes[i];
+            n.period = period;
+            n.fn = std::move(f);
+            n.state = ARMED;
+            insert(i, expiry);
+            ++m_armed;
+            return (static_cast<timer_id>(n.generation) << 32) | (i + 1);
+        }
+        auto index_of(timer_id id) const noexcept -> std::uint32_t
+        {
+            auto i = static_cast<std::uint32_t>(id & 0xffffffffu);
+            if (i == 0 || i > m_nodes.size()) return NIL;
+            auto& n = m_nodes[i - 1];
+            if (n.generation != static_cast<std::uint32_t>(id >> 32) || (n.state != ARMED && n.state != DUE && n.state != FIRING)) return NIL;
+            return i - 1;
+        }
+        auto acquire() -> std::uint32_t
+        {
+            if (m_free != NIL) {
+                auto i = m_free;
+                m_free = m_nodes[i].next;
+                return i;
+            }
+            m_nodes.emplace_back();
+            return static_cast<std::uint32_t>(m_nodes.size() - 1);
+        }
+        auto release(std::uint32_t i) noexcept -> void
+        {
+            auto& n = m_nodes[i];
+            n.fn = nullptr;
+            n.state = FREE;
+            ++n.generation;
+            n.next = m_free;
+            m_free = i;
+        }
+        /** Place node by the highest tick bit where its due tick and now differ .
+         *
+         * The node keeps the nominal expiry (periodic phase), the due tick is rounded up to the slack.
+         * due == now is kept only for cascade() (lands in the slot fired right after it), anywhere
+         * else the slot of now is already being fired and the node would wait a whole wheel turn.
+         */
+        auto insert(std::uint32_t i, std::uint64_t expiry, bool cascading = false) noexcept -> void
+        {
+            auto& n = m_nodes[i];
+            n.expiry = expiry;
+            auto due = m_slack > 1 ? (expiry + m_slack - 1) / m_slack * m_slack : expiry;
+            if (due < m_now || (due == m_now && ! cascading)) due = m_now + 1; // overdue, fires on the next tick
+            auto x = due ^ m_now;
+            auto level = x ? (static_cast<unsigned>(std::bit_width(x)) - 1) / 8 : 0u;
+            std::uint16_t slot = level < LEVELS
+                ? static_cast<std::uint16_t>(level * SLOTS + ((due >> (8 * level)) & (SLOTS - 1)))
+                : OVERFLOW_SLOT;
+            link(i, slot);
+        }
+        auto head(std::uint16_t slot) noexcept -> std::uint32_t& {return slot == OVERFLOW_SLOT ? m_overflow : m_heads[slot / SLOTS][slot % SLOTS];}
+        auto link(std::uint32_t i, std::uint16_t slot) noexcept -> void
+        {
+            auto& n = m_nodes[i];
+            auto& h = head(slot);
+            n.slot = slot;
+            n.prev = NIL;
+            n.next = h;
+            if (h != NIL) m_nodes[h].prev = i;
+            h = i;
+            if (slot != OVERFLOW_SLOT) m_occupied[slot / SLOTS][(slot % SLOTS) / 64] |= std::uint64_t{1} << (slot % 64);
+        }
+        auto unlink(std::uint32_t i) noexcept -> void
+        {
+            auto& n = m_nodes[i];
+            if (n.slot == NO_SLOT) return;
+            if (n.prev != NIL) m_nodes[n.prev].next = n.next;
+            else head(n.slot) = n.next;
+            if (n.next != NIL) m_nodes[n.next].prev = n.prev;
+            if (n.slot != OVERFLOW_SLOT && head(n.slot) == NIL) {
+                m_occupied[n.slot / SLOTS][(n.slot % SLOTS) / 64] &= ~(std::uint64_t{1} << (n.slot % 64));
+            }
+            n.slot = NO_SLOT;
+            n.prev = n.next = NIL;
+        }
+        /** Detach whole slot list .
+         */
+        auto take(std::uint16_t slot) noexcept -> std::uint32_t
+        {
+            auto& h = head(slot);
+            auto list = h;
+            h = NIL;
+            if (slot != OVERFLOW_SLOT) m_occupied[slot / SLOTS][(slot % SLOTS) / 64] &= ~(std::uint64_t{1} << (slot % 64));
+            for (auto i = list; i != NIL; i = m_nodes[i].next) m_nodes[i].slot = NO_SLOT;
+            return list;
+        }
+        /** Re-insert higher level slots reached by m_now (top down) .
+         */
+        auto cascade() noexcept -> void
+        {
+            if ((m_now & 0xffffffffULL) == 0) reinsert(take(OVERFLOW_SLOT));
+            for (unsigned level = LEVELS - 1; level > 0; --level) {
+                if ((m_now & ((std::uint64_t{1} << (8 * level)) - 1)) != 0) continue;
+                reinsert(take(static_cast<std::uint16_t>(level * SLOTS + ((m_now >> (8 * level)) & (SLOTS - 1)))));
+            }
+        }
+        auto reinsert(std::uint32_t list) noexcept -> void
+        {
+            while (list != NIL) {
+                auto next = m_nodes[list].next;
+                insert(list, m_nodes[list].expiry, true);
+                list = next;
+            }
+        }
+        template <typename Sink>
+        auto fire(unsigned slot, Sink& sink) -> size_type
+        {
+            size_type fired = 0;
+            auto list = take(static_cast<std::uint16_t>(slot));
+            for (auto i = list; i != NIL; i = m_nodes[i].next) m_nodes[i].state = DUE; // cancel() must not free them meanwhile
+            while (list != NIL) {
+                auto i = list;
+                list = m_nodes[i].next;
+                m_nodes[i].prev = m_nodes[i].next = NIL;
+                if (m_nodes[i].state == CANCELLED) { // by an earlier callback of this slot
+                    release(i);
+                    continue;
+                }
+                auto id = (static_cast<timer_id>(m_nodes[i].generation) << 32) | (i + 1);
+                ++fired;
+                if (m_nodes[i].period == 0) {
+                    callback f = std::move(m_nodes[i].fn);
+                    release(i);
+                    --m_armed;
+                    sink(id, f);
+                    continue;
+                }
+                m_nodes[i].state = FIRING;
+                insert(i, m_nodes[i].expiry + m_nodes[i].period);
+                callback f = std::move(m_nodes[i].fn); // sink may arm (m_nodes grows)
+                sink(id, f);
+                if (m_nodes[i].state == CANCELLED) {
+                    release(i);
+                } else {
+                    m_nodes[i].fn = std::move(f);
+                    m_nodes[i].state = ARMED;
+                }
+            }
+            return fired;
+        }
+        /** Next tick where a level 0 slot fires or an occupied higher slot cascades .
+         *
+         * Level L only holds digits above the current one (expiry and now differ first at L).
+         */
+        auto next_event_tick() const noexcept -> std::uint64_t
+        {
+            auto best = ~std::uint64_t{0};
+            for (unsigned level = 0; level < LEVELS; ++level) {
+                auto shift = 8 * level;
+                auto start = static_cast<unsigned>((m_now >> shift) & (SLOTS - 1)) + 1;
+                for (unsigned w = start / 64; w < SLOTS / 64; ++w) {
+                    auto bits = m_occupied[level][w];
+                    if (w == start / 64) bits &= ~std::uint64_t{0} << (start % 64);
+                    if (! bits) continue;
+                    auto digit = std::uint64_t{w * 64 + static_cast<unsigned>(std::countr_zero(bits))};
+                    auto high = m_now & ~((std::uint64_t{1} << (shift + 8)) - 1);
+                    best = std::min(best, high | (digit << shift));
+                    break;
+                }
+                if (best != ~std::uint64_t{0}) return best; // lower levels always come first
+            }
+            if (m_overflow != NIL) best = (m_now | 0xffffffffULL) + 1;
+            return best;
+        }
+        duration                                                m_tick;
+        std::uint64_t                                           m_slack;
+        time_point                                              m_origin;
+        std::uint64_t                                           m_now = 0;
+        size_type                                               m_armed = 0;
+        std::vector<node>                                       m_nodes;
+        std::uint32_t                                           m_free = NIL;
+        std::array<std::array<std::uint32_t, SLOTS>, LEVELS>    m_heads;
+        std::array<std::array<std::uint64_t, SLOTS / 64>, LEVELS> m_occupied {};
+        std::uint32_t                                           m_overflow = NIL;
+    }; //<-- class TimerWheel ends here.
+
+    /** Timer thread driving a TimerWheel .
+     *
+     * Callbacks run on the executor pool when given, on the timer thread otherwise
+     * (keep them short there). Safe to use from any thread, also from callbacks.
+     * A callback already handed to the executor may still run once after cancel().
+     * @code
+     * TimerService timers(&pool, std::chrono::milliseconds(1), std::chrono::milliseconds(4));
+     * auto id = timers.schedule_after(std::chrono::seconds(3), [this] {post_event(TIMEOUT);});
+     * ...
+     * timers.cancel(id);
+     * @endcode
+     */
+    class TimerService final
+    {
+    public:
+        using clock      = TimerWheel::clock;
+        using duration   = TimerWheel::duration;
+        using time_point = TimerWheel::time_point;
+        using callback   = TimerWheel::callback;
+        /** Start timer thread .
+         *
+         *  \param[in] executor pool running callbacks (nullptr = timer thread)
+         *  \param[in] tick wheel resolution
+         *  \param[in] slack coalescing window
+         */
+        explicit TimerService(ThreadPool* executor = nullptr, duration tick = std::chrono::milliseconds(1), duration slack = duration::zero())
+            : m_executor(executor)
+            , m_wheel(tick, slack)
+            , m_thread([this] {loop();})
+        {}
+        TimerService(const TimerService&) = delete;
+        TimerService& operator=(const TimerService&) = delete;
+        /** Stop the thread, pending timers are dropped .
+         */
+        ~TimerService()
+        {
+            {
+                std::lock_guard<std::mutex> l(m_guard);
+                m_stop = true;
+            }
+            m_wake.notify_one();
+            if (m_thread.joinable()) m_thread.join();
+        }
+        auto schedule_after(duration delay, callback f) -> timer_id
+        {
+            return arm([&] {return m_wheel.arm_at(clock::now() + delay, std::move(f));}); // wheel time stands still while idle
+        }
+        auto schedule_at(time_point when, callback f) -> timer_id
+        {
+            return arm([&] {return m_wheel.arm_at(when, std::move(f));});
+        }
+        auto schedule_every(duration period, callback f) -> timer_id
+        {
+            return arm([&] {return m_wheel.arm_every_from(clock::now() + period, period, std::move(f));});
+        }
+        /**
+         *  \retval OK cancelled
+         *  \retval NO_DATA unknown, fired or already cancelled
+         */
+        auto cancel(timer_id id) -> return_code
+        {
+            std::lock_guard<std::mutex> l(m_guard);
+            return m_wheel.cancel(id);
+        }
+        auto size() -> size_type
+        {
+            std::lock_guard<std::mutex> l(m_guard);
+            return m_wheel.size();
+        }
+    private:
+        template <typename A>
+        auto arm(A&& a) -> timer_id
+        {
+            std::unique_lock<std::mutex> l(m_guard);
+            auto id = a();
+            auto d = m_wheel.next_deadline();
+            bool earlier = d && *d < m_sleep_until;
+            l.unlock();
+            if (earlier) m_wake.notify_one(); // only when the timer thread sleeps past the new deadline
+            return id;
+        }
+        auto loop() -> void
+        {
+            std::vector<callback> batch;
+            std::unique_lock<std::mutex> l(m_guard);
+            while (! m_stop) {
+                m_wheel.advance(clock::now(), [&batch](timer_id, callback& f) {batch.push_back(f);});
+                if (! batch.empty()) {
+                    l.unlock();
+                    for (auto& f : batch) deliver(f);
+                    batch.clear();
+                    l.lock();
+                    continue;
+                }
+                auto d = m_wheel.next_deadline();
+                m_sleep_until = d ? *d : time_point::max();
+                if (d) m_wake.wait_until(l, *d);
+                else m_wake.wait(l);
+                m_sleep_until = time_point::min();
+            }
+        }
+        auto deliver(callback& f) -> void
+        {
+            if (m_executor && m_executor->post(std::move(f)) == OK) return;
+            if (f) f();
+        }
+        ThreadPool*             m_executor;
+        std::mutex              m_guard;
+        std::condition_variable m_wake;
+        TimerWheel              m_wheel;
+        time_point              m_sleep_until = time_point::min();
+        bool                    m_stop = false;
+        std::thread             m_thread; // last : starts after every other member
+    }; //<-- class TimerService ends here.
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_TIMER_WHEEL_Hpp ends here.
@@ -0,0 +1,376 @@
+/**
+ * @file utf8.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief UTF-8 validator and ASCII classifier
+ *
+ * Bulk check is the lookup algorithm of J.Keiser and D.Lemire (simdjson)
+ * on AVX2 or SSSE3 (selected at compile time). When a block contains an error
+ * the exact offset is located by the scalar validator from the last character boundary.
+ * Validation is strict RFC 3629 (no overlong, no surrogate, nothing over U+10FFFF).
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_UTF8_Hpp
+# define  MULT_UTF8_Hpp
+
+# include <cstring>
+
+# if defined (__AVX2__) || defined (__SSSE3__)
+#  include <immintrin.h>
+# endif
+
+# include "byte_buffer.hpp"
+
+namespace Mult {
+    namespace Internal {
+        /** Length of sequence from lead byte (0 is invalid lead) .
+         */
+        constexpr size_type utf8_sequence_length(std::uint8_t c) noexcept
+        {
+            if (c < 0x80) return 1;
+            if (c < 0xc2) return 0; // continuation or overlong 2 byte lead
+            if (c < 0xe0) return 2;
+            if (c < 0xf0) return 3;
+            if (c < 0xf5) return 4;
+            return 0;
+        }
+        /** Scalar validator .
+         *
+         *  \param[in] s target
+         *  \param[in] pos start position (must be a character boundary)
+         *  \param[in] n length of s
+         *  \param[out] incomplete length of the valid but incomplete sequence at the end
+         *  \retval offset of the first invalid sequence, n when no error
+         */
+        inline size_type utf8_scalar(const std::uint8_t* s, size_type pos, size_type n, size_type& incomplete) noexcept
+        {
+            incomplete = 0;
+            while (pos < n) {
+                auto c = s[pos];
+                if (c < 0x80) {++pos; continue;}
+                auto l = utf8_sequence_length(c);
+                if (l == 0) return pos;
+                // second byte range depends on lead
+                std::uint8_t lo = 0x80, hi = 0xbf;
+                if      (c == 0xe0) lo = 0xa0;
+                else if (c == 0xed) hi = 0x9f;
+                else if (c == 0xf0) lo = 0x90;
+                else if (c == 0xf4) hi = 0x8f;
+                for (size_type i = 1; i < l; ++i) {
+                    if (pos + i >= n) {
+                        incomplete = n - pos;
+                        return n;
+                    }
+                    auto x = s[pos + i];
+                    if (x < lo || x > hi) return pos;
+                    lo = 0x80;
+                    hi = 0xbf;
+                }
+                pos += l;
+            }
+            return n;
+        }
+        /** Start of the character which contains the byte before pos .
+         *
+         * the prefix before pos is checked by SIMD except the lead bytes in its last 3 bytes
+         */
+        inline size_type utf8_boundary(const std::uint8_t* s, size_type pos) noexcept
+        {
+            for (size_type k = 1; k <= 3 && k <= pos; ++k) {
+                auto c = s[pos - k];
+                if ((c & 0xc0) != 0x80) { // lead or ASCII
+                    auto l = utf8_sequence_length(c);
+                    return (l == 0 || l > k) ? pos - k : pos;
+                }
+            }
+            return pos;
+        }
+
+        static constexpr std::uint8_t UTF8_TOO_SHORT      = 1 << 0;
+        static constexpr std::uint8_t UTF8_TOO_LONG       = 1 << 1;
+        static constexpr std::uint8_t UTF8_OVERLONG_3     = 1 << 2;
+        static constexpr std::uint8_t UTF8_TOO_LARGE      = 1 << 3;
+        static constexpr std::uint8_t UTF8_SURROGATE      = 1 << 4;
+        static constexpr std::uint8_t UTF8_OVERLONG_2     = 1 << 5;
+        static constexpr std::uint8_t UTF8_TOO_LARGE_1000 = 1 << 6;
+        static constexpr std::uint8_t UTF8_OVERLONG_4     = 1 << 6;
+        static constexpr std::uint8_t UTF8_TWO_CONTS      = 1 << 7;
+        static constexpr std::uint8_t UTF8_CARRY          = UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS;
+        static constexpr std::uint8_t utf8Byte1HighTbl[16] = {
+            UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+            UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+            UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+            UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+            UTF8_TOO_SHORT,
+            UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+            UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+        };
+        static constexpr std::uint8_t utf8Byte1LowTbl[16] = {
+            UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+            UTF8_CARRY | UTF8_OVERLONG_2,
+            UTF8_CARRY,
+            UTF8_CARRY,
+            UTF8_CARRY | UTF8_TOO_LARGE,
+            UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+            UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+            UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+            UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+            UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+            UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+            UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+            UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+            UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+            UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+            UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+        };
+        static constexpr std::uint8_t utf8Byte2HighTbl[16] = {
+            UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+            UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+            UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+            UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+            UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE  | UTF8_TOO_LARGE,
+            UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE  | UTF8_TOO_LARGE,
+            UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+        };
+# if defined (__AVX2__)
+        using utf8_vector = __m256i;
+        static constexpr size_type UTF8_BLOCK = 32;
+        inline utf8_vector utf8_load(const std::uint8_t* p) noexcept {return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));}
+        inline utf8_vector utf8_lut(const std::uint8_t* t) noexcept {return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t)));}
+        template <int N>
+        inline utf8_vector utf8_prev(utf8_vector in, utf8_vector prev) noexcept
+        {
+            return _mm256_alignr_epi8(in, _mm256_permute2x128_si256(prev, in, 0x21), 16 - N);
+        }
+        inline utf8_vector utf8_nibble_hi(utf8_vector v) noexcept {return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f));}
+        inline utf8_vector utf8_nibble_lo(utf8_vector v) noexcept {return _mm256_and_si256(v, _mm256_set1_epi8(0x0f));}
+        inline utf8_vector utf8_shuffle(utf8_vector t, utf8_vector i) noexcept {return _mm256_shuffle_epi8(t, i);}
+        inline utf8_vector utf8_and(utf8_vector a, utf8_vector b) noexcept {return _mm256_and_si256(a, b);}
+        inline utf8_vector utf8_or(utf8_vector a, utf8_vector b) noexcept {return _mm256_or_si256(a, b);}
+        inline utf8_vector utf8_xor(utf8_vector a, utf8_vector b) noexcept {return _mm256_xor_si256(a, b);}
+        inline utf8_vector utf8_subs(utf8_vector a, utf8_vector b) noexcept {return _mm256_subs_epu8(a, b);}
+        inline utf8_vector utf8_splat(std::uint8_t b) noexcept {return _mm256_set1_epi8(static_cast<char>(b));}
+        inline utf8_vector utf8_zero() noexcept {return _mm256_setzero_si256();}
+        inline bool utf8_any(utf8_vector v) noexcept {return ! _mm256_testz_si256(v, v);}
+        inline int utf8_movemask(utf8_vector v) noexcept {return _mm256_movemask_epi8(v);}
+        inline utf8_vector utf8_incomplete_max() noexcept
+        {
+            return _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                    static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1), static_cast<char>(0xc0 - 1));
+        }
+# elif defined (__SSSE3__)
+        using utf8_vector = __m128i;
+        static constexpr size_type UTF8_BLOCK = 16;
+        inline utf8_vector utf8_load(const std::uint8_t* p) noexcept {return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));}
+        inline utf8_vector utf8_lut(const std::uint8_t* t) noexcept {return _mm_loadu_si128(reinterpret_cast<const __m128i*>(t));}
+        template <int N>
+        inline utf8_vector utf8_prev(utf8_vector in, utf8_vector prev) noexcept {return _mm_alignr_epi8(in, prev, 16 - N);}
+        inline utf8_vector utf8_nibble_hi(utf8_vector v) noexcept {return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));}
+        inline utf8_vector utf8_nibble_lo(utf8_vector v) noexcept {return _mm_and_si128(v, _mm_set1_epi8(0x0f));}
+        inline utf8_vector utf8_shuffle(utf8_vector t, utf8_vector i) noexcept {return _mm_shuffle_epi8(t, i);}
+        inline utf8_vector utf8_and(utf8_vector a, utf8_vector b) noexcept {return _mm_and_si128(a, b);}
+        inline utf8_vector utf8_or(utf8_vector a, utf8_vector b) noexcept {return _mm_or_si128(a, b);}
+        inline utf8_vector utf8_xor(utf8_vector a, utf8_vector b) noexcept {return _mm_xor_si128(a, b);}
+        inline utf8_vector utf8_subs(utf8_vector a, utf8_vector b) noexcept {return _mm_subs_epu8(a, b);}
+        inline utf8_vector utf8_splat(std::uint8_t b) noexcept {return _mm_set1_epi8(static_cast<char>(b));}
+        inline utf8_vector utf8_zero() noexcept {return _mm_setzero_si128();}
+        inline bool utf8_any(utf8_vector v) noexcept {return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xffff;}
+        inline int utf8_movemask(utf8_vector v) noexcept {return _mm_movemask_epi8(v);}
+        inline utf8_vector utf8_incomplete_max() noexcept
+        {
+            return _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                 static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1), static_cast<char>(0xc0 - 1));
+        }
+# endif
+# if defined (__AVX2__) || defined (__SSSE3__)
+        /** Error bits of one block (non zero when the block has an error) .
+         */
+        inline utf8_vector utf8_block_error(utf8_vector in, utf8_vector prev) noexcept
+        {
+            auto prev1 = utf8_prev<1>(in, prev);
+            auto b1h = utf8_shuffle(utf8_lut(utf8Byte1HighTbl), utf8_nibble_hi(prev1));
+            auto b1l = utf8_shuffle(utf8_lut(utf8Byte1LowTbl), utf8_nibble_lo(prev1));
+            auto b2h = utf8_shuffle(utf8_lut(utf8Byte2HighTbl), utf8_nibble_hi(in));
+            auto sc  = utf8_and(utf8_and(b1h, b1l), b2h);
+            auto prev2 = utf8_prev<2>(in, prev);
+            auto prev3 = utf8_prev<3>(in, prev);
+            auto must23 = utf8_or(utf8_subs(prev2, utf8_splat(0xe0 - 0x80)), utf8_subs(prev3, utf8_splat(0xf0 - 0x80)));
+            return utf8_xor(utf8_and(must23, utf8_splat(0x80)), sc);
+        }
+# endif
+        /** Validator (bulk by SIMD, exact offset by scalar) .
+         *
+         *  \param[out] incomplete length of the valid but incomplete sequence at the end
+         *  \retval offset of the first invalid sequence, n when no error
+         */
+        inline size_type utf8_validate(const std::uint8_t* s, size_type n, size_type& incomplete) noexcept
+        {
+            size_type pos = 0;
+# if defined (__AVX2__) || defined (__SSSE3__)
+            auto prev = utf8_zero();
+            auto prev_incomplete = utf8_zero();
+            for (; pos + UTF8_BLOCK <= n; pos += UTF8_BLOCK) {
+                auto in = utf8_load(s + pos);
+                if (utf8_movemask(in) == 0) { // ASCII only
+                    if (utf8_any(prev_incomplete)) break;
+                } else {
+                    if (utf8_any(utf8_block_error(in, prev))) break;
+                    // lead byte in the last 3 bytes which needs the next block
+                    prev_incomplete = utf8_subs(in, utf8_incomplete_max());
+                }
+                prev = in;
+            }
+            pos = utf8_boundary(s, pos);
+# endif
+            return utf8_scalar(s, pos, n, incomplete);
+        }
+    } //<-- namespace Internal ends here.
+
+    /** Offset of the first non ASCII byte .
+     *
+     *  \param[in] src target
+     *  \param[in] n length of src
+     *  \retval n all bytes are ASCII
+     *  \retval other offset of the first byte over 0x7f
+     */
+    inline size_type ascii_validate(const char* src, size_type n) noexcept
+    {
+        auto s = reinterpret_cast<const std::uint8_t*>(src);
+        size_type pos = 0;
+# if defined (__AVX2__) || defined (__SSSE3__)
+        for (; pos + Internal::UTF8_BLOCK * 2 <= n; pos += Internal::UTF8_BLOCK * 2) {
+            auto v = Internal::utf8_or(Internal::utf8_load(s + pos), Internal::utf8_load(s + pos + Internal::UTF8_BLOCK));
+            if (Internal::utf8_movemask(v) != 0) break;
+        }
+        for (; pos + Internal::UTF8_BLOCK <= n; pos += Internal::UTF8_BLOCK) {
+            auto m = static_cast<unsigned>(Internal::utf8_movemask(Internal::utf8_load(s + pos)));
+            if (m != 0) return pos + static_cast<size_type>(__builtin_ctz(m));
+        }
+# else
+        for (; pos + 8 <= n; pos += 8) {
+            std::uint64_t w;
+            std::memcpy(&w, s + pos, 8);
+            if (w & 0x8080808080808080ULL) break;
+        }
+# endif
+        for (; pos < n; ++pos) {
+            if (s[pos] & 0x80) return pos;
+        }
+        return n;
+    }
+    /** Offset of the first invalid UTF-8 sequence .
+     *
+     * A sequence cut at the end of src is invalid, use Utf8Validator for chunked input.
+     *
+     *  \param[in] src target
+     *  \param[in] n length of src
+     *  \retval n src is valid UTF-8
+     *  \retval other offset of the lead byte of the first invalid sequence
+     */
+    inline size_type utf8_validate(const char* src, size_type n) noexcept
+    {
+        size_type incomplete = 0;
+        auto r = Internal::utf8_validate(reinterpret_cast<const std::uint8_t*>(src), n, incomplete);
+        return (r == n) ? n - incomplete : r;
+    }
+    inline bool is_ascii(const char* src, size_type n) noexcept {return ascii_validate(src, n) == n;}
+    inline bool is_utf8(const char* src, size_type n) noexcept {return utf8_validate(src, n) == n;}
+
+    /** Incremental UTF-8 validator .
+     *
+     * Chunks are fed in order, a sequence split over chunks is carried by up to 3 pending bytes.
+     * Offsets are counted from the first byte of the first chunk.
+     */
+    class Utf8Validator
+    {
+    public:
+        static constexpr size_type npos = static_cast<size_type>(-1);
+        Utf8Validator() noexcept = default;
+        /** Validate next chunk .
+         *
+         *  \retval OK valid so far
+         *  \retval FAIL_ARG invalid sequence (see error_offset), later feed is ignored
+         */
+        return_code feed(const char* src, size_type n) noexcept
+        {
+            if (m_error != npos) return FAIL_ARG;
+            auto s = reinterpret_cast<const std::uint8_t*>(src);
+            size_type used = 0;
+            if (m_pending_len) { // complete the pending sequence first
+                auto need = Internal::utf8_sequence_length(m_pending[0]) - m_pending_len;
+                auto take = (n < need) ? n : need;
+                std::memcpy(m_pending + m_pending_len, s, take);
+                size_type incomplete = 0;
+                auto len = m_pending_len + take;
+                auto r = Internal::utf8_scalar(m_pending, 0, len, incomplete);
+                if (r != len) return fail(m_offset - m_pending_len);
+                if (incomplete) {
+                    m_pending_len = len;
+                    m_offset += take;
+                    return OK;
+                }
+                m_pending_len = 0;
+                used = take;
+            }
+            size_type incomplete = 0;
+            auto r = Internal::utf8_validate(s + used, n - used, incomplete);
+            if (r != n - used) return fail(m_offset + used + r);
+            std::memcpy(m_pending, s + n - incomplete, incomplete);
+            m_pending_len = incomplete;
+            m_offset += n;
+            return OK;
+        }
+        return_code feed(std::string_view v) noexcept {return feed(v.data(), v.size());}
+        /** End of input (pending sequence is an error) .
+         */
+        return_code finish() noexcept
+        {
+            if (m_error != npos) return FAIL_ARG;
+            if (m_pending_len) return fail(m_offset - m_pending_len);
+            return OK;
+        }
+        void reset() noexcept
+        {
+            m_offset = 0;
+            m_error = npos;
+            m_pending_len = 0;
+        }
+        /** Offset of the first invalid sequence (npos when no error) .
+         */
+        size_type error_offset() const noexcept {return m_error;}
+        /** Total length of fed bytes (until error) .
+         */
+        size_type consumed() const noexcept {return m_offset;}
+        /** Length of the sequence waiting for the next chunk .
+         */
+        size_type pending() const noexcept {return m_pending_len;}
+    private:
+        return_code fail(size_type offset) noexcept
+        {
+            m_error = offset;
+            m_pending_len = 0;
+            return FAIL_ARG;
+        }
+        std::uint8_t m_pending[4]{};
+        size_type m_pending_len{0};
+        size_type m_offset{0};
+        size_type m_error{npos};
+    }; //<-- class Utf8Validator ends here.
+
+    inline size_type asciiValidate(const ByteBuffer& src) noexcept {return ascii_validate(src.const_ptr(), src.size());}
+    inline size_type asciiValidate(std::string_view src) noexcept {return ascii_validate(src.data(), src.size());}
+    inline size_type utf8Validate(const ByteBuffer& src) noexcept {return utf8_validate(src.const_ptr(), src.size());}
+    inline size_type utf8Validate(std::string_view src) noexcept {return utf8_validate(src.data(), src.size());}
+    inline bool isAscii(const ByteBuffer& src) noexcept {return is_ascii(src.const_ptr(), src.size());}
+    inline bool isUtf8(const ByteBuffer& src) noexcept {return is_utf8(src.const_ptr(), src.size());}
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_UTF8_Hpp ends here.
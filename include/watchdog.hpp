@@ -0,0 +1,353 @@
+/**
+ * @file watchdog.hpp
+ *
+ * @copyright © 2023 s3mat3
+ *
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief Heartbeat stall watchdog for long running thread loops
+ *
+ * A watched thread beats a cache line private counter (one relaxed store per loop).
+ * One watchdog thread samples every counter, a counter that does not move for longer than
+ * its threshold is a stall: the stalled thread's backtrace is captured with a signal and
+ * reported (through the logger by default). Linux / glibc only (backtrace(3)).
+ *
+ * @author s3mat3
+ */
+
+#pragma once
+
+#ifndef MULT_WATCHDOG_Hpp
+# define  MULT_WATCHDOG_Hpp
+
+# include <algorithm>
+# include <atomic>
+# include <cerrno>
+# include <chrono>
+# include <condition_variable>
+# include <csignal>
+# include <cstdlib>
+# include <functional>
+# include <map>
+# include <memory>
+# include <mutex>
+# include <string>
+# include <thread>
+# include <utility>
+# include <vector>
+
+# include <execinfo.h>
+# include <pthread.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+
+# include "mult.hpp"
+# include "debug.hpp"
+
+namespace Mult {
+    /** One detected stall .
+     */
+    struct stall_report
+    {
+        std::string                         name;
+        long                                tid = 0;
+        std::chrono::milliseconds           stalled {0};   //!< time since the last beat
+        std::chrono::milliseconds           threshold {0};
+        std::uint64_t                       beats = 0;     //!< beats before the stall
+        std::vector<std::string>            backtrace;     //!< empty when the thread did not answer the signal
+    };
+
+    namespace Internal {
+        /** Counter of one watched thread, alone in its cache line .
+         */
+        struct alignas(64) heartbeat_slot
+        {
+            std::atomic<std::uint64_t> count {0}; //!< odd = parked
+            char                       pad[64 - sizeof(std::atomic<std::uint64_t>)];
+            // written at enroll only, read by the watchdog
+            std::string                      name;
+            std::chrono::milliseconds        threshold {0};
+            pthread_t                        thread {};
+            long                             tid = 0;
+            // watchdog thread only
+            std::uint64_t                         seen = 0;
+            std::chrono::steady_clock::time_point changed {};
+            bool                                  reported = false;
+        };
+        /** Backtrace handed over from the signal handler (one capture at a time) .
+         */
+        struct stack_capture
+        {
+            static constexpr int MAX_FRAMES = 64;
+            enum : int {IDLE, REQUESTED, CAPTURING, DONE};
+            std::atomic<int> state {IDLE};
+            void*            frames[MAX_FRAMES] {};
+            int              depth = 0;
+            static inline stack_capture& instance() noexcept {return s_capture;}
+            static void on_signal(int) noexcept
+            {
+                auto& c = s_capture;
+                int expect = REQUESTED;
+                if (! c.state.compare_exchange_strong(expect, CAPTURING, std::memory_order_acquire)) return; // not ours
+                auto saved = errno;
+                c.depth = ::backtrace(c.frames, MAX_FRAMES);
+                errno = saved;
+                c.state.store(DONE, std::memory_order_release);
+            }
+            static stack_capture s_capture;
+        };
+        inline stack_capture stack_capture::s_capture {};
+    } //<-- namespace Internal ends here.
+
+    class Watchdog;
+    /** Heartbeat of the enrolled thread (move only, owned and used by that thread) .
+     *
+     * Destroy it on its thread before the thread ends and before the Watchdog.
+     */
+    class Heartbeat final
+    {
+    public:
+        Heartbeat() noexcept = default;
+        Heartbeat(const Heartbeat&) = delete;
+        Heartbeat& operator=(const Heartbeat&) = delete;
+        Heartbeat(Heartbeat&& rhs) noexcept
+            : m_owner(std::exchange(rhs.m_owner, nullptr)), m_slot(std::exchange(rhs.m_slot, nullptr)), m_local(rhs.m_local) {}
+        Heartbeat& operator=(Heartbeat&& rhs) noexcept
+        {
+            if (this != &rhs) {
+                leave();
+                m_owner = std::exchange(rhs.m_owner, nullptr);
+                m_slot = std::exchange(rhs.m_slot, nullptr);
+                m_local = rhs.m_local;
+            }
+            return *this;
+        }
+        ~Heartbeat() {leave();}
+        /** Loop iteration done (one relaxed store) .
+         */
+        void beat() noexcept
+        {
+            m_local = (m_local | 1) + 1;
+            m_slot->count.store(m_local, std::memory_order_relaxed);
+        }
+        /** Going to wait on purpose (e.g. for input), not watched until the next beat() .
+         */
+        void park() noexcept
+        {
+            m_local |= 1;
+            m_slot->count.store(m_local, std::memory_order_relaxed);
+        }
+        explicit operator bool() const noexcept {return m_slot != nullptr;}
+    private:
+        friend class Watchdog;
+        Heartbeat(Watchdog* o, Internal::heartbeat_slot* s) noexcept : m_owner(o), m_slot(s) {}
+        inline void leave() noexcept;
+        Watchdog*                 m_owner = nullptr;
+        Internal::heartbeat_slot* m_slot  = nullptr;
+        std::uint64_t             m_local = 0;
+    }; //<-- class Heartbeat ends here.
+
+    /** Stall watchdog .
+     *
+     * @code
+     * Watchdog dog;                                  // samples every 10ms, reports through MULT_ERROR
+     * void Rx::entry(void_ptr) {
+     *     auto hb = dog.enroll("rx", std::chrono::milliseconds(200));
+     *     while (m_run) {
+     *         hb.park();                             // blocking on input is not a stall
+     *         auto n = wait_input();
+     *         handle(n);
+     *         hb.beat();
+     *     }
+     * }
+     * @endcode
+     * Each stall is reported once, the thread is watched again after its next beat.
+     * The backtrace signal (default SIGRTMIN + 1) is installed while any Watchdog lives.
+     */
+    class Watchdog final
+    {
+    public:
+        using clock    = std::chrono::steady_clock;
+        using reporter = std::function<void(const stall_report&)>;
+        /**
+         *  \param[in] period sampling period
+         *  \param[in] report stall sink (nullptr: MULT_ERROR)
+         *  \param[in] signo signal used to capture backtraces (0: no backtrace)
+         */
+        explicit Watchdog(std::chrono::milliseconds period = std::chrono::milliseconds(10), reporter report = nullptr, int signo = SIGRTMIN + 1)
+            : m_period(period), m_report(std::move(report)), m_signo(signo)
+        {
+            if (m_signo) install(m_signo);
+            m_thread = std::thread([this] {loop();});
+        }
+        Watchdog(const Watchdog&) = delete;
+        Watchdog& operator=(const Watchdog&) = delete;
+        ~Watchdog()
+        {
+            {
+                std::lock_guard<std::mutex> l(m_guard);
+                m_stop = true;
+            }
+            m_monitor.notify_all();
+            m_thread.join();
+            if (m_signo) uninstall(m_signo);
+        }
+        /** Watch the calling thread .
+         *
+         *  \param[in] name reported name
+         *  \param[in] threshold longest allowed time between beats
+         */
+        auto enroll(std::string name, std::chrono::milliseconds threshold) -> Heartbeat
+        {
+            auto s = std::make_unique<Internal::heartbeat_slot>();
+            s->name = std::move(name);
+            s->threshold = threshold;
+            s->thread = pthread_self();
+            s->tid = static_cast<long>(::syscall(SYS_gettid));
+            s->changed = clock::now();
+            auto p = s.get();
+            std::lock_guard<std::mutex> l(m_guard);
+            m_slots.push_back(std::move(s));
+            return Heartbeat(this, p);
+        }
+        /** Stalls reported so far .
+         */
+        auto stalls() const noexcept -> size_type {return m_stalls.load(std::memory_order_relaxed);}
+        auto size() const -> size_type
+        {
+            std::lock_guard<std::mutex> l(m_guard);
+            return m_slots.size();
+        }
+    private:
+        friend class Heartbeat;
+        static constexpr auto CAPTURE_WAIT = std::chrono::milliseconds(200);
+        auto leave(Internal::heartbeat_slot* s) noexcept -> void
+        {
+            std::lock_guard<std::mutex> l(m_guard); // the watchdog can not signal a thread that is gone
+            std::erase_if(m_slots, [s](const auto& p) {return p.get() == s;});
+        }
+        auto loop() -> void
+        {
+            std::unique_lock<std::mutex> l(m_guard);
+            std::vector<stall_report> found;
+            while (! m_stop) {
+                m_monitor.wait_for(l, m_period, [this] {return m_stop;});
+                if (m_stop) break;
+                auto now = clock::now();
+                for (auto& s : m_slots) {
+                    auto c = s->count.load(std::memory_order_relaxed);
+                    if (c != s->seen) {
+                        s->seen = c;
+                        s->changed = now;
+                        s->reported = false;
+                        continue;
+                    }
+                    if ((c & 1) || s->reported || now - s->changed < s->threshold) continue;
+                    s->reported = true;
+                    stall_report r;
+                    r.name = s->name;
+                    r.tid = s->tid;
+                    r.stalled = std::chrono::duration_cast<std::chrono::milliseconds>(now - s->changed);
+                    r.threshold = s->threshold;
+                    r.beats = c / 2;
+                    if (m_signo) r.backtrace = capture(s->thread); // slot owner can not leave while we hold m_guard
+                    found.push_back(std::move(r));
+                }
+                if (found.empty()) continue;
+                m_stalls.fetch_add(found.size(), std::memory_order_relaxed);
+                l.unlock(); // the reporter may enroll / leave
+                for (auto& r : found) deliver(r);
+                found.clear();
+                l.lock();
+            }
+        }
+        auto capture(pthread_t t) -> std::vector<std::string>
+        {
+            using C = Internal::stack_capture;
+            auto& c = C::instance();
+            std::lock_guard<std::mutex> one(capture_guard()); // one capture per process at a time
+            c.state.store(C::REQUESTED, std::memory_order_release);
+            if (pthread_kill(t, m_signo) != 0) {
+                c.state.store(C::IDLE, std::memory_order_relaxed);
+                return {};
+            }
+            auto limit = clock::now() + CAPTURE_WAIT;
+            while (c.state.load(std::memory_order_acquire) != C::DONE) {
+                if (clock::now() > limit) {
+                    int expect = C::REQUESTED;
+                    if (c.state.compare_exchange_strong(expect, C::IDLE)) return {}; // blocked the signal, no answer
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            std::vector<std::string> out;
+            if (auto names = ::backtrace_symbols(c.frames, c.depth)) {
+                for (int i = std::min(2, c.depth); i < c.depth; ++i) out.emplace_back(names[i]); // skip handler and signal trampoline
+                std::free(names);
+            }
+            c.state.store(C::IDLE, std::memory_order_release);
+            return out;
+        }
+        auto deliver(const stall_report& r) -> void
+        {
+            if (m_report) {
+                m_report(r);
+                return;
+            }
+            std::string msg = "=====> stall " + r.name + " (tid " + std::to_string(r.tid) + ") no beat for "
+                            + std::to_string(r.stalled.count()) + "ms (threshold " + std::to_string(r.threshold.count()) + "ms)";
+            for (auto& f : r.backtrace) msg += "\n    " + f;
+            MULT_ERROR(msg);
+        }
+        static auto capture_guard() -> std::mutex& {static std::mutex m; return m;}
+        /** Install the capture handler (reference counted per signal) .
+         */
+        static auto install(int signo) -> void
+        {
+            std::lock_guard<std::mutex> l(handler_guard());
+            auto& [users, previous] = handlers()[signo];
+            if (users++ > 0) return;
+            void* prime[1];
+            ::backtrace(prime, 1); // loads libgcc now, not inside the handler
+            struct sigaction sa {};
+            sa.sa_handler = Internal::stack_capture::on_signal;
+            sa.sa_flags = SA_RESTART;
+            sigemptyset(&sa.sa_mask);
+            ::sigaction(signo, &sa, &previous);
+        }
+        static auto uninstall(int signo) -> void
+        {
+            std::lock_guard<std::mutex> l(handler_guard());
+            auto h = handlers().find(signo);
+            if (h == handlers().end() || --h->second.first > 0) return;
+            ::sigaction(signo, &h->second.second, nullptr);
+            handlers().erase(h);
+        }
+        static auto handler_guard() -> std::mutex& {static std::mutex m; return m;}
+        /** signal -> (watchdogs using it, action saved at first install) .
+         */
+        static auto handlers() -> std::map<int, std::pair<int, struct sigaction>>&
+        {
+            static std::map<int, std::pair<int, struct sigaction>> h;
+            return h;
+        }
+
+        const std::chrono::milliseconds                        m_period;
+        const reporter                                         m_report;
+        const int                                              m_signo;
+        mutable std::mutex                                     m_guard;
+        std::condition_variable                                m_monitor;
+        std::vector<std::unique_ptr<Internal::heartbeat_slot>> m_slots;
+        std::atomic<size_type>                                 m_stalls {0};
+        bool                                                   m_stop = false;
+        std::thread                                            m_thread;
+    }; //<-- class Watchdog ends here.
+
+    inline void Heartbeat::leave() noexcept
+    {
+        if (m_owner && m_slot) m_owner->leave(m_slot);
+        m_owner = nullptr;
+        m_slot = nullptr;
+    }
+} //<-- namespace Mult ends here.
+
+#endif //<-- macro  MULT_WATCHDOG_Hpp ends here.
@@ -10,11 +10,22 @@
  *
  * @author matsuo.shin@gmail.com
  */
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <string>
 #include <vector>
 #include "benchmark.h"
 
+#include "base64.hpp"
+#include "byte_order.hpp"
+#include "chunker.hpp"
+#include "flat_message.hpp"
+#include "mapped_file.hpp"
+#include "multi_pattern.hpp"
+#include "serializer.hpp"
 #include "byte_buffer.hpp"
+#include "utf8.hpp"
 
 using namespace Mult;
 /**  .
@@ -125,4 +136,459 @@ BENCHMARK(BM_string_assign);
 BENCHMARK(BM_buffer_assign);
 BENCHMARK(BM_buffer_string_assign);
 
+static void BM_buffer_hex_dump_string(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS, 'c');
+    for (auto _ : state) {
+        auto s = hexDump(buffer);
+        benchmark::DoNotOptimize(s.data());
+    }
+    state.SetBytesProcessed(state.iterations() * TEST_ROOMS);
+}
+static void BM_buffer_hex_dump_memory(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS, 'c');
+    std::vector<char> out(TEST_ROOMS * 2);
+    for (auto _ : state) {
+        MemorySink sink(out.data(), out.size());
+        hexDump(buffer, sink);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * TEST_ROOMS);
+}
+static void BM_buffer_xxd_dump_memory(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS, 'c');
+    std::vector<char> out(TEST_ROOMS * 5);
+    for (auto _ : state) {
+        MemorySink sink(out.data(), out.size());
+        xxdDump(buffer, sink);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * TEST_ROOMS);
+}
+static void BM_buffer_readable_ctrl_code(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS, 0x02);
+    for (auto _ : state) {
+        auto s = toReadableCtrlCode(buffer);
+        benchmark::DoNotOptimize(s.data());
+    }
+    state.SetBytesProcessed(state.iterations() * TEST_ROOMS);
+}
+BENCHMARK(BM_buffer_hex_dump_string);
+BENCHMARK(BM_buffer_hex_dump_memory);
+BENCHMARK(BM_buffer_xxd_dump_memory);
+BENCHMARK(BM_buffer_readable_ctrl_code);
+
+static void BM_buffer_base64_encode(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS, 'c');
+    ByteBuffer out(base64_encoded_length(TEST_ROOMS));
+    for (auto _ : state) {
+        out.clear();
+        base64Encode(buffer, out);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * TEST_ROOMS);
+}
+static void BM_buffer_base64_decode(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS, 'c');
+    ByteBuffer text(base64_encoded_length(TEST_ROOMS));
+    base64Encode(buffer, text);
+    ByteBuffer out(TEST_ROOMS);
+    for (auto _ : state) {
+        out.clear();
+        base64Decode(text, out);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_buffer_base64_encode);
+BENCHMARK(BM_buffer_base64_decode);
+
+static void BM_buffer_from_string_copy(benchmark::State& state) {
+    for (auto _ : state) {
+        std::string str(TEST_ROOMS, 'c');
+        auto buffer = from_string(str);
+        benchmark::DoNotOptimize(buffer.const_ptr());
+    }
+}
+static void BM_buffer_from_string_adopt(benchmark::State& state) {
+    for (auto _ : state) {
+        std::string str(TEST_ROOMS, 'c');
+        auto buffer = from_string(std::move(str));
+        benchmark::DoNotOptimize(buffer.const_ptr());
+    }
+}
+static void BM_buffer_to_string_copy(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS, 'c');
+    for (auto _ : state) {
+        auto str = to_string(buffer);
+        benchmark::DoNotOptimize(str.data());
+    }
+}
+static void BM_buffer_to_string_view(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS, 'c');
+    for (auto _ : state) {
+        auto str = to_string_view(buffer);
+        benchmark::DoNotOptimize(str.data());
+    }
+}
+BENCHMARK(BM_buffer_from_string_copy);
+BENCHMARK(BM_buffer_from_string_adopt);
+BENCHMARK(BM_buffer_to_string_copy);
+BENCHMARK(BM_buffer_to_string_view);
+
+static void BM_buffer_ascii_validate(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS, 'c');
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(asciiValidate(buffer));
+    }
+    state.SetBytesProcessed(state.iterations() * TEST_ROOMS);
+}
+static void BM_buffer_utf8_validate(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS);
+    const std::string text = "UTF-8 \xe3\x83\x86\xe3\x82\xad\xe3\x82\xb9\xe3\x83\x88 \xf0\x9f\x98\x80 \xc3\xa9t\xc3\xa9 ";
+    while (buffer.size() + text.size() <= TEST_ROOMS) buffer.append(text.data(), text.size());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(utf8Validate(buffer));
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+static void BM_buffer_utf8_validate_scalar(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS);
+    const std::string text = "UTF-8 \xe3\x83\x86\xe3\x82\xad\xe3\x82\xb9\xe3\x83\x88 \xf0\x9f\x98\x80 \xc3\xa9t\xc3\xa9 ";
+    while (buffer.size() + text.size() <= TEST_ROOMS) buffer.append(text.data(), text.size());
+    auto p = reinterpret_cast<const std::uint8_t*>(buffer.const_ptr());
+    for (auto _ : state) {
+        size_type incomplete = 0;
+        benchmark::DoNotOptimize(Internal::utf8_scalar(p, 0, buffer.size(), incomplete));
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+BENCHMARK(BM_buffer_ascii_validate);
+BENCHMARK(BM_buffer_utf8_validate);
+BENCHMARK(BM_buffer_utf8_validate_scalar);
+
+struct bench_header {
+    std::uint32_t magic;
+    std::uint16_t version;
+    std::uint16_t flags;
+    std::uint64_t length;
+    double stamp;
+};
+static void BM_buffer_header_shift(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS, 'c');
+    auto p = reinterpret_cast<const unsigned char*>(buffer.const_ptr());
+    auto be = [](const unsigned char* q, int n) {
+        std::uint64_t v = 0;
+        for (int i = 0; i < n; ++i) v = (v << 8) | q[i];
+        return v;
+    };
+    for (auto _ : state) {
+        std::uint64_t sum = 0;
+        for (size_type off = 0; off + 24 <= TEST_ROOMS; off += 24) {
+            bench_header h;
+            h.magic = static_cast<std::uint32_t>(be(p + off, 4));
+            h.version = static_cast<std::uint16_t>(be(p + off + 4, 2));
+            h.flags = static_cast<std::uint16_t>(be(p + off + 6, 2));
+            h.length = be(p + off + 8, 8);
+            h.stamp = std::bit_cast<double>(be(p + off + 16, 8));
+            sum += h.magic + h.version + h.flags + h.length + static_cast<std::uint64_t>(h.stamp);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * TEST_ROOMS);
+}
+static void BM_buffer_header_load(benchmark::State& state) {
+    ByteBuffer buffer(TEST_ROOMS, 'c');
+    for (auto _ : state) {
+        std::uint64_t sum = 0;
+        for (size_type off = 0; off + 24 <= TEST_ROOMS; off += 24) {
+            auto v = view(buffer, off, 24).value();
+            bench_header h;
+            h.magic = v.load<std::uint32_t, std::endian::big>(0);
+            h.version = v.load<std::uint16_t, std::endian::big>(4);
+            h.flags = v.load<std::uint16_t, std::endian::big>(6);
+            h.length = v.load<std::uint64_t, std::endian::big>(8);
+            h.stamp = v.load<double, std::endian::big>(16);
+            sum += h.magic + h.version + h.flags + h.length + static_cast<std::uint64_t>(h.stamp);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * TEST_ROOMS);
+}
+static void BM_buffer_bulk_byteswap(benchmark::State& state) {
+    std::vector<std::uint32_t> v(TEST_ROOMS / sizeof(std::uint32_t), 0x01020304u);
+    for (auto _ : state) {
+        bulk_byteswap(std::span<std::uint32_t>(v));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * TEST_ROOMS);
+}
+BENCHMARK(BM_buffer_header_shift);
+BENCHMARK(BM_buffer_header_load);
+BENCHMARK(BM_buffer_bulk_byteswap);
+
+static const char* BENCH_FILE = "mult_bench_mapped.bin";
+static void make_bench_file(size_type n) {
+    std::ofstream o(BENCH_FILE, std::ios::binary);
+    std::string block(TEST_ROOMS, 'c');
+    for (size_type i = 0; i < n; i += block.size()) o.write(block.data(), static_cast<std::streamsize>(block.size()));
+}
+static void BM_file_read_whole(benchmark::State& state) {
+    make_bench_file(64 * TEST_ROOMS);
+    for (auto _ : state) {
+        std::ifstream i(BENCH_FILE, std::ios::binary | std::ios::ate);
+        auto n = static_cast<size_type>(i.tellg());
+        i.seekg(0);
+        ByteBuffer buffer(n);
+        i.read(buffer.prepare(n), static_cast<std::streamsize>(n));
+        buffer.commit(n);
+        size_type sum = 0;
+        for (size_type p = 0; p < n; p += 4096) sum += static_cast<size_type>(buffer[p]);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * 64 * TEST_ROOMS);
+    std::remove(BENCH_FILE);
+}
+static void BM_file_mapped_scan(benchmark::State& state) {
+    make_bench_file(64 * TEST_ROOMS);
+    for (auto _ : state) {
+        MappedFile f;
+        f.open(BENCH_FILE);
+        size_type sum = 0;
+        while (f.remain() > 0) {
+            auto v = f.read(65536);
+            for (size_type p = 0; p < v.size(); p += 4096) sum += static_cast<size_type>(v[p]);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * 64 * TEST_ROOMS);
+    std::remove(BENCH_FILE);
+}
+BENCHMARK(BM_file_read_whole);
+BENCHMARK(BM_file_mapped_scan);
+
+static ByteBuffer random_buffer(size_type n) {
+    ByteBuffer buffer(n);
+    std::uint64_t x = 88172645463325252ULL;
+    for (size_type i = 0; i < n; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        buffer.push_back(static_cast<char>(x));
+    }
+    return buffer;
+}
+static void BM_buffer_cdc(benchmark::State& state) {
+    auto buffer = random_buffer(16 * TEST_ROOMS);
+    cdc_options opt;
+    opt.fingerprint = state.range(0) != 0;
+    for (auto _ : state) {
+        size_type n = 0;
+        chunkBuffer(buffer, [&](const chunk&) {++n; return OK;}, opt);
+        benchmark::DoNotOptimize(n);
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+static void BM_sha256(benchmark::State& state) {
+    auto buffer = random_buffer(TEST_ROOMS);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sha256(buffer.const_ptr(), buffer.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+BENCHMARK(BM_buffer_cdc)->Arg(0)->Arg(1);
+BENCHMARK(BM_sha256);
+
+static std::vector<std::string> bench_keywords(size_type n) {
+    std::vector<std::string> k;
+    std::uint64_t x = 0x9e3779b97f4a7c15ULL;
+    for (size_type i = 0; i < n; ++i) {
+        std::string w(4 + i % 9, 'a');
+        for (auto& c : w) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            c = static_cast<char>('A' + x % 58);
+        }
+        k.push_back(w);
+    }
+    return k;
+}
+static ByteBuffer bench_text() {
+    ByteBuffer text(TEST_ROOMS);
+    const std::string line = "2023-09-01T12:34:56 INFO request GET /index.html from 192.168.0.1 status 200 ";
+    while (text.size() + line.size() <= TEST_ROOMS) text.append(line.data(), line.size());
+    return text;
+}
+static void BM_multi_pattern_naive(benchmark::State& state) {
+    auto keywords = bench_keywords(static_cast<size_type>(state.range(0)));
+    auto text = bench_text();
+    auto view = to_string_view(text);
+    for (auto _ : state) {
+        size_type n = 0;
+        for (const auto& k : keywords) {
+            for (auto p = view.find(k); p != std::string_view::npos; p = view.find(k, p + 1)) ++n;
+        }
+        benchmark::DoNotOptimize(n);
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+static void BM_multi_pattern_matcher(benchmark::State& state) {
+    auto keywords = bench_keywords(static_cast<size_type>(state.range(0)));
+    auto text = bench_text();
+    MultiPatternMatcher m;
+    for (const auto& k : keywords) m.add(k);
+    m.compile();
+    for (auto _ : state) {
+        size_type n = 0;
+        m.scan(text, [&](const pattern_match&) {++n; return OK;});
+        benchmark::DoNotOptimize(n);
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_multi_pattern_naive)->Arg(10)->Arg(100)->Arg(500);
+BENCHMARK(BM_multi_pattern_matcher)->Arg(10)->Arg(100)->Arg(500);
+
+struct bench_order {
+    std::uint64_t id;
+    std::string   name;
+    double        price;
+    std::vector<std::uint32_t> tags;
+};
+static ByteBuffer bench_flat_order() {
+    std::vector<std::uint32_t> tags(16, 7);
+    ByteBuffer out;
+    FlatBuilder b(out, 4);
+    b.add<std::uint64_t>(0, 123456789);
+    b.add_string(1, "some instrument name");
+    b.add<double>(2, 101.25);
+    b.add_vector<std::uint32_t>(3, tags);
+    b.finish();
+    return out;
+}
+static void BM_flat_decode_copy(benchmark::State& state) {
+    auto msg = bench_flat_order();
+    for (auto _ : state) { // decode into object (copy) then use
+        auto m = FlatReader::verify(msg).value();
+        bench_order o{m.get<std::uint64_t>(0), std::string(m.string(1)), m.get<double>(2), {}};
+        auto t = m.vector<std::uint32_t>(3);
+        o.tags.assign(t.begin(), t.end());
+        benchmark::DoNotOptimize(o.id + o.name.size() + o.tags[3]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+static void BM_flat_read_in_place(benchmark::State& state) {
+    auto msg = bench_flat_order();
+    for (auto _ : state) {
+        auto m = FlatReader::verify(msg).value();
+        benchmark::DoNotOptimize(m.get<std::uint64_t>(0) + m.string(1).size() + m.vector<std::uint32_t>(3)[3]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_flat_decode_copy);
+BENCHMARK(BM_flat_read_in_place);
+
+struct bench_trade { // 20 fields
+    std::uint64_t id;
+    std::uint64_t order_id;
+    std::int64_t  price;
+    std::int64_t  qty;
+    std::uint32_t venue;
+    std::uint32_t trader;
+    std::uint32_t account;
+    std::uint32_t flags;
+    double        fee;
+    double        rate;
+    std::int64_t  ts_exchange;
+    std::int64_t  ts_receive;
+    std::int64_t  ts_send;
+    std::uint16_t side;
+    std::uint16_t kind;
+    std::uint32_t seq;
+    std::string   symbol;
+    std::string   counterparty;
+    std::uint64_t parent;
+    std::uint64_t checksum;
+};
+template <typename T>
+static void bench_put(ByteBuffer& b, const T& v) {b.append(reinterpret_cast<const char*>(&v), sizeof(T));}
+static void bench_put(ByteBuffer& b, const std::string& v) {
+    auto n = static_cast<std::uint32_t>(v.size());
+    bench_put(b, n);
+    b.append(v.data(), v.size());
+}
+template <typename T>
+static bool bench_get(ByteBuffer& b, T& v) {
+    auto pos = b.position();
+    if (b.size() - pos < sizeof(T)) return false;
+    std::memcpy(&v, b.const_ptr() + pos, sizeof(T));
+    return b.position(pos + sizeof(T)) == OK;
+}
+static bool bench_get(ByteBuffer& b, std::string& v) {
+    std::uint32_t n;
+    if (! bench_get(b, n) || b.size() - b.position() < n) return false;
+    v.assign(b.const_ptr() + b.position(), n);
+    return b.position(b.position() + n) == OK;
+}
+static void hand_encode(const bench_trade& t, ByteBuffer& b) { // what we write by hand today
+    bench_put(b, t.id); bench_put(b, t.order_id); bench_put(b, t.price); bench_put(b, t.qty);
+    bench_put(b, t.venue); bench_put(b, t.trader); bench_put(b, t.account); bench_put(b, t.flags);
+    bench_put(b, t.fee); bench_put(b, t.rate); bench_put(b, t.ts_exchange); bench_put(b, t.ts_receive);
+    bench_put(b, t.ts_send); bench_put(b, t.side); bench_put(b, t.kind); bench_put(b, t.seq);
+    bench_put(b, t.symbol); bench_put(b, t.counterparty); bench_put(b, t.parent); bench_put(b, t.checksum);
+}
+static bool hand_decode(ByteBuffer& b, bench_trade& t) {
+    return bench_get(b, t.id) && bench_get(b, t.order_id) && bench_get(b, t.price) && bench_get(b, t.qty)
+        && bench_get(b, t.venue) && bench_get(b, t.trader) && bench_get(b, t.account) && bench_get(b, t.flags)
+        && bench_get(b, t.fee) && bench_get(b, t.rate) && bench_get(b, t.ts_exchange) && bench_get(b, t.ts_receive)
+        && bench_get(b, t.ts_send) && bench_get(b, t.side) && bench_get(b, t.kind) && bench_get(b, t.seq)
+        && bench_get(b, t.symbol) && bench_get(b, t.counterparty) && bench_get(b, t.parent) && bench_get(b, t.checksum);
+}
+static bench_trade bench_trade_value() {
+    return bench_trade{1, 2, 10150, 300, 4, 5, 6, 7, 0.25, 1.5, 100, 200, 300, 1, 2, 99, "EURUSD", "BANK-A", 8, 9};
+}
+static void BM_serialize_hand(benchmark::State& state) {
+    auto t = bench_trade_value();
+    ByteBuffer b(1024);
+    for (auto _ : state) {
+        b.clear();
+        hand_encode(t, b);
+        benchmark::DoNotOptimize(b.const_ptr());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+static void BM_serialize_aggregate(benchmark::State& state) {
+    auto t = bench_trade_value();
+    ByteBuffer b(1024);
+    for (auto _ : state) {
+        b.clear();
+        serialize(t, b);
+        benchmark::DoNotOptimize(b.const_ptr());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+static void BM_deserialize_hand(benchmark::State& state) {
+    ByteBuffer b(1024);
+    hand_encode(bench_trade_value(), b);
+    bench_trade t{};
+    for (auto _ : state) {
+        b.position(0);
+        benchmark::DoNotOptimize(hand_decode(b, t));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+static void BM_deserialize_aggregate(benchmark::State& state) {
+    ByteBuffer b(1024);
+    serialize(bench_trade_value(), b);
+    bench_trade t{};
+    for (auto _ : state) {
+        b.position(0);
+        benchmark::DoNotOptimize(deserialize(b, t));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_serialize_hand);
+BENCHMARK(BM_serialize_aggregate);
+BENCHMARK(BM_deserialize_hand);
+BENCHMARK(BM_deserialize_aggregate);
+
 BENCHMARK_MAIN();
@@ -11,7 +11,20 @@
  */
 
 //#undef TRACE_FUNCTION
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <tuple>
+#include <sstream>
+#include "base64.hpp"
+#include "byte_order.hpp"
+#include "chunker.hpp"
+#include "flat_message.hpp"
+#include "mapped_file.hpp"
+#include "multi_pattern.hpp"
+#include "serializer.hpp"
 #include "byte_buffer.hpp"
+#include "utf8.hpp"
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #define DOCTEST_CONFIG_SUPER_FAST_ASSERTS
@@ -209,3 +222,588 @@ TEST_CASE("ByteBuffer helper") {
     auto y = to_string(x);
     CHECK(y == rts);
 }
+
+TEST_CASE("ByteBuffer hex dump") {
+    auto x = from_string(std::string("\x00\x01\x7f\x80\xff" "Hello world, Hello hex", 27));
+    auto h = hexDump(x);
+    CHECK(h.size() == x.size() * 2);
+    CHECK(h.substr(0, 10) == "00017f80ff");
+    CHECK(h == Debug::hexDump(to_string(x)));
+    SUBCASE("to stream") {
+        std::ostringstream os;
+        CHECK(hexDump(x, StreamSink(os)) == OK);
+        CHECK(os.str() == h);
+    }
+    SUBCASE("to ByteBuffer") {
+        auto y = ByteBuffer(4);
+        CHECK(hexDump(x, BufferSink(y)) == OK);
+        CHECK(to_string(y) == h);
+    }
+    SUBCASE("to short memory") {
+        char mem[8];
+        MemorySink sink(mem, sizeof(mem));
+        CHECK(hexDump(x, sink) == OVER_FLOW);
+        CHECK(sink.written() == 0);
+    }
+}
+
+TEST_CASE("ByteBuffer xxd dump") {
+    auto x = from_string("Hello\n0123456789abcdefXYZ");
+    std::ostringstream os;
+    CHECK(xxdDump(x, StreamSink(os)) == OK);
+    CHECK(os.str() ==
+          "00000000: 4865 6c6c 6f0a 3031 3233 3435 3637 3839  Hello.0123456789\n"
+          "00000010: 6162 6364 6566 5859 5a                   abcdefXYZ\n");
+}
+
+TEST_CASE("ByteBuffer readable control code") {
+    auto x = from_string(std::string("\x02" "A B\x7f\x80\xff\x03", 8));
+    CHECK(toReadableCtrlCode(x) == "[STX]A[SPC]B[DEL][80H][EOF][ETX]");
+}
+
+TEST_CASE("base64 encode/decode") {
+    auto x = from_string("Hello world!!");
+    auto y = ByteBuffer(4);
+    auto z = ByteBuffer(4);
+    SUBCASE("standard") {
+        REQUIRE(base64Encode(x, y) == OK);
+        CHECK(to_string(y) == "SGVsbG8gd29ybGQhIQ==");
+        REQUIRE(base64Decode(y, z) == OK);
+        CHECK(to_string(z) == "Hello world!!");
+    }
+    SUBCASE("url without padding") {
+        auto u = from_string(std::string("\xfb\xff\xfe", 3));
+        REQUIRE(base64Encode(u, y, base64_alphabet::url, false) == OK);
+        CHECK(to_string(y) == "-__-");
+        REQUIRE(base64Decode(y, z, base64_alphabet::url, false) == OK);
+        CHECK(to_string(z) == to_string(u));
+    }
+}
+
+TEST_CASE("base64 strict validation") {
+    char out[16];
+    auto bad = [&out](const char* s, bool pad = true) {
+        return ! base64_decode(s, std::strlen(s), out, base64_alphabet::standard, pad);
+    };
+    CHECK(bad("QUI"));          // no padding
+    CHECK(bad("QUJ="));         // non zero trailing bits
+    CHECK(bad("QR=="));         // non zero trailing bits
+    CHECK(bad("Q==="));         // too many padding
+    CHECK(bad("QU=I"));         // padding in the middle
+    CHECK(bad("QUI=QUI="));     // padding in the middle
+    CHECK(bad("QU-_"));         // url alphabet
+    CHECK(bad("QUI=", false));  // padding is rejected
+    CHECK(bad("Q", false));     // bad length
+    CHECK(! bad("QUI", false));
+    CHECK(! bad(""));
+}
+
+TEST_CASE("base64 round trip fuzz") {
+    std::mt19937 rng(20230901);
+    for (int i = 0; i < 2000; ++i) {
+        auto n = static_cast<size_type>(rng() % 512);
+        auto a = (rng() & 1) ? base64_alphabet::url : base64_alphabet::standard;
+        bool pad = rng() & 1;
+        auto x = ByteBuffer(n + 1);
+        for (size_type j = 0; j < n; ++j) x.push_back(static_cast<char>(rng()));
+        auto y = ByteBuffer(8);
+        auto z = ByteBuffer(8);
+        REQUIRE(base64Encode(x, y, a, pad) == OK);
+        REQUIRE(y.size() == base64_encoded_length(n, pad));
+        REQUIRE(base64Decode(y, z, a, pad) == OK);
+        REQUIRE(to_string(z) == to_string(x));
+        if (y.size() > 0) { // any single corruption into non alphabet character must be detected
+            auto p = static_cast<size_type>(rng() % y.size());
+            y[p] = "!*.@` \n\x80"[rng() % 8];
+            auto w = ByteBuffer(8);
+            CHECK(base64Decode(y, w, a, pad) == FAIL_ARG);
+            CHECK(w.size() == 0);
+        }
+    }
+}
+
+TEST_CASE("ByteBuffer zero copy interop") {
+    std::string s(100, 'x');
+    auto p = s.data();
+    auto x = from_string(std::move(s));
+    REQUIRE((x) == true);
+    CHECK(x.is_borrowed());
+    CHECK(x.const_ptr() == p);
+    CHECK(x.size() == 100);
+    CHECK(to_string_view(x).data() == p);
+    CHECK(x.const_span().size() == 100);
+    SUBCASE("append detaches from the adopted string") {
+        x.push_back('y');
+        CHECK(x.is_borrowed() == false);
+        CHECK(x.size() == 101);
+        CHECK(x[99] == 'x');
+        CHECK(x[100] == 'y');
+    }
+    SUBCASE("release and adopt") {
+        auto r = x.release();
+        CHECK((x) == false);
+        CHECK(r.ptr == p);
+        CHECK(r.size == 100);
+        auto y = ByteBuffer(std::move(r));
+        CHECK(y.const_ptr() == p);
+        CHECK(to_string_view(y) == std::string(100, 'x'));
+    }
+    SUBCASE("empty string") {
+        auto e = from_string(std::string{});
+        CHECK(e.is_borrowed() == false);
+        CHECK(e.size() == 0);
+        e.push_back('a');
+        e.push_back('b');
+        CHECK(to_string_view(e) == "ab");
+    }
+}
+
+TEST_CASE("ASCII and UTF-8 validation") {
+    using namespace std::string_view_literals;
+    CHECK(isAscii(from_string("plain text")));
+    CHECK(asciiValidate(std::string(100, 'a') + "\xc3\xa9") == 100);
+    CHECK(utf8Validate("a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80"sv) == 10);
+    CHECK(utf8Validate("ab\xc0\xafz"sv) == 2);       // overlong
+    CHECK(utf8Validate("ab\xed\xa0\x80z"sv) == 2);   // surrogate
+    CHECK(utf8Validate("ab\xf4\x90\x80\x80"sv) == 2); // over U+10FFFF
+    CHECK(utf8Validate("ab\x80"sv) == 2);             // stray continuation
+    CHECK(utf8Validate("ab\xe2\x82"sv) == 2);         // cut at the end
+    auto long_text = std::string(70, 'x') + "\xe2\x82\xac" + std::string(70, 'y');
+    CHECK(isUtf8(from_string(long_text)));
+    long_text[71] = 'z';
+    CHECK(utf8Validate(long_text) == 70);
+}
+
+TEST_CASE("UTF-8 incremental validation") {
+    std::mt19937 rng(20230902);
+    const char* pieces[] = {"a", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xf4\x8f\xbf\xbf", "0123456789abcdef"};
+    for (int i = 0; i < 500; ++i) {
+        std::string s;
+        while (s.size() < 200) s += pieces[rng() % 6];
+        auto expect = s.size();
+        if (rng() & 1) {
+            expect = rng() % s.size();
+            while ((s[expect] & 0xc0) == 0x80) --expect; // lead of the broken character
+            s[expect] = '\xff';
+        }
+        REQUIRE(utf8Validate(s) == expect);
+        Utf8Validator v;
+        size_type p = 0;
+        return_code rc = OK;
+        while (p < s.size() && rc == OK) {
+            auto c = std::min<size_type>(rng() % 9, s.size() - p);
+            rc = v.feed(s.data() + p, c);
+            p += c;
+        }
+        if (rc == OK) rc = v.finish();
+        CHECK((rc == OK) == (expect == s.size()));
+        if (rc != OK) CHECK(v.error_offset() == expect);
+    }
+    Utf8Validator v;
+    CHECK(v.feed("ab\xf0\x9f") == OK);
+    CHECK(v.pending() == 2);
+    CHECK(v.finish() == FAIL_ARG);
+    CHECK(v.error_offset() == 2);
+}
+
+TEST_CASE("ByteBuffer endian aware access") {
+    auto x = ByteBuffer(32);
+    for (char c = 1; c <= 16; ++c) x.push_back(c);
+    CHECK(load<std::uint32_t, std::endian::big>(x, 1).value() == 0x02030405u);
+    CHECK(load<std::uint32_t, std::endian::little>(x, 1).value() == 0x05040302u);
+    CHECK(load<std::uint64_t, std::endian::big>(x, 8).value() == 0x090a0b0c0d0e0f10ull);
+    CHECK(load<std::uint64_t, std::endian::big>(x, 9).error() == OUT_OF_RANGE);
+    CHECK(store<double, std::endian::big>(x, 3, 1.5) == OK);
+    CHECK(static_cast<unsigned char>(x[3]) == 0x3f);
+    CHECK(load<double, std::endian::big>(x, 3).value() == 1.5);
+    CHECK(store<std::uint16_t, std::endian::big>(x, 15, 1) == OUT_OF_RANGE);
+    SUBCASE("header view is checked once") {
+        CHECK(view(x, 10, 7).has_value() == false);
+        CHECK(view(x, static_cast<size_type>(-1), 2).has_value() == false);
+        auto h = view(x, 11, 5).value();
+        CHECK(h.load<std::uint16_t, std::endian::big>(0) == 0x0c0d);
+        CHECK(h.load<std::int8_t, std::endian::big>(4) == 16);
+        std::uint16_t a[2];
+        h.load<std::uint16_t, std::endian::big>(0, a, 2);
+        CHECK(a[1] == 0x0e0f);
+        auto w = mutable_view(x, 0, 4).value();
+        w.store<std::uint32_t, std::endian::little>(0, 0xdeadbeefu);
+        CHECK(load<std::uint32_t, std::endian::big>(x, 0).value() == 0xefbeaddeu);
+    }
+    SUBCASE("append") {
+        auto y = ByteBuffer(2);
+        CHECK(store_back<std::uint16_t, std::endian::big>(y, 0x1234) == OK);
+        CHECK(store_back<float, std::endian::little>(y, 2.0f) == OK);
+        CHECK(y.size() == 6);
+        CHECK(load<float, std::endian::little>(y, 2).value() == 2.0f);
+    }
+}
+
+TEST_CASE("bulk byteswap") {
+    std::mt19937 rng(20230903);
+    for (size_type n = 0; n < 80; ++n) {
+        std::vector<std::uint16_t> a(n);
+        std::vector<std::uint32_t> b(n);
+        std::vector<std::uint64_t> c(n);
+        for (size_type i = 0; i < n; ++i) {
+            a[i] = static_cast<std::uint16_t>(rng());
+            b[i] = static_cast<std::uint32_t>(rng());
+            c[i] = (static_cast<std::uint64_t>(rng()) << 32) | rng();
+        }
+        auto a2 = a;
+        auto c2 = c;
+        std::vector<std::uint32_t> b2(n);
+        bulk_byteswap(std::span<std::uint16_t>(a2));
+        bulk_byteswap(b.data(), b2.data(), n);
+        bulk_byteswap(std::span<std::uint64_t>(c2));
+        for (size_type i = 0; i < n; ++i) {
+            REQUIRE(a2[i] == byte_swap(a[i]));
+            REQUIRE(b2[i] == byte_swap(b[i]));
+            REQUIRE(c2[i] == byte_swap(c[i]));
+        }
+    }
+}
+
+TEST_CASE("MappedFile") {
+    const char* path = "mult_mapped_file_test.bin";
+    std::string text;
+    std::mt19937 rng(20230904);
+    for (int i = 0; i < 300000; ++i) text.push_back(static_cast<char>(rng()));
+    {
+        std::ofstream o(path, std::ios::binary);
+        o.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    MappedFile f;
+    map_options opt;
+    opt.window = 8192; // move windows often
+    REQUIRE(f.open(path, opt) == OK);
+    CHECK(f.is_open());
+    CHECK(f.size() == text.size());
+    CHECK(f.buffer().is_borrowed());
+    SUBCASE("read cursor") {
+        CHECK(f.read() == text[0]);
+        CHECK(f.position() == 1);
+        CHECK(f.put_back() == OK);
+        size_type pos = 0;
+        while (f.remain() > 0) {
+            auto v = f.read(static_cast<size_type>(rng() % 20000));
+            REQUIRE(v == std::string_view(text).substr(pos, v.size()));
+            pos += v.size();
+        }
+        CHECK(pos == text.size());
+        CHECK(f.read(10).empty());
+        CHECK_THROWS_AS(f.read(), std::out_of_range);
+        CHECK(f.position(text.size() + 1) == OUT_OF_RANGE);
+        CHECK(f.position(5) == OK); // back over released pages
+        CHECK(f.read() == text[5]);
+    }
+    SUBCASE("share keeps mapping") {
+        auto b = f.share();
+        f.close();
+        CHECK(f.is_open() == false);
+        CHECK(to_string_view(b) == text);
+    }
+    SUBCASE("writes through a shared buffer survive reading on") {
+        auto b = f.share();
+        b[0] = static_cast<char>(~text[0]); // copy on write page of b
+        while (f.remain() > 0) f.read(4096);
+        CHECK(b[0] == static_cast<char>(~text[0]));
+        CHECK(f.buffer().const_ptr()[0] == static_cast<char>(~text[0])); // one private mapping
+    }
+    SUBCASE("errors") {
+        CHECK(f.open("no/such/file") == IO_ERROR_BASE - ENOENT);
+        CHECK(f.is_open() == false);
+    }
+    std::remove(path);
+}
+
+TEST_CASE("SHA-256") {
+    CHECK(to_string(sha256("", 0)) == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    CHECK(to_string(sha256("abc", 3)) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    std::string a(1000000, 'a');
+    Sha256 h;
+    for (size_type i = 0; i < a.size(); i += 999) h.update(a.data() + i, std::min<size_type>(999, a.size() - i));
+    CHECK(to_string(h.finish()) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST_CASE("content defined chunking") {
+    std::mt19937 rng(20230905);
+    std::string text(1 << 20, 0);
+    for (auto& c : text) c = static_cast<char>(rng());
+    cdc_options opt;
+    opt.min_size = 1024;
+    opt.avg_size = 4096;
+    opt.max_size = 16384;
+    std::vector<chunk> whole;
+    auto b = from_string(text);
+    REQUIRE(chunkBuffer(b, [&](const chunk& c) {whole.push_back(c); return OK;}, opt) == OK);
+    REQUIRE(whole.size() > 1);
+    size_type total = 0;
+    for (size_type i = 0; i < whole.size(); ++i) {
+        CHECK(whole[i].offset == total);
+        CHECK(whole[i].data.size() <= opt.max_size);
+        if (i + 1 < whole.size()) CHECK(whole[i].data.size() >= opt.min_size);
+        CHECK(whole[i].fingerprint == sha256(text.data() + total, whole[i].data.size()));
+        total += whole[i].data.size();
+    }
+    CHECK(total == text.size());
+    SUBCASE("incremental append gives same cut points") {
+        Chunker c(opt);
+        ByteBuffer x(64);
+        std::vector<chunk> parts;
+        auto sink = [&](const chunk& k) {parts.push_back(k); return OK;};
+        size_type pos = 0;
+        while (pos < text.size()) {
+            auto n = std::min<size_type>(rng() % 9000, text.size() - pos);
+            x.append(text.data() + pos, n);
+            pos += n;
+            REQUIRE(c.update(x, sink) == OK);
+            c.compact(x);
+        }
+        REQUIRE(c.finish(x, sink) == OK);
+        REQUIRE(parts.size() == whole.size());
+        for (size_type i = 0; i < parts.size(); ++i) {
+            CHECK(parts[i].offset == whole[i].offset);
+            CHECK(parts[i].fingerprint == whole[i].fingerprint);
+        }
+    }
+    SUBCASE("insertion only changes nearby chunks") {
+        auto edited = text.substr(0, 5000) + "inserted" + text.substr(5000);
+        std::vector<sha256_digest> after;
+        chunkBuffer(from_string(edited), [&](const chunk& k) {after.push_back(k.fingerprint); return OK;}, opt);
+        size_type same = 0;
+        for (auto& d : after) {
+            for (auto& w : whole) if (w.fingerprint == d) {++same; break;}
+        }
+        CHECK(same + 3 >= whole.size());
+    }
+    SUBCASE("sink stops scanning") {
+        int calls = 0;
+        CHECK(chunkBuffer(b, [&](const chunk&) {++calls; return FAILURE;}, opt) == FAILURE);
+        CHECK(calls == 1);
+    }
+}
+
+TEST_CASE("multi pattern matcher") {
+    MultiPatternMatcher m;
+    CHECK(m.add("").has_value() == false);
+    CHECK(m.add("he").value() == 0);
+    CHECK(m.add("she").value() == 1);
+    CHECK(m.add("his").value() == 2);
+    CHECK(m.add("hers").value() == 3);
+    CHECK(m.scan("ushers", 6, [](const pattern_match&) {return OK;}) == NO_RESOURCE);
+    REQUIRE(m.compile() == OK);
+    CHECK(m.add("late").has_value() == false);
+    std::vector<std::tuple<size_type, size_type>> found;
+    auto sink = [&](const pattern_match& r) {found.emplace_back(r.offset, r.id); return OK;};
+    SUBCASE("all overlapping matches") {
+        CHECK(m.scan(from_string("ushers"), sink) == OK);
+        REQUIRE(found.size() == 3);
+        CHECK(found[0] == std::make_tuple(size_type(1), size_type(1))); // she
+        CHECK(found[1] == std::make_tuple(size_type(2), size_type(0))); // he
+        CHECK(found[2] == std::make_tuple(size_type(2), size_type(3))); // hers
+        CHECK(m.contains("this", 4));
+        CHECK(m.contains("xyz", 3) == false);
+    }
+    SUBCASE("streaming across chunks") {
+        MultiPatternMatcher::scan_state st;
+        CHECK(m.scan(st, "us", 2, sink) == OK);
+        CHECK(m.scan(st, "h", 1, sink) == OK);
+        CHECK(m.scan(st, "ers", 3, sink) == OK);
+        CHECK(found.size() == 3);
+        CHECK(st.offset == 6);
+    }
+    SUBCASE("same as naive search") {
+        std::mt19937 rng(20230906);
+        MultiPatternMatcher n;
+        std::vector<std::string> words;
+        for (int i = 0; i < 100; ++i) {
+            std::string w(1 + rng() % 5, 'a');
+            for (auto& c : w) c = static_cast<char>('a' + rng() % 4);
+            words.push_back(w);
+            n.add(w);
+        }
+        REQUIRE(n.compile() == OK);
+        std::string text(3000, 'x');
+        for (auto& c : text) c = static_cast<char>('a' + rng() % 6);
+        std::vector<std::tuple<size_type, size_type>> expect;
+        for (size_type id = 0; id < words.size(); ++id) {
+            for (auto p = text.find(words[id]); p != std::string::npos; p = text.find(words[id], p + 1)) expect.emplace_back(p, id);
+        }
+        REQUIRE(n.scan(text.data(), text.size(), sink) == OK);
+        std::sort(expect.begin(), expect.end());
+        std::sort(found.begin(), found.end());
+        CHECK(found == expect);
+    }
+}
+
+TEST_CASE("flat message") {
+    ByteBuffer out;
+    out.push_back('x'); // message head is padded to 8
+    std::vector<double> values{1.5, -2.25, 3.0};
+    ByteBuffer inner;
+    {
+        FlatBuilder b(inner, 1);
+        CHECK(b.add_string(0, "inner") == OK);
+        CHECK(b.finish() == OK);
+    }
+    FlatBuilder b(out, 7);
+    CHECK(b.base() == 8);
+    CHECK(b.add<std::uint8_t>(0, 7) == OK);
+    CHECK(b.add<std::int64_t>(1, -42) == OK);
+    CHECK(b.add_string(2, "hello") == OK);
+    CHECK(b.add_vector<double>(3, values) == OK);
+    CHECK(b.add<bool>(5, true) == OK);
+    CHECK(b.add_message(6, FlatReader::verify(inner).value()) == OK);
+    CHECK(b.add<std::uint8_t>(0, 1) == FAIL_ARG);
+    CHECK(b.add<std::uint8_t>(7, 1) == OUT_OF_RANGE);
+    CHECK(b.finish() == OK);
+    CHECK(b.finish() == FAIL_ARG);
+    {
+        ByteBuffer big;
+        FlatBuilder o(big, FLAT_MAX_FIELDS + 1); // not representable in the header
+        CHECK(big.size() == 0);
+        CHECK(o.add<std::uint8_t>(0, 1) == OVER_FLOW);
+        CHECK(o.finish() == OVER_FLOW);
+        FlatBuilder m(big, FLAT_MAX_FIELDS);
+        CHECK(m.add<std::uint8_t>(FLAT_MAX_FIELDS - 1, 1) == OK);
+        CHECK(m.finish() == OK);
+        auto r = FlatReader::verify(big.const_ptr() + m.base(), big.size() - m.base());
+        REQUIRE(r.has_value());
+        CHECK(r.value().field_count() == FLAT_MAX_FIELDS);
+        CHECK(r.value().get<std::uint8_t>(FLAT_MAX_FIELDS - 1) == 1);
+    }
+    auto head = out.const_ptr() + b.base();
+    auto n = out.size() - b.base();
+
+    SUBCASE("read in place") {
+        auto r = FlatReader::verify(head, n);
+        REQUIRE(r.has_value());
+        auto m = r.value();
+        CHECK(m.size() == n);
+        CHECK(m.field_count() == 7);
+        CHECK(m.get<std::uint8_t>(0) == 7);
+        CHECK(m.get<std::int64_t>(1) == -42);
+        CHECK(m.get<std::int32_t>(1, 9) == 9); // other kind
+        CHECK(m.string(2) == "hello");
+        CHECK(m.string(2).data()[5] == '\0');
+        CHECK((m.string(2).data() > head && m.string(2).data() < head + n)); // no copy
+        auto v = m.vector<double>(3);
+        REQUIRE(v.size() == 3);
+        CHECK(v[1] == -2.25);
+        CHECK(reinterpret_cast<std::uintptr_t>(v.data()) % alignof(double) == 0);
+        CHECK(m.has(4) == false);
+        CHECK(m.get<std::uint16_t>(4, 3) == 3);
+        CHECK(m.get<bool>(5));
+        CHECK(m.message(6).string(0) == "inner");
+        CHECK(m.message(2).is_valid() == false);
+        CHECK(m.kind(100) == flat_kind::none);
+    }
+    SUBCASE("verify rejects broken message") {
+        CHECK(FlatReader::verify(head, n - 1).has_value() == false);
+        CHECK(FlatReader::verify(out.const_ptr(), out.size()).has_value() == false); // bad magic
+        CHECK(FlatReader::verify(head + 8, n - 8).has_value() == false);
+        std::vector<std::uint64_t> copy((n + 7) / 8);
+        auto c = reinterpret_cast<char*>(copy.data());
+        std::memcpy(c, head, n);
+        REQUIRE(FlatReader::verify(c, n).has_value());
+        CHECK(FlatReader::verify(c + 1, n - 1).has_value() == false); // misaligned head
+        std::mt19937 rng(20230910);
+        for (int i = 0; i < 20000; ++i) { // any corruption is caught or stays inside the message
+            std::memcpy(c, head, n);
+            auto at = rng() % n;
+            c[at] = static_cast<char>(rng());
+            auto r = FlatReader::verify(c, n);
+            if (! r.has_value()) continue;
+            auto m = r.value();
+            for (size_type id = 0; id < m.field_count(); ++id) {
+                auto s = m.string(id);
+                CHECK((s.empty() || (s.data() >= c && s.data() + s.size() <= c + n)));
+                auto d = m.vector<double>(id);
+                CHECK((d.empty() || (reinterpret_cast<const char*>(d.data() + d.size()) <= c + n)));
+                CHECK(m.message(id).size() <= n);
+            }
+        }
+    }
+    SUBCASE("mapped file") {
+        const char* path = "/tmp/mult_flat_message_test.bin";
+        {
+            std::ofstream f(path, std::ios::binary);
+            f.write(head, static_cast<std::streamsize>(n));
+        }
+        MappedFile f;
+        REQUIRE(f.open(path) == OK);
+        auto shared = f.share();
+        auto r = FlatReader::verify(shared);
+        REQUIRE(r.has_value());
+        CHECK(r.value().string(2) == "hello");
+        CHECK(r.value().string(2).data() >= shared.const_ptr());
+        std::remove(path);
+    }
+}
+
+namespace {
+    enum class side : std::uint8_t {buy = 1, sell = 2};
+    struct price_level {
+        std::int64_t  price;
+        std::uint32_t qty;
+        std::uint32_t orders;
+    };
+    struct order_message {
+        std::uint64_t id;
+        side          s;
+        bool          urgent;
+        double        price;
+        price_level   best;
+        std::string   symbol;
+        BufferBase<std::uint32_t> fills;
+        std::int16_t  venue;
+    };
+}
+
+TEST_CASE("aggregate serializer") {
+    static_assert(field_count_v<price_level> == 3);
+    static_assert(field_count_v<order_message> == 8);
+    static_assert(serializable_aggregate<order_message>);
+    static_assert(! serializable_aggregate<std::string>);
+    static_assert(Internal::is_blittable<price_level>());
+    static_assert(! Internal::is_blittable<order_message>());
+    static_assert(Internal::run_end<price_level, 0>() == 3); // whole struct in one memcpy
+    static_assert(Internal::run_end<order_message, 0>() == 2); // id, side (bool breaks the run)
+    order_message m{42, side::sell, true, 101.5, {10150, 7, 3}, "EURUSD", BufferBase<std::uint32_t>(8), -3};
+    for (std::uint32_t i = 1; i <= 5; ++i) m.fills.push_back(i * 100);
+    ByteBuffer b;
+    REQUIRE(serialize(m, b) == OK);
+    CHECK(b.size() == serialized_size(m));
+    CHECK(b.size() == 8 + 1 + 1 + 8 + 16 + (4 + 6) + (4 + 20) + 2);
+    REQUIRE(serialize(price_level{1, 2, 3}, b) == OK);
+
+    SUBCASE("round trip") {
+        order_message r{};
+        REQUIRE(deserialize(b, r) == OK);
+        CHECK(r.id == 42);
+        CHECK(r.s == side::sell);
+        CHECK(r.urgent);
+        CHECK(r.price == 101.5);
+        CHECK(r.best.price == 10150);
+        CHECK(r.best.orders == 3);
+        CHECK(r.symbol == "EURUSD");
+        REQUIRE(r.fills.size() == 5);
+        CHECK(r.fills.const_ptr()[4] == 500);
+        CHECK(r.venue == -3);
+        price_level l{};
+        CHECK(deserialize(b, l) == OK);
+        CHECK(l.orders == 3);
+        CHECK(b.position() == b.size());
+        CHECK(deserialize(b, l) == OUT_OF_RANGE);
+    }
+    SUBCASE("short input") {
+        for (size_type n = 0; n < serialized_size(m); ++n) {
+            ByteBuffer t;
+            t.append(b.const_ptr(), n);
+            order_message r{};
+            CHECK(deserialize(t, r) == OUT_OF_RANGE);
+            CHECK(t.position() == 0);
+        }
+    }
+}
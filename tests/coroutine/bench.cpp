@@ -0,0 +1,126 @@
+/**
+ * @file bench.cpp
+ *
+ * @copylight © 2023 Matsuo Shin
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief bench mark for coroutine flows VS one thread per flow
+ *
+ * @warning using google benchmark
+ *
+ * @author matsuo.shin@gmail.com
+ */
+
+
+#undef MULT_TRACE_FUNCTION
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+
+#include "coroutine.hpp"
+
+using namespace Mult;
+using namespace std::chrono_literals;
+/**  N flows, each takes M items from its own queue (ping through the scheduler) .
+ *
+ *
+ */
+static constexpr int ITEMS = 100;
+static auto flow(AsyncQueue<int>& q, std::atomic<long long>& sum) -> Task<void>
+{
+    for (int i = 0; i < ITEMS; ++i) {
+        auto v = co_await q.pop();
+        if (! v) co_return;
+        sum.fetch_add(v.value(), std::memory_order_relaxed);
+    }
+}
+static auto all_flows(Scheduler& s, int n, std::atomic<long long>& sum) -> Task<void>
+{
+    std::deque<AsyncQueue<int>> qs;
+    for (int i = 0; i < n; ++i) qs.emplace_back(s);
+    for (int i = 0; i < n; ++i) s.spawn(flow(qs[i], sum));
+    for (int k = 0; k < ITEMS; ++k) {
+        for (auto& q : qs) q.push(k);
+        co_await s.schedule(); // let the consumers run
+    }
+    while (sum.load(std::memory_order_relaxed) != static_cast<long long>(n) * ITEMS * (ITEMS - 1) / 2) co_await s.schedule();
+}
+static void BM_coroutine_flows(benchmark::State& state) {
+  auto n = static_cast<int>(state.range(0));
+  Scheduler s;
+  for (auto _ : state) {
+      std::atomic<long long> sum {0};
+      s.run(all_flows(s, n, sum));
+  }
+  state.SetItemsProcessed(state.iterations() * n * ITEMS);
+}
+/**  the same with one blocked thread per flow .
+ *
+ *
+ */
+struct blocking_queue
+{
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<int> items;
+    void push(int v)
+    {
+        {
+            std::lock_guard<std::mutex> l(m);
+            items.push_back(v);
+        }
+        cv.notify_one();
+    }
+    int pop()
+    {
+        std::unique_lock<std::mutex> l(m);
+        cv.wait(l, [&] {return ! items.empty();});
+        auto v = items.front();
+        items.pop_front();
+        return v;
+    }
+};
+static void BM_thread_flows(benchmark::State& state) {
+  auto n = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+      std::atomic<long long> sum {0};
+      std::deque<blocking_queue> qs(n);
+      std::vector<std::thread> ts;
+      for (int i = 0; i < n; ++i) ts.emplace_back([&, i] {for (int k = 0; k < ITEMS; ++k) sum.fetch_add(qs[i].pop(), std::memory_order_relaxed);});
+      for (int k = 0; k < ITEMS; ++k) {
+          for (auto& q : qs) q.push(k);
+      }
+      for (auto& t : ts) t.join();
+  }
+  state.SetItemsProcessed(state.iterations() * n * ITEMS);
+}
+BENCHMARK(BM_coroutine_flows)->Arg(100)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_thread_flows)->Arg(100)->Arg(1000)->Unit(benchmark::kMillisecond);
+/**  timer heavy flows : N coroutines sleeping 1ms M times .
+ *
+ *
+ */
+static auto sleeper(Scheduler& s, std::atomic<int>& left) -> Task<void>
+{
+    for (int i = 0; i < 10; ++i) co_await s.sleep_for(1ms);
+    left.fetch_sub(1);
+}
+static auto sleepers(Scheduler& s, int n) -> Task<void>
+{
+    std::atomic<int> left {n};
+    for (int i = 0; i < n; ++i) s.spawn(sleeper(s, left));
+    while (left.load()) co_await s.sleep_for(1ms);
+}
+static void BM_coroutine_sleepers(benchmark::State& state) {
+  auto n = static_cast<int>(state.range(0));
+  Scheduler s;
+  for (auto _ : state) s.run(sleepers(s, n));
+  state.SetItemsProcessed(state.iterations() * n * 10);
+}
+BENCHMARK(BM_coroutine_sleepers)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,186 @@
+/*! \file unit_test.cpp
+ *
+ * \brief
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "coroutine.hpp"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+using namespace Mult;
+using namespace std::chrono_literals;
+using clock_type = Scheduler::clock;
+
+static auto square(int v) -> Task<int> {co_return v * v;}
+static auto fails() -> Task<int> {co_return Result<int>(error_type(NO_DATA));}
+static auto throws() -> Task<void>
+{
+    throw std::runtime_error("x");
+    co_return;
+}
+static auto chain(int n) -> Task<int>
+{
+    int sum = 0;
+    for (int i = 0; i < n; ++i) {
+        auto r = co_await square(i);
+        sum += r.value();
+    }
+    auto e = co_await fails();
+    if (! e && e.error_info().code() == NO_DATA) sum = -sum;
+    auto x = co_await throws();
+    if (! x) sum -= 1;
+    co_return sum;
+}
+
+TEST_CASE("task") {
+    Scheduler s;
+    auto r = s.run(chain(10));
+    REQUIRE(r);
+    CHECK(r.value() == -286);
+    SUBCASE("nested tasks") {
+        struct rec
+        {
+            static auto down(int n) -> Task<int>
+            {
+                if (n == 0) co_return 0;
+                auto r = co_await down(n - 1);
+                co_return r.value() + 1;
+            }
+        };
+        CHECK(s.run(rec::down(1000)).value() == 1000);
+    }
+}
+
+TEST_CASE("scheduler timers, fd and signal") {
+    Scheduler s;
+    SUBCASE("sleep_for") {
+        auto t0 = clock_type::now();
+        auto r = s.run([](Scheduler& s) -> Task<void> {co_await s.sleep_for(20ms);}(s));
+        CHECK(r);
+        CHECK(clock_type::now() - t0 >= 20ms);
+    }
+    SUBCASE("spawned sleepers interleave on one thread") {
+        std::vector<int> order;
+        auto sleeper = [](Scheduler& s, std::vector<int>& o, int ms) -> Task<void> {
+            co_await s.sleep_for(std::chrono::milliseconds(ms));
+            o.push_back(ms);
+        };
+        s.spawn(sleeper(s, order, 30));
+        s.spawn(sleeper(s, order, 10));
+        s.spawn(sleeper(s, order, 20));
+        s.run(sleeper(s, order, 40));
+        CHECK(order == std::vector<int>{10, 20, 30, 40});
+    }
+    SUBCASE("readable with timeout") {
+        int p[2];
+        REQUIRE(::pipe(p) == 0);
+        auto reader = [](Scheduler& s, int fd) -> Task<std::string> {
+            auto r = co_await s.readable(fd, 10ms);
+            if (r) co_return Result<std::string>(error_type(FAILURE));
+            if (r.error_info().code() != TIMEOUT) co_return Result<std::string>(error_type(FAILURE));
+            r = co_await s.readable(fd, 2s);
+            if (! r) co_return Result<std::string>(r.error_info());
+            char buf[16] {};
+            auto n = ::read(fd, buf, sizeof(buf));
+            co_return std::string(buf, static_cast<std::size_t>(n));
+        };
+        std::thread w([&] {
+            std::this_thread::sleep_for(50ms);
+            [[maybe_unused]] auto n = ::write(p[1], "abc", 3);
+        });
+        auto r = s.run(reader(s, p[0]));
+        w.join();
+        REQUIRE(r);
+        CHECK(r.value() == "abc");
+        auto bad = s.run([](Scheduler& s) -> Task<int> {
+            auto r = co_await s.readable(-1);
+            if (! r) co_return Result<int>(r.error_info());
+            co_return 0;
+        }(s));
+        CHECK(! bad);
+        CHECK(bad.error_info().code() == IO_ERROR_BASE - EBADF);
+        ::close(p[0]);
+        ::close(p[1]);
+    }
+    SUBCASE("signal") {
+        Signal sig;
+        std::thread u([&] {
+            std::this_thread::sleep_for(10ms);
+            sig.update(7);
+            std::this_thread::sleep_for(10ms);
+            sig.update(8);
+            std::this_thread::sleep_for(10ms);
+            sig.cancel();
+        });
+        auto r = s.run([](Scheduler& s, Signal& g) -> Task<int> {
+            int sum = 0;
+            while (true) {
+                auto v = co_await s.wait_update(g);
+                if (! v) break;
+                sum += v.value();
+            }
+            co_return sum;
+        }(s, sig));
+        u.join();
+        CHECK(r.value() == 15);
+        sig.update(3); // no waiter: taken at once
+        CHECK(s.run([](Scheduler& s, Signal& g) -> Task<return_code> {co_return co_await s.wait_update(g);}(s, sig)).value() == 3);
+
+        std::atomic<bool> blocked_canceled {false}; // cancel reaches blocking and async waiters alike
+        std::thread b([&] {
+            try {
+                sig.wait_update();
+            } catch (canceled_wait_event&) {
+                blocked_canceled = true;
+            }
+        });
+        std::thread c([&] {
+            std::this_thread::sleep_for(20ms);
+            sig.cancel();
+        });
+        auto cr = s.run([](Scheduler& s, Signal& g) -> Task<return_code> {co_return co_await s.wait_update(g);}(s, sig));
+        c.join();
+        b.join();
+        CHECK(! cr);
+        CHECK(blocked_canceled);
+    }
+}
+
+TEST_CASE("scheduler on pool and async queue") {
+    ThreadPool pool(3);
+    Scheduler s(pool);
+    AsyncQueue<int> q(s);
+    constexpr int N = 2000;
+    std::atomic<long long> sum {0};
+    std::atomic<int> done {0};
+    auto consumer = [](AsyncQueue<int>& q, std::atomic<long long>& sum, std::atomic<int>& done) -> Task<void> {
+        while (true) {
+            auto v = co_await q.pop();
+            if (! v) break;
+            sum.fetch_add(v.value());
+        }
+        done.fetch_add(1);
+    };
+    for (int i = 0; i < 4; ++i) s.spawn(consumer(q, sum, done));
+    std::thread producer([&] {for (int i = 1; i <= N; ++i) q.push(i);});
+    auto r = s.run([](Scheduler& s) -> Task<int> {
+        co_await s.sleep_for(5ms);
+        co_await s.schedule();
+        co_return 1;
+    }(s));
+    producer.join();
+    CHECK(r.value() == 1);
+    while (q.size()) std::this_thread::sleep_for(1ms);
+    q.close();
+    while (done.load() < 4) std::this_thread::sleep_for(1ms);
+    CHECK(sum.load() == static_cast<long long>(N) * (N + 1) / 2);
+    CHECK(q.push(1) == NO_RESOURCE);
+}
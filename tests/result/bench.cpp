@@ -16,9 +16,12 @@
 #undef MULT_TRACE_FUNCTION
 #include <optional>
 #include <string>
+#include <vector>
 #include "benchmark.h"
 
+#include "byte_buffer.hpp"
 #include "result.hpp"
+#include "result_batch.hpp"
 #include "expected.hpp"
 
 using namespace Mult;
@@ -165,4 +168,273 @@ static void BM_mult_result_fail_move(benchmark::State& state) {
 BENCHMARK(BM_mult_result_ok_move);
 BENCHMARK(BM_mult_result_fail_move);
 
+/**  heavy payload (4KiB) : return, access and chain .
+ *
+ *
+ */
+using heavy = std::vector<char>;
+static heavy heavy_source(4096, 'x');
+
+auto heavy_optional(bool s) -> std::optional<heavy>
+{
+    if (s) return heavy_source;
+    return std::nullopt;
+}
+auto heavy_expected(bool s) -> tl::expected<heavy, return_code>
+{
+    if (s) return heavy_source;
+    return tl::make_unexpected(-1);
+}
+auto heavy_result(bool s) -> Mult::Result<heavy>
+{
+    if (s) return Mult::Result<heavy>(heavy_source);
+    return Mult::Result<heavy>(Mult::error_type(-1));
+}
+static void BM_heavy_optional_access(benchmark::State& state) {
+  for (auto _ : state) {
+      auto x = heavy_optional(true);
+      benchmark::DoNotOptimize(x.value()[0] + x->size() + (*x)[1]);
+  }
+}
+static void BM_heavy_expected_access(benchmark::State& state) {
+  for (auto _ : state) {
+      auto x = heavy_expected(true);
+      benchmark::DoNotOptimize(x.value()[0] + x->size() + (*x)[1]);
+  }
+}
+static void BM_heavy_result_access(benchmark::State& state) {
+  for (auto _ : state) {
+      auto x = heavy_result(true);
+      benchmark::DoNotOptimize(x.value()[0] + x->size() + (*x)[1]);
+  }
+}
+static void BM_heavy_expected_chain(benchmark::State& state) {
+  for (auto _ : state) {
+      auto x = heavy_expected(true)
+          .map([](heavy&& h) {h.push_back('y'); return std::move(h);})
+          .and_then([](heavy&& h) -> tl::expected<size_type, return_code> {return h.size();});
+      benchmark::DoNotOptimize(x);
+  }
+}
+static void BM_heavy_result_chain(benchmark::State& state) {
+  for (auto _ : state) {
+      auto x = heavy_result(true)
+          .transform([](heavy&& h) {h.push_back('y'); return std::move(h);})
+          .and_then([](heavy&& h) {return Mult::Result<size_type>(h.size());});
+      benchmark::DoNotOptimize(x);
+  }
+}
+static void BM_heavy_result_extract(benchmark::State& state) { // BufferBase::extract() + access
+  auto b = from_string(std::string(4096, 'x'));
+  for (auto _ : state) {
+      auto x = b.extract(0, 2048);
+      benchmark::DoNotOptimize(x.value().size() + x->const_ptr()[0]);
+  }
+}
+
+BENCHMARK(BM_heavy_optional_access);
+BENCHMARK(BM_heavy_expected_access);
+BENCHMARK(BM_heavy_result_access);
+BENCHMARK(BM_heavy_expected_chain);
+BENCHMARK(BM_heavy_result_chain);
+BENCHMARK(BM_heavy_result_extract);
+
+/**  small payload : trivially copyable Result returns in registers .
+ *
+ * Result<int> is compared with a Result whose value has a user provided destructor
+ * (returned through hidden pointer), and status only return_code vs Result<void>.
+ */
+struct boxed_int { // same layout as int, but not trivially destructible
+    int v;
+    explicit boxed_int(int x) : v(x) {}
+    boxed_int(const boxed_int&) = default;
+    ~boxed_int() {}
+};
+__attribute__((noinline)) auto parse_trivial(int x) -> Mult::Result<int>
+{
+    if (x < 0) return Mult::Result<int>(Mult::error_type(Mult::FAIL_ARG));
+    return Mult::Result<int>(x * 3);
+}
+__attribute__((noinline)) auto parse_boxed(int x) -> Mult::Result<boxed_int>
+{
+    if (x < 0) return Mult::Result<boxed_int>(Mult::error_type(Mult::FAIL_ARG));
+    return Mult::Result<boxed_int>(boxed_int(x * 3));
+}
+__attribute__((noinline)) auto status_code(int x) -> Mult::return_code
+{
+    return x < 0 ? Mult::FAIL_ARG : Mult::OK;
+}
+__attribute__((noinline)) auto status_result(int x) -> Mult::Result<void>
+{
+    if (x < 0) return Mult::Result<void>(Mult::error_type(Mult::FAIL_ARG));
+    return Mult::Result<void>();
+}
+__attribute__((noinline)) auto lookup_copy(size_type i) -> Mult::Result<heavy>
+{
+    if (i) return Mult::Result<heavy>(Mult::error_type(Mult::OUT_OF_RANGE));
+    return Mult::Result<heavy>(heavy_source);
+}
+__attribute__((noinline)) auto lookup_ref(size_type i) -> Mult::Result<const heavy&>
+{
+    if (i) return Mult::Result<const heavy&>(Mult::error_type(Mult::OUT_OF_RANGE));
+    return Mult::Result<const heavy&>(heavy_source);
+}
+static void BM_small_result_trivial(benchmark::State& state) {
+  int sum = 0, i = 0;
+  for (auto _ : state) {
+      auto r = parse_trivial(i++ & 0xff);
+      sum += r ? r.value() : 0;
+  }
+  benchmark::DoNotOptimize(sum);
+}
+static void BM_small_result_nontrivial(benchmark::State& state) {
+  int sum = 0, i = 0;
+  for (auto _ : state) {
+      auto r = parse_boxed(i++ & 0xff);
+      sum += r ? r.value().v : 0;
+  }
+  benchmark::DoNotOptimize(sum);
+}
+static void BM_status_return_code(benchmark::State& state) {
+  int n = 0, i = 0;
+  for (auto _ : state) n += status_code(i++ & 0xff) == Mult::OK;
+  benchmark::DoNotOptimize(n);
+}
+static void BM_status_result_void(benchmark::State& state) {
+  int n = 0, i = 0;
+  for (auto _ : state) n += status_result(i++ & 0xff).has_value();
+  benchmark::DoNotOptimize(n);
+}
+static void BM_lookup_result_copy(benchmark::State& state) {
+  for (auto _ : state) {
+      auto r = lookup_copy(0);
+      benchmark::DoNotOptimize(r->size());
+  }
+}
+static void BM_lookup_result_ref(benchmark::State& state) {
+  for (auto _ : state) {
+      auto r = lookup_ref(0);
+      benchmark::DoNotOptimize(r->size());
+  }
+}
+
+BENCHMARK(BM_small_result_trivial);
+BENCHMARK(BM_small_result_nontrivial);
+BENCHMARK(BM_status_return_code);
+BENCHMARK(BM_status_result_void);
+BENCHMARK(BM_lookup_result_copy);
+BENCHMARK(BM_lookup_result_ref);
+
+/**  error path : creation (site interned), propagation with trace ring off / on .
+ *
+ *
+ */
+__attribute__((noinline)) auto deep_fail(int x) -> Mult::Result<int>
+{
+    if (x >= 0) return Mult::Result<int>(Mult::error_type(Mult::NO_DATA));
+    return Mult::Result<int>(x);
+}
+__attribute__((noinline)) auto deep_pass(int x) -> Mult::Result<int>
+{
+    auto r = deep_fail(x);
+    if (! r) return Mult::Result<int>(r.error_info().propagate());
+    return r;
+}
+static void BM_error_create(benchmark::State& state) {
+  int i = 0;
+  for (auto _ : state) benchmark::DoNotOptimize(deep_fail(i++ & 0xff));
+}
+static void BM_error_propagate(benchmark::State& state) {
+  int i = 0;
+  for (auto _ : state) benchmark::DoNotOptimize(deep_pass(i++ & 0xff));
+}
+static void BM_error_propagate_traced(benchmark::State& state) {
+  int i = 0;
+  Mult::ErrorTrace::enable(true);
+  for (auto _ : state) benchmark::DoNotOptimize(deep_pass(i++ & 0xff));
+  Mult::ErrorTrace::enable(false);
+}
+
+BENCHMARK(BM_error_create);
+BENCHMARK(BM_error_propagate);
+BENCHMARK(BM_error_propagate_traced);
+
+/**  batch of 100k results : vector<Result<T>> scan vs ResultBatch bitmap .
+ *
+ *
+ */
+static constexpr size_type batch_n = 100000;
+static auto batch_validate(size_type i) -> Mult::Result<double>
+{
+    if (i % 9973 == 17) return Mult::Result<double>(Mult::error_type(Mult::FAIL_ARG));
+    return Mult::Result<double>(static_cast<double>(i) * 0.5);
+}
+static void BM_batch_vector_evaluate(benchmark::State& state) {
+  std::vector<Mult::Result<double>> v;
+  v.reserve(batch_n);
+  for (size_type i = 0; i < batch_n; ++i) v.push_back(batch_validate(i));
+  for (auto _ : state) {
+      bool all = true;
+      size_type errors = 0;
+      for (const auto& r : v) {
+          all = all && r.has_value();
+          errors += ! r.has_value();
+      }
+      benchmark::DoNotOptimize(all);
+      benchmark::DoNotOptimize(errors);
+  }
+  state.SetItemsProcessed(state.iterations() * batch_n);
+}
+static void BM_batch_soa_evaluate(benchmark::State& state) {
+  auto b = Mult::ResultBatch<double>::collect(batch_n, batch_validate);
+  for (auto _ : state) {
+      benchmark::DoNotOptimize(b.all_ok());
+      benchmark::DoNotOptimize(b.count_errors());
+  }
+  state.SetItemsProcessed(state.iterations() * batch_n);
+}
+static void BM_batch_vector_errors(benchmark::State& state) {
+  std::vector<Mult::Result<double>> v;
+  v.reserve(batch_n);
+  for (size_type i = 0; i < batch_n; ++i) v.push_back(batch_validate(i));
+  for (auto _ : state) {
+      size_type sum = 0;
+      for (size_type i = 0; i < v.size(); ++i) if (! v[i]) sum += i;
+      benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * batch_n);
+}
+static void BM_batch_soa_errors(benchmark::State& state) {
+  auto b = Mult::ResultBatch<double>::collect(batch_n, batch_validate);
+  for (auto _ : state) {
+      size_type sum = 0;
+      b.for_each_error([&](size_type i, const Mult::error_type&) {sum += i;});
+      benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * batch_n);
+}
+static void BM_batch_vector_collect(benchmark::State& state) {
+  for (auto _ : state) {
+      std::vector<Mult::Result<double>> v;
+      v.reserve(batch_n);
+      for (size_type i = 0; i < batch_n; ++i) v.push_back(batch_validate(i));
+      benchmark::DoNotOptimize(v.data());
+  }
+  state.SetItemsProcessed(state.iterations() * batch_n);
+}
+static void BM_batch_soa_collect(benchmark::State& state) {
+  for (auto _ : state) {
+      auto b = Mult::ResultBatch<double>::collect(batch_n, batch_validate);
+      benchmark::DoNotOptimize(b.values().const_ptr());
+  }
+  state.SetItemsProcessed(state.iterations() * batch_n);
+}
+
+BENCHMARK(BM_batch_vector_evaluate);
+BENCHMARK(BM_batch_soa_evaluate);
+BENCHMARK(BM_batch_vector_errors);
+BENCHMARK(BM_batch_soa_errors);
+BENCHMARK(BM_batch_vector_collect);
+BENCHMARK(BM_batch_soa_collect);
+
 BENCHMARK_MAIN();
@@ -4,7 +4,9 @@
  *
  */
 
+#include <vector>
 #include "result.hpp"
+#include "result_batch.hpp"
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
@@ -101,3 +103,324 @@ TEST_CASE("class result")
         CHECK(x.value().str() == "a + b = 330");
     }
 };
+
+struct counted {
+    static inline int copies = 0;
+    std::vector<int> v;
+    counted() = default;
+    explicit counted(int n) : v(n, 1) {}
+    counted(const counted& r) : v(r.v) {++copies;}
+    counted(counted&&) noexcept = default;
+    counted& operator=(const counted& r) {v = r.v; ++copies; return *this;}
+    counted& operator=(counted&&) noexcept = default;
+};
+auto make_counted(int n) -> Result<counted>
+{
+    if (n < 0) return Result<counted>(error_type(FAIL_ARG));
+    return Result<counted>(n);
+}
+
+TEST_CASE("Result accessors without copy") {
+    counted::copies = 0;
+    auto x = make_counted(1000);
+    REQUIRE(x);
+    CHECK(x.value().v.size() == 1000);
+    CHECK((*x).v.size() == 1000);
+    CHECK(x->v.size() == 1000);
+    const auto& cx = x;
+    CHECK(cx.value().v.size() == 1000);
+    x.value().v.push_back(2); // reference
+    CHECK(x->v.size() == 1001);
+    auto moved = std::move(x).value();
+    CHECK(moved.v.size() == 1001);
+    CHECK(make_counted(3).value().v.size() == 3);
+    CHECK(counted::copies == 0);
+    auto copy = cx; // explicit copy still works
+    CHECK(counted::copies == 1);
+    CHECK(make_counted(-1).value_or(counted(2)).v.size() == 2);
+    CHECK(make_counted(4).value_or(counted(2)).v.size() == 4);
+    CHECK(Result<int>(error_type(FAIL_ARG)).value_or(7) == 7);
+}
+
+TEST_CASE("Result combinators") {
+    counted::copies = 0;
+    auto size_of = [](counted&& c) {return c.v.size();};
+    auto positive = [](size_type n) {return n ? Result<int>(static_cast<int>(n)) : Result<int>(error_type(NO_DATA));};
+    SUBCASE("value flows") {
+        auto r = make_counted(5).transform(size_of).and_then(positive);
+        REQUIRE(r);
+        CHECK(r.value() == 5);
+        CHECK(counted::copies == 0);
+    }
+    SUBCASE("error passes through") {
+        int called = 0;
+        auto r = make_counted(-1)
+            .transform([&](counted&& c) {++called; return c.v.size();})
+            .and_then(positive);
+        CHECK(! r);
+        CHECK(r.error() == FAIL_ARG);
+        CHECK(called == 0);
+        auto z = make_counted(0).transform(size_of).and_then(positive);
+        CHECK(z.error() == NO_DATA);
+    }
+    SUBCASE("or_else") {
+        auto r = make_counted(-1).or_else([](const error_type& e) {
+            return e.code() == FAIL_ARG ? Result<counted>(3) : Result<counted>(error_type(e.code()));
+        });
+        REQUIRE(r);
+        CHECK(r->v.size() == 3);
+        auto k = make_counted(8).or_else([](const error_type&) {return Result<counted>(1);});
+        CHECK(k->v.size() == 8);
+        CHECK(counted::copies == 0);
+    }
+    SUBCASE("lvalue chain copies nothing but the callee wants") {
+        auto x = make_counted(6);
+        auto n = x.transform([](const counted& c) {return c.v.size();});
+        CHECK(n.value() == 6);
+        auto m = x.and_then([](counted& c) {c.v.clear(); return Result<size_type>(c.v.size());});
+        CHECK(m.value() == 0);
+        CHECK(x->v.empty());
+        CHECK(counted::copies == 0);
+    }
+}
+
+TEST_CASE("Result trivially copyable") {
+    static_assert(std::is_trivially_copyable_v<Result<int>>);
+    static_assert(std::is_trivially_destructible_v<Result<int>>);
+    static_assert(std::is_trivially_copyable_v<Result<void>>);
+    static_assert(std::is_trivially_copyable_v<Result<std::string&>>);
+    static_assert(sizeof(Result<int>) <= 16);
+    static_assert(sizeof(Result<void>) == sizeof(return_code));
+    static_assert(! std::is_trivially_copyable_v<Result<std::string>>);
+    static_assert(! std::is_trivially_destructible_v<Result<std::string>>);
+    static_assert(! std::is_constructible_v<Result<int&>, int>);
+    static_assert(! std::is_constructible_v<Result<const int&>, int>);
+    constexpr auto c = Result<int>(3);
+    static_assert(c.value() == 3);
+    auto x = Result<int>(5);
+    auto y = x;
+    y = Result<int>(error_type(NO_DATA));
+    CHECK(x.value() == 5);
+    CHECK(y.error() == NO_DATA);
+    y = x;
+    CHECK(y.value() == 5);
+}
+
+auto close_it(bool ok) -> Result<void>
+{
+    if (! ok) return Result<void>(error_type(FAIL_CMD));
+    return Result<void>();
+}
+
+TEST_CASE("Result<void>") {
+    CHECK(close_it(true));
+    CHECK(close_it(true).error() == OK);
+    CHECK(close_it(false).error() == FAIL_CMD);
+    int called = 0;
+    auto r = close_it(true).and_then([&] {++called; return Result<int>(4);});
+    CHECK(r.value() == 4);
+    auto e = close_it(false).and_then([&] {++called; return Result<int>(4);});
+    CHECK(e.error() == FAIL_CMD);
+    CHECK(called == 1);
+    auto t = close_it(true).transform([] {return 2;});
+    CHECK(t.value() == 2);
+    auto v = close_it(true).transform([&] {++called;});
+    static_assert(std::is_same_v<decltype(v), Result<void>>);
+    CHECK(v);
+    CHECK(called == 2);
+    auto o = close_it(false).or_else([](const error_type& err) {
+        return err.code() == FAIL_CMD ? Result<void>() : Result<void>(error_type(err.code()));
+    });
+    CHECK(o);
+    auto vv = Result<int>(1).transform([](int) {});
+    static_assert(std::is_same_v<decltype(vv), Result<void>>);
+    CHECK(vv);
+}
+
+TEST_CASE("Result<T&>") {
+    counted::copies = 0;
+    std::vector<counted> table;
+    table.emplace_back(10);
+    table.emplace_back(20);
+    auto find = [&](size_type i) {
+        if (i >= table.size()) return Result<counted&>(error_type(OUT_OF_RANGE));
+        return Result<counted&>(table[i]);
+    };
+    auto r = find(1);
+    REQUIRE(r);
+    CHECK(&r.value() == &table[1]);
+    CHECK(r->v.size() == 20);
+    r->v.push_back(1);
+    CHECK(table[1].v.size() == 21);
+    CHECK(find(5).error() == OUT_OF_RANGE);
+    auto n = find(0).transform([](const counted& c) {return c.v.size();});
+    CHECK(n.value() == 10);
+    auto m = find(0).and_then([](counted& c) {return Result<int>(static_cast<int>(c.v.size()));});
+    CHECK(m.value() == 10);
+    auto f = find(9).or_else([&](const error_type&) {return Result<counted&>(table[0]);});
+    CHECK(&*f == &table[0]);
+    CHECK(counted::copies == 0);
+    CHECK(find(9).value_or(counted(3)).v.size() == 3);
+    const counted& cref = table[0];
+    auto cr = Result<const counted&>(cref);
+    CHECK(cr->v.size() == 10);
+    CHECK(counted::copies == 0);
+}
+
+static auto fail_here() -> Result<int> {return Result<int>(error_type(OUT_OF_RANGE));}
+static auto pass_on() -> Result<long>
+{
+    auto r = fail_here();
+    if (! r) return Result<long>(r.error_info().propagate());
+    return Result<long>(r.value());
+}
+
+TEST_CASE("error context") {
+    SUBCASE("site and category") {
+        auto r = fail_here();
+        REQUIRE(! r);
+        const auto& e = r.error_info();
+        CHECK(e.code() == OUT_OF_RANGE);
+        CHECK(e.category() == error_category::range);
+        CHECK(e.site() != 0);
+        auto w = e.where();
+        CHECK(std::string_view(w.file).ends_with("unit_test.cpp"));
+        CHECK(std::string_view(w.function).find("fail_here") != std::string_view::npos);
+        CHECK(fail_here().error_info().site() == e.site()); // interned once
+        CHECK(error_type(FAIL_ARG).site() != e.site());
+        CHECK(error_type(IO_ERROR_BASE - 2).category() == error_category::io);
+        CHECK(error_type(FAIL_JOIN).category() == error_category::thread);
+        CHECK(error_type(-42, error_category::user).category() == error_category::user);
+        constexpr auto c = error_type(NO_DATA);
+        static_assert(c.site() == 0 && c.category() == error_category::resource);
+    }
+    SUBCASE("messages") {
+        CHECK(error_type(OUT_OF_RANGE).message() == "out of range");
+        CHECK(error_type(IO_ERROR_BASE - 5).message() == "I/O error");
+        CHECK(error_type(-777).message() == "unknown error");
+        CHECK(register_error_message(-777, "widget jammed"));
+        CHECK(error_type(-777).message() == "widget jammed");
+        char buf[256];
+        auto n = fail_here().error_info().describe(buf, sizeof(buf));
+        auto s = std::string_view(buf, n);
+        CHECK(s.find("unit_test.cpp:") != std::string_view::npos);
+        CHECK(s.ends_with("out of range (-10100)"));
+        char tiny[8];
+        CHECK(fail_here().error_info().describe(tiny, sizeof(tiny)) == 7);
+        CHECK(std::string_view(bad_result_access(fail_here().error_info()).what()).ends_with("(-10100)"));
+        CHECK(std::string_view(bad_result_access("no value").what()) == "no value");
+    }
+    SUBCASE("trace ring") {
+        ErrorTrace::clear();
+        auto r0 = pass_on(); // disabled
+        CHECK(ErrorTrace::recorded() == 0);
+        ErrorTrace::enable(true);
+        auto r = pass_on();
+        ErrorTrace::enable(false);
+        REQUIRE(! r);
+        CHECK(r.error_info().site() == fail_here().error_info().site()); // origin kept
+        error_trace_entry path[ErrorTrace::CAPACITY];
+        auto n = ErrorTrace::snapshot(path, ErrorTrace::CAPACITY);
+        REQUIRE(n == 2);
+        CHECK(path[0].code == OUT_OF_RANGE);
+        CHECK(path[0].site == path[0].origin);
+        CHECK(path[1].origin == path[0].origin);
+        CHECK(std::string_view(error_site_of(path[1].site).function).find("pass_on") != std::string_view::npos);
+        ErrorTrace::enable(true);
+        for (int i = 0; i < 100; ++i) (void)error_type(-1000 - i);
+        ErrorTrace::enable(false);
+        CHECK(ErrorTrace::snapshot(path, ErrorTrace::CAPACITY) == ErrorTrace::CAPACITY);
+        CHECK(path[ErrorTrace::CAPACITY - 1].code == -1099); // newest last
+        CHECK(path[0].code == -1000 - (100 - static_cast<int>(ErrorTrace::CAPACITY)));
+        ErrorTrace::clear();
+    }
+    SUBCASE("sizes stay small") {
+        static_assert(sizeof(error_type) == 8);
+        static_assert(sizeof(Result<int>) <= 16);
+        static_assert(std::is_trivially_copyable_v<error_type>);
+    }
+}
+
+TEST_CASE("ResultBatch") {
+    auto validate = [](size_type i) {
+        if (i % 37 == 5) return Result<int>(error_type(FAIL_ARG));
+        if (i == 130) return Result<int>(error_type(OUT_OF_RANGE));
+        return Result<int>(static_cast<int>(i * 2));
+    };
+    SUBCASE("collect and inspect") {
+        const size_type n = 1000;
+        auto b = ResultBatch<int>::collect(n, validate);
+        CHECK(b.size() == n);
+        CHECK(! b.all_ok());
+        size_type expect = 0;
+        for (size_type i = 0; i < n; ++i) expect += (i % 37 == 5 || i == 130);
+        CHECK(b.count_errors() == expect);
+        CHECK(b.count_ok() == n - expect);
+        CHECK(b.errors().size() == expect);
+        CHECK(b.ok(4));
+        CHECK(! b.ok(5));
+        CHECK(b.value(4) == 8);
+        CHECK(b.error(5).code() == FAIL_ARG);
+        CHECK(b.error(130).code() == OUT_OF_RANGE);
+        CHECK(b.at(4).value() == 8);
+        CHECK(b.at(42).error() == FAIL_ARG);
+        CHECK(b.at(n).error() == OUT_OF_RANGE);
+        std::vector<size_type> seen;
+        bool codes = true;
+        b.for_each_error([&](size_type i, const error_type& e) {
+            seen.push_back(i);
+            codes = codes && e.code() == (i == 130 ? OUT_OF_RANGE : FAIL_ARG);
+        });
+        CHECK(seen.size() == expect);
+        CHECK(std::is_sorted(seen.begin(), seen.end()));
+        CHECK(codes);
+    }
+    SUBCASE("all ok across word boundaries") {
+        for (size_type n : {size_type(0), size_type(1), size_type(63), size_type(64), size_type(65), size_type(1000)}) {
+            auto b = ResultBatch<int>::collect(n, [](size_type i) {return Result<int>(static_cast<int>(i));});
+            CHECK(b.all_ok());
+            CHECK(b.count_errors() == 0);
+            int calls = 0;
+            b.for_each_error([&](size_type, const error_type&) {++calls;});
+            CHECK(calls == 0);
+        }
+    }
+    SUBCASE("out of order and unset") {
+        ResultBatch<std::string> b(70);
+        for (size_type i = 0; i < 70; ++i) if (i != 3 && i != 69 && i != 50) b.set_value(i, std::to_string(i));
+        b.set_error(69, error_type(TIMEOUT));
+        b.set_error(3, error_type(FAIL_CMD));
+        CHECK(b.count_errors() == 3);
+        CHECK(b.error(3).code() == FAIL_CMD);
+        CHECK(b.error(50).code() == NO_DATA); // unset
+        std::vector<std::pair<size_type, return_code>> got;
+        b.for_each_error([&](size_type i, const error_type& e) {got.emplace_back(i, e.code());});
+        REQUIRE(got.size() == 3);
+        CHECK(got[0] == std::pair<size_type, return_code>(3, FAIL_CMD));
+        CHECK(got[1] == std::pair<size_type, return_code>(50, NO_DATA));
+        CHECK(got[2] == std::pair<size_type, return_code>(69, TIMEOUT));
+        CHECK(*b.at(10) == "10");
+        b.set_value(69, "69");                // replaces the error
+        b.set_error(10, error_type(FAILURE)); // replaces the value
+        CHECK(b.ok(69));
+        CHECK(! b.ok(10));
+        REQUIRE(b.errors().size() == 2);
+        CHECK(b.errors()[0].index == 3);
+        CHECK(b.errors()[1].index == 10);
+        CHECK(b.count_errors() == 3);
+    }
+    SUBCASE("from existing results, moves values") {
+        std::vector<Result<int>> rs;
+        for (size_type i = 0; i < 10; ++i) rs.push_back(validate(i));
+        auto b = ResultBatch<int>::collect(std::span<const Result<int>>(rs));
+        CHECK(b.count_errors() == 1);
+        CHECK(b.error(5).site() == rs[5].error_info().site());
+        ResultBatch<counted> c(3); // rooms are filled with default values
+        counted::copies = 0;
+        for (size_type i = 0; i < 3; ++i) c.set(i, make_counted(static_cast<int>(i + 1)));
+        CHECK(c.value(2).v.size() == 3);
+        CHECK(counted::copies == 0);
+        auto moved = std::move(c);
+        CHECK(moved.value(1).v.size() == 2);
+    }
+}
@@ -13,10 +13,16 @@
 
 
 #undef MULT_TRACE_FUNCTION
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
 #include <string>
 #include <vector>
 #include "benchmark.h"
 
+#include "column_codec.hpp"
+#include "snapshot.hpp"
 #include "storage.hpp"
 
 using namespace Mult;
@@ -74,4 +80,110 @@ static void BM_StorageCopy(benchmark::State& state) {
 BENCHMARK(BM_StringCopy);
 BENCHMARK(BM_StorageCopy);
 
+static constexpr size_type COLUMN_SIZE = 1 << 20;
+template <typename T>
+static std::vector<T> bench_column(column_codec codec) {
+    std::mt19937_64 rng(12345);
+    std::vector<T> v(COLUMN_SIZE);
+    T x = 1000000;
+    for (size_type i = 0; i < v.size(); ++i) {
+        if (codec == column_codec::delta_of_delta) x += 1000 + ((i % 64 == 0) ? rng() % 8 : 0); // timestamps
+        else if (codec == column_codec::delta_bitpack) x += rng() % 64;                         // sorted ids
+        else x = static_cast<T>(rng() % ((i % 4 == 0) ? 1000000 : 300));                        // counts
+        v[i] = x;
+    }
+    return v;
+}
+template <typename T>
+static void BM_column_decode(benchmark::State& state) {
+    auto codec = static_cast<column_codec>(state.range(0));
+    auto v = bench_column<T>(codec);
+    CompressedColumn<T> c;
+    c.encode(v.data(), v.size(), codec);
+    std::vector<T> out(v.size());
+    for (auto _ : state) {
+        c.decode(out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * v.size());
+    state.counters["bits/int"] = 8.0 * c.compressed_size() / v.size();
+}
+static void BM_column_copy(benchmark::State& state) { // uncompressed baseline
+    std::vector<std::uint32_t> v(COLUMN_SIZE, 1), out(COLUMN_SIZE);
+    for (auto _ : state) {
+        std::memcpy(out.data(), v.data(), v.size() * sizeof(std::uint32_t));
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * v.size());
+}
+BENCHMARK(BM_column_copy);
+BENCHMARK(BM_column_decode<std::uint32_t>)->Arg(0)->Arg(1)->Arg(2);
+BENCHMARK(BM_column_decode<std::uint64_t>)->Arg(0)->Arg(1);
+
+static constexpr size_type SNAPSHOT_COUNT = 8 << 20; // 64MiB of uint64
+static const char* SNAPSHOT_FILE = "mult_bench.snap";
+static StorageBase<std::uint64_t> bench_snapshot_source() {
+    StorageBase<std::uint64_t> s(SNAPSHOT_COUNT);
+    for (size_type i = 0; i < SNAPSHOT_COUNT; ++i) s.ptr()[i] = i * 7;
+    s.copy_from(s.const_ptr(), SNAPSHOT_COUNT);
+    return s;
+}
+static void BM_snapshot_write_each(benchmark::State& state) { // element by element (current way)
+    auto s = bench_snapshot_source();
+    for (auto _ : state) {
+        std::ofstream f(SNAPSHOT_FILE, std::ios::binary | std::ios::trunc);
+        for (auto v : s) f.write(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+    state.SetBytesProcessed(state.iterations() * SNAPSHOT_COUNT * sizeof(std::uint64_t));
+}
+static void BM_snapshot_save(benchmark::State& state) {
+    auto s = bench_snapshot_source();
+    snapshot_options opt;
+    opt.sync = false; // measure the writer, not the device
+    for (auto _ : state) save_snapshot(s, SNAPSHOT_FILE, opt);
+    state.SetBytesProcessed(state.iterations() * SNAPSHOT_COUNT * sizeof(std::uint64_t));
+}
+static void BM_snapshot_load(benchmark::State& state) {
+    auto s = bench_snapshot_source();
+    snapshot_options opt;
+    opt.sync = false;
+    save_snapshot(s, SNAPSHOT_FILE, opt);
+    for (auto _ : state) {
+        StorageBase<std::uint64_t> r;
+        load_snapshot(SNAPSHOT_FILE, r);
+        benchmark::DoNotOptimize(r.const_ptr());
+    }
+    state.SetBytesProcessed(state.iterations() * SNAPSHOT_COUNT * sizeof(std::uint64_t));
+}
+static void BM_snapshot_map(benchmark::State& state) {
+    auto s = bench_snapshot_source();
+    snapshot_options opt;
+    opt.sync = false;
+    save_snapshot(s, SNAPSHOT_FILE, opt);
+    opt.verify = false; // pages are read on touch
+    for (auto _ : state) {
+        StorageBase<std::uint64_t> r;
+        map_snapshot(SNAPSHOT_FILE, r, opt);
+        benchmark::DoNotOptimize(r.const_ptr());
+    }
+}
+static void BM_snapshot_background_start(benchmark::State& state) { // owner blocked time
+    auto s = bench_snapshot_source();
+    snapshot_options opt;
+    opt.sync = false;
+    SnapshotWriter w;
+    for (auto _ : state) {
+        w.start(s, SNAPSHOT_FILE, opt);
+        state.PauseTiming();
+        w.wait();
+        state.ResumeTiming();
+    }
+    std::remove(SNAPSHOT_FILE);
+}
+BENCHMARK(BM_snapshot_write_each)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_snapshot_save)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_snapshot_load)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_snapshot_map)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_snapshot_background_start)->Unit(benchmark::kMicrosecond);
+
 BENCHMARK_MAIN();
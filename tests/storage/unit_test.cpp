@@ -4,6 +4,12 @@
  *
  */
 
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+#include "column_codec.hpp"
+#include "snapshot.hpp"
 #include "storage.hpp"
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
@@ -105,3 +111,141 @@ TEST_CASE("Direct construct") {
         CHECK(v.b == "DEAD_BEEF");
     }
 }
+
+template <typename T>
+static void check_column(const std::vector<T>& v, column_codec codec) {
+    CompressedColumn<T> c;
+    REQUIRE(c.encode(v.data(), v.size(), codec) == OK);
+    CHECK(c.size() == v.size());
+    CHECK(c.block_count() == (v.size() + CompressedColumn<T>::BLOCK - 1) / CompressedColumn<T>::BLOCK);
+    std::vector<T> out(v.size());
+    CHECK(c.decode(out.data()) == v.size());
+    CHECK(out == v);
+    for (size_type b = 0; b < c.block_count(); ++b) { // random block access
+        T blk[CompressedColumn<T>::BLOCK];
+        auto n = c.decode_block(b, blk);
+        for (size_type i = 0; i < n; ++i) CHECK(blk[i] == v[b * CompressedColumn<T>::BLOCK + i]);
+    }
+    if (! v.empty()) CHECK(c.at(v.size() - 1).value() == v.back());
+    CHECK(c.at(v.size()).has_value() == false);
+}
+
+TEST_CASE("compressed integer column") {
+    std::mt19937_64 rng(20230912);
+    SUBCASE("timestamps") {
+        std::vector<std::uint64_t> ts;
+        std::uint64_t t = 1693526400000000000ULL;
+        for (int i = 0; i < 10000; ++i) ts.push_back(t += 1000000000ULL + (i % 97 == 0 ? rng() % 1000 : 0));
+        check_column(ts, column_codec::delta_of_delta);
+        check_column(ts, column_codec::delta_bitpack);
+        CompressedColumn<std::uint64_t> c;
+        c.encode(ts.data(), ts.size(), column_codec::delta_of_delta);
+        CHECK(c.compressed_size() * 4 < ts.size() * sizeof(std::uint64_t));
+        std::vector<std::uint64_t> regular(10000);
+        for (size_type i = 0; i < regular.size(); ++i) regular[i] = t + i * 1000;
+        c.encode(regular.data(), regular.size(), column_codec::delta_of_delta);
+        CHECK(c.compressed_size() * 32 < regular.size() * sizeof(std::uint64_t)); // 0 bit per value
+        CHECK(c.encode(ts.data(), ts.size(), column_codec::stream_vbyte) == FAIL_ARG);
+        StorageBase<std::uint64_t> s(ts.size());
+        s.copy_from(ts.data(), ts.size());
+        CHECK(c.encode(s, column_codec::delta_of_delta) == OK);
+        auto d = c.decode();
+        REQUIRE(d.size() == ts.size());
+        CHECK(std::equal(d.begin(), d.end(), ts.begin()));
+    }
+    SUBCASE("any width and any length") {
+        for (int bits : {0, 1, 7, 13, 31, 32}) {
+            for (size_type n : {size_type(0), size_type(1), size_type(255), size_type(256), size_type(1000)}) {
+                std::vector<std::uint32_t> v(n);
+                for (auto& e : v) e = (bits == 0) ? 5 : static_cast<std::uint32_t>(rng() >> (64 - bits));
+                check_column(v, column_codec::delta_bitpack);
+                check_column(v, column_codec::delta_of_delta);
+                check_column(v, column_codec::stream_vbyte);
+            }
+        }
+        for (int bits : {1, 33, 63, 64}) {
+            std::vector<std::uint64_t> v(700);
+            for (auto& e : v) e = rng() >> (64 - bits);
+            check_column(v, column_codec::delta_bitpack);
+            check_column(v, column_codec::delta_of_delta);
+        }
+    }
+    SUBCASE("sorted ids are small") {
+        std::vector<std::uint32_t> v(4096);
+        std::uint32_t x = 0;
+        for (auto& e : v) e = x += 1 + rng() % 16;
+        CompressedColumn<std::uint32_t> c;
+        c.encode(v.data(), v.size(), column_codec::delta_bitpack);
+        CHECK(c.compressed_size() * 4 < v.size() * sizeof(std::uint32_t));
+    }
+}
+
+struct tick {
+    std::int64_t  ts;
+    double        price;
+    std::uint32_t qty;
+};
+
+TEST_CASE("storage snapshot") {
+    const std::string path = "mult_snapshot_test.snap";
+    StorageBase<tick> s(1000);
+    for (int i = 0; i < 1000; ++i) s.ptr()[i] = tick{i, i * 0.5, static_cast<std::uint32_t>(i * 3)};
+    s.copy_from(s.const_ptr(), 1000); // size 1000
+    REQUIRE(s.size() == 1000);
+    CHECK(crc32c("123456789", 9) == 0xe3069283); // check value of CRC-32C
+    CHECK(crc32c("56789", 5, crc32c("1234", 4)) == 0xe3069283);
+    REQUIRE(save_snapshot(s, path) == OK);
+
+    SUBCASE("load and map") {
+        StorageBase<tick> r;
+        REQUIRE(load_snapshot(path, r) == OK);
+        REQUIRE(r.size() == 1000);
+        CHECK(std::memcmp(r.const_ptr(), s.const_ptr(), 1000 * sizeof(tick)) == 0);
+        StorageBase<tick> m;
+        REQUIRE(map_snapshot(path, m) == OK);
+        CHECK(m.is_borrowed());
+        CHECK(m.const_ptr()[999].qty == 2997);
+        m.ptr()[0].qty = 7; // private mapping
+        StorageBase<tick> again;
+        REQUIRE(load_snapshot(path, again) == OK);
+        CHECK(again.const_ptr()[0].qty == 0);
+    }
+    SUBCASE("broken or other snapshot") {
+        StorageBase<std::uint64_t> other;
+        CHECK(load_snapshot(path, other) == FAIL_ARG);
+        CHECK(load_snapshot("no_such_dir/x.snap", other) == IO_ERROR_BASE - ENOENT);
+        StorageBase<tick> r;
+        {
+            std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp(64 + 100);
+            f.put('\x55');
+        }
+        CHECK(load_snapshot(path, r) == FAILURE);
+        CHECK(map_snapshot(path, r) == FAILURE);
+        snapshot_options no_verify;
+        no_verify.verify = false;
+        CHECK(map_snapshot(path, r, no_verify) == OK);
+        {
+            std::ofstream f(path, std::ios::binary | std::ios::app);
+            f.put('x');
+        }
+        CHECK(load_snapshot(path, r) == OUT_OF_RANGE);
+        CHECK(save_snapshot(s, "no_such_dir/x.snap") == IO_ERROR_BASE - ENOENT);
+    }
+    SUBCASE("background writer") {
+        SnapshotWriter w;
+        CHECK(w.start(s, path) == OK);
+        CHECK(w.start(s, path) == FAIL_CMD);
+        for (int i = 0; i < 1000; ++i) s.ptr()[i].qty = 0; // after start, not in the snapshot
+        CHECK(w.wait() == OK);
+        CHECK(w.running() == false);
+        StorageBase<tick> r;
+        REQUIRE(load_snapshot(path, r) == OK);
+        CHECK(r.const_ptr()[999].qty == 2997);
+        CHECK(w.start(s, "no_such_dir/x.snap") == OK);
+        return_code rc;
+        while ((rc = w.poll()) == TIMEOUT) {}
+        CHECK(rc == IO_ERROR_BASE - ENOENT);
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,451 @@
+/**
+ * @file bench.cpp
+ *
+ * @copylight © 2023 Matsuo Shin
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief bench mark for ThreadPool VS one thread per task
+ *
+ * @warning using google benchmark
+ *
+ * @author matsuo.shin@gmail.com
+ */
+
+
+#undef MULT_TRACE_FUNCTION
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "benchmark.h"
+
+#include "thread.hpp"
+#include "thread_pool.hpp"
+#include "future.hpp"
+#include "parallel.hpp"
+#include "buffer.hpp"
+#include "signal.hpp"
+#include "thread_stats.hpp"
+#include "inline_task.hpp"
+#include "watchdog.hpp"
+#include <functional>
+
+using namespace Mult;
+/**  tiny task : some arithmetic on a shared counter .
+ *
+ *
+ */
+static std::atomic<std::uint64_t> sink {0};
+static inline void tiny_work(std::uint64_t i)
+{
+    std::uint64_t x = i;
+    for (int k = 0; k < 64; ++k) x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    sink.fetch_add(x & 1, std::memory_order_relaxed);
+}
+struct tiny_runnable final : Runnable
+{
+    explicit tiny_runnable(std::uint64_t v) : i(v) {}
+    void run(void*) noexcept override {tiny_work(i);}
+    void stop() noexcept override {}
+    std::uint64_t i;
+};
+static ThreadPool& bench_pool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+/**  fork / join fan-out : N children then join .
+ *
+ *
+ */
+static void BM_fanout_thread_per_task(benchmark::State& state) {
+  auto n = static_cast<std::uint64_t>(state.range(0));
+  for (auto _ : state) {
+      std::vector<std::unique_ptr<Thread>> ts;
+      ts.reserve(n);
+      for (std::uint64_t i = 0; i < n; ++i) {
+          ts.emplace_back(std::make_unique<Thread>(std::make_shared<tiny_runnable>(i)));
+          ts.back()->start(nullptr);
+      }
+      for (auto& t : ts) t->join();
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+static void BM_fanout_pool(benchmark::State& state) {
+  auto n = static_cast<std::uint64_t>(state.range(0));
+  auto& pool = bench_pool();
+  for (auto _ : state) {
+      WorkGroup g(pool);
+      for (std::uint64_t i = 0; i < n; ++i) g.run([i] {tiny_work(i);});
+      g.wait();
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+static void BM_fanout_pool_runnable(benchmark::State& state) {
+  auto n = static_cast<std::uint64_t>(state.range(0));
+  auto& pool = bench_pool();
+  for (auto _ : state) {
+      for (std::uint64_t i = 0; i < n; ++i) pool.post(std::make_shared<tiny_runnable>(i));
+      pool.wait_idle();
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_fanout_thread_per_task)->Arg(16)->Arg(256);
+BENCHMARK(BM_fanout_pool)->Arg(16)->Arg(256);
+BENCHMARK(BM_fanout_pool_runnable)->Arg(16)->Arg(256);
+/**  recursive fork / join (fib 25, cut off 12) .
+ *
+ *
+ */
+static auto fib_seq(int n) -> long
+{
+    long a = 0, b = 1;
+    for (int i = 0; i < n; ++i) {auto t = a + b; a = b; b = t;}
+    return a;
+}
+static auto fib_pool(ThreadPool& pool, int n) -> long
+{
+    if (n < 12) return fib_seq(n);
+    long x = 0;
+    WorkGroup g(pool);
+    g.run([&] {x = fib_pool(pool, n - 1);});
+    auto y = fib_pool(pool, n - 2);
+    g.wait();
+    return x + y;
+}
+static void BM_fork_join_fib(benchmark::State& state) {
+  auto& pool = bench_pool();
+  for (auto _ : state) benchmark::DoNotOptimize(fib_pool(pool, 25));
+}
+BENCHMARK(BM_fork_join_fib);
+/**  stream of tiny tasks posted from outside .
+ *
+ *
+ */
+static void BM_stream_thread_per_task(benchmark::State& state) {
+  auto n = static_cast<std::uint64_t>(state.range(0));
+  for (auto _ : state) {
+      for (std::uint64_t i = 0; i < n; ++i) { // one at a time, no oversubscription
+          Thread t(std::make_shared<tiny_runnable>(i));
+          t.start(nullptr);
+      }
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+static void BM_stream_pool(benchmark::State& state) {
+  auto n = static_cast<std::uint64_t>(state.range(0));
+  auto& pool = bench_pool();
+  for (auto _ : state) {
+      for (std::uint64_t i = 0; i < n; ++i) pool.post([i] {tiny_work(i);});
+      pool.wait_idle();
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_stream_thread_per_task)->Arg(1024);
+BENCHMARK(BM_stream_pool)->Arg(1024)->Arg(65536);
+/**  pipeline of 16 dependent stages : blocking get per stage VS then .
+ *
+ *
+ */
+static void BM_pipeline_blocking_get(benchmark::State& state) {
+  auto& pool = bench_pool();
+  for (auto _ : state) {
+      std::uint64_t x = 1;
+      for (int k = 0; k < 16; ++k) x = std::move(submit(pool, [x] {return x * 3 + 1;})).get().value();
+      benchmark::DoNotOptimize(x);
+  }
+}
+static void BM_pipeline_then(benchmark::State& state) {
+  auto& pool = bench_pool();
+  for (auto _ : state) {
+      auto f = submit(pool, [] {return std::uint64_t{1};});
+      for (int k = 1; k < 16; ++k) f = std::move(f).then([](std::uint64_t x) {return x * 3 + 1;});
+      benchmark::DoNotOptimize(std::move(f).get().value());
+  }
+}
+BENCHMARK(BM_pipeline_blocking_get);
+BENCHMARK(BM_pipeline_then);
+/**  fan-in of N results : std::promise per task VS Future + when_all .
+ *
+ *
+ */
+static void BM_fanin_std_promise(benchmark::State& state) {
+  auto n = static_cast<std::uint64_t>(state.range(0));
+  auto& pool = bench_pool();
+  for (auto _ : state) {
+      std::vector<std::future<std::uint64_t>> fs;
+      fs.reserve(n);
+      for (std::uint64_t i = 0; i < n; ++i) {
+          auto p = std::make_shared<std::promise<std::uint64_t>>();
+          fs.push_back(p->get_future());
+          pool.post([p, i] {p->set_value(i);});
+      }
+      std::uint64_t sum = 0;
+      for (auto& f : fs) sum += f.get();
+      benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+static void BM_fanin_when_all(benchmark::State& state) {
+  auto n = static_cast<std::uint64_t>(state.range(0));
+  auto& pool = bench_pool();
+  for (auto _ : state) {
+      std::vector<Future<Result<std::uint64_t>>> fs;
+      fs.reserve(n);
+      for (std::uint64_t i = 0; i < n; ++i) fs.push_back(submit(pool, [i] {return i;}));
+      std::uint64_t sum = 0;
+      for (auto v : std::move(when_all(std::move(fs))).get().value()) sum += v;
+      benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_fanin_std_promise)->Arg(256);
+BENCHMARK(BM_fanin_when_all)->Arg(256);
+/**  parallel algorithms scaling : Arg = pool workers (1 .. hardware threads), serial baseline .
+ *
+ *
+ */
+static ThreadPool& sized_pool(size_type workers)
+{
+    static std::map<size_type, std::unique_ptr<ThreadPool>> pools;
+    auto& p = pools[workers];
+    if (! p) p = std::make_unique<ThreadPool>(workers);
+    return *p;
+}
+static void scaling_args(benchmark::internal::Benchmark* b)
+{
+    auto hw = static_cast<long>(ThreadPool::default_workers());
+    for (long k = 1; k < hw; k *= 2) b->Arg(k);
+    b->Arg(hw);
+}
+static constexpr size_type SCALE_N = 1 << 22;
+static auto random_buffer() -> const BufferBase<std::uint32_t>&
+{
+    static BufferBase<std::uint32_t> buf = [] {
+        BufferBase<std::uint32_t> b(SCALE_N, 0);
+        std::mt19937 rng(1);
+        for (auto& x : b) x = rng();
+        return b;
+    }();
+    return buf;
+}
+static void BM_reduce_serial(benchmark::State& state) {
+  auto& in = random_buffer();
+  for (auto _ : state) benchmark::DoNotOptimize(std::accumulate(in.const_begin(), in.const_end(), std::uint64_t{0}));
+  state.SetItemsProcessed(state.iterations() * SCALE_N);
+}
+static void BM_reduce_parallel(benchmark::State& state) {
+  auto& in = random_buffer();
+  auto& pool = sized_pool(static_cast<size_type>(state.range(0)));
+  for (auto _ : state) benchmark::DoNotOptimize(parallel_reduce(pool, in, std::uint64_t{0}));
+  state.SetItemsProcessed(state.iterations() * SCALE_N);
+}
+static void BM_transform_serial(benchmark::State& state) {
+  auto& in = random_buffer();
+  StorageBase<float> out(SCALE_N, 0.0f);
+  for (auto _ : state) {
+      std::transform(in.const_begin(), in.const_end(), out.begin(), [](std::uint32_t x) {return static_cast<float>(x) * 0.5f + 1.0f;});
+      benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * SCALE_N);
+}
+static void BM_transform_parallel(benchmark::State& state) {
+  auto& in = random_buffer();
+  auto& pool = sized_pool(static_cast<size_type>(state.range(0)));
+  StorageBase<float> out(SCALE_N, 0.0f);
+  for (auto _ : state) {
+      parallel_transform(pool, in, out, [](std::uint32_t x) {return static_cast<float>(x) * 0.5f + 1.0f;});
+      benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * SCALE_N);
+}
+static void BM_scan_serial(benchmark::State& state) {
+  auto& in = random_buffer();
+  std::vector<std::uint64_t> out(SCALE_N);
+  for (auto _ : state) {
+      std::inclusive_scan(in.const_begin(), in.const_end(), out.begin(), std::plus<std::uint64_t>{});
+      benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * SCALE_N);
+}
+static void BM_scan_parallel(benchmark::State& state) {
+  auto& in = random_buffer();
+  auto& pool = sized_pool(static_cast<size_type>(state.range(0)));
+  std::vector<std::uint64_t> out(SCALE_N);
+  for (auto _ : state) {
+      parallel_scan(pool, std::span(in.const_begin(), SCALE_N), std::span(out), std::plus<std::uint64_t>{});
+      benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * SCALE_N);
+}
+static void BM_sort_serial(benchmark::State& state) {
+  auto& in = random_buffer();
+  std::vector<std::uint32_t> v(SCALE_N);
+  for (auto _ : state) {
+      state.PauseTiming();
+      std::copy(in.const_begin(), in.const_end(), v.begin());
+      state.ResumeTiming();
+      std::sort(v.begin(), v.end());
+  }
+  state.SetItemsProcessed(state.iterations() * SCALE_N);
+}
+static void BM_sort_parallel_radix(benchmark::State& state) {
+  auto& in = random_buffer();
+  auto& pool = sized_pool(static_cast<size_type>(state.range(0)));
+  std::vector<std::uint32_t> v(SCALE_N);
+  for (auto _ : state) {
+      state.PauseTiming();
+      std::copy(in.const_begin(), in.const_end(), v.begin());
+      state.ResumeTiming();
+      parallel_sort(pool, std::span(v));
+  }
+  state.SetItemsProcessed(state.iterations() * SCALE_N);
+}
+static void BM_sort_parallel_sample(benchmark::State& state) {
+  auto& in = random_buffer();
+  auto& pool = sized_pool(static_cast<size_type>(state.range(0)));
+  std::vector<std::uint32_t> v(SCALE_N);
+  for (auto _ : state) {
+      state.PauseTiming();
+      std::copy(in.const_begin(), in.const_end(), v.begin());
+      state.ResumeTiming();
+      parallel_sort(pool, std::span(v), std::less<>{});
+  }
+  state.SetItemsProcessed(state.iterations() * SCALE_N);
+}
+BENCHMARK(BM_reduce_serial);
+BENCHMARK(BM_reduce_parallel)->Apply(scaling_args);
+BENCHMARK(BM_transform_serial);
+BENCHMARK(BM_transform_parallel)->Apply(scaling_args);
+BENCHMARK(BM_scan_serial);
+BENCHMARK(BM_scan_parallel)->Apply(scaling_args);
+BENCHMARK(BM_sort_serial);
+BENCHMARK(BM_sort_parallel_radix)->Apply(scaling_args);
+BENCHMARK(BM_sort_parallel_sample)->Apply(scaling_args);
+
+/**  registry snapshot with N accounted threads, and the cost accounting adds to a Signal wait .
+ *
+ *
+ */
+static void BM_registry_snapshot(benchmark::State& state) {
+  auto n = static_cast<std::size_t>(state.range(0));
+  ThreadRegistry reg;
+  Signal idle;
+  std::atomic<bool> quit {false};
+  std::atomic<std::size_t> ready {0};
+  std::vector<std::thread> ts;
+  for (std::size_t i = 0; i < n; ++i) ts.emplace_back([&, i] {
+      auto s = reg.track(i, "w" + std::to_string(i));
+      ready.fetch_add(1);
+      while (! quit.load()) idle.wait_for(5);
+  });
+  while (ready.load() < n) std::this_thread::yield();
+  for (auto _ : state) benchmark::DoNotOptimize(reg.snapshot());
+  quit = true;
+  for (auto& t : ts) t.join();
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_registry_snapshot)->Arg(8)->Arg(64);
+template <bool ACCOUNTED>
+static void BM_signal_wait(benchmark::State& state) {
+  Signal s;
+  auto a = std::make_shared<ThreadAccount>(0, "bench");
+  if (ACCOUNTED) a->begin();
+  for (auto _ : state) {
+      s.update(1);
+      benchmark::DoNotOptimize(s.wait_update()); // already updated, no sleep
+  }
+  if (ACCOUNTED) a->end();
+}
+BENCHMARK(BM_signal_wait<false>);
+BENCHMARK(BM_signal_wait<true>);
+
+/**  task dispatch : build a task for a member function and run it .
+ *
+ *  shared_ptr<RunnableAdapter> + virtual run / std::function / InlineTask
+ */
+struct dispatch_target
+{
+    std::uint64_t n = 0;
+    void stop() {}
+    void entry(void_ptr vp) {n += reinterpret_cast<std::uintptr_t>(vp);}
+};
+static void BM_dispatch_runnable_adapter(benchmark::State& state) {
+  auto t = std::make_shared<dispatch_target>();
+  std::uintptr_t k = 0;
+  for (auto _ : state) {
+      std::shared_ptr<Runnable> r = std::make_shared<RunnableAdapter<dispatch_target>>(t, &dispatch_target::entry);
+      benchmark::DoNotOptimize(r);
+      r->run(reinterpret_cast<void_ptr>(++k));
+  }
+  benchmark::DoNotOptimize(t->n);
+}
+static void BM_dispatch_std_function(benchmark::State& state) {
+  auto t = std::make_shared<dispatch_target>();
+  std::uintptr_t k = 0;
+  for (auto _ : state) {
+      std::function<void()> f([t, e = &dispatch_target::entry, vp = reinterpret_cast<void_ptr>(++k)] {(*t.*e)(vp);});
+      benchmark::DoNotOptimize(f);
+      f();
+  }
+  benchmark::DoNotOptimize(t->n);
+}
+static void BM_dispatch_inline_task(benchmark::State& state) {
+  auto t = std::make_shared<dispatch_target>();
+  std::uintptr_t k = 0;
+  for (auto _ : state) {
+      auto f = make_task(t, &dispatch_target::entry, reinterpret_cast<void_ptr>(++k));
+      benchmark::DoNotOptimize(f);
+      f();
+  }
+  benchmark::DoNotOptimize(t->n);
+}
+BENCHMARK(BM_dispatch_runnable_adapter);
+BENCHMARK(BM_dispatch_std_function);
+BENCHMARK(BM_dispatch_inline_task);
+/**  task dispatch through the pool : post N and wait .
+ *
+ *
+ */
+template <bool INLINE_TASK>
+static void BM_pool_dispatch(benchmark::State& state) {
+  ThreadPool pool(2);
+  auto t = std::make_shared<dispatch_target>();
+  constexpr int N = 10000;
+  for (auto _ : state) {
+      for (int i = 0; i < N; ++i) {
+          if constexpr (INLINE_TASK) {
+              pool.post(make_task(t, &dispatch_target::entry, nullptr));
+          } else {
+              pool.post(std::make_shared<RunnableAdapter<dispatch_target>>(t, &dispatch_target::entry), nullptr);
+          }
+      }
+      pool.wait_idle();
+  }
+  state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK(BM_pool_dispatch<false>);
+BENCHMARK(BM_pool_dispatch<true>);
+
+/**  heartbeat cost in a loop (watched by a running watchdog) VS a shared atomic counter .
+ *
+ *
+ */
+static void BM_heartbeat(benchmark::State& state) {
+  Watchdog dog(std::chrono::milliseconds(1));
+  auto hb = dog.enroll("bench", std::chrono::seconds(10));
+  for (auto _ : state) hb.beat();
+}
+static void BM_atomic_increment(benchmark::State& state) {
+  std::atomic<std::uint64_t> n {0};
+  for (auto _ : state) n.fetch_add(1, std::memory_order_relaxed);
+  benchmark::DoNotOptimize(n.load());
+}
+BENCHMARK(BM_heartbeat);
+BENCHMARK(BM_atomic_increment);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,808 @@
+/*! \file unit_test.cpp
+ *
+ * \brief
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "thread_pool.hpp"
+#include "future.hpp"
+#include "cpu_topology.hpp"
+#include "parallel.hpp"
+#include "buffer.hpp"
+#include "signal.hpp"
+#include "thread_stats.hpp"
+#include "inline_task.hpp"
+#include "watchdog.hpp"
+#include <pthread.h>
+#include <sched.h>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+using namespace Mult;
+
+TEST_CASE("work stealing deque") {
+    using Internal::pool_job;
+    struct mark_job final : pool_job {
+        explicit mark_job(int v) : value(v) {}
+        void execute() noexcept override {}
+        int value;
+    };
+    SUBCASE("owner LIFO, thief FIFO, grows") {
+        Internal::WorkStealingDeque d(4);
+        std::vector<std::unique_ptr<mark_job>> jobs;
+        for (int i = 0; i < 10; ++i) {
+            jobs.emplace_back(std::make_unique<mark_job>(i));
+            d.push(jobs.back().get());
+        }
+        CHECK(d.size() == 10);
+        CHECK(static_cast<mark_job*>(d.steal())->value == 0);
+        CHECK(static_cast<mark_job*>(d.pop())->value == 9);
+        CHECK(static_cast<mark_job*>(d.steal())->value == 1);
+        for (int i = 8; i >= 2; --i) CHECK(static_cast<mark_job*>(d.pop())->value == i);
+        CHECK(d.pop() == nullptr);
+        CHECK(d.steal() == nullptr);
+        CHECK(d.empty());
+    }
+    SUBCASE("each job taken exactly once under contention") {
+        constexpr int N = 20000;
+        Internal::WorkStealingDeque d(8);
+        std::vector<std::unique_ptr<mark_job>> jobs;
+        for (int i = 0; i < N; ++i) jobs.emplace_back(std::make_unique<mark_job>(i));
+        std::vector<std::atomic<int>> taken(N);
+        std::atomic<bool> done {false};
+        std::vector<std::thread> thieves;
+        for (int t = 0; t < 3; ++t) thieves.emplace_back([&] {
+            while (! done.load()) {
+                if (auto j = d.steal()) taken[static_cast<mark_job*>(j)->value].fetch_add(1);
+            }
+            while (auto j = d.steal()) taken[static_cast<mark_job*>(j)->value].fetch_add(1);
+        });
+        for (int i = 0; i < N; ++i) {
+            d.push(jobs[i].get());
+            if (i % 3 == 0) {
+                if (auto j = d.pop()) taken[static_cast<mark_job*>(j)->value].fetch_add(1);
+            }
+        }
+        while (auto j = d.pop()) taken[static_cast<mark_job*>(j)->value].fetch_add(1);
+        done.store(true);
+        for (auto& t : thieves) t.join();
+        int bad = 0;
+        for (auto& t : taken) bad += t.load() != 1;
+        CHECK(bad == 0);
+    }
+}
+
+TEST_CASE("thread pool") {
+    SUBCASE("callables from outside") {
+        ThreadPool pool(3);
+        CHECK(pool.worker_count() == 3);
+        CHECK(pool.current_index() == ThreadPool::NOT_WORKER);
+        CHECK(pool.try_run_one() == false);
+        std::atomic<int> sum {0};
+        for (int i = 1; i <= 1000; ++i) CHECK(pool.post([&sum, i] {sum.fetch_add(i);}) == OK);
+        pool.wait_idle();
+        CHECK(sum.load() == 500500);
+        CHECK(pool.pending() == 0);
+    }
+    SUBCASE("default worker count") {
+        ThreadPool pool(0);
+        CHECK(pool.worker_count() == ThreadPool::default_workers());
+    }
+    SUBCASE("worker index and nested post go to own deque") {
+        ThreadPool pool(2);
+        std::atomic<int> inner {0};
+        std::atomic<size_type> index {ThreadPool::NOT_WORKER};
+        pool.post([&] {
+            index = pool.current_index();
+            for (int i = 0; i < 500; ++i) pool.post([&] {inner.fetch_add(1);});
+        });
+        while (pool.pending()) std::this_thread::yield(); // not helping, all jobs run on workers
+        CHECK(index.load() < 2);
+        CHECK(inner.load() == 500);
+    }
+    SUBCASE("idle workers steal") {
+        ThreadPool pool(4);
+        std::set<std::thread::id> ids;
+        std::mutex m;
+        pool.post([&] {
+            for (int i = 0; i < 64; ++i) pool.post([&] {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                std::lock_guard<std::mutex> l(m);
+                ids.insert(std::this_thread::get_id());
+            });
+        });
+        while (pool.pending()) std::this_thread::yield();
+        CHECK(pool.steals() > 0);
+        CHECK(ids.size() > 1);
+    }
+    SUBCASE("runnable") {
+        struct counter {
+            std::atomic<int> runs {0};
+            void stop() {}
+            void entry(void_ptr vp) {runs.fetch_add(*static_cast<int*>(vp));}
+        };
+        auto c = std::make_shared<counter>();
+        auto r = std::make_shared<RunnableAdapter<counter>>(c, &counter::entry);
+        ThreadPool pool(2);
+        int three = 3;
+        for (int i = 0; i < 10; ++i) CHECK(pool.post(r, &three) == OK);
+        CHECK(pool.post(ThreadPool::runnable_p(), nullptr) == FAIL_ARG);
+        pool.wait_idle();
+        CHECK(c->runs.load() == 30);
+    }
+    SUBCASE("throwing job does not stop the pool") {
+        ThreadPool pool(2);
+        std::atomic<int> n {0};
+        pool.post([] {throw std::runtime_error("boom");});
+        WorkGroup g(pool);
+        g.run([] {throw 1;});
+        g.run([&] {n.fetch_add(1);});
+        g.wait();
+        pool.wait_idle();
+        CHECK(n.load() == 1);
+    }
+    SUBCASE("destructor runs queued jobs") {
+        std::atomic<int> n {0};
+        {
+            ThreadPool pool(1);
+            for (int i = 0; i < 100; ++i) pool.post([&n] {std::this_thread::yield(); n.fetch_add(1);});
+        }
+        CHECK(n.load() == 100);
+    }
+}
+
+static auto fib(ThreadPool& pool, int n) -> long
+{
+    if (n < 12) {
+        long a = 0, b = 1;
+        for (int i = 0; i < n; ++i) {auto t = a + b; a = b; b = t;}
+        return a;
+    }
+    long x = 0, y = 0;
+    WorkGroup g(pool);
+    g.run([&] {x = fib(pool, n - 1);});
+    y = fib(pool, n - 2);
+    g.wait();
+    return x + y;
+}
+
+TEST_CASE("work group fork join") {
+    for (size_type workers : {size_type(1), size_type(2), size_type(4)}) {
+        ThreadPool pool(workers);
+        CHECK(fib(pool, 24) == 46368);
+        long r = 0;
+        WorkGroup outer(pool);
+        outer.run([&] {r = fib(pool, 20);}); // nested groups inside a pool job
+        outer.wait();
+        CHECK(r == 6765);
+        CHECK(outer.pending() == 0);
+    }
+}
+
+TEST_CASE("future") {
+    ThreadPool pool(3);
+    SUBCASE("submit values, Result and void") {
+        auto a = submit(pool, [] {return 21;});
+        auto b = submit(pool, []() -> Result<std::string> {return Result<std::string>(error_type(NO_DATA));});
+        std::atomic<int> n {0};
+        auto c = submit(pool, [&n] {n = 1;});
+        auto d = submit(pool, []() -> int {throw std::runtime_error("boom");});
+        static_assert(std::is_same_v<decltype(a), Future<Result<int>>>);
+        static_assert(std::is_same_v<decltype(b), Future<Result<std::string>>>);
+        static_assert(std::is_same_v<decltype(c), Future<Result<void>>>);
+        auto ra = std::move(a).get();
+        CHECK(ra.has_value());
+        CHECK(ra.value() == 21);
+        CHECK(! a.valid());
+        auto rb = std::move(b).get();
+        CHECK(rb.error() == NO_DATA);
+        CHECK(std::move(c).get().has_value());
+        CHECK(n.load() == 1);
+        CHECK(std::move(d).get().error() == FAILURE);
+        CHECK(Future<Result<int>>().valid() == false);
+        CHECK(std::move(a).get().error() == FAIL_ARG);
+    }
+    SUBCASE("then chains value and error paths") {
+        auto f = submit(pool, [] {return 20;})
+            .then([](int v) {return v + 1;})
+            .then([](int v) {return std::to_string(v * 2);});
+        CHECK(std::move(f).get().value() == "42");
+        std::atomic<int> skipped {0};
+        auto g = submit(pool, []() -> Result<int> {return Result<int>(error_type(TIMEOUT));})
+            .then([&](int v) {skipped = 1; return v;})                      // not called
+            .then([](Result<int>&& r) {return r.has_value() ? 0 : static_cast<int>(r.error());});
+        CHECK(std::move(g).get().value() == TIMEOUT);
+        CHECK(skipped.load() == 0);
+        auto h = submit(pool, [] {})
+            .then([] {return Result<double>(1.5);})
+            .then([](double v) -> Result<double> {if (v > 1) return Result<double>(error_type(OVER_FLOW)); return Result<double>(v);});
+        CHECK(std::move(h).get().error() == OVER_FLOW);
+        auto w = submit(pool, [] {return 3;})
+            .then([](auto r) {return r.has_value() ? r.value() : -1;});     // generic: the whole Result
+        CHECK(std::move(w).get().value() == 3);
+        auto we = submit(pool, []() -> Result<int> {return Result<int>(error_type(TIMEOUT));})
+            .then([](const auto& r) {return r.has_value() ? r.value() : -1;});
+        CHECK(std::move(we).get().value() == -1);
+        auto c = submit(pool, [] {return 4;})
+            .then([](const Result<int>& r) {return r.value() * 2;});
+        CHECK(std::move(c).get().value() == 8);
+    }
+    SUBCASE("then on ready future and long pipeline") {
+        auto f = make_ready_future(Result<int>(0), &pool);
+        CHECK(f.ready());
+        for (int i = 0; i < 200; ++i) f = std::move(f).then([](int v) {return v + 1;});
+        CHECK(std::move(f).get().value() == 200);
+        auto g = make_ready_future(Result<int>(7)).then([](int v) {return v * 6;}); // no pool, runs inline
+        CHECK(g.ready());
+        CHECK(std::move(g).get().value() == 42);
+    }
+    SUBCASE("when_all") {
+        std::vector<Future<Result<int>>> fs;
+        for (int i = 0; i < 100; ++i) fs.push_back(submit(pool, [i] {return i;}));
+        auto all = std::move(std::move(when_all(std::move(fs))).get()).value();
+        REQUIRE(all.size() == 100);
+        bool ordered = true;
+        for (int i = 0; i < 100; ++i) ordered = ordered && all[i] == i;
+        CHECK(ordered);
+
+        std::vector<Future<Result<int>>> gs;
+        for (int i = 0; i < 10; ++i) gs.push_back(submit(pool, [i]() -> Result<int> {
+            if (i == 3) return Result<int>(error_type(NO_DATA));
+            if (i == 7) return Result<int>(error_type(TIMEOUT));
+            return Result<int>(i);
+        }));
+        CHECK(std::move(when_all(std::move(gs))).get().error() == NO_DATA); // first by index
+
+        std::vector<Future<Result<void>>> vs;
+        std::atomic<int> n {0};
+        for (int i = 0; i < 20; ++i) vs.push_back(submit(pool, [&n] {n.fetch_add(1);}));
+        CHECK(std::move(when_all(std::move(vs))).get().has_value());
+        CHECK(n.load() == 20);
+        CHECK(std::move(when_all(std::vector<Future<Result<int>>>{})).get().value().empty());
+        std::vector<Future<Result<int>>> is;
+        is.push_back(make_ready_future(Result<int>(1)));
+        is.push_back(Future<Result<int>>{});
+        CHECK(std::move(when_all(std::move(is))).get().error() == FAIL_ARG);
+
+        auto t = when_all(submit(pool, [] {return 1;}), submit(pool, [] {return std::string("x");}));
+        auto tv = std::move(t).get();
+        REQUIRE(tv.has_value());
+        CHECK(std::get<0>(tv.value()) == 1);
+        CHECK(std::get<1>(tv.value()) == "x");
+        auto te = when_all(submit(pool, [] {return 1;}), submit(pool, []() -> Result<int> {return Result<int>(error_type(FAIL_CMD));}));
+        CHECK(std::move(te).get().error() == FAIL_CMD);
+    }
+    SUBCASE("when_any") {
+        std::vector<Future<Result<int>>> fs;
+        fs.push_back(submit(pool, []() -> Result<int> {return Result<int>(error_type(NO_DATA));}));
+        fs.push_back(submit(pool, [] {return 5;}));
+        auto r = std::move(when_any(std::move(fs))).get();
+        REQUIRE(r.has_value());
+        CHECK(r.value().first == 1);
+        CHECK(r.value().second == 5);
+
+        std::vector<Future<Result<int>>> es;
+        for (int i = 0; i < 4; ++i) es.push_back(make_ready_future(Result<int>(error_type(TIMEOUT))));
+        CHECK(std::move(when_any(std::move(es))).get().error() == TIMEOUT);
+        CHECK(std::move(when_any(std::vector<Future<Result<int>>>{})).get().error() == NO_DATA);
+        std::vector<Future<Result<int>>> ns;
+        ns.push_back(Future<Result<int>>{});
+        CHECK(std::move(when_any(std::move(ns))).get().error() == FAIL_ARG);
+
+        std::vector<Future<Result<void>>> vs;
+        vs.push_back(make_ready_future(Result<void>(error_type(FAILURE))));
+        vs.push_back(make_ready_future(Result<void>()));
+        CHECK(std::move(when_any(std::move(vs))).get().value() == 1);
+    }
+    SUBCASE("get on a worker helps instead of blocking") {
+        ThreadPool one(1);
+        auto outer = submit(one, [&one] {
+            auto inner = submit(one, [] {return 2;}); // queued behind us on the only worker
+            return std::move(inner).get().value() * 21;
+        });
+        CHECK(std::move(outer).get().value() == 42);
+    }
+    SUBCASE("dropped future and stopped pool") {
+        std::atomic<int> n {0};
+        {
+            ThreadPool p(2);
+            for (int i = 0; i < 100; ++i) {
+                auto f = submit(p, [&n] {n.fetch_add(1); return 1;}); // future dropped at once
+                if (i % 2) std::move(f).then([&n](int) {n.fetch_add(1);});
+            }
+        }
+        CHECK(n.load() == 150);
+    }
+}
+
+TEST_CASE("cpu topology") {
+    CHECK(parse_cpu_list("0-3,8,10-11\n") == std::vector<unsigned>{0, 1, 2, 3, 8, 10, 11});
+    CHECK(parse_cpu_list("5") == std::vector<unsigned>{5});
+    CHECK(parse_cpu_list("3-1").empty());
+    CHECK(parse_cpu_list("x").empty());
+    CHECK(parse_cpu_list("99999999999").empty());
+    CHECK(parse_cpu_list("0-4294967295").empty());
+    CHECK(parse_cpu_list(std::to_string(CPU_SETSIZE)).empty());
+    CHECK(parse_cpu_list(std::to_string(CPU_SETSIZE - 1)) == std::vector<unsigned>{CPU_SETSIZE - 1});
+    SUBCASE("fake sysfs: 1 package, 2 L3 groups, 4 cores, 2 SMT") {
+        namespace fs = std::filesystem;
+        auto root = fs::temp_directory_path() / "mult_cpu_topology";
+        fs::remove_all(root);
+        auto put = [](const fs::path& p, const std::string& v) {
+            fs::create_directories(p.parent_path());
+            std::ofstream(p) << v << "\n";
+        };
+        put(root / "online", "0-7");
+        for (unsigned c = 0; c < 8; ++c) { // cpu c is core c % 4, siblings c and c + 4
+            auto d = root / ("cpu" + std::to_string(c));
+            auto core = c % 4;
+            put(d / "topology/core_id", std::to_string(core));
+            put(d / "topology/physical_package_id", "0");
+            put(d / "topology/thread_siblings_list", std::to_string(core) + "," + std::to_string(core + 4));
+            put(d / "cache/index0/level", "1");
+            put(d / "cache/index0/type", "Data");
+            put(d / "cache/index0/shared_cpu_list", std::to_string(core) + "," + std::to_string(core + 4));
+            put(d / "cache/index1/level", "1");
+            put(d / "cache/index1/type", "Instruction");
+            put(d / "cache/index1/shared_cpu_list", std::to_string(core));
+            put(d / "cache/index2/level", "2");
+            put(d / "cache/index2/type", "Unified");
+            put(d / "cache/index2/shared_cpu_list", std::to_string(core) + "," + std::to_string(core + 4));
+            put(d / "cache/index3/level", "3");
+            put(d / "cache/index3/type", "Unified");
+            put(d / "cache/index3/shared_cpu_list", core < 2 ? "0-1,4-5" : "2-3,6-7");
+        }
+        auto t = CpuTopology::discover(root.string());
+        fs::remove_all(root);
+        CHECK(t.size() == 8);
+        CHECK(t.core_count() == 4);
+        CHECK(t.package_count() == 1);
+        CHECK(t.l3_count() == 2);
+        CHECK(t.siblings(1) == std::vector<unsigned>{1, 5});
+        CHECK(t.find(5)->smt == 1);
+        CHECK(t.find(6)->l2 == 2);
+        CHECK(t.shares_l2(3, 7));
+        CHECK(! t.shares_l2(3, 2));
+        CHECK(t.shares_l3(1, 4));
+        CHECK(! t.shares_l3(1, 2));
+        CHECK(t.find(9) == nullptr);
+        CHECK(t.placement(4) == std::vector<unsigned>{0, 1, 2, 3});                   // one per core, L3 neighbours adjacent
+        CHECK(t.placement(10) == std::vector<unsigned>{0, 1, 2, 3, 4, 5, 6, 7, 0, 1}); // SMT siblings last
+    }
+    SUBCASE("missing sysfs falls back to flat topology") {
+        auto t = CpuTopology::discover("/nonexistent/mult");
+        CHECK(t.size() == ThreadPool::default_workers());
+        CHECK(t.core_count() == t.size());
+        CHECK(t.l3_count() == 1);
+    }
+    SUBCASE("this machine") {
+        auto t = CpuTopology::discover();
+        CHECK(t.size() > 0);
+        CHECK(t.core_count() <= t.size());
+        CHECK(t.placement(t.size()).size() == t.size());
+    }
+}
+
+static auto allowed_cpu() -> unsigned
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    sched_getaffinity(0, sizeof(set), &set);
+    for (unsigned c = 0; c < CPU_SETSIZE; ++c) if (CPU_ISSET(c, &set)) return c;
+    return 0;
+}
+
+TEST_CASE("thread options") {
+    auto cpu = allowed_cpu();
+    SUBCASE("apply to calling thread") {
+        std::thread([cpu] {
+            thread_options o;
+            o.cpus = {cpu};
+            o.nice = 1;
+            CHECK(apply_thread_options(o, "options-test-long-name") == OK);
+            CHECK(static_cast<unsigned>(sched_getcpu()) == cpu);
+            char name[16] {};
+            pthread_getname_np(pthread_self(), name, sizeof(name));
+            CHECK(std::string(name) == "options-test-lo"); // truncated to 15 bytes
+            thread_options bad;
+            bad.cpus = {CPU_SETSIZE};
+            CHECK(apply_thread_options(bad) == FAIL_ARG);
+            thread_options prio;
+            prio.policy = sched_policy::fifo;
+            prio.priority = 0;
+            CHECK(apply_thread_options(prio) == FAIL_ARG);
+            thread_options other;
+            other.policy = sched_policy::other;
+            CHECK(apply_thread_options(other) == OK);
+            CHECK(thread_options{}.changes_placement() == false);
+        }).join();
+    }
+    SUBCASE("Thread applies options before run") {
+        struct probe {
+            std::atomic<int> cpu {-1};
+            std::string name;
+            void stop() {}
+            void entry(void_ptr) {
+                cpu = sched_getcpu();
+                char b[16] {};
+                pthread_getname_np(pthread_self(), b, sizeof(b));
+                name = b;
+            }
+        };
+        auto p = std::make_shared<probe>();
+        Thread t(std::make_shared<RunnableAdapter<probe>>(p, &probe::entry), "rx");
+        thread_options o;
+        o.cpus = {cpu};
+        t.options(o);
+        CHECK(t.options().cpus.size() == 1);
+        CHECK(t.start(nullptr) == OK);
+        t.join();
+        CHECK(p->cpu.load() == static_cast<int>(cpu));
+        CHECK(p->name == "rx");
+
+        auto q = std::make_shared<probe>();
+        Thread r(std::make_shared<RunnableAdapter<probe>>(q, &probe::entry), "bad");
+        o.cpus = {CPU_SETSIZE + 1};
+        r.options(o);
+        CHECK(r.start(nullptr) == FAIL_ARG);
+        CHECK(r.started() == false);
+        CHECK(q->cpu.load() == -1); // refused options, runnable never ran
+    }
+    SUBCASE("pool placement") {
+        ThreadPool pool(2, thread_options{}, std::vector<unsigned>{cpu});
+        CHECK(pool.setup_result() == OK);
+        std::atomic<int> wrong {0};
+        WorkGroup g(pool);
+        for (int i = 0; i < 64; ++i) g.run([&] {
+            if (static_cast<unsigned>(sched_getcpu()) != cpu && pool.current_index() != ThreadPool::NOT_WORKER) wrong.fetch_add(1);
+        });
+        g.wait();
+        CHECK(wrong.load() == 0);
+        thread_options bad;
+        bad.cpus = {CPU_SETSIZE};
+        ThreadPool refused(1, bad);
+        CHECK(refused.setup_result() == FAIL_ARG);
+        CHECK(std::move(submit(refused, [] {return 1;})).get().value() == 1); // still works
+    }
+}
+
+TEST_CASE("thread accounting") {
+    using namespace std::chrono_literals;
+    struct stage {
+        Signal go;
+        std::atomic<bool> spun {false};
+        void stop() {}
+        void entry(void_ptr) {
+            auto cpu = [] {
+                timespec ts {};
+                ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+                return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+            };
+            auto t = cpu();
+            while (cpu() - t < 30ms) {}                           // burn 30ms of CPU, however long it takes
+            spun = true;
+            go.wait_update();                                     // blocked
+        }
+    };
+    auto p = std::make_shared<stage>();
+    Thread t(std::make_shared<RunnableAdapter<stage>>(p, &stage::entry), 7, "stage");
+    CHECK(! t.usage());
+    thread_options o;
+    o.account = true;
+    t.options(o);
+    REQUIRE(t.start(nullptr) == OK);
+    while (! p->spun.load()) std::this_thread::sleep_for(1ms);
+    auto live = t.usage();
+    REQUIRE(live);
+    CHECK(live->running);
+    CHECK(live->tid > 0);
+    CHECK(live->cpu >= 20ms);       // read while the thread runs
+    std::this_thread::sleep_for(30ms);
+    p->go.update(1);
+    t.join();
+    auto u = *t.usage();
+    CHECK(! u.running);
+    CHECK(u.id == 7);
+    CHECK(u.name == "stage");
+    CHECK(u.waits == 1);
+    CHECK(u.blocked >= 20ms);
+    CHECK(u.blocked < u.wall());
+    CHECK(u.cpu >= live->cpu);
+    CHECK(u.cpu < u.wall());
+    CHECK(u.voluntary >= 1);        // went to sleep in the wait
+    CHECK(u.utilization() > 0.0);
+    CHECK(u.utilization() <= 1.0);
+
+    ThreadPool pool(2, o);
+    auto names = std::set<std::string>{};
+    for (auto& x : ThreadRegistry::global().snapshot()) {
+        if (x.running) names.insert(x.name);
+    }
+    CHECK(names == std::set<std::string>{"pool/0", "pool/1"});
+    CHECK(ThreadRegistry::global().prune() >= 1); // the stage account
+    CHECK(ThreadRegistry::global().size() == 2);
+    CHECK(t.usage()->name == "stage");            // still owned by the Thread
+}
+
+TEST_CASE("inline task") {
+    struct tracked {
+        std::shared_ptr<int> alive;  // use_count() counts live copies
+        int* hits;
+        void operator()() {++*hits;}
+    };
+    int hits = 0;
+    auto alive = std::make_shared<int>(0);
+    SUBCASE("inline and heap storage, move only") {
+        static_assert(sizeof(InlineTask) == 64);
+        static_assert(InlineTask::stored_inline<tracked>);
+        struct big {char pad[64]; int* hits; void operator()() {++*hits;}};
+        static_assert(! InlineTask::stored_inline<big>);
+        static_assert(! std::is_copy_constructible_v<InlineTask>);
+        InlineTask a(tracked{alive, &hits});
+        CHECK(alive.use_count() == 2);
+        InlineTask b(std::move(a));
+        CHECK(! a);
+        CHECK(alive.use_count() == 2);
+        b();
+        b();
+        InlineTask h(big{{}, &hits});
+        InlineTask h2;
+        h2 = std::move(h);
+        h2();
+        CHECK(hits == 3);
+        b = std::move(h2);           // destroys the tracked callable
+        CHECK(alive.use_count() == 1);
+        b();
+        CHECK(hits == 4);
+        InlineTask c([&hits] {hits += 10;}); // trivially copyable
+        InlineTask d(std::move(c));
+        d();
+        CHECK(hits == 14);
+        d.reset();
+        CHECK(! d);
+    }
+    SUBCASE("Thread and pool accept tasks, adapter from RunnableAdapter") {
+        struct target {
+            std::atomic<int> n {0};
+            void stop() {}
+            void entry(void_ptr vp) {n.fetch_add(*static_cast<int*>(vp));}
+        };
+        auto tg = std::make_shared<target>();
+        int one = 1;
+        Thread t(make_task(tg, &target::entry, &one), "task");
+        REQUIRE(t);
+        CHECK(t.start(nullptr) == OK);
+        t.join();
+        CHECK(tg->n.load() == 1);
+        RunnableAdapter<target> adapter(tg, &target::entry);
+        int ten = 10;
+        Thread u;
+        u.task(make_task(adapter, &ten));
+        CHECK(u.start(nullptr) == OK);
+        u.join();
+        CHECK(tg->n.load() == 11);
+
+        ThreadPool pool(2);
+        std::atomic<int> sum {0};
+        for (int i = 0; i < 100; ++i) {
+            InlineTask job([&sum, i] {sum.fetch_add(i);});
+            CHECK(pool.post(std::move(job)) == OK);
+        }
+        CHECK(pool.post(make_task(std::make_shared<RunnableAdapter<target>>(tg, &target::entry), &one)) == OK);
+        pool.wait_idle();
+        CHECK(sum.load() == 4950);
+        CHECK(tg->n.load() == 12);
+    }
+}
+
+TEST_CASE("watchdog") {
+    using namespace std::chrono_literals;
+    std::mutex reports_guard;
+    std::vector<stall_report> reports;
+    Watchdog dog(5ms, [&](const stall_report& r) {
+        std::lock_guard<std::mutex> l(reports_guard);
+        reports.push_back(r);
+    });
+    std::mutex stuck;
+    std::atomic<int> phase {0};
+    std::thread worker([&] {
+        auto hb = dog.enroll("worker", 50ms);
+        for (int i = 0; i < 1000; ++i) hb.beat();
+        hb.park();                            // parked: a long wait is fine
+        std::this_thread::sleep_for(100ms);
+        hb.beat();
+        phase = 1;
+        std::lock_guard<std::mutex> l(stuck); // hangs on a lock
+        hb.beat();
+        hb.beat();
+    });
+    std::thread healthy([&] {
+        auto hb = dog.enroll("healthy", 50ms);
+        while (phase.load() < 2) {
+            hb.beat();
+            std::this_thread::sleep_for(1ms);
+        }
+    });
+    {
+        std::unique_lock<std::mutex> hold(stuck);
+        while (phase.load() == 0) std::this_thread::sleep_for(1ms);
+        auto t = std::chrono::steady_clock::now();
+        while (dog.stalls() == 0 && std::chrono::steady_clock::now() - t < 2s) std::this_thread::sleep_for(5ms);
+        std::this_thread::sleep_for(100ms); // reported once
+    }
+    phase = 2;
+    worker.join();
+    healthy.join();
+    CHECK(dog.size() == 0);
+    std::lock_guard<std::mutex> l(reports_guard);
+    REQUIRE(reports.size() == 1);
+    CHECK(dog.stalls() == 1);
+    auto& r = reports.front();
+    CHECK(r.name == "worker");
+    CHECK(r.tid > 0);
+    CHECK(r.stalled >= 50ms);
+    CHECK(r.threshold == 50ms);
+    CHECK(r.beats == 1001);
+#if ! defined(__SANITIZE_THREAD__) // tsan holds signals to a thread blocked in a lock
+    CHECK(! r.backtrace.empty());
+#endif
+}
+
+TEST_CASE("watchdog signal handlers") {
+    using namespace std::chrono_literals;
+    auto action = [](int signo) {
+        struct sigaction sa {};
+        ::sigaction(signo, nullptr, &sa);
+        return sa.sa_handler;
+    };
+    auto mine = [](int) {};
+    struct sigaction sa {};
+    sa.sa_handler = mine;
+    sigemptyset(&sa.sa_mask);
+    struct sigaction saved {};
+    ::sigaction(SIGRTMIN + 2, &sa, &saved);
+    auto before = action(SIGRTMIN + 1);
+    {
+        auto a = std::make_unique<Watchdog>(5ms, nullptr, SIGRTMIN + 1);
+        auto b = std::make_unique<Watchdog>(5ms, nullptr, SIGRTMIN + 2); // another signal, its own saved action
+        Watchdog c(5ms, nullptr, SIGRTMIN + 1);
+        CHECK(action(SIGRTMIN + 1) != before);
+        CHECK(action(SIGRTMIN + 2) != mine);
+        a.reset();
+        CHECK(action(SIGRTMIN + 1) != before); // c still uses it
+        b.reset();
+        CHECK(action(SIGRTMIN + 2) == mine);
+    }
+    CHECK(action(SIGRTMIN + 1) == before);
+    ::sigaction(SIGRTMIN + 2, &saved, nullptr);
+}
+
+TEST_CASE("parallel algorithms") {
+    ThreadPool pool(3);
+    std::mt19937_64 rng(7);
+    SUBCASE("parallel_for covers every index once, small input runs on the caller") {
+        std::vector<std::atomic<int>> hit(100000);
+        parallel_for(pool, 0, hit.size(), [&](size_type b, size_type e) {
+            for (auto i = b; i < e; ++i) hit[i].fetch_add(1);
+        }, 1000);
+        int bad = 0;
+        for (auto& h : hit) bad += h.load() != 1;
+        CHECK(bad == 0);
+        std::atomic<int> chunks {0};
+        auto caller = std::this_thread::get_id();
+        std::atomic<bool> other {false};
+        parallel_for(pool, 10, 20, [&](size_type b, size_type e) {
+            chunks.fetch_add(1);
+            other = other || std::this_thread::get_id() != caller || b != 10 || e != 20;
+        });
+        CHECK(chunks.load() == 1);
+        CHECK(! other.load());
+        parallel_for(pool, 5, 5, [&](size_type, size_type) {chunks.fetch_add(1);});
+        CHECK(chunks.load() == 1);
+    }
+    SUBCASE("parallel_for_each over BufferBase") {
+        BufferBase<int> buf(50000, 0);
+        std::iota(buf.begin(), buf.end(), 0);
+        parallel_for_each(pool, buf, [](int& v) {v *= 2;}, 512);
+        CHECK(buf.const_ptr()[0] == 0);
+        CHECK(buf.const_ptr()[49999] == 99998);
+    }
+    SUBCASE("parallel_reduce") {
+        std::vector<long> v(200000);
+        std::iota(v.begin(), v.end(), 1L);
+        CHECK(parallel_reduce(pool, std::span(v), 0L) == 200000L * 200001L / 2);
+        CHECK(parallel_reduce(pool, std::span(v), 0L, [](long a, long b) {return std::max(a, b);}, 777) == 200000);
+        CHECK(parallel_reduce(pool, std::span<long>(), 5L) == 5);
+        StorageBase<double> d(100000, 0.5);
+        CHECK(parallel_reduce(pool, d, 0.0) == 50000.0); // exact in binary
+        // chunk / combine form : count of even values
+        auto even = parallel_reduce(pool, 0, v.size(), size_type{0},
+                                    [&](size_type b, size_type e) {
+                                        size_type n = 0;
+                                        for (auto i = b; i < e; ++i) n += (v[i] & 1) == 0;
+                                        return n;
+                                    }, std::plus<>{}, 3000);
+        CHECK(even == 100000);
+    }
+    SUBCASE("parallel_transform") {
+        std::vector<int> in(70000), out(70000);
+        std::iota(in.begin(), in.end(), 0);
+        CHECK(parallel_transform(pool, std::span(in), std::span(out), [](int x) {return x * 3;}, 1000) == OK);
+        bool ok = true;
+        for (int i = 0; i < 70000; ++i) ok = ok && out[i] == i * 3;
+        CHECK(ok);
+        std::vector<int> small(10);
+        CHECK(parallel_transform(pool, std::span(in), std::span(small), [](int x) {return x;}) == FAIL_ARG);
+        StorageBase<int> sin(30000, 2);
+        StorageBase<double> sout(30000, 0.0);
+        CHECK(parallel_transform(pool, sin, sout, [](int x) {return x * 0.5;}) == OK);
+        CHECK(sout.const_ptr()[29999] == 1.0);
+        StorageBase<double> reserved(30000); // capacity only, size 0
+        CHECK(parallel_transform(pool, sin, reserved, [](int x) {return x * 0.5;}) == FAIL_ARG);
+    }
+    SUBCASE("parallel_scan") {
+        std::vector<long> in(100003);
+        for (auto& x : in) x = static_cast<long>(rng() % 100);
+        std::vector<long> expect(in.size()), out(in.size());
+        std::inclusive_scan(in.begin(), in.end(), expect.begin());
+        for (size_type grain : {size_type(0), size_type(1), size_type(999), size_type(200000)}) {
+            std::fill(out.begin(), out.end(), -1);
+            CHECK(parallel_scan(pool, std::span(in), std::span(out), std::plus<>{}, grain) == OK);
+            CHECK(out == expect);
+        }
+        StorageBase<long> inplace(100003, 1);
+        CHECK(parallel_scan(pool, inplace, std::plus<>{}, 4096) == OK); // in place
+        CHECK(inplace.const_ptr()[100002] == 100003);
+        std::vector<long> shorter(3);
+        CHECK(parallel_scan(pool, std::span(in), std::span(shorter)) == FAIL_ARG);
+    }
+    SUBCASE("parallel_sort integer keys (radix)") {
+        std::vector<int> v(300000);
+        for (auto& x : v) x = static_cast<int>(rng());
+        v[5] = std::numeric_limits<int>::min();
+        v[6] = std::numeric_limits<int>::max();
+        auto expect = v;
+        std::sort(expect.begin(), expect.end());
+        parallel_sort(pool, std::span(v), 10000);
+        CHECK(v == expect);
+        std::vector<std::uint16_t> small(1000);
+        for (auto& x : small) x = static_cast<std::uint16_t>(rng() & 7); // high digit pass skipped
+        auto sexpect = small;
+        std::sort(sexpect.begin(), sexpect.end());
+        parallel_sort(pool, std::span(small), 64);
+        CHECK(small == sexpect);
+        BufferBase<std::uint64_t> buf(100000, 0);
+        for (auto& x : buf) x = rng();
+        parallel_sort(pool, buf);
+        CHECK(std::is_sorted(buf.const_ptr(), buf.const_ptr() + buf.size()));
+    }
+    SUBCASE("parallel_sort comparator (sample sort)") {
+        std::vector<std::string> v(50000);
+        for (auto& s : v) s = std::to_string(rng() % 10000);
+        auto expect = v;
+        std::sort(expect.begin(), expect.end(), std::greater<>{});
+        parallel_sort(pool, std::span(v), std::greater<>{}, 1000);
+        CHECK(v == expect);
+        std::vector<double> d(200000);
+        for (auto& x : d) x = static_cast<double>(rng() % 50); // heavy duplicates
+        auto dexpect = d;
+        std::sort(dexpect.begin(), dexpect.end());
+        parallel_sort(pool, std::span(d));
+        CHECK(d == dexpect);
+    }
+}
@@ -0,0 +1,98 @@
+/**
+ * @file bench.cpp
+ *
+ * @copylight © 2023 Matsuo Shin
+ * This code is licensed under the MIT License, see the LICENSE.txt file for details
+ *
+ * @brief bench mark for TimerWheel VS ordered containers
+ *
+ * @warning using google benchmark
+ *
+ * @author matsuo.shin@gmail.com
+ */
+
+
+#undef MULT_TRACE_FUNCTION
+#include <chrono>
+#include <functional>
+#include <map>
+#include <queue>
+#include <random>
+#include <vector>
+#include "benchmark.h"
+
+#include "timer_wheel.hpp"
+
+using namespace Mult;
+using namespace std::chrono_literals;
+using clock_type = TimerWheel::clock;
+/**  arm + cancel (timeouts that almost never fire) .
+ *
+ *
+ */
+static void BM_wheel_arm_cancel(benchmark::State& state) {
+  auto n = static_cast<std::size_t>(state.range(0));
+  TimerWheel w(1ms);
+  std::vector<timer_id> ids(n);
+  std::mt19937 rng(1);
+  for (std::size_t i = 0; i < n; ++i) ids[i] = w.arm(std::chrono::milliseconds(1 + rng() % 60000), [] {});
+  std::size_t k = 0;
+  for (auto _ : state) {
+      w.cancel(ids[k]);
+      ids[k] = w.arm(std::chrono::milliseconds(1 + rng() % 60000), [] {});
+      k = k + 1 == n ? 0 : k + 1;
+  }
+}
+static void BM_multimap_arm_cancel(benchmark::State& state) {
+  auto n = static_cast<std::size_t>(state.range(0));
+  std::multimap<std::uint64_t, std::function<void()>> m;
+  std::vector<decltype(m)::iterator> ids(n);
+  std::mt19937 rng(1);
+  for (std::size_t i = 0; i < n; ++i) ids[i] = m.emplace(1 + rng() % 60000, [] {});
+  std::size_t k = 0;
+  for (auto _ : state) {
+      m.erase(ids[k]);
+      ids[k] = m.emplace(1 + rng() % 60000, [] {});
+      k = k + 1 == n ? 0 : k + 1;
+  }
+}
+BENCHMARK(BM_wheel_arm_cancel)->Arg(1000)->Arg(1000000);
+BENCHMARK(BM_multimap_arm_cancel)->Arg(1000)->Arg(1000000);
+/**  arm N timers over 10s and run them all .
+ *
+ *
+ */
+static void BM_wheel_arm_fire(benchmark::State& state) {
+  auto n = static_cast<std::size_t>(state.range(0));
+  std::uint64_t sum = 0;
+  for (auto _ : state) {
+      auto t0 = clock_type::now();
+      TimerWheel w(1ms, 0ms, t0);
+      std::mt19937 rng(1);
+      for (std::size_t i = 0; i < n; ++i) w.arm(std::chrono::milliseconds(1 + rng() % 10000), [&sum] {++sum;});
+      w.advance(t0 + 10s);
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * n);
+}
+static void BM_heap_arm_fire(benchmark::State& state) {
+  auto n = static_cast<std::size_t>(state.range(0));
+  std::uint64_t sum = 0;
+  using entry = std::pair<std::uint64_t, std::function<void()>>;
+  auto later = [](const entry& a, const entry& b) {return a.first > b.first;};
+  for (auto _ : state) {
+      std::priority_queue<entry, std::vector<entry>, decltype(later)> q(later);
+      std::mt19937 rng(1);
+      for (std::size_t i = 0; i < n; ++i) q.emplace(1 + rng() % 10000, [&sum] {++sum;});
+      while (! q.empty()) {
+          q.top().second();
+          q.pop();
+      }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_wheel_arm_fire)->Arg(100000)->Arg(1000000);
+BENCHMARK(BM_heap_arm_fire)->Arg(100000)->Arg(1000000);
+
+BENCHMARK_MAIN();
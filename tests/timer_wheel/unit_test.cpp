@@ -0,0 +1,211 @@
+/*! \file unit_test.cpp
+ *
+ * \brief
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+#include "timer_wheel.hpp"
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest.h"
+
+using namespace Mult;
+using namespace std::chrono_literals;
+using clock_type = TimerWheel::clock;
+
+TEST_CASE("timer wheel one shot") {
+    auto t0 = clock_type::now();
+    TimerWheel w(1ms, 0ms, t0);
+    std::vector<int> order;
+    auto a = w.arm(5ms, [&] {order.push_back(5);});
+    w.arm(1ms, [&] {order.push_back(1);});
+    w.arm(300ms, [&] {order.push_back(300);});          // level 1
+    w.arm(70000ms, [&] {order.push_back(70000);});      // level 2
+    CHECK(w.size() == 4);
+    CHECK(w.armed(a));
+    CHECK(w.next_deadline() == t0 + 1ms);
+    CHECK(w.advance(t0 + 4ms) == 1);
+    CHECK(order == std::vector<int>{1});
+    CHECK(w.advance(t0 + 5ms) == 1);
+    CHECK(! w.armed(a));
+    CHECK(w.cancel(a) == NO_DATA);                       // already fired
+    CHECK(w.advance(t0 + 299ms) == 0);
+    CHECK(w.advance(t0 + 300ms) == 1);
+    CHECK(w.advance(t0 + 69999ms) == 0);
+    CHECK(w.advance(t0 + 70s) == 1);
+    CHECK(order == std::vector<int>{1, 5, 300, 70000});
+    CHECK(w.size() == 0);
+    CHECK(w.next_deadline() == std::nullopt);
+    CHECK(w.timeout_ms(t0 + 70s) == -1);
+}
+
+TEST_CASE("timer wheel fires every timer at its tick") {
+    auto t0 = clock_type::now();
+    TimerWheel w(1ms, 0ms, t0);
+    std::mt19937_64 rng(3);
+    constexpr int N = 20000;
+    std::vector<std::uint64_t> expect(N), got(N, 0);
+    for (int i = 0; i < N; ++i) {
+        std::uint64_t d = 1 + rng() % (i % 4 == 0 ? (1u << 24) : 5000u); // mix of near and far
+        expect[i] = d;
+        w.arm(std::chrono::milliseconds(d), [&, i] {got[i] = w.now_tick();});
+    }
+    std::uint64_t now = 0;
+    while (w.size()) { // drive like an event loop, jump to the next deadline
+        auto d = w.next_deadline();
+        REQUIRE(d);
+        now = static_cast<std::uint64_t>((*d - t0) / 1ms);
+        w.advance(*d);
+    }
+    int wrong = 0;
+    for (int i = 0; i < N; ++i) wrong += got[i] != expect[i];
+    CHECK(wrong == 0);
+    CHECK(now <= (1u << 24));
+}
+
+TEST_CASE("timer wheel cancel, periodic and reentrancy") {
+    auto t0 = clock_type::now();
+    TimerWheel w(1ms, 0ms, t0);
+    SUBCASE("cancel is O(1) and ids are not reused") {
+        int fired = 0;
+        std::vector<timer_id> ids;
+        for (int i = 0; i < 1000; ++i) ids.push_back(w.arm(std::chrono::milliseconds(10 + i), [&] {++fired;}));
+        for (int i = 0; i < 1000; i += 2) CHECK(w.cancel(ids[i]) == OK);
+        CHECK(w.cancel(ids[0]) == NO_DATA);
+        CHECK(w.size() == 500);
+        auto again = w.arm(1ms, [&] {++fired;}); // reuses a freed node
+        CHECK(again != ids[998]);
+        CHECK(w.cancel(ids[998]) == NO_DATA);
+        CHECK(w.cancel(0) == NO_DATA);
+        w.advance(t0 + 2s);
+        CHECK(fired == 501);
+    }
+    SUBCASE("periodic keeps phase and cancels itself") {
+        std::vector<std::uint64_t> at;
+        timer_id id = 0;
+        id = w.arm_every(10ms, [&] {
+            at.push_back(w.now_tick());
+            if (at.size() == 5) CHECK(w.cancel(id) == OK);
+        });
+        w.advance(t0 + 25ms);
+        w.advance(t0 + 1s);
+        CHECK(at == std::vector<std::uint64_t>{10, 20, 30, 40, 50});
+        CHECK(w.size() == 0);
+        CHECK(! w.armed(id));
+    }
+    SUBCASE("callbacks arm and cancel") {
+        std::vector<int> log;
+        timer_id victim = w.arm(20ms, [&] {log.push_back(-1);});
+        w.arm(10ms, [&] {
+            log.push_back(1);
+            w.cancel(victim);
+            for (int i = 0; i < 100; ++i) w.arm(1ms, [&] {log.push_back(2);}); // grows the slab while firing
+        });
+        w.advance(t0 + 100ms);
+        CHECK(log.size() == 101);
+        CHECK(log.front() == 1);
+        CHECK(w.size() == 0);
+
+        timer_id first = 0, second = 0; // same slot, whichever fires first cancels the other
+        int fired = 0;
+        first = w.arm(5ms, [&] {++fired; CHECK(w.cancel(second) == OK);});
+        second = w.arm(5ms, [&] {++fired; CHECK(w.cancel(first) == OK);});
+        CHECK(w.advance(t0 + 110ms) == 1);
+        CHECK(fired == 1);
+        CHECK(w.size() == 0);
+        CHECK(! w.armed(first));
+        CHECK(! w.armed(second));
+    }
+    SUBCASE("arm_at and past deadlines") {
+        int n = 0;
+        w.advance(t0 + 50ms);
+        w.arm_at(t0 + 10ms, [&] {++n;}); // already past, next tick
+        w.arm(-5ms, [&] {++n;});
+        w.arm_at(t0 + 60ms, [&] {++n;});
+        CHECK(w.advance(t0 + 51ms) == 2);
+        CHECK(w.advance(t0 + 60ms) == 1);
+        CHECK(n == 3);
+    }
+    SUBCASE("beyond 2^32 ticks (overflow list)") {
+        TimerWheel ns(1ns, 0ns, t0);
+        bool fired = false;
+        ns.arm(std::chrono::nanoseconds((1ULL << 33) + 7), [&] {fired = true;});
+        ns.advance(t0 + std::chrono::nanoseconds(1ULL << 33));
+        CHECK(! fired);
+        ns.advance(t0 + std::chrono::nanoseconds((1ULL << 33) + 7));
+        CHECK(fired);
+    }
+}
+
+TEST_CASE("timer wheel slack coalesces") {
+    auto t0 = clock_type::now();
+    TimerWheel w(1ms, 8ms, t0);
+    std::map<std::uint64_t, int> wakeups;
+    for (int d = 1; d <= 64; ++d) w.arm(std::chrono::milliseconds(d), [&] {++wakeups[w.now_tick()];});
+    while (w.size()) w.advance(*w.next_deadline());
+    CHECK(wakeups.size() == 8); // 64 timers, one wake up per 8ms window
+    for (auto& [tick, n] : wakeups) {
+        CHECK(tick % 8 == 0);
+        CHECK(n == 8);
+    }
+}
+
+TEST_CASE("timer wheel slack keeps periodic phase") {
+    auto t0 = clock_type::now();
+    TimerWheel w(1ms, 4ms, t0);
+    std::vector<std::uint64_t> ticks;
+    w.arm_every(5ms, [&] {ticks.push_back(w.now_tick());});
+    for (int ms = 1; ms <= 40; ++ms) w.advance(t0 + std::chrono::milliseconds(ms));
+    CHECK(ticks == std::vector<std::uint64_t>{8, 12, 16, 20, 28, 32, 36, 40}); // nominal 5, 10, 15 ... rounded up to 4
+
+    TimerWheel fast(1ms, 4ms, t0); // period < slack: next due rounds to the tick being fired
+    std::vector<std::uint64_t> fast_ticks;
+    fast.arm_every(1ms, [&] {fast_ticks.push_back(fast.now_tick());});
+    for (int ms = 1; ms <= 12; ++ms) fast.advance(t0 + std::chrono::milliseconds(ms));
+    CHECK(fast_ticks == std::vector<std::uint64_t>{4, 5, 6, 7, 8, 9, 10, 11, 12});
+}
+
+TEST_CASE("timer service") {
+    SUBCASE("timer thread") {
+        TimerService s;
+        std::atomic<int> n {0};
+        auto start = clock_type::now();
+        std::atomic<long long> late {0};
+        s.schedule_after(20ms, [&] {
+            late = std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::now() - start).count();
+            n.fetch_add(1);
+        });
+        auto c = s.schedule_after(10ms, [&] {n.fetch_add(100);});
+        CHECK(s.cancel(c) == OK);
+        auto p = s.schedule_every(5ms, [&] {n.fetch_add(1000);});
+        while (n.load() % 1000 < 1) std::this_thread::sleep_for(1ms);
+        CHECK(late.load() >= 20);
+        CHECK(s.cancel(p) == OK);
+        CHECK(n.load() % 1000 == 1);
+        CHECK(n.load() / 1000 >= 3);
+        CHECK(s.size() == 0);
+    }
+    SUBCASE("delivery onto pool, earlier timer wakes the thread") {
+        ThreadPool pool(2);
+        TimerService s(&pool, 1ms, 2ms);
+        std::atomic<bool> on_pool {false};
+        std::atomic<int> n {0};
+        s.schedule_after(10s, [] {});
+        s.schedule_at(clock_type::now() + 5ms, [&] {
+            on_pool = pool.current_index() != ThreadPool::NOT_WORKER;
+            n.fetch_add(1);
+        });
+        auto t = clock_type::now();
+        while (n.load() == 0 && clock_type::now() - t < 2s) std::this_thread::sleep_for(1ms);
+        CHECK(n.load() == 1);
+        CHECK(on_pool.load());
+        CHECK(clock_type::now() - t < 1s);
+        CHECK(s.size() == 1); // destructor drops it
+    }
+}